@@ -556,7 +556,7 @@ Value pi_tone(vm_t *vm, int argc, Value *argv)
 
         for (int i = 0; i < sample_count; i++)
         {
-            double value = as_number(LIST_AT(list, i));
+            double value = as_number(list_value(list, i));
 
             // clamp to [-1,1]
             if (value > 1.0)
@@ -648,14 +648,14 @@ Value pi_melody(vm_t *vm, int argc, Value *argv)
             vm_error(vm, "[audio] List length must be a multiple of 3 (freq, duration, wave).");
 
         for (int i = 0; i < size; i++)
-            if (!IS_NUM(LIST_AT(list, i)))
+            if (!IS_NUM(list_value(list, i)))
                 vm_error(vm, "[melody] list values must be numbers.");
 
         int total_samples = 0;
         // Calculate total samples for all segments in the melody
         for (int i = 0; i < size; i += 3)
         {
-            int duration = (int)as_number(LIST_AT(list, i + 1));
+            int duration = (int)as_number(list_value(list, i + 1));
             total_samples += (duration * SAMPLE_RATE) / 1000;
         }
 
@@ -668,9 +668,9 @@ Value pi_melody(vm_t *vm, int argc, Value *argv)
         // Generate waveform for each segment in the melody
         for (int i = 0; i < size; i += 3)
         {
-            int frequency = (int)as_number(LIST_AT(list, i));
-            int duration = (int)as_number(LIST_AT(list, i + 1));
-            WaveType wave = (WaveType)(int)as_number(LIST_AT(list, i + 2));
+            int frequency = (int)as_number(list_value(list, i));
+            int duration = (int)as_number(list_value(list, i + 1));
+            WaveType wave = (WaveType)(int)as_number(list_value(list, i + 2));
 
             int sample_count = (duration * SAMPLE_RATE) / 1000;
             sound_params_t params = {
@@ -109,13 +109,16 @@ BuiltinFunc builtin_functions[] = {
     {"play", pi_play},
     {"stop", pi_stop},
     {"pause", pi_pause},
-    {"resume", pi_resume},
     {"is_playing", pi_isPlaying},
     {"channel", pi_channel},
     {"set_loop", pi_setLoop},
 
     // System
     {"fps", pi_fps},
+    {"gc", pi_gc},
+    {"gc_budget", pi_gc_budget},
+    {"gc_threads", pi_gc_threads},
+    {"gc_stats", pi_gc_stats},
     {"error", pi_error},
     {"zen", pi_zen},
     {"cursor", pi_cursor},
@@ -128,6 +131,7 @@ BuiltinFunc builtin_functions[] = {
     {"is_bool", pi_isBool},
     {"is_list", pi_isList},
     {"is_map", pi_isMap},
+    {"is_set", pi_isSet},
     {"as_num", pi_asNum},
     {"as_str", pi_asStr},
     {"as_bool", pi_asBool},
@@ -151,12 +155,32 @@ BuiltinFunc builtin_functions[] = {
     {"len", pi_len},
     {"range", pi_range},
 
+    // Set
+    {"set", pi_set},
+    {"union", pi_union},
+    {"intersect", pi_intersect},
+    {"difference", pi_difference},
+
+    // Priority queue
+    {"pqueue", pi_pqueue},
+    {"pq_update", pi_pqUpdate},
+
     // Functional
     {"map", _pi_map},
     {"filter", pi_filter},
     {"reduce", pi_reduce},
     {"find", pi_find},
 
+    // Iterator
+    {"iter", pi_iter},
+    {"take", pi_take},
+    {"skip", pi_skip},
+    {"collect", pi_collect},
+
+    // Generator
+    {"resume", pi_genResume}, // Sounds too
+    {"is_done", pi_isDone},
+
     // Matrix
     {"size", pi_size},
     {"mult", pi_mult},
@@ -167,6 +191,14 @@ BuiltinFunc builtin_functions[] = {
     {"ones", pi_ones},
     {"is_mat", pi_isMat},
 
+    // Vector
+    {"vadd", pi_vadd},
+    {"vsub", pi_vsub},
+    {"vmul", pi_vmul},
+    {"vdiv", pi_vdiv},
+    {"vscale", pi_vscale},
+    {"vlerp", pi_vlerp},
+
     // Object
     {"clone", pi_clone},
     {"values", pi_values},
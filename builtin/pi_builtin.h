@@ -11,6 +11,11 @@
 #include "pi_col.h"    // Color functions
 #include "pi_fun.h"    // Function functions
 #include "pi_mat.h"    // Matrix functions
+#include "pi_vec.h"    // Vector functions
+#include "pi_set.h"    // Set functions
+#include "pi_heap.h"   // Priority queue functions
+#include "pi_iter.h"   // Iterator functions
+#include "pi_gen.h"    // Generator functions
 #include "pi_type.h"   // Type functions
 #include "pi_obj.h"    // Object functions
 #include "pi_render.h" // 3D rendering functions
@@ -1,39 +1,251 @@
 #include <stdlib.h>
+#include <math.h>
 #include <time.h>
 
 #include "pi_col.h"
 #include "../list.h"
+#include "../gc.h"
+#include "../pi_func.h"
+#include "../pi_set.h"
+#include "../pi_heap.h"
+
+// Lists shorter than this are sorted by insertion instead of by radix
+#define SORT_INSERTION 32
+
+// Radix sort digits: 6 digits of 11 bits cover the 64 bits of a key
+#define RADIX_BITS 11
+#define RADIX_MASK ((1 << RADIX_BITS) - 1)
+#define RADIX_DIGITS 6
+
+/**
+ * @brief Maps a number to an unsigned integer that sorts in the same order.
+ *
+ * Negative numbers have all their bits flipped (larger magnitudes come
+ * first), positive numbers only their sign bit, so that the keys can be
+ * sorted byte by byte.
+ *
+ * @param number The number.
+ * @return The sort key.
+ */
+static inline uint64_t radix_key(double number)
+{
+    uint64_t bits;
+    memcpy(&bits, &number, sizeof(bits));
+    return (bits >> 63) ? ~bits : bits | 0x8000000000000000ULL;
+}
+
+/**
+ * @brief Maps a sort key back to its number (see radix_key).
+ */
+static inline double radix_number(uint64_t key)
+{
+    uint64_t bits = (key >> 63) ? key & ~0x8000000000000000ULL : ~key;
+    double number;
+    memcpy(&number, &bits, sizeof(number));
+    return number;
+}
+
+/**
+ * @brief Sorts keys, and the item indices that go with them, by insertion.
+ */
+static void insertion_sort(uint64_t *keys, int *order, int n)
+{
+    for (int i = 1; i < n; i++)
+    {
+        uint64_t key = keys[i];
+        int index = order ? order[i] : 0;
+        int j = i - 1;
+
+        for (; j >= 0 && keys[j] > key; j--)
+        {
+            keys[j + 1] = keys[j];
+            if (order)
+                order[j + 1] = order[j];
+        }
+
+        keys[j + 1] = key;
+        if (order)
+            order[j + 1] = index;
+    }
+}
+
+/**
+ * @brief Sorts keys with a least-significant-digit radix sort.
+ *
+ * Keys are sorted RADIX_BITS bits at a time, from the lowest digit,
+ * counting every digit of every key in a single pass first. Digits that
+ * are the same in every key (such as the exponent of numbers of the same
+ * magnitude) are skipped. The sort is stable.
+ *
+ * @param keys The keys (see radix_key).
+ * @param order The indices of the items, moved with their keys (may be NULL).
+ * @param n The number of keys.
+ */
+static void radix_sort(uint64_t *keys, int *order, int n)
+{
+    if (n < SORT_INSERTION)
+    {
+        insertion_sort(keys, order, n);
+        return;
+    }
+
+    size_t *counts = calloc((size_t)RADIX_DIGITS << RADIX_BITS, sizeof(size_t));
+
+    for (int i = 0; i < n; i++)
+        for (int d = 0; d < RADIX_DIGITS; d++)
+            counts[((size_t)d << RADIX_BITS) + ((keys[i] >> (RADIX_BITS * d)) & RADIX_MASK)]++;
+
+    uint64_t *src_keys = keys;
+    uint64_t *dst_keys = malloc(sizeof(uint64_t) * n);
+    int *src_order = order;
+    int *dst_order = order ? malloc(sizeof(int) * n) : NULL;
+
+    for (int d = 0; d < RADIX_DIGITS; d++)
+    {
+        size_t *count = counts + ((size_t)d << RADIX_BITS);
+        int shift = RADIX_BITS * d;
+
+        if (count[(src_keys[0] >> shift) & RADIX_MASK] == (size_t)n)
+            continue; // Every key has this digit
+
+        size_t offset = 0;
+        for (int b = 0; b <= RADIX_MASK; b++)
+        {
+            size_t c = count[b];
+            count[b] = offset;
+            offset += c;
+        }
+
+        for (int i = 0; i < n; i++)
+        {
+            size_t j = count[(src_keys[i] >> shift) & RADIX_MASK]++;
+            dst_keys[j] = src_keys[i];
+            if (order)
+                dst_order[j] = src_order[i];
+        }
+
+        uint64_t *swap_keys = src_keys;
+        src_keys = dst_keys;
+        dst_keys = swap_keys;
+
+        int *swap_order = src_order;
+        src_order = dst_order;
+        dst_order = swap_order;
+    }
+
+    // After an odd number of passes the result is in the scratch buffers
+    if (src_keys != keys)
+    {
+        memcpy(keys, src_keys, sizeof(uint64_t) * n);
+        if (order)
+            memcpy(order, src_order, sizeof(int) * n);
+        free(src_keys);
+        free(src_order);
+    }
+    else
+    {
+        free(dst_keys);
+        free(dst_order);
+    }
+
+    free(counts);
+}
+
+// An item sorted by a string key. The first bytes of the key are kept in
+// the record, so most comparisons don't have to follow the string.
+typedef struct
+{
+    uint64_t prefix;   // First 8 bytes of the key, big-endian, zero padded
+    const char *chars; // The key
+    int index;         // Index of the item in the list
+} SortItem;
 
 /**
- * @brief Compares two values and returns a negative, zero, or positive value.
+ * @brief Packs the first 8 bytes of a string into an integer that compares
+ * like the bytes do.
+ */
+static inline uint64_t string_prefix(const char *chars)
+{
+    uint64_t prefix = 0;
+    for (int i = 0; i < 8 && chars[i]; i++)
+        prefix |= (uint64_t)(unsigned char)chars[i] << (56 - 8 * i);
+    return prefix;
+}
+
+/**
+ * @brief Compares the string keys of two items for sorting.
+ */
+static inline int compare_items(const SortItem *a, const SortItem *b, bool reverse)
+{
+    int cmp;
+
+    if (a->prefix != b->prefix)
+        cmp = a->prefix < b->prefix ? -1 : 1;
+    else if ((a->prefix & 0xFF) == 0)
+        cmp = 0; // Both keys end within the prefix
+    else
+        cmp = strcmp(a->chars + 8, b->chars + 8);
+
+    return reverse ? -cmp : cmp;
+}
+
+/**
+ * @brief Sorts items by their string keys with a stable merge sort.
  *
- * This function compares two values and returns a negative value if the first
- * value is less than the second, zero if they are equal, and a positive value if
- * the first value is greater than the second.
+ * Runs of SORT_INSERTION items are sorted by insertion, then merged
+ * bottom-up. Equal keys keep the order of their items.
  *
- * @param a The first value to compare.
- * @param b The second value to compare.
- * @return A negative value if the first value is less than the second, zero if
- *         they are equal, and a positive value if the first value is greater
- *         than the second.
+ * @param items The items.
+ * @param n The number of items.
+ * @param reverse Whether to sort in descending order.
  */
-static int _compare(const void *a, const void *b)
+static void merge_sort(SortItem *items, int n, bool reverse)
 {
-    const Value *va = (const Value *)a;
-    const Value *vb = (const Value *)b;
+    for (int lo = 0; lo < n; lo += SORT_INSERTION)
+    {
+        int hi = lo + SORT_INSERTION < n ? lo + SORT_INSERTION : n;
+        for (int i = lo + 1; i < hi; i++)
+        {
+            SortItem item = items[i];
+            int j = i - 1;
+            for (; j >= lo && compare_items(&items[j], &item, reverse) > 0; j--)
+                items[j + 1] = items[j];
+            items[j + 1] = item;
+        }
+    }
+
+    SortItem *src = items;
+    SortItem *dst = malloc(sizeof(SortItem) * n);
 
-    // Compare two numbers
-    if (IS_NUM(*va) && IS_NUM(*vb))
+    for (int width = SORT_INSERTION; width < n; width *= 2)
     {
-        double diff = AS_NUM(*va) - AS_NUM(*vb);
-        return (diff < 0) ? -1 : (diff > 0);
+        for (int lo = 0; lo < n; lo += 2 * width)
+        {
+            int mid = lo + width < n ? lo + width : n;
+            int hi = lo + 2 * width < n ? lo + 2 * width : n;
+            int i = lo, j = mid, k = lo;
+
+            // Take from the left run on ties, which keeps the sort stable
+            while (i < mid && j < hi)
+                dst[k++] = compare_items(&src[j], &src[i], reverse) < 0 ? src[j++] : src[i++];
+            while (i < mid)
+                dst[k++] = src[i++];
+            while (j < hi)
+                dst[k++] = src[j++];
+        }
+
+        SortItem *swap = src;
+        src = dst;
+        dst = swap;
     }
-    // Compare two strings
-    else if (IS_STRING(*va) && IS_STRING(*vb))
-        return strcmp(AS_CSTRING(*va), AS_CSTRING(*vb));
 
-    // Should not reach here due to earlier type check
-    return 0;
+    if (src != items)
+    {
+        memcpy(items, src, sizeof(SortItem) * n);
+        free(src);
+    }
+    else
+        free(dst);
 }
 
 /**
@@ -42,7 +254,8 @@ static int _compare(const void *a, const void *b)
  * This function takes a list or string as input and removes the last element/character.
  * If the input is a list, the last element is removed and returned.
  * If the input is a string, the last character is removed and returned as a new string.
- * If the input is neither, an error is raised.
+ * If the input is a priority queue, its item with the lowest priority is removed and returned.
+ * If the input is none of these, an error is raised.
  *
  * @param vm The virtual machine instance.
  * @param argc The number of arguments passed to the function.
@@ -58,9 +271,11 @@ Value pi_pop(vm_t *vm, int argc, Value *argv)
 
     if (IS_LIST(arg))
     {
-        list_t *list = AS_CLIST(arg);
+        list_t *list = AS_LIST(arg)->items;
         if (list->size == 0)
             vm_error(vm, "[pop] Cannot pop from an empty list.");
+        if (LIST_PACKED(list))
+            return NEW_NUM(*(double *)list_pop(list));
         return *(Value *)list_pop(list);
     }
     else if (IS_STRING(arg))
@@ -78,10 +293,17 @@ Value pi_pop(vm_t *vm, int argc, Value *argv)
         str->length -= 1;
         str->chars[len - 1] = '\0';
 
-        return NEW_OBJ(new_pistring(strdup(ch)));
+        return NEW_OBJ(new_pistring(string_copy(ch)));
+    }
+    else if (IS_HEAP(arg))
+    {
+        Value value;
+        if (!heap_pop(AS_HEAP(arg), &value, NULL))
+            vm_error(vm, "[pop] Cannot pop from an empty priority queue.");
+        return value;
     }
     else
-        vm_error(vm, "[pop] Argument must be a list or a string.");
+        vm_error(vm, "[pop] Argument must be a list, a string or a priority queue.");
 
     return NEW_NIL();
 }
@@ -92,12 +314,15 @@ Value pi_pop(vm_t *vm, int argc, Value *argv)
  * This function takes a list or string as the first argument and appends additional
  * elements/characters to it. If the first argument is a list, all subsequent arguments
  * are appended as elements. If it's a string, each argument must be a string of length 1,
- * which will be appended as characters. If the first argument is neither, an error is raised.
+ * which will be appended as characters. If it's a set, the arguments not already in the
+ * set are added to it. If it's a priority queue, the arguments are a value and its priority,
+ * and a handle to the queued value is returned (see pq_update). If the first argument is
+ * none of these, an error is raised.
  *
  * @param vm The virtual machine instance.
  * @param argc The number of arguments passed to the function.
  * @param argv The arguments provided to the function.
- * @return The new length of the list or string after pushing.
+ * @return The new length of the list, string or set after pushing.
  */
 Value pi_push(vm_t *vm, int argc, Value *argv)
 {
@@ -108,11 +333,14 @@ Value pi_push(vm_t *vm, int argc, Value *argv)
 
     if (IS_LIST(target))
     {
-        list_t *list = AS_CLIST(target);
+        PiList *list = AS_LIST(target);
         for (int i = 1; i < argc; i++)
-            list_add(list, &argv[i]);
+        {
+            list_push(list, argv[i]);
+            write_barrier(vm, AS_OBJ(target), argv[i]);
+        }
 
-        return NEW_NUM(list->size);
+        return NEW_NUM(list->items->size);
     }
     else if (IS_STRING(target))
     {
@@ -137,8 +365,26 @@ Value pi_push(vm_t *vm, int argc, Value *argv)
 
         return NEW_NUM(str->length);
     }
+    else if (IS_SET(target))
+    {
+        PiSet *set = AS_SET(target);
+        for (int i = 1; i < argc; i++)
+            if (set_add(set, argv[i]))
+                write_barrier(vm, AS_OBJ(target), argv[i]);
+
+        return NEW_NUM(set->size);
+    }
+    else if (IS_HEAP(target))
+    {
+        if (argc != 3 || !IS_NUM(argv[2]) || isnan(AS_NUM(argv[2])))
+            vm_error(vm, "[push] expects a priority queue, a value and a numeric priority.");
+
+        int handle = heap_push(AS_HEAP(target), argv[1], AS_NUM(argv[2]));
+        write_barrier(vm, AS_OBJ(target), argv[1]);
+        return NEW_NUM(handle);
+    }
     else
-        vm_error(vm, "[push] First argument must be a list or a string.");
+        vm_error(vm, "[push] First argument must be a list, a string, a set or a priority queue.");
 
     return NEW_NIL();
 }
@@ -165,10 +411,10 @@ Value pi_peek(vm_t *vm, int argc, Value *argv)
 
     if (IS_LIST(arg))
     {
-        list_t *list = AS_CLIST(arg);
+        list_t *list = AS_LIST(arg)->items;
         if (list->size == 0)
             vm_error(vm, "[peek] Cannot peek from an empty list.");
-        return *(Value *)list_getAt(list, list->size - 1);
+        return list_value(list, list->size - 1);
     }
     else if (IS_STRING(arg))
     {
@@ -179,19 +425,27 @@ Value pi_peek(vm_t *vm, int argc, Value *argv)
 
         // Return the last character as a one-character string
         char ch[2] = {str->chars[len - 1], '\0'};
-        return NEW_OBJ(new_pistring(strdup(ch)));
+        return NEW_OBJ(new_pistring(string_copy(ch)));
+    }
+    else if (IS_HEAP(arg))
+    {
+        // The item that pop would return
+        Value value;
+        if (!heap_peek(AS_HEAP(arg), &value, NULL))
+            vm_error(vm, "[peek] Cannot peek from an empty priority queue.");
+        return value;
     }
     else
-        vm_error(vm, "[peek] Argument must be a list or a string.");
+        vm_error(vm, "[peek] Argument must be a list, a string or a priority queue.");
 
     return NEW_NIL();
 }
 
 /**
- * @brief Checks if a list, string, or map is empty.
+ * @brief Checks if a list, string, map or set is empty.
  *
- * This function takes one argument and returns true if the list, string, or map is empty,
- * false otherwise. If the input is not a list, string, or map, an error is raised.
+ * This function takes one argument and returns true if the list, string, map or set is
+ * empty, false otherwise. If the input is none of these, an error is raised.
  *
  * @param vm The virtual machine instance.
  * @param argc The number of arguments passed to the function.
@@ -207,7 +461,7 @@ Value pi_empty(vm_t *vm, int argc, Value *argv)
 
     if (IS_LIST(arg))
     {
-        list_t *list = AS_CLIST(arg);
+        list_t *list = AS_LIST(arg)->items;
         return NEW_BOOL(list->size == 0);
     }
     else if (IS_STRING(arg))
@@ -218,58 +472,160 @@ Value pi_empty(vm_t *vm, int argc, Value *argv)
     else if (IS_MAP(arg))
     {
         PiMap *map = AS_MAP(arg);
-        return NEW_BOOL(map->table->size == 0);
+        return NEW_BOOL(map_size(map) == 0);
     }
+    else if (IS_SET(arg))
+        return NEW_BOOL(AS_SET(arg)->size == 0);
+    else if (IS_HEAP(arg))
+        return NEW_BOOL(AS_HEAP(arg)->size == 0);
     else
-        vm_error(vm, "[empty] Argument must be a list, string, or map.");
+        vm_error(vm, "[empty] Argument must be a list, string, map, set or priority queue.");
 
     return NEW_NIL();
 }
 
 /**
- * @brief Sorts a list in-place in ascending order.
+ * @brief Sorts a list in-place.
+ *
+ * Accepts sort(list, key?, reverse?). Items are ordered by their key, the
+ * result of the key function for each item (called once per item), or the
+ * item itself. Keys must be all numbers or all strings. The sort is stable:
+ * items with equal keys keep their order, also when reversed.
  *
- * This function takes one argument: a list. It sorts the list in-place using the default
- * comparison for supported types (numbers and strings). All elements must be of the same
- * type and either all numbers or all strings. Mixed types or unsupported types will raise an error.
+ * Numeric keys are sorted with a radix sort on their bits, string keys with
+ * a merge sort comparing their first bytes inline.
  *
  * @param vm The virtual machine instance.
  * @param argc The number of arguments passed to the function.
- * @param argv The arguments provided to the function.
- * @return nil
+ * @param argv The arguments: the list, a key function or nil, and whether
+ *             to sort in descending order.
+ * @return The sorted list.
  */
 Value pi_sort(vm_t *vm, int argc, Value *argv)
 {
     if (argc == 0)
         vm_error(vm, "[sort] expects one argument.");
 
-    Value arg = argv[0];
-
-    if (!IS_LIST(arg))
+    if (!IS_LIST(argv[0]))
         vm_error(vm, "[sort] Argument must be a list.");
 
-    list_t *list = AS_CLIST(arg);
+    Function *key = NULL;
+    if (argc > 1 && !IS_NIL(argv[1]))
+    {
+        if (!IS_FUN(argv[1]))
+            vm_error(vm, "[sort] key must be a function or nil.");
+        key = AS_FUN(argv[1]);
+    }
 
-    if (list->size <= 1)
-        return NEW_NIL(); // Nothing to sort
+    bool reverse = argc > 2 && as_bool(argv[2]);
+    uint64_t flip = reverse ? ~0ULL : 0; // Reverses the order of numeric keys
 
-    Value first = (*(Value *)list_getAt(list, 0));
+    list_t *items = AS_LIST(argv[0])->items;
+    int n = items->size;
 
-    if (!IS_STRING(first) && !IS_NUM(first))
-        vm_error(vm, "[sort] List elements must all be numbers or strings.");
+    if (n <= 1)
+        return argv[0]; // Nothing to sort
 
-    for (int i = 1; i < list->size; i++)
+    // Numbers sorted by themselves: sort the packed items directly
+    if (!key && LIST_PACKED(items))
     {
-        Value item = (*(Value *)list_getAt(list, i));
-        if (item.type != first.type)
-            vm_error(vm, "[sort] List elements must all be of the same type.");
+        if (items->share)
+            list_unshare(items);
+
+        double *numbers = (double *)items->data;
+        uint64_t *keys = malloc(sizeof(uint64_t) * n);
+        for (int i = 0; i < n; i++)
+            keys[i] = radix_key(numbers[i]) ^ flip;
+
+        radix_sort(keys, NULL, n);
+
+        for (int i = 0; i < n; i++)
+            numbers[i] = radix_number(keys[i] ^ flip);
+
+        free(keys);
+        return argv[0];
     }
 
-    // Comparator for qsort
+    // Compute the key of every item once. The keys and the list are kept
+    // on the stack, where the collector sees them while the key function runs.
+    if (vm->sp + 2 > STACK_MAX)
+        vm_error(vm, "Stack overflow: Attempted to push onto a full stack");
 
-    qsort(list->data, list->size, sizeof(Value), _compare);
+    list_t *key_items = list_create(sizeof(Value));
+    if (n > key_items->capacity)
+        list_expand(key_items, n);
 
-    return NEW_NIL();
+    Object *key_list = add_obj(vm, new_list(key_items));
+    vm->stack[vm->sp++] = argv[0];
+    vm->stack[vm->sp++] = NEW_OBJ(key_list);
+
+    for (int i = 0; i < n; i++)
+    {
+        // A key function that shrinks the list would leave stale slots past its end
+        if (items->size != n)
+            vm_error(vm, "[sort] The list was modified by the key function.");
+
+        Value item = list_value(items, i);
+        Value k = key ? call_func(vm, key, 1, &item) : item;
+        list_add(key_items, &k);
+        write_barrier(vm, key_list, k);
+    }
+
+    if (items->size != n)
+        vm_error(vm, "[sort] The list was modified by the key function.");
+
+    Value *keys = (Value *)key_items->data;
+    bool numeric = IS_NUM(keys[0]);
+
+    for (int i = 0; i < n; i++)
+        if (numeric ? !IS_NUM(keys[i]) : !IS_STRING(keys[i]))
+            vm_error(vm, IS_NUM(keys[i]) || IS_STRING(keys[i])
+                             ? "[sort] List elements must all be of the same type."
+                             : "[sort] List elements must all be numbers or strings.");
+
+    int *order = malloc(sizeof(int) * n);
+    for (int i = 0; i < n; i++)
+        order[i] = i;
+
+    if (numeric)
+    {
+        uint64_t *bits = malloc(sizeof(uint64_t) * n);
+        for (int i = 0; i < n; i++)
+            bits[i] = radix_key(AS_NUM(keys[i])) ^ flip;
+
+        radix_sort(bits, order, n);
+        free(bits);
+    }
+    else
+    {
+        SortItem *sorted = malloc(sizeof(SortItem) * n);
+        for (int i = 0; i < n; i++)
+            sorted[i] = (SortItem){string_prefix(AS_CSTRING(keys[i])), AS_CSTRING(keys[i]), i};
+
+        merge_sort(sorted, n, reverse);
+
+        for (int i = 0; i < n; i++)
+            order[i] = sorted[i].index;
+        free(sorted);
+    }
+
+    // Move the items to their sorted positions
+    if (items->share)
+        list_unshare(items);
+
+    int size = items->i_size;
+    byte *data = (byte *)items->data;
+    byte *sorted = malloc((size_t)size * n);
+
+    for (int i = 0; i < n; i++)
+        memcpy(sorted + (size_t)i * size, data + (size_t)order[i] * size, size);
+    memcpy(data, sorted, (size_t)size * n);
+
+    free(sorted);
+    free(order);
+
+    vm->sp -= 2;
+    return argv[0];
 }
 
 /**
@@ -301,6 +657,7 @@ Value pi_insert(vm_t *vm, int argc, Value *argv)
             vm_error(vm, "[insert] Index out of bounds for list.");
 
         list_addAt(list, index, &value);
+        write_barrier(vm, AS_OBJ(collection), value);
         return collection;
     }
     else if (IS_STRING(collection))
@@ -343,6 +700,8 @@ Value pi_insert(vm_t *vm, int argc, Value *argv)
  *
  * For lists: returns the removed element.
  * For strings: returns the removed character as a new string.
+ * For sets: the second argument is the item to remove (not an index),
+ * returns whether it was in the set.
  *
  * @param vm The virtual machine instance.
  * @param argc Number of arguments passed (must be 2).
@@ -357,13 +716,22 @@ Value pi_remove(vm_t *vm, int argc, Value *argv)
     Value collection = argv[0];
     Value _index = argv[1];
 
+    if (IS_SET(collection))
+        return NEW_BOOL(set_remove(AS_SET(collection), _index));
+
     int index = as_number(_index);
 
     // Handle list removal
     if (IS_LIST(collection))
     {
-        list_t *list = AS_CLIST(collection);
-        return *(Value *)list_remove(list, index); // Assumes list_removeAt returns a pointer to Value
+        list_t *list = AS_LIST(collection)->items;
+        if (list->size == 0)
+            vm_error(vm, "[remove] Cannot remove from an empty list.");
+
+        // Read first, so packed lists stay packed
+        Value removed = list_value(list, index);
+        free(list_remove(list, index));
+        return removed;
     }
 
     // Handle string character removal
@@ -378,7 +746,7 @@ Value pi_remove(vm_t *vm, int argc, Value *argv)
 
         // Create a new string with the character
         char ch[2] = {removed, '\0'};
-        Value removed_val = NEW_OBJ(new_pistring(strdup(ch)));
+        Value removed_val = NEW_OBJ(new_pistring(string_copy(ch)));
 
         // Shift string content left to remove character
         memmove(&str->chars[index], &str->chars[index + 1], str->length - index);
@@ -388,7 +756,7 @@ Value pi_remove(vm_t *vm, int argc, Value *argv)
         return removed_val;
     }
 
-    vm_error(vm, "[remove] First argument must be a list or string.");
+    vm_error(vm, "[remove] First argument must be a list, string or set.");
 
     return NEW_NIL();
 }
@@ -413,13 +781,22 @@ Value pi_unshift(vm_t *vm, int argc, Value *argv)
 
     if (IS_LIST(target))
     {
-        list_t *list = AS_CLIST(target);
+        PiList *list = AS_LIST(target);
 
-        // Shift items right and insert in reverse order to maintain input order
+        // Prepend each item at index 0, in O(1) amortised (see list_addFirst)
         for (int i = 1; i < argc; i++)
-            list_addFirst(list, &argv[i]); // Prepend each item at index 0
+        {
+            if (LIST_PACKED(list->items) && IS_NUM(argv[i]))
+                list_addFirst(list->items, &AS_NUM(argv[i]));
+            else
+            {
+                list->is_numeric = false;
+                list_addFirst(list_values(list), &argv[i]);
+            }
+            write_barrier(vm, AS_OBJ(target), argv[i]);
+        }
 
-        return NEW_NUM(list->size);
+        return NEW_NUM(list->items->size);
     }
     else if (IS_STRING(target))
     {
@@ -486,7 +863,10 @@ Value pi_append(vm_t *vm, int argc, Value *argv)
         list_t *list = AS_CLIST(target);
 
         for (int i = 1; i < argc; i++)
+        {
             list_add(list, &argv[i]); // Append each value to the end
+            write_barrier(vm, AS_OBJ(target), argv[i]);
+        }
 
         return NEW_NUM(list->size);
     }
@@ -536,6 +916,7 @@ Value pi_append(vm_t *vm, int argc, Value *argv)
  * For lists, checks if the value is present.
  * For strings, checks if the value is a substring.
  * For maps, checks if the value is a key.
+ * For sets, checks if the value is an item, without scanning the set.
  *
  * @param vm The virtual machine instance.
  * @param argc Number of arguments.
@@ -555,7 +936,7 @@ Value pi_contains(vm_t *vm, int argc, Value *argv)
         PiList *list = AS_LIST(collection);
         for (int i = 0; i < list->items->size; i++)
         {
-            Value item = *(Value *)list_getAt(list->items, i);
+            Value item = list_value(list->items, i);
             if (equals(item, target))
                 return NEW_BOOL(true);
         }
@@ -582,8 +963,10 @@ Value pi_contains(vm_t *vm, int argc, Value *argv)
         PiMap *map = AS_MAP(collection);
         return NEW_BOOL(map_has(map, target));
     }
+    else if (IS_SET(collection))
+        return NEW_BOOL(set_has(AS_SET(collection), target));
     else
-        vm_error(vm, "[contains] First argument must be a list, string, or map.");
+        vm_error(vm, "[contains] First argument must be a list, string, map or set.");
 
     return NEW_BOOL(false);
 }
@@ -611,7 +994,7 @@ Value pi_indexOf(vm_t *vm, int argc, Value *argv)
         PiList *list = AS_LIST(collection);
         for (int i = 0; i < list->items->size; i++)
         {
-            Value item = *(Value *)list_getAt(list->items, i);
+            Value item = list_value(list->items, i);
             if (equals(item, target))
                 return NEW_NUM(i);
         }
@@ -654,9 +1037,18 @@ Value pi_reverse(vm_t *vm, int argc, Value *argv)
 
     if (IS_LIST(input))
     {
-        list_t *list = AS_CLIST(input);
+        list_t *list = AS_LIST(input)->items;
         int size = list->size;
 
+        if (LIST_PACKED(list))
+        {
+            // Numbers need no deep copy: add the packed items backwards
+            list_t *copy = list_create(sizeof(double));
+            for (int i = size - 1; i >= 0; i--)
+                list_add(copy, list_getAt(list, i));
+            return NEW_OBJ(new_list(copy));
+        }
+
         list_t *copy = list_copy(list);
         for (int i = 0; i < size / 2; i++)
         {
@@ -716,6 +1108,22 @@ Value pi_shuffle(vm_t *vm, int argc, Value *argv)
         seeded = true;
     }
 
+    if (list->items->share)
+        list_unshare(list->items);
+
+    if (LIST_PACKED(list->items))
+    {
+        double *items = (double *)list->items->data;
+        for (int i = size - 1; i > 0; i--)
+        {
+            int j = rand() % (i + 1);
+            double tmp = items[i];
+            items[i] = items[j];
+            items[j] = tmp;
+        }
+        return argv[0];
+    }
+
     for (int i = size - 1; i > 0; i--)
     {
         int j = rand() % (i + 1);
@@ -730,7 +1138,11 @@ Value pi_shuffle(vm_t *vm, int argc, Value *argv)
 }
 
 /**
- * @brief Returns a deep copy of a list or a string.
+ * @brief Returns a copy of a list, a string or a set.
+ *
+ * A list copy is shallow and copy-on-write: it shares the original's
+ * items (through list_view) until either list is modified, and nested
+ * lists or maps are shared, not copied.
  *
  * @param vm The virtual machine instance.
  * @param argc Number of arguments (should be 1).
@@ -747,18 +1159,13 @@ Value pi_copy(vm_t *vm, int argc, Value *argv)
     if (IS_STRING(input))
     {
         PiString *str = AS_STRING(input);
-        return NEW_OBJ(new_pistring(strdup(str->chars)));
+        return NEW_OBJ(new_pistring(string_copy(str->chars)));
     }
     else if (IS_LIST(input))
     {
         PiList *orig = AS_LIST(input);
-        list_t *copied_items = list_create(sizeof(Value));
-
-        for (int i = 0; i < orig->items->size; i++)
-        {
-            Value *item = (Value *)list_getAt(orig->items, i);
-            list_add(copied_items, item); // shallow copy of elements
-        }
+        // Shallow copy sharing the items until either list is modified
+        list_t *copied_items = list_view(orig->items, 0, orig->items->size);
 
         PiList *result = (PiList *)new_list(copied_items);
         result->is_numeric = orig->is_numeric;
@@ -766,8 +1173,10 @@ Value pi_copy(vm_t *vm, int argc, Value *argv)
 
         return NEW_OBJ(result);
     }
+    else if (IS_SET(input))
+        return NEW_OBJ(set_copy(AS_SET(input)));
 
-    vm_error(vm, "[copy] only works with lists or strings.");
+    vm_error(vm, "[copy] only works with lists, strings or sets.");
     return NEW_NIL();
 }
 
@@ -797,12 +1206,8 @@ Value pi_slice(vm_t *vm, int argc, Value *argv)
     {
         PiList *list = AS_LIST(collection);
 
-        list_t *sliced_items = list_create(sizeof(Value));
-        for (int i = start_index; i <= end_index; i++)
-        {
-            Value *item = (Value *)list_getAt(list->items, i);
-            list_add(sliced_items, item);
-        }
+        // Shares the items of the list until either is modified
+        list_t *sliced_items = list_view(list->items, start_index, end_index - start_index + 1);
 
         PiList *result = (PiList *)new_list(sliced_items);
         result->is_numeric = list->is_numeric;
@@ -836,11 +1241,15 @@ Value pi_len(vm_t *vm, int argc, Value *argv)
     switch (OBJ_TYPE(argv[0]))
     {
     case OBJ_LIST:
-        return NEW_NUM(AS_CLIST(argv[0])->size);
+        return NEW_NUM(PILIST_SIZE(argv[0]));
     case OBJ_STRING:
         return NEW_NUM(AS_STRING(argv[0])->length);
     case OBJ_MAP:
-        return NEW_NUM(AS_CMAP(argv[0])->size);
+        return NEW_NUM(map_size(AS_MAP(argv[0])));
+    case OBJ_SET:
+        return NEW_NUM(AS_SET(argv[0])->size);
+    case OBJ_HEAP:
+        return NEW_NUM(AS_HEAP(argv[0])->size);
     default:
         return NEW_NIL();
     }
@@ -15,7 +15,7 @@ Value pi_peek(vm_t *vm, int argc, Value *argv);
 // Checks if a list, string, or map is empty.
 Value pi_empty(vm_t *vm, int argc, Value *argv);
 
-// Sorts the elements of a list in ascending order.
+// Sorts a list in place (stable), optionally by a key function and in reverse.
 Value pi_sort(vm_t *vm, int argc, Value *argv);
 
 // Inserts a value at a specified index in a list or string.
@@ -1,12 +1,16 @@
 #include "pi_fun.h"
 #include "../pi_func.h"
 #include "../list.h"
+#include "../pi_iter.h"
+#include "../gc.h"
 
 /**
  * @brief Maps a function to every item in a list.
  *
  * This function takes two arguments: a function and a list. It applies the
  * function to each item in the list and returns a new list with the results.
+ * Given an iterator instead of a list, it returns a new iterator with a map
+ * stage, and the function is only called when the iterator runs.
  *
  * @param vm The virtual machine instance.
  * @param argc The number of arguments passed to the function.
@@ -15,45 +19,52 @@
  */
 Value _pi_map(vm_t *vm, int argc, Value *argv)
 {
+    if (argc == 2 && IS_ITER(argv[0]) && IS_FUN(argv[1]))
+        return NEW_OBJ(iter_extend(AS_ITER(argv[0]), STAGE_MAP, argv[1], 0));
+
     if (argc != 2 || !IS_LIST(argv[0]) || !IS_FUN(argv[1]))
         vm_error(vm,"map(fn, list): expects a function and a list");
 
     PiList *input = AS_LIST(argv[0]);
     Function *fn = AS_FUN(argv[1]);
-    list_t *list = list_create(sizeof(Value));
-
     int size = input->items->size;
-    for (int i = 0; i < size; i++)
-    {
-        Value *item = (Value *)list_getAt(input->items, i);
-        Value ret_val = call_func(vm, fn, 1, item);
-        list_add(list, &ret_val);
-    }
 
-    PiList *result = (PiList *)new_list(list);
-    result->is_numeric = false;
-    result->is_matrix = false;
+    // The result starts packed and is unpacked by the first result that is
+    // not a number, so it is never scanned again to pack it
+    list_t *list = list_create(sizeof(double));
+    if (size > list->capacity)
+        list_expand(list, size);
+
+    Object *result = add_obj(vm, new_list(list));
+    ((PiList *)result)->is_matrix = false;
 
-    // Update numeric flag if all values are numbers
-    result->is_numeric = true;
+    // The input, the function and the result are kept on the stack, where
+    // the collector sees them while the function runs
+    if (vm->sp + 3 > STACK_MAX)
+        vm_error(vm, "Stack overflow: Attempted to push onto a full stack");
 
-    size = result->items->size;
-    for (int i = 0; i < size; i++)
+    vm->stack[vm->sp++] = argv[0];
+    vm->stack[vm->sp++] = argv[1];
+    vm->stack[vm->sp++] = NEW_OBJ(result);
+
+    for (int i = 0; i < size && i < input->items->size; i++)
     {
-        Value item = *(Value *)list_getAt(result->items, i);
-        if (!IS_NUM(item))
-        {
-            result->is_numeric = false;
-            break;
-        }
+        Value item = list_value(input->items, i);
+        Value ret_val = call_func(vm, fn, 1, &item);
+        list_push((PiList *)result, ret_val);
+        write_barrier(vm, result, ret_val);
     }
 
+    vm->sp -= 3;
     return NEW_OBJ(result);
 }
 
 /**
  * @brief Returns a new list containing the items for which the callback function returns true.
  *
+ * Given an iterator instead of a list, returns a new iterator with a filter
+ * stage, and the callback is only called when the iterator runs.
+ *
  * @param vm The virtual machine instance.
  * @param argc Number of arguments (should be 2).
  * @param argv Arguments: [callback, list]
@@ -61,6 +72,9 @@ Value _pi_map(vm_t *vm, int argc, Value *argv)
  */
 Value pi_filter(vm_t *vm, int argc, Value *argv)
 {
+    if (argc == 2 && IS_ITER(argv[0]) && IS_FUN(argv[1]))
+        return NEW_OBJ(iter_extend(AS_ITER(argv[0]), STAGE_FILTER, argv[1], 0));
+
     if (argc != 2 || !IS_LIST(argv[0]) || !IS_FUN(argv[1]))
         vm_error(vm,"filter(fn, list): expects a function and a list");
 
@@ -68,28 +82,74 @@ Value pi_filter(vm_t *vm, int argc, Value *argv)
     Function *fn = AS_FUN(argv[1]);
     list_t *list = list_create(sizeof(Value));
 
+    // The kept items belong to the input, which is kept on the stack with
+    // the callback while the callback runs
+    if (vm->sp + 2 > STACK_MAX)
+        vm_error(vm, "Stack overflow: Attempted to push onto a full stack");
+
+    vm->stack[vm->sp++] = argv[0];
+    vm->stack[vm->sp++] = argv[1];
+
     int size = input->items->size;
-    for (int i = 0; i < size; i++)
+    for (int i = 0; i < size && i < input->items->size; i++)
     {
-        Value *item = (Value *)list_getAt(input->items, i);
-        Value ret_val = call_func(vm, fn, 1, item);
+        Value item = list_value(input->items, i);
+        Value ret_val = call_func(vm, fn, 1, &item);
         if (as_bool(ret_val))
-            list_add(list, item);
+            list_add(list, &item);
     }
 
+    vm->sp -= 2;
+
     PiList *result = (PiList *)new_list(list);
-    result->is_numeric = input->is_numeric;
+    if (input->is_numeric)
+        list_pack(result);
     result->is_matrix = false; // filtering may disrupt matrix structure
 
     return NEW_OBJ(result);
 }
 
+/**
+ * Reduces the items of an iterator, pulling them one at a time.
+ *
+ * @param vm The virtual machine instance.
+ * @param iter The iterator.
+ * @param fn The reducing function.
+ * @param initial The initial value, or NULL to start from the first item.
+ * @return The accumulated value, nil for an empty iterator with no initial value.
+ */
+static Value reduce_iter(vm_t *vm, PiIter *iter, Function *fn, Value *initial)
+{
+    // The iterator, the function and the accumulator are kept on the
+    // stack, where the collector sees them while the functions run
+    if (vm->sp + 3 > STACK_MAX)
+        vm_error(vm, "Stack overflow: Attempted to push onto a full stack");
+
+    vm->stack[vm->sp++] = NEW_OBJ(iter);
+    vm->stack[vm->sp++] = NEW_OBJ(fn);
+    Value *acc = &vm->stack[vm->sp++];
+
+    Value item;
+    iter_rewind(iter);
+    if (initial)
+        *acc = *initial;
+    else if (!iter_pull(vm, iter, acc))
+        *acc = NEW_NIL();
+
+    while (iter_pull(vm, iter, &item))
+        *acc = call_funcv(vm, fn, 2, *acc, item);
+
+    vm->sp -= 3;
+    return *acc;
+}
+
 /**
  * @brief Applies a function against an accumulator and each value of the list (from left to right) to reduce it to a single value.
  *
  * This function takes a list, a function, and an optional initial value. It applies the function to an accumulator and
  * each element of the list in turn, reducing the list to a single accumulated value. If an initial value is provided,
  * it is used as the starting value of the accumulator. Otherwise, the first element of the list is used.
+ * An iterator can be reduced as well: it is run once, without collecting its items.
  *
  * @param vm The virtual machine instance.
  * @param argc Number of arguments (should be 2 or 3).
@@ -99,22 +159,37 @@ Value pi_filter(vm_t *vm, int argc, Value *argv)
 
 Value pi_reduce(vm_t *vm, int argc, Value *argv)
 {
+    if (argc >= 2 && IS_ITER(argv[0]) && IS_FUN(argv[1]))
+        return reduce_iter(vm, AS_ITER(argv[0]), AS_FUN(argv[1]), argc == 3 ? &argv[2] : NULL);
+
     if (argc < 2 || !IS_LIST(argv[0]) || !IS_FUN(argv[1]))
         vm_error(vm,"reduce(fn, list, [initial]): expects a function, a list, and optional initial value");
 
     PiList *input = AS_LIST(argv[0]);
-    Function *fn = AS_FUN(argv[1]);    
-    Value acc = (argc == 3) ? argv[2] : *(Value *)list_getAt(input->items, 0);
+    Function *fn = AS_FUN(argv[1]);
     int start = (argc == 3) ? 0 : 1;
 
-    int size = input->items->size;
-    for (int i = start; i < size; i++)
+    if (argc != 3 && input->items->size == 0)
+        return NEW_NIL();
+
+    // The list, the function and the accumulator are kept on the stack,
+    // where the collector sees them while the function runs
+    if (vm->sp + 3 > STACK_MAX)
+        vm_error(vm, "Stack overflow: Attempted to push onto a full stack");
+
+    vm->stack[vm->sp++] = argv[0];
+    vm->stack[vm->sp++] = argv[1];
+    Value *acc = &vm->stack[vm->sp++];
+    *acc = (argc == 3) ? argv[2] : list_value(input->items, 0);
+
+    for (int i = start; i < input->items->size; i++)
     {
-        Value item = *(Value *)list_getAt(input->items, i);
-        acc = call_funcv(vm, fn, 2, acc, item);
+        Value item = list_value(input->items, i);
+        *acc = call_funcv(vm, fn, 2, *acc, item);
     }
 
-    return acc;
+    vm->sp -= 3;
+    return *acc;
 }
 
 /**
@@ -141,8 +216,8 @@ Value pi_find(vm_t *vm, int argc, Value *argv)
         PiList *list = AS_LIST(collection);
         for (int i = 0; i < list->items->size; i++)
         {
-            Value *item = (Value *)list_getAt(list->items, i);
-            Value result = call_func(vm, fn, 1, item);
+            Value item = list_value(list->items, i);
+            Value result = call_func(vm, fn, 1, &item);
             if (as_bool(result))
                 return NEW_NUM(i);
         }
@@ -154,7 +229,7 @@ Value pi_find(vm_t *vm, int argc, Value *argv)
         for (int i = 0; i < str->length; i++)
         {
             ch[0] = str->chars[i];
-            Value arg = NEW_OBJ(new_pistring(strdup(ch)));
+            Value arg = NEW_OBJ(new_pistring(string_copy(ch)));
             Value result = call_func(vm, fn, 1, &arg);
             if (as_bool(result))
                 return NEW_NUM(i);
@@ -0,0 +1,46 @@
+#include "pi_gen.h"
+#include "pi_audio.h"
+#include "../pi_gen.h"
+
+/**
+ * @brief Runs a generator until its next yield.
+ *
+ * A generator is created by calling a function that contains `yield`; its
+ * body starts on the first resume and stops at each yield, keeping its
+ * variables until the next resume. This spreads work over several frames:
+ * resume one step of a state machine or of a long computation per draw().
+ * Sounds are resumed as well (see pi_audio.c).
+ *
+ * @param vm The virtual machine instance.
+ * @param argc The number of arguments (1).
+ * @param argv The arguments: the generator.
+ * @return The yielded value, or the returned one once the generator is done.
+ */
+Value pi_genResume(vm_t *vm, int argc, Value *argv)
+{
+    if (argc == 1 && IS_OBJ_TYPE(argv[0], OBJ_SOUND))
+        return pi_resume(vm, argc, argv);
+
+    if (argc != 1 || !IS_GEN(argv[0]))
+        vm_error(vm, "[resume] expects a generator or a sound.");
+
+    Value value;
+    gen_resume(vm, AS_GEN(argv[0]), &value);
+    return value;
+}
+
+/**
+ * @brief Checks if a generator has finished its body.
+ *
+ * @param vm The virtual machine instance.
+ * @param argc The number of arguments (1).
+ * @param argv The arguments: the generator.
+ * @return true once the body has returned.
+ */
+Value pi_isDone(vm_t *vm, int argc, Value *argv)
+{
+    if (argc != 1 || !IS_GEN(argv[0]))
+        vm_error(vm, "[is_done] expects a generator.");
+
+    return NEW_BOOL(AS_GEN(argv[0])->state == GEN_DONE);
+}
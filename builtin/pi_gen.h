@@ -0,0 +1,10 @@
+#ifndef PI_GEN_BUILTIN_H
+#define PI_GEN_BUILTIN_H
+
+#include "../pi_value.h"
+#include "../pi_vm.h"
+
+Value pi_genResume(vm_t *vm, int argc, Value *argv);
+Value pi_isDone(vm_t *vm, int argc, Value *argv);
+
+#endif // PI_GEN_BUILTIN_H
@@ -0,0 +1,44 @@
+#include <math.h>
+
+#include "pi_heap.h"
+#include "../pi_heap.h"
+
+/**
+ * @brief Creates an empty priority queue.
+ *
+ * Items are added with push(q, value, priority) and removed with pop(q),
+ * lowest priority first; peek, len, # and empty work as for lists.
+ *
+ * @param vm The virtual machine instance.
+ * @param argc The number of arguments (none).
+ * @param argv The arguments.
+ * @return A new priority queue.
+ */
+Value pi_pqueue(vm_t *vm, int argc, Value *argv)
+{
+    return NEW_OBJ(new_heap());
+}
+
+/**
+ * @brief Changes the priority of a queued item.
+ *
+ * Accepts pq_update(q, handle, priority), where handle is the number
+ * returned by push when the item was queued. The item moves up or down
+ * the queue in O(log n), which is what decrease-key in Dijkstra or A*
+ * needs.
+ *
+ * @param vm The virtual machine instance.
+ * @param argc The number of arguments.
+ * @param argv The arguments: the queue, the handle and the new priority.
+ * @return false if the item was already popped, true otherwise.
+ */
+Value pi_pqUpdate(vm_t *vm, int argc, Value *argv)
+{
+    if (argc != 3 || !IS_HEAP(argv[0]) || !IS_NUM(argv[1]) || !IS_NUM(argv[2]))
+        vm_error(vm, "[pq_update] expects a priority queue, a handle and a priority.");
+
+    if (isnan(AS_NUM(argv[2])))
+        vm_error(vm, "[pq_update] Priority must be a number.");
+
+    return NEW_BOOL(heap_update(AS_HEAP(argv[0]), (int)AS_NUM(argv[1]), AS_NUM(argv[2])));
+}
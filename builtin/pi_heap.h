@@ -0,0 +1,10 @@
+#ifndef PI_HEAP_BUILTIN_H
+#define PI_HEAP_BUILTIN_H
+
+#include "../pi_value.h"
+#include "../pi_vm.h"
+
+Value pi_pqueue(vm_t *vm, int argc, Value *argv);
+Value pi_pqUpdate(vm_t *vm, int argc, Value *argv);
+
+#endif // PI_HEAP_BUILTIN_H
@@ -468,7 +468,7 @@ Value pi_input(vm_t *vm, int argc, Value *argv)
     if (len > 0 && buffer[len - 1] == '\n')
         buffer[len - 1] = '\0';
 
-    return NEW_OBJ(new_pistring(strdup(buffer)));
+    return NEW_OBJ(new_pistring(string_copy(buffer)));
 }
 
 /**
@@ -511,8 +511,8 @@ Value pi_open(vm_t *vm, int argc, Value *argv)
     const char *filename = last ? last + 1 : fullpath;
 
     // Make a copy of filename and mode, since they must be owned by ObjFile
-    char *_filename = strdup(filename);
-    char *_mode = strdup(mode);
+    char *_filename = string_copy(filename);
+    char *_mode = string_copy(mode);
     ObjFile *f = (ObjFile *)new_file(file, _filename, _mode);
 
     return NEW_OBJ(f);
@@ -570,7 +570,7 @@ Value pi_read(vm_t *vm, int argc, Value *argv)
 
     content[length] = '\0';
 
-    Value result = NEW_OBJ(new_pistring(strdup(content)));
+    Value result = NEW_OBJ(new_pistring(string_copy(content)));
     free(content); // assuming new_pistring makes a copy
     return result;
 }
@@ -0,0 +1,167 @@
+#include <string.h>
+
+#include "pi_iter.h"
+#include "pi_fun.h"
+#include "../pi_iter.h"
+#include "../pi_func.h"
+#include "../gc.h"
+
+/**
+ * Returns an iterator over a value: the value itself if it is an iterator,
+ * a new iterator with no stages if it is a list, range, string, set, map or
+ * generator.
+ */
+static PiIter *as_iter(vm_t *vm, Value value, const char *error)
+{
+    if (IS_ITER(value))
+        return AS_ITER(value);
+
+    if (IS_LIST(value) || IS_RANGE(value) || IS_STRING(value) || IS_SET(value) || IS_MAP(value) ||
+        IS_GEN(value))
+        return (PiIter *)add_obj(vm, new_iter(value));
+
+    vm_error(vm, error);
+    return NULL;
+}
+
+/**
+ * @brief Creates a lazy iterator over a collection.
+ *
+ * Accepts a list, range, string, set, map (its keys, as in a for loop) or
+ * generator.
+ * Stages are chained with map, filter, take and skip, either as methods
+ * (iter(list).map(f).take(10)) or as functions; nothing runs until the
+ * iterator is looped over, collected or reduced, and then every item goes
+ * through all the stages in a single pass, without intermediate lists.
+ *
+ * @param vm The virtual machine instance.
+ * @param argc The number of arguments (1).
+ * @param argv The arguments: the collection to iterate.
+ * @return A new iterator, or the argument if it already is one.
+ */
+Value pi_iter(vm_t *vm, int argc, Value *argv)
+{
+    if (argc != 1)
+        vm_error(vm, "[iter] expects one argument: a collection.");
+
+    return NEW_OBJ(as_iter(vm, argv[0], "[iter] expects a list, range, string, set, map or generator."));
+}
+
+/**
+ * Adds a take or skip stage to an iterator, after checking the count.
+ */
+static Value count_stage(vm_t *vm, int argc, Value *argv, stage_type type, const char *error)
+{
+    if (argc != 2 || !IS_NUM(argv[1]) || AS_NUM(argv[1]) < 0)
+        vm_error(vm, error);
+
+    PiIter *iter = as_iter(vm, argv[0], error);
+    return NEW_OBJ(iter_extend(iter, type, NEW_NIL(), (int)AS_NUM(argv[1])));
+}
+
+/**
+ * @brief Limits an iterator to its first n items.
+ *
+ * The source is not read past the n-th item, so take(iter(list).map(f), 3)
+ * calls f at most three times.
+ *
+ * @param vm The virtual machine instance.
+ * @param argc The number of arguments (2).
+ * @param argv The arguments: an iterator or collection, and the count.
+ * @return A new iterator.
+ */
+Value pi_take(vm_t *vm, int argc, Value *argv)
+{
+    return count_stage(vm, argc, argv, STAGE_TAKE, "[take] expects an iterator and a count.");
+}
+
+/**
+ * @brief Drops the first n items of an iterator.
+ *
+ * @param vm The virtual machine instance.
+ * @param argc The number of arguments (2).
+ * @param argv The arguments: an iterator or collection, and the count.
+ * @return A new iterator.
+ */
+Value pi_skip(vm_t *vm, int argc, Value *argv)
+{
+    return count_stage(vm, argc, argv, STAGE_SKIP, "[skip] expects an iterator and a count.");
+}
+
+/**
+ * @brief Runs an iterator and returns its items as a list.
+ *
+ * The list is packed while all the items are numbers.
+ *
+ * @param vm The virtual machine instance.
+ * @param argc The number of arguments (1).
+ * @param argv The arguments: an iterator or collection.
+ * @return A new list.
+ */
+Value pi_collect(vm_t *vm, int argc, Value *argv)
+{
+    if (argc != 1)
+        vm_error(vm, "[collect] expects one argument: an iterator.");
+
+    PiIter *iter = as_iter(vm, argv[0], "[collect] expects an iterator.");
+
+    // The iterator and the list are kept on the stack, where the collector
+    // sees them while the stage functions run
+    if (vm->sp + 2 > STACK_MAX)
+        vm_error(vm, "Stack overflow: Attempted to push onto a full stack");
+
+    Object *list = add_obj(vm, new_list(list_create(sizeof(double))));
+    vm->stack[vm->sp++] = NEW_OBJ(iter);
+    vm->stack[vm->sp++] = NEW_OBJ(list);
+
+    Value item;
+    iter_rewind(iter);
+    while (iter_pull(vm, iter, &item))
+    {
+        list_push((PiList *)list, item);
+        write_barrier(vm, list, item);
+    }
+
+    vm->sp -= 2;
+    return NEW_OBJ(list);
+}
+
+// Methods of iterators, called on a bound copy of the builtin
+static const struct
+{
+    const char *name;
+    native_func native;
+} methods[] = {
+    {"map", _pi_map},
+    {"filter", pi_filter},
+    {"take", pi_take},
+    {"skip", pi_skip},
+    {"collect", pi_collect},
+    {"reduce", pi_reduce},
+};
+
+/**
+ * Looks up a method of an iterator (the `iter.name` operator), bound to
+ * the iterator so that it is passed as the first argument.
+ *
+ * @param vm The virtual machine instance.
+ * @param iter The iterator.
+ * @param name The name of the method.
+ * @return The bound method.
+ */
+Value iter_method(vm_t *vm, PiIter *iter, Value name)
+{
+    if (IS_STRING(name))
+        for (size_t i = 0; i < sizeof(methods) / sizeof(methods[0]); i++)
+            if (strcmp(AS_CSTRING(name), methods[i].name) == 0)
+            {
+                Function *fn = (Function *)new_func((char *)methods[i].name, NULL, NULL, NULL, (Object *)iter);
+                fn->is_native = true;
+                fn->is_method = true;
+                fn->native = methods[i].native;
+                return NEW_OBJ(add_obj(vm, (Object *)fn));
+            }
+
+    vm_errorf(vm, "Iterators have no method [%s].", IS_STRING(name) ? AS_CSTRING(name) : "?");
+    return NEW_NIL();
+}
@@ -0,0 +1,15 @@
+#ifndef PI_ITER_BUILTIN_H
+#define PI_ITER_BUILTIN_H
+
+#include "../pi_value.h"
+#include "../pi_vm.h"
+#include "../pi_object.h"
+
+Value pi_iter(vm_t *vm, int argc, Value *argv);
+Value pi_take(vm_t *vm, int argc, Value *argv);
+Value pi_skip(vm_t *vm, int argc, Value *argv);
+Value pi_collect(vm_t *vm, int argc, Value *argv);
+
+Value iter_method(vm_t *vm, PiIter *iter, Value name);
+
+#endif // PI_ITER_BUILTIN_H
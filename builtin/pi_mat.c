@@ -1,5 +1,33 @@
 #include "pi_mat.h"
 #include "../list.h"
+#include "../pi_matrix.h"
+
+/**
+ * Wraps the packed row of a new matrix into a list known to the collector.
+ *
+ * @param vm The virtual machine.
+ * @param row The items of the row, packed doubles.
+ * @return The row.
+ */
+static Object *new_row(vm_t *vm, list_t *row)
+{
+    return add_obj(vm, new_list(row));
+}
+
+/**
+ * Reads a number of a vector or of a row of a matrix. Packed items are
+ * read directly, boxed ones are converted.
+ *
+ * @param items The items of the vector (in bounds index).
+ * @param i The index of the number.
+ * @return The number.
+ */
+static inline double row_number(list_t *items, int i)
+{
+    if (LIST_PACKED(items))
+        return ((double *)items->data)[i];
+    return as_number(((Value *)items->data)[i]);
+}
 
 /**
  * @brief Returns the size of a matrix.
@@ -23,9 +51,9 @@ Value pi_size(vm_t *vm, int argc, Value *argv)
     int cols = list->cols;
 
     /* Create a new list to store the size */
-    list_t *_list = list_create(sizeof(Value));
-    list_add(_list, &NEW_NUM(rows));
-    list_add(_list, &NEW_NUM(cols));
+    list_t *_list = list_create(sizeof(double));
+    list_add(_list, &(double){rows});
+    list_add(_list, &(double){cols});
 
     /* Create a new matrix to store the size */
     PiList *result = (PiList *)new_list(_list);
@@ -57,16 +85,18 @@ Value pi_zeros(vm_t *vm, int argc, Value *argv)
 
     for (int i = 0; i < rows; ++i)
     {
-        list_t *row = list_create(sizeof(Value));
+        list_t *row = list_create(sizeof(double));
         for (int j = 0; j < cols; ++j)
-            list_add(row, &NEW_NUM(0));
-        list_add(list, &row);
+            list_add(row, &(double){0});
+        list_add(list, &NEW_OBJ(new_row(vm, row)));
     }
 
     PiList *mat = (PiList *)new_list(list);
 
     mat->is_numeric = true;
     mat->is_matrix = true;
+    mat->rows = rows;
+    mat->cols = cols;
 
     return NEW_OBJ(mat);
 }
@@ -91,10 +121,10 @@ Value pi_ones(vm_t *vm, int argc, Value *argv)
     /* Iterate over the rows and columns to fill the matrix */
     for (int i = 0; i < rows; ++i)
     {
-        list_t *row = list_create(sizeof(Value));
+        list_t *row = list_create(sizeof(double));
         for (int j = 0; j < cols; ++j)
-            list_add(row, &NEW_NUM(1));
-        list_add(list, &row);
+            list_add(row, &(double){1});
+        list_add(list, &NEW_OBJ(new_row(vm, row)));
     }
 
     /* Create a new matrix to store the result */
@@ -102,6 +132,8 @@ Value pi_ones(vm_t *vm, int argc, Value *argv)
 
     mat->is_numeric = true;
     mat->is_matrix = true;
+    mat->rows = rows;
+    mat->cols = cols;
 
     return NEW_OBJ(mat);
 }
@@ -126,15 +158,10 @@ Value pi_eye(vm_t *vm, int argc, Value *argv)
     /* Iterate over the rows and columns to fill the matrix */
     for (int i = 0; i < rows; ++i)
     {
-        list_t *row = list_create(sizeof(Value));
+        list_t *row = list_create(sizeof(double));
         for (int j = 0; j < cols; ++j)
-        {
-            if (i == j)
-                list_add(row, &NEW_NUM(1));
-            else
-                list_add(row, &NEW_NUM(0));
-        }
-        list_add(list, &row);
+            list_add(row, &(double){i == j ? 1 : 0});
+        list_add(list, &NEW_OBJ(new_row(vm, row)));
     }
 
     /* Create a new matrix to store the result */
@@ -142,6 +169,8 @@ Value pi_eye(vm_t *vm, int argc, Value *argv)
 
     mat->is_numeric = true;
     mat->is_matrix = true;
+    mat->rows = rows;
+    mat->cols = cols;
 
     return NEW_OBJ(mat);
 }
@@ -162,59 +191,7 @@ Value pi_mult(vm_t *vm, int argc, Value *argv)
     if (argc != 2 || !IS_LIST(argv[0]) || !IS_LIST(argv[1]))
         vm_error(vm, "Expected two matrices (list of lists)");
 
-    PiList *A = AS_LIST(argv[0]);
-    PiList *B = AS_LIST(argv[1]);
-
-    if (!A->is_numeric || !B->is_numeric)
-        vm_error(vm, "Matrix multiplication requires numeric lists.");
-
-    if (A->cols == -1 || B->cols == -1)
-        vm_error(vm, "Matrix dimensions are not set properly.");
-
-    if (A->cols != B->rows)
-        vm_error(vm, "Matrix multiplication dimension mismatch.");
-
-    int m = A->rows;
-    int n = A->cols;
-    int p = B->cols;
-
-    list_t *result = list_create(sizeof(Value));
-
-    /* Iterate over the rows of matrix A */
-    for (int i = 0; i < m; i++)
-    {
-        Value *rowA_val = (Value *)list_getAt(A->items, i);
-        list_t *rowA = as_list(*rowA_val);
-        list_t *temp = list_create(sizeof(Value));
-
-        /* Iterate over the columns of matrix B */
-        for (int j = 0; j < p; j++)
-        {
-            double sum = 0.0;
-
-            /* Iterate over the elements of row A and column B */
-            for (int k = 0; k < n; k++)
-            {
-                /* Get A[i][k] */
-                Value *a_val = (Value *)list_getAt(rowA, k);
-                double a = as_number(*a_val);
-
-                /* Get B[k][j] */
-                Value *rowB_val = (Value *)list_getAt(B->items, k);
-                list_t *rowB = as_list(*rowB_val);
-                Value *b_val = (Value *)list_getAt(rowB, j);
-                double b = as_number(*b_val);
-
-                sum += a * b;
-            }
-
-            list_add(temp, &NEW_NUM(sum));
-        }
-
-        list_add(result, &NEW_OBJ(new_list(temp)));
-    }
-
-    return NEW_OBJ(new_list(result));
+    return mat_product(vm, AS_LIST(argv[0]), AS_LIST(argv[1]));
 }
 
 Value pi_dot(vm_t *vm, int argc, Value *argv)
@@ -233,11 +210,7 @@ Value pi_dot(vm_t *vm, int argc, Value *argv)
 
     double sum = 0;
     for (int i = 0; i < A->items->size; i++)
-    {
-        double a = AS_NUM(*(Value *)list_getAt(A->items, i));
-        double b = AS_NUM(*(Value *)list_getAt(B->items, i));
-        sum += a * b;
-    }
+        sum += row_number(A->items, i) * row_number(B->items, i);
 
     return NEW_NUM(sum);
 }
@@ -265,13 +238,13 @@ Value pi_cross(vm_t *vm, int argc, Value *argv)
         vm_error(vm, "cross: Only 3D vectors supported");
 
     // Extract components from the input vectors
-    double a1 = AS_NUM(*(Value *)list_getAt(A->items, 0));
-    double a2 = AS_NUM(*(Value *)list_getAt(A->items, 1));
-    double a3 = AS_NUM(*(Value *)list_getAt(A->items, 2));
+    double a1 = row_number(A->items, 0);
+    double a2 = row_number(A->items, 1);
+    double a3 = row_number(A->items, 2);
 
-    double b1 = AS_NUM(*(Value *)list_getAt(B->items, 0));
-    double b2 = AS_NUM(*(Value *)list_getAt(B->items, 1));
-    double b3 = AS_NUM(*(Value *)list_getAt(B->items, 2));
+    double b1 = row_number(B->items, 0);
+    double b2 = row_number(B->items, 1);
+    double b3 = row_number(B->items, 2);
 
     // Compute the cross product
     double x = a2 * b3 - a3 * b2;
@@ -279,10 +252,10 @@ Value pi_cross(vm_t *vm, int argc, Value *argv)
     double z = a1 * b2 - a2 * b1;
 
     // Create the result vector
-    list_t *items = list_create(sizeof(Value));
-    list_add(items, &NEW_NUM(x));
-    list_add(items, &NEW_NUM(y));
-    list_add(items, &NEW_NUM(z));
+    list_t *items = list_create(sizeof(double));
+    list_add(items, &x);
+    list_add(items, &y);
+    list_add(items, &z);
 
     PiList *result = (PiList *)new_list(items);
     result->is_numeric = true;
@@ -314,7 +287,7 @@ Value pi_isMat(vm_t *vm, int argc, Value *argv)
     // Check if all sublists have the same length
     for (int i = 0; i < size; i++)
     {
-        list_t *sublist = AS_CLIST(*(Value *)list_getAt(list->items, i));
+        list_t *sublist = AS_LIST(list_value(list->items, i))->items;
         if (sublist->size != size)
             return NEW_BOOL(false);
     }
@@ -30,12 +30,12 @@ Value pi_floor(vm_t *vm, int argc, Value *argv)
 
     else if (IS_LIST(arg))
     {
-        list_t *input = AS_CLIST(arg);
+        list_t *input = AS_LIST(arg)->items;
         list_t *result = list_create(sizeof(Value));
 
         for (int i = 0; i < input->size; i++)
         {
-            Value item = *(Value *)list_getAt(input, i);
+            Value item = list_value(input, i);
             if (!is_numeric(item))
                 vm_error(vm,"[floor] All elements in the list must be numeric.");
 
@@ -45,7 +45,7 @@ Value pi_floor(vm_t *vm, int argc, Value *argv)
         }
 
         PiList *list = (PiList *)new_list(result);
-        list->is_numeric = true;
+        list_pack(list);
         list->is_matrix = false;
         return NEW_OBJ(list);
     }
@@ -73,12 +73,12 @@ Value pi_ceil(vm_t *vm, int argc, Value *argv)
 
     else if (IS_LIST(arg))
     {
-        list_t *input = AS_CLIST(arg);
+        list_t *input = AS_LIST(arg)->items;
         list_t *result = list_create(sizeof(Value));
 
         for (int i = 0; i < input->size; i++)
         {
-            Value item = *(Value *)list_getAt(input, i);
+            Value item = list_value(input, i);
             if (!is_numeric(item))
                 vm_error(vm,"[ceil] All elements in the list must be numeric.");
 
@@ -88,7 +88,7 @@ Value pi_ceil(vm_t *vm, int argc, Value *argv)
         }
 
         PiList *list = (PiList *)new_list(result);
-        list->is_numeric = true;
+        list_pack(list);
         list->is_matrix = false;
         return NEW_OBJ(list);
     }
@@ -116,12 +116,12 @@ Value pi_round(vm_t *vm, int argc, Value *argv)
 
     else if (IS_LIST(arg))
     {
-        list_t *input = AS_CLIST(arg);
+        list_t *input = AS_LIST(arg)->items;
         list_t *result = list_create(sizeof(Value));
 
         for (int i = 0; i < input->size; i++)
         {
-            Value item = *(Value *)list_getAt(input, i);
+            Value item = list_value(input, i);
             if (!is_numeric(item))
                 vm_error(vm,"[round] All elements in the list must be numeric.");
 
@@ -131,7 +131,7 @@ Value pi_round(vm_t *vm, int argc, Value *argv)
         }
 
         PiList *list = (PiList *)new_list(result);
-        list->is_numeric = true;
+        list_pack(list);
         list->is_matrix = false;
         return NEW_OBJ(list);
     }
@@ -159,12 +159,12 @@ Value pi_sqrt(vm_t *vm, int argc, Value *argv)
 
     else if (IS_LIST(arg))
     {
-        list_t *input = AS_CLIST(arg);
+        list_t *input = AS_LIST(arg)->items;
         list_t *result = list_create(sizeof(Value));
 
         for (int i = 0; i < input->size; i++)
         {
-            Value item = *(Value *)list_getAt(input, i);
+            Value item = list_value(input, i);
             if (!is_numeric(item))
                 vm_error(vm,"[sqrt] All elements in the list must be numeric.");
 
@@ -174,7 +174,7 @@ Value pi_sqrt(vm_t *vm, int argc, Value *argv)
         }
 
         PiList *list = (PiList *)new_list(result);
-        list->is_numeric = true;
+        list_pack(list);
         list->is_matrix = false;
         return NEW_OBJ(list);
     }
@@ -202,12 +202,12 @@ Value pi_sin(vm_t *vm, int argc, Value *argv)
 
     else if (IS_LIST(arg))
     {
-        list_t *input = AS_CLIST(arg);
+        list_t *input = AS_LIST(arg)->items;
         list_t *result = list_create(sizeof(Value));
 
         for (int i = 0; i < input->size; i++)
         {
-            Value item = *(Value *)list_getAt(input, i);
+            Value item = list_value(input, i);
             if (!is_numeric(item))
                 vm_error(vm,"[sin] All elements in the list must be numeric.");
 
@@ -217,7 +217,7 @@ Value pi_sin(vm_t *vm, int argc, Value *argv)
         }
 
         PiList *list = (PiList *)new_list(result);
-        list->is_numeric = true;
+        list_pack(list);
         list->is_matrix = false;
         return NEW_OBJ(list);
     }
@@ -245,12 +245,12 @@ Value pi_cos(vm_t *vm, int argc, Value *argv)
 
     else if (IS_LIST(arg))
     {
-        list_t *input = AS_CLIST(arg);
+        list_t *input = AS_LIST(arg)->items;
         list_t *result = list_create(sizeof(Value));
 
         for (int i = 0; i < input->size; i++)
         {
-            Value item = *(Value *)list_getAt(input, i);
+            Value item = list_value(input, i);
             if (!is_numeric(item))
                 vm_error(vm,"[cos] All elements in the list must be numeric.");
 
@@ -260,7 +260,7 @@ Value pi_cos(vm_t *vm, int argc, Value *argv)
         }
 
         PiList *list = (PiList *)new_list(result);
-        list->is_numeric = true;
+        list_pack(list);
         list->is_matrix = false;
         return NEW_OBJ(list);
     }
@@ -295,12 +295,12 @@ Value pi_asin(vm_t *vm, int argc, Value *argv)
     }
     else if (IS_LIST(arg))
     {
-        list_t *input = AS_CLIST(arg);
+        list_t *input = AS_LIST(arg)->items;
         list_t *result = list_create(sizeof(Value));
 
         for (int i = 0; i < input->size; i++)
         {
-            Value item = *(Value *)list_getAt(input, i);
+            Value item = list_value(input, i);
             if (!is_numeric(item))
                 vm_error(vm,"[asin] All elements in the list must be numeric.");
 
@@ -314,7 +314,7 @@ Value pi_asin(vm_t *vm, int argc, Value *argv)
         }
 
         PiList *list = (PiList *)new_list(result);
-        list->is_numeric = true;
+        list_pack(list);
         list->is_matrix = false;
         return NEW_OBJ(list);
     }
@@ -342,12 +342,12 @@ Value pi_tan(vm_t *vm, int argc, Value *argv)
 
     else if (IS_LIST(arg))
     {
-        list_t *input = AS_CLIST(arg);
+        list_t *input = AS_LIST(arg)->items;
         list_t *result = list_create(sizeof(Value));
 
         for (int i = 0; i < input->size; i++)
         {
-            Value item = *(Value *)list_getAt(input, i);
+            Value item = list_value(input, i);
             if (!is_numeric(item))
                 vm_error(vm,"[tan] All elements in the list must be numeric.");
 
@@ -357,7 +357,7 @@ Value pi_tan(vm_t *vm, int argc, Value *argv)
         }
 
         PiList *list = (PiList *)new_list(result);
-        list->is_numeric = true;
+        list_pack(list);
         list->is_matrix = false;
         return NEW_OBJ(list);
     }
@@ -392,12 +392,12 @@ Value pi_acos(vm_t *vm, int argc, Value *argv)
     }
     else if (IS_LIST(arg))
     {
-        list_t *input = AS_CLIST(arg);
+        list_t *input = AS_LIST(arg)->items;
         list_t *result = list_create(sizeof(Value));
 
         for (int i = 0; i < input->size; i++)
         {
-            Value item = *(Value *)list_getAt(input, i);
+            Value item = list_value(input, i);
             if (!is_numeric(item))
                 vm_error(vm,"[acos] All elements in the list must be numeric.");
 
@@ -411,7 +411,7 @@ Value pi_acos(vm_t *vm, int argc, Value *argv)
         }
 
         PiList *list = (PiList *)new_list(result);
-        list->is_numeric = true;
+        list_pack(list);
         list->is_matrix = false;
         return NEW_OBJ(list);
     }
@@ -444,12 +444,12 @@ Value pi_atan(vm_t *vm, int argc, Value *argv)
     }
     else if (IS_LIST(arg))
     {
-        list_t *input = AS_CLIST(arg);
+        list_t *input = AS_LIST(arg)->items;
         list_t *result = list_create(sizeof(Value));
 
         for (int i = 0; i < input->size; i++)
         {
-            Value item = *(Value *)list_getAt(input, i);
+            Value item = list_value(input, i);
             if (!is_numeric(item))
                 vm_error(vm,"[atan] All elements in the list must be numeric.");
 
@@ -460,7 +460,7 @@ Value pi_atan(vm_t *vm, int argc, Value *argv)
         }
 
         PiList *list = (PiList *)new_list(result);
-        list->is_numeric = true;
+        list_pack(list);
         list->is_matrix = false;
         return NEW_OBJ(list);
     }
@@ -492,12 +492,12 @@ Value pi_deg(vm_t *vm, int argc, Value *argv)
     }
     else if (IS_LIST(arg))
     {
-        list_t *input = AS_CLIST(arg);
+        list_t *input = AS_LIST(arg)->items;
         list_t *result = list_create(sizeof(Value));
 
         for (int i = 0; i < input->size; i++)
         {
-            Value item = *(Value *)list_getAt(input, i);
+            Value item = list_value(input, i);
             if (!is_numeric(item))
                 vm_error(vm,"[deg] All elements in the list must be numeric.");
 
@@ -508,7 +508,7 @@ Value pi_deg(vm_t *vm, int argc, Value *argv)
         }
 
         PiList *list = (PiList *)new_list(result);
-        list->is_numeric = true;
+        list_pack(list);
         list->is_matrix = false;
         return NEW_OBJ(list);
     }
@@ -541,12 +541,12 @@ Value pi_rad(vm_t *vm, int argc, Value *argv)
     }
     else if (IS_LIST(arg))
     {
-        list_t *input = AS_CLIST(arg);
+        list_t *input = AS_LIST(arg)->items;
         list_t *result = list_create(sizeof(Value));
 
         for (int i = 0; i < input->size; i++)
         {
-            Value item = *(Value *)list_getAt(input, i);
+            Value item = list_value(input, i);
             if (!is_numeric(item))
                 vm_error(vm,"[rad] All elements in the list must be numeric.");
 
@@ -557,7 +557,7 @@ Value pi_rad(vm_t *vm, int argc, Value *argv)
         }
 
         PiList *list = (PiList *)new_list(result);
-        list->is_numeric = true;
+        list_pack(list);
         list->is_matrix = false;
         return NEW_OBJ(list);
     }
@@ -583,12 +583,12 @@ Value pi_sum(vm_t *vm, int argc, Value *argv)
     if (argc == 0 || !IS_LIST(argv[0]))
         vm_error(vm,"[sum] expects a single list of numeric values.");
 
-    list_t *input = AS_CLIST(argv[0]);
+    list_t *input = AS_LIST(argv[0])->items;
     double total = 0.0;
 
     for (int i = 0; i < input->size; i++)
     {
-        Value item = *(Value *)list_getAt(input, i);
+        Value item = list_value(input, i);
         if (!is_numeric(item))
             vm_error(vm,"[sum] All elements in the list must be numeric.");
         total += as_number(item);
@@ -621,12 +621,12 @@ Value pi_exp(vm_t *vm, int argc, Value *argv)
 
     else if (IS_LIST(arg))
     {
-        list_t *input = AS_CLIST(arg);
+        list_t *input = AS_LIST(arg)->items;
         list_t *result = list_create(sizeof(Value));
 
         for (int i = 0; i < input->size; i++)
         {
-            Value item = *(Value *)list_getAt(input, i);
+            Value item = list_value(input, i);
             if (!is_numeric(item))
                 vm_error(vm,"[exp] All elements in the list must be numeric.");
 
@@ -636,7 +636,7 @@ Value pi_exp(vm_t *vm, int argc, Value *argv)
         }
 
         PiList *list = (PiList *)new_list(result);
-        list->is_numeric = true;
+        list_pack(list);
         list->is_matrix = false;
         return NEW_OBJ(list);
     }
@@ -674,12 +674,12 @@ Value pi_log2(vm_t *vm, int argc, Value *argv)
     }
     else if (IS_LIST(arg))
     {
-        list_t *input = AS_CLIST(arg);
+        list_t *input = AS_LIST(arg)->items;
         list_t *result = list_create(sizeof(Value));
 
         for (int i = 0; i < input->size; i++)
         {
-            Value item = *(Value *)list_getAt(input, i);
+            Value item = list_value(input, i);
             if (!is_numeric(item))
                 vm_error(vm,"[log2] All elements in the list must be numeric.");
 
@@ -692,7 +692,7 @@ Value pi_log2(vm_t *vm, int argc, Value *argv)
         }
 
         PiList *list = (PiList *)new_list(result);
-        list->is_numeric = true;
+        list_pack(list);
         list->is_matrix = false;
         return NEW_OBJ(list);
     }
@@ -729,12 +729,12 @@ Value pi_log10(vm_t *vm, int argc, Value *argv)
     }
     else if (IS_LIST(arg))
     {
-        list_t *input = AS_CLIST(arg);
+        list_t *input = AS_LIST(arg)->items;
         list_t *result = list_create(sizeof(Value));
 
         for (int i = 0; i < input->size; i++)
         {
-            Value item = *(Value *)list_getAt(input, i);
+            Value item = list_value(input, i);
             if (!is_numeric(item))
                 vm_error(vm,"[log10] All elements in the list must be numeric.");
 
@@ -747,7 +747,7 @@ Value pi_log10(vm_t *vm, int argc, Value *argv)
         }
 
         PiList *list = (PiList *)new_list(result);
-        list->is_numeric = true;
+        list_pack(list);
         list->is_matrix = false;
         return NEW_OBJ(list);
     }
@@ -784,12 +784,12 @@ Value pi_pow(vm_t *vm, int argc, Value *argv)
     }
     else if (IS_LIST(base))
     {
-        list_t *input = AS_CLIST(base);
+        list_t *input = AS_LIST(base)->items;
         list_t *result = list_create(sizeof(Value));
 
         for (int i = 0; i < input->size; i++)
         {
-            Value item = *(Value *)list_getAt(input, i);
+            Value item = list_value(input, i);
 
             if (!is_numeric(item))
                 vm_error(vm,"[pow] All elements in the base list must be numeric.");
@@ -801,7 +801,7 @@ Value pi_pow(vm_t *vm, int argc, Value *argv)
         }
 
         PiList *list = (PiList *)new_list(result);
-        list->is_numeric = true;
+        list_pack(list);
         list->is_matrix = false;
 
         return NEW_OBJ(list);
@@ -829,7 +829,7 @@ Value pi_mean(vm_t *vm, int argc, Value *argv)
     if (!IS_LIST(arg))
         vm_error(vm,"[mean] expects a list of numeric values.");
 
-    list_t *input = AS_CLIST(arg);
+    list_t *input = AS_LIST(arg)->items;
 
     if (input->size == 0)
         vm_error(vm,"[mean] cannot compute mean of an empty list.");
@@ -838,7 +838,7 @@ Value pi_mean(vm_t *vm, int argc, Value *argv)
 
     for (int i = 0; i < input->size; i++)
     {
-        Value item = *(Value *)list_getAt(input, i);
+        Value item = list_value(input, i);
 
         if (!is_numeric(item))
             vm_error(vm,"[mean] all elements in the list must be numeric.");
@@ -868,7 +868,7 @@ Value pi_var(vm_t *vm, int argc, Value *argv)
     if (argc == 0 || !IS_LIST(argv[0]))
         vm_error(vm,"[var] expects a single argument: a list of numbers.");
 
-    list_t *input = AS_CLIST(argv[0]);
+    list_t *input = AS_LIST(argv[0])->items;
     if (input->size == 0)
         vm_error(vm,"[var] Cannot calculate variance of an empty list.");
 
@@ -876,7 +876,7 @@ Value pi_var(vm_t *vm, int argc, Value *argv)
     double sum = 0.0;
     for (int i = 0; i < input->size; i++)
     {
-        Value item = *(Value *)list_getAt(input, i);
+        Value item = list_value(input, i);
         if (!is_numeric(item))
             vm_error(vm,"[var] All elements in the list must be numeric.");
 
@@ -888,7 +888,7 @@ Value pi_var(vm_t *vm, int argc, Value *argv)
     double variance = 0.0;
     for (int i = 0; i < input->size; i++)
     {
-        Value item = *(Value *)list_getAt(input, i);
+        Value item = list_value(input, i);
         double diff = as_number(item) - mean;
         variance += diff * diff;
     }
@@ -907,7 +907,7 @@ Value pi_dev(vm_t *vm, int argc, Value *argv)
     if (argc == 0 || !IS_LIST(argv[0]))
         vm_error(vm,"[dev] expects a single argument: a list of numbers.");
 
-    list_t *input = AS_CLIST(argv[0]);
+    list_t *input = AS_LIST(argv[0])->items;
     if (input->size == 0)
         vm_error(vm,"[dev] Cannot calculate standard deviation of an empty list.");
 
@@ -915,7 +915,7 @@ Value pi_dev(vm_t *vm, int argc, Value *argv)
     double sum = 0.0;
     for (int i = 0; i < input->size; i++)
     {
-        Value item = *(Value *)list_getAt(input, i);
+        Value item = list_value(input, i);
         if (!is_numeric(item))
             vm_error(vm,"[dev] All elements in the list must be numeric.");
 
@@ -927,7 +927,7 @@ Value pi_dev(vm_t *vm, int argc, Value *argv)
     double variance = 0.0;
     for (int i = 0; i < input->size; i++)
     {
-        Value item = *(Value *)list_getAt(input, i);
+        Value item = list_value(input, i);
         double diff = as_number(item) - mean;
         variance += diff * diff;
     }
@@ -976,7 +976,7 @@ Value pi_median(vm_t *vm, int argc, Value *argv)
     if (argc == 0 || !IS_LIST(argv[0]))
         vm_error(vm,"[median] expects a single argument: a list of numbers.");
 
-    list_t *input = AS_CLIST(argv[0]);
+    list_t *input = AS_LIST(argv[0])->items;
     int size = input->size;
     if (size == 0)
         vm_error(vm,"[median] Cannot calculate median of an empty list.");
@@ -988,7 +988,7 @@ Value pi_median(vm_t *vm, int argc, Value *argv)
 
     for (int i = 0; i < size; i++)
     {
-        Value item = *(Value *)list_getAt(input, i);
+        Value item = list_value(input, i);
         if (!is_numeric(item))
         {
             free(copy);
@@ -1028,7 +1028,7 @@ Value pi_mode(vm_t *vm, int argc, Value *argv)
     if (argc == 0 || !IS_LIST(argv[0]))
         vm_error(vm,"[mode] expects a single argument: a list of numbers.");
 
-    list_t *input = AS_CLIST(argv[0]);
+    list_t *input = AS_LIST(argv[0])->items;
     int size = input->size;
 
     if (size == 0)
@@ -1041,7 +1041,7 @@ Value pi_mode(vm_t *vm, int argc, Value *argv)
 
     for (int i = 0; i < size; i++)
     {
-        Value item = *(Value *)list_getAt(input, i);
+        Value item = list_value(input, i);
         if (!is_numeric(item))
         {
             free(copy);
@@ -1254,17 +1254,15 @@ Value pi_rand_n(vm_t *vm, int argc, Value *argv)
     if (size < 0)
         vm_error(vm,"[rand_n] size must be non-negative.");
 
-    list_t *list = list_create(sizeof(Value));
+    list_t *list = list_create(sizeof(double)); // Packed, see list_pack
 
     for (int i = 0; i < size; i++)
     {
         double r = (double)rand() / RAND_MAX; // random float between 0 and 1
-        Value val = NEW_NUM(r);
-        list_add(list, &val);
+        list_add(list, &r);
     }
 
     PiList *result = (PiList *)new_list(list);
-    result->is_numeric = true;
     result->is_matrix = false;
 
     return NEW_OBJ(result);
@@ -1281,7 +1279,7 @@ Value pi_min(vm_t *vm, int argc, Value *argv)
     if (argc == 0 || !IS_LIST(argv[0]))
         vm_error(vm,"[min] expects a list of numeric values.");
 
-    list_t *input = AS_CLIST(argv[0]);
+    list_t *input = AS_LIST(argv[0])->items;
 
     if (input->size == 0)
         vm_error(vm,"[min] cannot operate on an empty list.");
@@ -1291,7 +1289,7 @@ Value pi_min(vm_t *vm, int argc, Value *argv)
 
     for (int i = 0; i < input->size; i++)
     {
-        Value item = *(Value *)list_getAt(input, i);
+        Value item = list_value(input, i);
         if (!is_numeric(item))
             vm_error(vm,"[min] All elements in the list must be numeric.");
 
@@ -1317,7 +1315,7 @@ Value pi_max(vm_t *vm, int argc, Value *argv)
     if (argc == 0 || !IS_LIST(argv[0]))
         vm_error(vm,"[max] expects a list of numeric values.");
 
-    list_t *input = AS_CLIST(argv[0]);
+    list_t *input = AS_LIST(argv[0])->items;
 
     if (input->size == 0)
         vm_error(vm,"[max] cannot operate on an empty list.");
@@ -1327,7 +1325,7 @@ Value pi_max(vm_t *vm, int argc, Value *argv)
 
     for (int i = 0; i < input->size; i++)
     {
-        Value item = *(Value *)list_getAt(input, i);
+        Value item = list_value(input, i);
         if (!is_numeric(item))
             vm_error(vm,"[max] All elements in the list must be numeric.");
 
@@ -1360,12 +1358,12 @@ Value pi_abs(vm_t *vm, int argc, Value *argv)
 
     else if (IS_LIST(arg))
     {
-        list_t *input = AS_CLIST(arg);
+        list_t *input = AS_LIST(arg)->items;
         list_t *result = list_create(sizeof(Value));
 
         for (int i = 0; i < input->size; i++)
         {
-            Value item = *(Value *)list_getAt(input, i);
+            Value item = list_value(input, i);
             if (!is_numeric(item))
                 vm_error(vm,"[abs] All elements in the list must be numeric.");
 
@@ -1375,7 +1373,7 @@ Value pi_abs(vm_t *vm, int argc, Value *argv)
         }
 
         PiList *list = (PiList *)new_list(result);
-        list->is_numeric = true;
+        list_pack(list);
         list->is_matrix = false;
         return NEW_OBJ(list);
     }
@@ -8,27 +8,21 @@ Value pi_clone(vm_t *vm, int argc, Value *argv)
 
     PiMap *original = AS_MAP(argv[0]);
 
-    // Create a new empty map and mark it as an instance
-    table_t *new_table = ht_create(sizeof(Value));
-    Object *obj = new_map(new_table, false); // true = is_instance
-    PiMap *map = (PiMap *)obj;
-
-    // Set the prototype to the original map
+    // Create a new map with the original as its prototype
+    PiMap *map = (PiMap *)new_map(NULL, false);
     map->proto = original;
 
-    // Copy each key-value pair into the new map
-    char **keys = ht_keys(original->table);
-
-    int size = ht_length(original->table);
-
-    for (int i = 0; i < size; i++)
+    if (original->shape)
     {
-        // char *key = string_get(keys, i);
-        char *key = keys[i];
-        Value *value = (Value *)ht_get(original->table, key);
-        if (value)
-            ht_put(map->table, key, value);
+        // Instances have few fields: copy them and keep the shape
+        map->shape = original->shape;
+        map->capacity = original->capacity;
+        map->fields = (Value *)malloc(sizeof(Value) * map->capacity);
+        memcpy(map->fields, original->fields, sizeof(Value) * original->shape->count);
     }
+    else
+        // Share the key-value pairs until either map is modified
+        map->table = ht_share(original->table);
 
     return NEW_OBJ(map);
 }
@@ -39,19 +33,12 @@ Value pi_values(vm_t *vm, int argc, Value *argv)
         vm_error(vm, "[values] expects a map as the first argument.");
 
     PiMap *map = AS_MAP(argv[0]);
-    char **keys = ht_keys(map->table);
-    int size = ht_length(map->table);
+    int size = map_size(map);
 
     list_t *list = list_create(sizeof(Value));
 
     for (int i = 0; i < size; i++)
-    {
-        // char *key = string_get(keys, i);
-        char *key = keys[i];
-        Value *val = ht_get(map->table, key);
-        if (val)
-            list_add(list, val); // Copy value to the list
-    }
+        list_add(list, map_valueAt(map, i)); // Copy value to the list
 
     return NEW_OBJ(new_list(list));
 }
@@ -63,17 +50,13 @@ Value pi_keys(vm_t *vm, int argc, Value *argv)
 
     PiMap *map = AS_MAP(argv[0]);
 
-    char **keys = ht_keys(map->table);
-    int size = ht_length(map->table);
+    int size = map_size(map);
 
     list_t *list = list_create(sizeof(Value));
 
+    // Keys are owned by the map, so each string gets its own copy
     for (int i = 0; i < size; i++)
-    {
-        // char *key = string_get(keys, i);
-        char *key = keys[i];
-        list_add(list, &NEW_OBJ(new_pistring(key)));
-    }
+        list_add(list, &NEW_OBJ(new_pistring(string_copy(map_keyAt(map, i)))));
 
     return NEW_OBJ(new_list(list));
 }
@@ -5,6 +5,7 @@
 #include "pi_plot.h"
 #include "../screen.h"
 #include "../common.h"
+#include "../gc.h"
 
 /**
  * Draws a pixel on the screen at the specified coordinates with a given color and optional alpha transparency.
@@ -107,6 +108,11 @@ Value pi_draw(vm_t *vm, int argc, Value *argv)
 
     screen_update(vm->screen);
 
+    // Give the incremental collector a slice of every frame, before pacing
+    // so the time is taken out of the frame's idle wait.
+    if (vm->gc_phase != GC_IDLE)
+        gc_step(vm, vm->gc_budget);
+
     // Runtime-level frame pacing for tight render loops.
     if (vm->frameInterval_ms > 0)
     {
@@ -245,7 +251,7 @@ Value pi_poly(vm_t *vm, int argc, Value *argv)
         vm_error(vm, "[poly] expects a list of points and a color index.");
 
     Screen *screen = vm->screen; // Assume vm has a Screen reference
-    list_t *points = AS_LIST(argv[0])->items;
+    list_t *points = AS_CLIST(argv[0]); // The screen reads the points as Values
 
     int color = ((int)round(AS_NUM(argv[1])) % 32);
 
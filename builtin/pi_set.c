@@ -0,0 +1,152 @@
+#include "pi_set.h"
+#include "../pi_set.h"
+
+/**
+ * Checks that the arguments of a set operation are sets.
+ *
+ * @param vm The virtual machine.
+ * @param name The name of the function, for the error messages.
+ * @param argc The number of arguments.
+ * @param argv The arguments.
+ */
+static void check_sets(vm_t *vm, const char *name, int argc, Value *argv)
+{
+    if (argc < 2)
+        vm_errorf(vm, "[%s] expects two sets at least.", name);
+
+    for (int i = 0; i < argc; i++)
+        if (!IS_SET(argv[i]))
+            vm_errorf(vm, "[%s] Arguments must be sets, got a %s.", name, type_name(argv[i]));
+}
+
+/**
+ * @brief Creates a set.
+ *
+ * Accepts set(), set(list), set(range) or set(set). The items are added
+ * in order, duplicates are dropped.
+ *
+ * @param vm The virtual machine instance.
+ * @param argc The number of arguments.
+ * @param argv The arguments: a list, a range or a set (optional).
+ * @return A new set.
+ */
+Value pi_set(vm_t *vm, int argc, Value *argv)
+{
+    if (argc == 0 || IS_NIL(argv[0]))
+        return NEW_OBJ(new_set());
+
+    if (IS_SET(argv[0]))
+        return NEW_OBJ(set_copy(AS_SET(argv[0])));
+
+    if (!IS_LIST(argv[0]) && !IS_RANGE(argv[0]))
+        vm_error(vm, "[set] Argument must be a list, a range or a set.");
+
+    PiSet *set = (PiSet *)new_set();
+
+    if (IS_RANGE(argv[0]))
+    {
+        // Walks the range without touching its iterator state
+        PiRange *range = AS_RANGE(argv[0]);
+        if (range->step == 0)
+            return NEW_OBJ(set);
+
+        for (double x = range->start; range->step > 0 ? x < range->end : x > range->end; x += range->step)
+            set_add(set, NEW_NUM(x));
+        return NEW_OBJ(set);
+    }
+
+    list_t *items = AS_LIST(argv[0])->items;
+
+    for (int i = 0; i < items->size; i++)
+        set_add(set, list_value(items, i));
+
+    return NEW_OBJ(set);
+}
+
+/**
+ * @brief Returns the union of sets: the items of any of them.
+ *
+ * Accepts union(a, b, ...). Items keep the order in which they first
+ * appear.
+ *
+ * @return A new set.
+ */
+Value pi_union(vm_t *vm, int argc, Value *argv)
+{
+    check_sets(vm, "union", argc, argv);
+
+    PiSet *result = set_copy(AS_SET(argv[0]));
+
+    for (int i = 1; i < argc; i++)
+    {
+        PiSet *set = AS_SET(argv[i]);
+        for (int j = 0; j < set->count; j++)
+            if (set->entries[j].live)
+                set_add(result, set->entries[j].value);
+    }
+
+    return NEW_OBJ(result);
+}
+
+/**
+ * @brief Returns the intersection of sets: the items of all of them.
+ *
+ * Accepts intersect(a, b, ...). Items keep their order in the first set.
+ *
+ * @return A new set.
+ */
+Value pi_intersect(vm_t *vm, int argc, Value *argv)
+{
+    check_sets(vm, "intersect", argc, argv);
+
+    PiSet *first = AS_SET(argv[0]);
+    PiSet *result = (PiSet *)new_set();
+
+    for (int i = 0; i < first->count; i++)
+    {
+        if (!first->entries[i].live)
+            continue;
+
+        Value item = first->entries[i].value;
+        bool everywhere = true;
+        for (int j = 1; j < argc && everywhere; j++)
+            everywhere = set_has(AS_SET(argv[j]), item);
+
+        if (everywhere)
+            set_add(result, item);
+    }
+
+    return NEW_OBJ(result);
+}
+
+/**
+ * @brief Returns the difference of sets: the items of the first set that
+ * are in none of the others.
+ *
+ * Accepts difference(a, b, ...). Items keep their order in the first set.
+ *
+ * @return A new set.
+ */
+Value pi_difference(vm_t *vm, int argc, Value *argv)
+{
+    check_sets(vm, "difference", argc, argv);
+
+    PiSet *first = AS_SET(argv[0]);
+    PiSet *result = (PiSet *)new_set();
+
+    for (int i = 0; i < first->count; i++)
+    {
+        if (!first->entries[i].live)
+            continue;
+
+        Value item = first->entries[i].value;
+        bool elsewhere = false;
+        for (int j = 1; j < argc && !elsewhere; j++)
+            elsewhere = set_has(AS_SET(argv[j]), item);
+
+        if (!elsewhere)
+            set_add(result, item);
+    }
+
+    return NEW_OBJ(result);
+}
@@ -0,0 +1,12 @@
+#ifndef PI_SET_BUILTIN_H
+#define PI_SET_BUILTIN_H
+
+#include "../pi_value.h"
+#include "../pi_vm.h"
+
+Value pi_set(vm_t *vm, int argc, Value *argv);
+Value pi_union(vm_t *vm, int argc, Value *argv);
+Value pi_intersect(vm_t *vm, int argc, Value *argv);
+Value pi_difference(vm_t *vm, int argc, Value *argv);
+
+#endif // PI_SET_BUILTIN_H
@@ -3,6 +3,8 @@
 #include "pi_sys.h"
 #include "../pi_value.h"
 #include "../list.h"
+#include "../gc.h"
+#include "../gc_worker.h"
 #include "pi_plot.h"
 
 Value pi_fps(vm_t *vm, int argc, Value *argv)
@@ -11,6 +13,168 @@ Value pi_fps(vm_t *vm, int argc, Value *argv)
     return NEW_NUM(fps);
 }
 
+/**
+ * Gets or sets the time budget of one incremental garbage collection slice.
+ *
+ * A slice runs on every `draw()` and after minor collections while a full
+ * collection is in progress.
+ *
+ * @param vm The virtual machine instance.
+ * @param argc The number of arguments (0 or 1).
+ * @param argv Optional new budget in milliseconds (must be positive).
+ * @return The budget in milliseconds (the previous one when setting).
+ */
+Value pi_gc_budget(vm_t *vm, int argc, Value *argv)
+{
+    double budget = vm->gc_budget;
+
+    if (argc > 0)
+    {
+        if (!IS_NUM(argv[0]) || AS_NUM(argv[0]) <= 0)
+            vm_error(vm, "[gc_budget] expects a positive number of milliseconds.");
+        vm->gc_budget = AS_NUM(argv[0]);
+    }
+
+    return NEW_NUM(budget);
+}
+
+/**
+ * Runs a full garbage collection immediately.
+ *
+ * Any incremental collection in progress is finished first, then the whole
+ * heap is marked and swept without interruption.
+ *
+ * @param vm The virtual machine instance.
+ * @param argc The number of arguments (unused).
+ * @param argv The arguments (unused).
+ * @return The number of objects freed.
+ */
+Value pi_gc(vm_t *vm, int argc, Value *argv)
+{
+    int before = vm->counter + vm->old_count;
+
+    run_gc(vm);
+
+    return NEW_NUM(before - vm->old_count);
+}
+
+/**
+ * Gets or sets the number of threads used by the garbage collector.
+ *
+ * On large heaps, unbounded collections may mark on these threads (at most
+ * one per processor) and sweeping may move to a background thread, each
+ * only while it is measured to be cheaper. One thread, the default, keeps
+ * all collection work on the thread running the program.
+ *
+ * @param vm The virtual machine instance.
+ * @param argc The number of arguments (0 or 1).
+ * @param argv Optional new thread count (1 to GC_MAX_THREADS).
+ * @return The thread count (the previous one when setting).
+ */
+Value pi_gc_threads(vm_t *vm, int argc, Value *argv)
+{
+    int threads = vm->gc_threads;
+
+    if (argc > 0)
+    {
+        if (!IS_NUM(argv[0]) || AS_NUM(argv[0]) < 1 || AS_NUM(argv[0]) > GC_MAX_THREADS)
+            vm_errorf(vm, "[gc_threads] expects a number of threads from 1 to %d.", GC_MAX_THREADS);
+        gc_set_threads(vm, (int)AS_NUM(argv[0]));
+    }
+
+    return NEW_NUM(threads);
+}
+
+/**
+ * Creates an empty map registered with the garbage collector.
+ *
+ * @param vm The virtual machine instance.
+ * @return The new map.
+ */
+static PiMap *stats_map(vm_t *vm)
+{
+    return (PiMap *)add_obj(vm, new_map(ht_create(sizeof(Value)), false));
+}
+
+/**
+ * Builds the map describing one collection for gc_stats().
+ *
+ * @param vm The virtual machine instance.
+ * @param cycle The counters of the collection.
+ * @return The map.
+ */
+static Value cycle_stats(vm_t *vm, GCCycle *cycle)
+{
+    PiMap *map = stats_map(vm);
+    PiMap *by_type = stats_map(vm);
+    PiMap *bytes_by_type = stats_map(vm);
+
+    map_put(map, "pause_ms", NEW_NUM(cycle->pause_ms));
+    map_put(map, "max_slice_ms", NEW_NUM(cycle->max_slice_ms));
+    map_put(map, "marked", NEW_NUM(cycle->marked));
+    map_put(map, "freed", NEW_NUM(cycle->freed));
+    map_put(map, "freed_bytes", NEW_NUM(cycle->freed_bytes));
+
+    for (int i = 0; i < GC_TYPE_COUNT; i++)
+    {
+        if (cycle->freed_by_type[i] == 0)
+            continue;
+        map_put(by_type, gc_type_name(i), NEW_NUM(cycle->freed_by_type[i]));
+        map_put(bytes_by_type, gc_type_name(i), NEW_NUM(cycle->freed_bytes_by_type[i]));
+    }
+
+    map_put(map, "freed_by_type", NEW_OBJ(by_type));
+    map_put(map, "freed_bytes_by_type", NEW_OBJ(bytes_by_type));
+
+    return NEW_OBJ(map);
+}
+
+/**
+ * Returns the statistics of the garbage collector as a map.
+ *
+ * The map holds totals since start (`live_objects`, `live_bytes`,
+ * `minor_collections`, `major_collections`, `total_pause_ms`,
+ * `max_pause_ms`), the current `phase` and `threads`, the counters of the
+ * last minor collection and full cycle (`last_minor`, `last_major`) and the
+ * state of the object pool (`pool`).
+ *
+ * @param vm The virtual machine instance.
+ * @param argc The number of arguments (unused).
+ * @param argv The arguments (unused).
+ * @return The statistics map.
+ */
+Value pi_gc_stats(vm_t *vm, int argc, Value *argv)
+{
+    static const char *phases[] = {"idle", "marking", "sweeping"};
+    GCStats *stats = &vm->gc_stats;
+
+    PiMap *map = stats_map(vm);
+    map_put(map, "live_objects", NEW_NUM(vm->counter + vm->old_count));
+    map_put(map, "live_bytes", NEW_NUM(stats->live_bytes));
+    map_put(map, "minor_collections", NEW_NUM(stats->minor_count));
+    map_put(map, "major_collections", NEW_NUM(stats->major_count));
+    map_put(map, "total_pause_ms", NEW_NUM(stats->total_pause_ms));
+    map_put(map, "max_pause_ms", NEW_NUM(stats->max_pause_ms));
+    map_put(map, "phase", NEW_OBJ(add_obj(vm, new_pistring(string_copy(phases[vm->gc_phase])))));
+    map_put(map, "threads", NEW_NUM(vm->gc_threads));
+    map_put(map, "last_minor", cycle_stats(vm, &stats->minor));
+    map_put(map, "last_major", cycle_stats(vm, &stats->major));
+
+    // Object pool (slabs of object cells and of list/table headers)
+    size_t slabs = pool_slabs(vm->pool), cells = 0;
+    for (int i = 0; i < POOL_CLASSES; i++)
+        cells += vm->pool->classes[i].live;
+
+    PiMap *pool = stats_map(vm);
+    map_put(pool, "slabs", NEW_NUM(slabs));
+    map_put(pool, "bytes", NEW_NUM(slabs * POOL_SLAB_SIZE));
+    map_put(pool, "live_cells", NEW_NUM(cells));
+    map_put(pool, "large_allocs", NEW_NUM(vm->pool->large_allocs));
+    map_put(map, "pool", NEW_OBJ(pool));
+
+    return NEW_OBJ(map);
+}
+
 Value _pi_type(vm_t *vm, int argc, Value *argv)
 {
     if (argc == 0)
@@ -18,7 +182,7 @@ Value _pi_type(vm_t *vm, int argc, Value *argv)
 
     char *type = type_name(argv[0]);
 
-    return NEW_OBJ(new_pistring(strdup(type)));
+    return NEW_OBJ(new_pistring(string_copy(type)));
 }
 
 Value pi_error(vm_t *vm, int argc, Value *argv)
@@ -102,7 +266,7 @@ Value pi_mouse(vm_t *vm, int argc, Value *argv)
 Value pi_zen(vm_t *vm, int argc, Value *argv)
 {
 
-    return NEW_OBJ(new_pistring(strdup(
+    return NEW_OBJ(new_pistring(string_copy(
 
         "*********************************************\n"
         " ____ ___ ____   ____ ____  ___ ____ _____  \n"
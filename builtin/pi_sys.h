@@ -5,6 +5,10 @@
 #include "../pi_vm.h"
 
 Value pi_fps(vm_t *vm, int argc, Value *argv);
+Value pi_gc(vm_t *vm, int argc, Value *argv);
+Value pi_gc_budget(vm_t *vm, int argc, Value *argv);
+Value pi_gc_threads(vm_t *vm, int argc, Value *argv);
+Value pi_gc_stats(vm_t *vm, int argc, Value *argv);
 Value _pi_type(vm_t *vm, int argc, Value *argv);
 Value pi_error(vm_t *vm, int argc, Value *argv);
 Value pi_zen(vm_t *vm, int argc, Value *argv);
@@ -18,6 +18,15 @@ Value pi_isMap(vm_t *vm, int argc, Value *argv)
     return NEW_BOOL(IS_MAP(argv[0]));
 }
 
+// Returns true if the argument is a set
+Value pi_isSet(vm_t *vm, int argc, Value *argv)
+{
+    if (argc == 0)
+        vm_error(vm,"[is_set] expects one argument.");
+
+    return NEW_BOOL(IS_SET(argv[0]));
+}
+
 // Returns true if the argument is numeric (integer or float)
 Value pi_isNum(vm_t *vm, int argc, Value *argv)
 {
@@ -9,6 +9,7 @@ Value pi_isStr(vm_t *vm, int argc, Value *argv);
 Value pi_isBool(vm_t *vm, int argc, Value *argv);
 Value pi_isList(vm_t *vm, int argc, Value *argv);
 Value pi_isMap(vm_t *vm, int argc, Value *argv);
+Value pi_isSet(vm_t *vm, int argc, Value *argv);
 
 Value pi_asNum(vm_t *vm, int argc, Value *argv);
 Value pi_asStr(vm_t *vm, int argc, Value *argv);
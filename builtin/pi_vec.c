@@ -0,0 +1,353 @@
+#include "pi_vec.h"
+#include "../list.h"
+
+// An operand of a vector function: a list of numbers or a single number,
+// which is broadcast over the items of the other operands.
+typedef struct
+{
+    const double *data; // The numbers of the list (NULL for a single number)
+    double scalar;      // The number, when `data` is NULL
+    int size;           // Number of items, -1 for a single number
+    double *copy;       // Numbers copied out of a list of Values, freed by free_args
+} VecArg;
+
+typedef enum
+{
+    VEC_ADD,
+    VEC_SUB,
+    VEC_MUL,
+    VEC_DIV,
+} VecOp;
+
+// Fills `out` with `expr` for every index `i`. The loops are kept this
+// simple (no calls, no branches) so that the compiler vectorises them.
+#define VEC_LOOP(expr)          \
+    for (int i = 0; i < n; i++) \
+        out[i] = (expr);
+
+/**
+ * Reads an operand of a vector function. Packed lists are used in place,
+ * lists of Values are copied into an array of doubles.
+ *
+ * @param value The argument.
+ * @param arg The operand.
+ * @return false if the argument is not a number or a list of numbers.
+ */
+static bool load_arg(Value value, VecArg *arg)
+{
+    *arg = (VecArg){NULL, 0, -1, NULL};
+
+    if (IS_NUM(value))
+    {
+        arg->scalar = AS_NUM(value);
+        return true;
+    }
+
+    if (!IS_LIST(value))
+        return false;
+
+    list_t *items = AS_LIST(value)->items;
+    arg->size = items->size;
+
+    if (LIST_PACKED(items))
+    {
+        arg->data = (double *)items->data;
+        return true;
+    }
+
+    arg->copy = malloc(sizeof(double) * (items->size + 1));
+    for (int i = 0; i < items->size; i++)
+    {
+        Value item = ((Value *)items->data)[i];
+        if (!IS_NUM(item))
+            return false;
+        arg->copy[i] = AS_NUM(item);
+    }
+
+    arg->data = arg->copy;
+    return true;
+}
+
+static void free_args(VecArg *args, int count)
+{
+    for (int i = 0; i < count; i++)
+        free(args[i].copy);
+}
+
+/**
+ * Reads the operands of a vector function and checks that the lists
+ * among them have the same length.
+ *
+ * @param vm The virtual machine.
+ * @param name The name of the function, for the error messages.
+ * @param argv The arguments.
+ * @param args The operands.
+ * @param count The number of operands.
+ * @return The length of the lists, -1 if every operand is a number.
+ */
+static int load_args(vm_t *vm, const char *name, Value *argv, VecArg *args, int count)
+{
+    int size = -1;
+
+    for (int i = 0; i < count; i++)
+    {
+        if (!load_arg(argv[i], &args[i]))
+        {
+            free_args(args, i + 1);
+            vm_errorf(vm, "[%s] expects numeric lists or numbers.", name);
+        }
+
+        if (args[i].size < 0)
+            continue;
+
+        if (size >= 0 && args[i].size != size)
+        {
+            free_args(args, i + 1);
+            vm_errorf(vm, "[%s] Lists must be of the same length.", name);
+        }
+        size = args[i].size;
+    }
+
+    return size;
+}
+
+/**
+ * Creates the packed list a vector function writes its result into.
+ *
+ * @param size The number of items.
+ * @param out Set to the items, to be filled by the caller.
+ * @return The new list.
+ */
+static Value new_vector(int size, double **out)
+{
+    list_t *items = list_create(sizeof(double));
+    if (size > items->capacity)
+        list_expand(items, size);
+    items->size = size;
+    *out = (double *)items->data;
+
+    // A numeric vector, as built by a list literal
+    PiList *list = (PiList *)new_list(items);
+    list->rows = 1;
+    list->cols = size;
+
+    return NEW_OBJ(list);
+}
+
+/**
+ * Applies an arithmetic operator to two numbers.
+ */
+static double apply_scalar(VecOp op, double a, double b)
+{
+    switch (op)
+    {
+    case VEC_ADD:
+        return a + b;
+    case VEC_SUB:
+        return a - b;
+    case VEC_MUL:
+        return a * b;
+    default:
+        return a / b;
+    }
+}
+
+/**
+ * Applies an arithmetic operator item by item, broadcasting a number
+ * over the items of a list.
+ *
+ * @param op The operator.
+ * @param out The result.
+ * @param a The left operand.
+ * @param b The right operand.
+ * @param n The number of items.
+ */
+static void apply(VecOp op, double *restrict out, const VecArg *a, const VecArg *b, int n)
+{
+    const double *restrict x = a->data;
+    const double *restrict y = b->data;
+    double s = x ? b->scalar : a->scalar;
+
+    switch (op)
+    {
+    case VEC_ADD:
+        if (x && y)
+            VEC_LOOP(x[i] + y[i])
+        else if (x)
+            VEC_LOOP(x[i] + s)
+        else
+            VEC_LOOP(s + y[i])
+        break;
+
+    case VEC_SUB:
+        if (x && y)
+            VEC_LOOP(x[i] - y[i])
+        else if (x)
+            VEC_LOOP(x[i] - s)
+        else
+            VEC_LOOP(s - y[i])
+        break;
+
+    case VEC_MUL:
+        if (x && y)
+            VEC_LOOP(x[i] * y[i])
+        else if (x)
+            VEC_LOOP(x[i] * s)
+        else
+            VEC_LOOP(s * y[i])
+        break;
+
+    case VEC_DIV:
+        if (x && y)
+            VEC_LOOP(x[i] / y[i])
+        else if (x)
+            VEC_LOOP(x[i] / s)
+        else
+            VEC_LOOP(s / y[i])
+        break;
+    }
+}
+
+/**
+ * Runs a binary vector function.
+ *
+ * @param vm The virtual machine.
+ * @param name The name of the function, for the error messages.
+ * @param op The operator.
+ * @param argc The number of arguments.
+ * @param argv The arguments.
+ * @return A new packed list, or a number if both operands are numbers.
+ */
+static Value vector_op(vm_t *vm, const char *name, VecOp op, int argc, Value *argv)
+{
+    if (argc != 2)
+        vm_errorf(vm, "[%s] expects two arguments: numeric lists or numbers.", name);
+
+    VecArg args[2];
+    int size = load_args(vm, name, argv, args, 2);
+
+    if (size < 0)
+        return NEW_NUM(apply_scalar(op, args[0].scalar, args[1].scalar));
+
+    double *out;
+    Value result = new_vector(size, &out);
+    apply(op, out, &args[0], &args[1], size);
+
+    free_args(args, 2);
+    return result;
+}
+
+/**
+ * @brief Adds two numeric lists item by item.
+ *
+ * Either argument may be a number, which is added to every item of the
+ * other one. Lists must have the same length.
+ *
+ * @return A new numeric list.
+ */
+Value pi_vadd(vm_t *vm, int argc, Value *argv)
+{
+    return vector_op(vm, "vadd", VEC_ADD, argc, argv);
+}
+
+/**
+ * @brief Subtracts two numeric lists item by item (numbers are broadcast).
+ *
+ * @return A new numeric list.
+ */
+Value pi_vsub(vm_t *vm, int argc, Value *argv)
+{
+    return vector_op(vm, "vsub", VEC_SUB, argc, argv);
+}
+
+/**
+ * @brief Multiplies two numeric lists item by item (numbers are broadcast).
+ *
+ * @return A new numeric list.
+ */
+Value pi_vmul(vm_t *vm, int argc, Value *argv)
+{
+    return vector_op(vm, "vmul", VEC_MUL, argc, argv);
+}
+
+/**
+ * @brief Divides two numeric lists item by item (numbers are broadcast).
+ *
+ * @return A new numeric list.
+ */
+Value pi_vdiv(vm_t *vm, int argc, Value *argv)
+{
+    return vector_op(vm, "vdiv", VEC_DIV, argc, argv);
+}
+
+/**
+ * @brief Multiplies every item of a numeric list by a number.
+ *
+ * Accepts a list and a number: vscale(v, s).
+ *
+ * @return A new numeric list.
+ */
+Value pi_vscale(vm_t *vm, int argc, Value *argv)
+{
+    if (argc != 2 || !IS_LIST(argv[0]) || !IS_NUM(argv[1]))
+        vm_error(vm, "[vscale] expects a numeric list and a number.");
+
+    return vector_op(vm, "vscale", VEC_MUL, argc, argv);
+}
+
+/**
+ * @brief Interpolates linearly between two numeric lists: a + (b - a) * t.
+ *
+ * Accepts vlerp(a, b, t). Any argument may be a number, broadcast over the
+ * items of the lists.
+ *
+ * @return A new numeric list, or a number if all arguments are numbers.
+ */
+Value pi_vlerp(vm_t *vm, int argc, Value *argv)
+{
+    if (argc != 3)
+        vm_error(vm, "[vlerp] expects three arguments: a, b and t.");
+
+    VecArg args[3];
+    int n = load_args(vm, "vlerp", argv, args, 3);
+
+    if (n < 0)
+        return NEW_NUM(args[0].scalar + (args[1].scalar - args[0].scalar) * args[2].scalar);
+
+    double *out;
+    Value result = new_vector(n, &out);
+
+    // Broadcast numbers into arrays, except for the common case of two
+    // lists and a single t
+    double *fill = malloc(sizeof(double) * (2 * n + 1));
+    const double *restrict x = args[0].data;
+    const double *restrict y = args[1].data;
+
+    if (!x)
+    {
+        for (int i = 0; i < n; i++)
+            fill[i] = args[0].scalar;
+        x = fill;
+    }
+    if (!y)
+    {
+        for (int i = 0; i < n; i++)
+            fill[n + i] = args[1].scalar;
+        y = fill + n;
+    }
+
+    if (args[2].data)
+    {
+        const double *restrict t = args[2].data;
+        VEC_LOOP(x[i] + (y[i] - x[i]) * t[i])
+    }
+    else
+    {
+        double t = args[2].scalar;
+        VEC_LOOP(x[i] + (y[i] - x[i]) * t)
+    }
+
+    free(fill);
+    free_args(args, 3);
+    return result;
+}
@@ -0,0 +1,16 @@
+#ifndef PI_VEC_H
+#define PI_VEC_H
+
+#include "../pi_value.h"
+#include "../pi_vm.h"
+
+// element-wise arithmetic on numeric lists, numbers are broadcast
+Value pi_vadd(vm_t *vm, int argc, Value *argv);
+Value pi_vsub(vm_t *vm, int argc, Value *argv);
+Value pi_vmul(vm_t *vm, int argc, Value *argv);
+Value pi_vdiv(vm_t *vm, int argc, Value *argv);
+
+Value pi_vscale(vm_t *vm, int argc, Value *argv);
+Value pi_vlerp(vm_t *vm, int argc, Value *argv);
+
+#endif // PI_VEC_H
@@ -272,6 +272,9 @@ static void *vm_run(void *arg)
 {
     vm_t *vm = (vm_t *)arg;
     clock_t start_time = clock();
+
+    // Objects are allocated on this thread while the program runs
+    pool_bind(vm->pool);
     run(vm);
     pthread_mutex_lock(&vm->lock);
     vm->running = false;
@@ -475,7 +478,8 @@ void cmd_run(int argc, char **argv)
 
     char *filename = argv[1];
     const char *ext = strrchr(filename, '.');
-    char *source = NULL;
+    const char *source = NULL;
+    long length = 0;
     bool is_cart = false;
 
     if (shell_io->vm->cart)
@@ -495,35 +499,21 @@ void cmd_run(int argc, char **argv)
             shell_io->out(buffer, SHELL_COLOR, 8, SHELL_END);
             return;
         }
-        source = (char *)cart->code;
+        source = (const char *)cart->code;
+        length = strlen(source);
         shell_io->vm->cart = cart;
     }
     else if (ext && strcmp(ext, ".pi") == 0)
     {
-        FILE *file = fopen(filename, "rb");
-        if (!file)
+        // The scanner reads the mapped file directly, tokens point into it
+        source = map_file(filename, &length);
+        if (!source)
         {
             char buffer[256];
             snprintf(buffer, sizeof(buffer), "Error: Could not open file '%s'.\n", filename);
             shell_io->out(buffer, SHELL_COLOR, 8, SHELL_END);
             return;
         }
-
-        fseek(file, 0, SEEK_END);
-        long length = ftell(file);
-        fseek(file, 0, SEEK_SET);
-
-        source = malloc(length + 1);
-        if (!source)
-        {
-            shell_io->out("Error: Not enough memory to read file.\n", SHELL_COLOR, 8, SHELL_END);
-            fclose(file);
-            return;
-        }
-
-        fread(source, 1, length, file);
-        source[length] = '\0';
-        fclose(file);
     }
     else
     {
@@ -534,7 +524,7 @@ void cmd_run(int argc, char **argv)
     shell_loading("Loading", 200);
 
     // Compile the source code
-    init_scanner(source);
+    init_buffer(source, length);
     token_t *tokens = scan();
     compiler_t *comp = init_compiler();
     parser_t *parser = init_parser(comp, tokens, MODE_FILE);
@@ -720,8 +710,8 @@ void cmd_run(int argc, char **argv)
         }
     }
     else
-        // We allocated source with malloc for .pi files
-        free(source);
+        // .pi files are mapped into memory
+        unmap_file(source, length);
 }
 
 const command_t commands[] = {
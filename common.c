@@ -4,6 +4,16 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdarg.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
 #include "common.h"
 
 error_handlerFn global_errorHandler = NULL;
@@ -116,3 +126,85 @@ void set_errorHandler(error_handlerFn handler)
 {
     global_errorHandler = handler;
 }
+
+/**
+ * Maps a file into memory, read only.
+ *
+ * The contents are not null-terminated: use the returned length. An empty
+ * file maps to an empty string.
+ *
+ * @param path The path of the file.
+ * @param length Set to the size of the file in bytes.
+ * @return The contents of the file, or NULL if it can't be opened or mapped.
+ */
+const char *map_file(const char *path, long *length)
+{
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return NULL;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size))
+    {
+        CloseHandle(file);
+        return NULL;
+    }
+
+    *length = (long)size.QuadPart;
+    if (*length == 0)
+    {
+        CloseHandle(file);
+        return "";
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if (mapping == NULL)
+        return NULL;
+
+    // The view keeps the mapping alive until it is unmapped
+    const char *data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    return data;
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+
+    struct stat st;
+    if (fstat(fd, &st) < 0)
+    {
+        close(fd);
+        return NULL;
+    }
+
+    *length = (long)st.st_size;
+    if (*length == 0)
+    {
+        close(fd);
+        return "";
+    }
+
+    void *data = mmap(NULL, *length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    return data == MAP_FAILED ? NULL : data;
+#endif
+}
+
+/**
+ * Unmaps a file mapped by map_file.
+ *
+ * @param data The contents of the file.
+ * @param length The size of the file in bytes.
+ */
+void unmap_file(const char *data, long length)
+{
+    if (data == NULL || length == 0)
+        return;
+#ifdef _WIN32
+    UnmapViewOfFile(data);
+#else
+    munmap((void *)data, length);
+#endif
+}
@@ -80,4 +80,8 @@ extern error_handlerFn global_errorHandler;
 // Function to set a custom error handler
 void set_errorHandler(error_handlerFn handler);
 
+// Read-only memory mapping of a whole file (the contents aren't null-terminated)
+const char *map_file(const char *path, long *length);
+void unmap_file(const char *data, long length);
+
 #endif
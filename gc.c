@@ -1,30 +1,19 @@
 #include "gc.h"
+#include "gc_worker.h"
+#include "gc_stats.h"
 #include "list.h"
 #include "pi_func.h"
+#include "pi_pool.h"
+#include "pi_set.h"
+#include "pi_heap.h"
+#include "pi_iter.h"
+#include "pi_gen.h"
 
-/**
- * @brief Marks all values in a list as reachable.
- *
- * This function iterates over the list and marks each value
- * as reachable. This is necessary for the garbage collector
- * to know not to free the memory associated with any of the
- * values in the list.
- *
- * @param list The list whose values are to be marked.
- */
-void mark_list(list_t *list)
-{
-    if (!list)
-        return; // If the list is NULL, exit the function
+// Set while a minor collection runs: old objects are then treated as live
+// and are not traversed (young objects they point to are in the remembered set).
+static bool young_only = false;
 
-    int size = list_size(list);
-    for (int i = 0; i < size; i++)
-    {
-        Value *val = (Value *)list_getAt(list, i); // Get the value at index i
-        if (val)
-            mark_value(*val); // Mark the value if it's not NULL
-    }
-}
+static void visit_values(void *ctx, list_t *list, gc_visit visit);
 
 /**
  * @brief Reallocates a memory block to a new size.
@@ -52,50 +41,76 @@ void *reallocate(void *ptr, size_t o_size, size_t n_size)
 }
 
 /**
- * @brief Marks all values in the global hash table as reachable.
+ * Visitor that queues an object for marking.
  *
- * This function iterates over the global hash table and marks each value
- * as reachable. This is necessary so that the garbage collector knows not
- * to free the memory associated with any of the values in the global hash
- * table.
+ * The object is not inspected here, only prefetched: its mark is tested
+ * when it is popped, by which time the header is likely in cache.
  *
- * @param vm The virtual machine.
+ * @param ctx The virtual machine instance.
+ * @param obj The object to queue.
  */
-void mark_globals(vm_t *vm)
+static void mark_push(void *ctx, Object *obj)
 {
-    ht_iter it = ht_iterator(vm->globals);
-    while (ht_next(&it))
-    {
-        Value *val = it.value;
-        if (val != NULL)
-            mark_value(*val);
-    }
+    vm_t *vm = (vm_t *)ctx;
+
+    GC_PREFETCH(obj);
+    mark_stack_push(&vm->mark_stack, obj);
+}
+
+/**
+ * Visitor that shades an object gray for the incremental marker.
+ *
+ * @param ctx The virtual machine instance.
+ * @param obj The object to shade.
+ */
+static void shade_visit(void *ctx, Object *obj)
+{
+    gc_shade((vm_t *)ctx, obj);
 }
 
 /**
- * @brief Marks all iterators in the iterator stack as reachable.
+ * Marks every object queued on the mark stack and everything reachable
+ * from them.
  *
- * This function iterates over the iterator stack and marks each iterator
- * as reachable. This is necessary so that the garbage collector knows not
- * to free the memory associated with any of the iterators in the iterator
- * stack.
+ * Objects go through a small FIFO window between the stack and the marker:
+ * each one is prefetched when it enters the window and scanned
+ * GC_PREFETCH_DEPTH objects later. During a minor collection old objects are
+ * skipped.
  *
- * @param vm The virtual machine.
+ * @param vm The virtual machine instance.
  */
-void mark_iters(vm_t *vm)
+static void drain_marks(vm_t *vm)
 {
-    for (int i = 0; i <= vm->iter_sp; i++)
+    MarkStack *stack = &vm->mark_stack;
+    Object *window[GC_PREFETCH_DEPTH];
+    int head = 0, size = 0;
+
+    while (stack->count > 0 || size > 0)
     {
-        if (vm->iters[i] != NULL)
-            mark_object(vm->iters[i]);
+        // Refill the window from the stack
+        while (size < GC_PREFETCH_DEPTH && stack->count > 0)
+        {
+            Object *next = stack->items[--stack->count];
+            GC_PREFETCH(next);
+            window[(head + size++) % GC_PREFETCH_DEPTH] = next;
+        }
+
+        Object *obj = window[head];
+        head = (head + 1) % GC_PREFETCH_DEPTH;
+        size--;
+
+        if (obj->is_marked || (young_only && obj->generation == GEN_OLD))
+            continue;
+        obj->is_marked = true;
+
+        visit_children(vm, obj, mark_push);
     }
 }
 
 void mark_constants(vm_t *vm)
 {
-    int count = list_size(vm->constants);
-    for (int i = 0; i < count; i++)
-        mark_value(*(Value *)list_getAt(vm->constants, i));
+    visit_values(vm, vm->constants, mark_push);
+    drain_marks(vm);
 }
 
 /**
@@ -103,51 +118,92 @@ void mark_constants(vm_t *vm)
  *
  * If the value is an object, marks the object as reachable.
  *
+ * @param vm The virtual machine instance.
  * @param val The value to mark.
  */
-void mark_value(Value val)
+void mark_value(vm_t *vm, Value val)
 {
     if (IS_OBJ(val))
-        mark_object(AS_OBJ(val));
+        mark_object(vm, AS_OBJ(val));
 }
 
 /**
  * @brief Marks an object as reachable.
  *
- * If the object is not marked, marks it as reachable and recursively marks any
- * referenced objects based on the object type.
+ * If the object is not marked, marks it as reachable along with every object
+ * it references. The traversal uses the VM's mark stack rather than
+ * recursion, so deeply nested structures cannot overflow the C stack.
+ * During a minor collection old objects are skipped.
  *
+ * @param vm The virtual machine instance.
  * @param obj The object to mark.
  */
-void mark_object(Object *obj)
+void mark_object(vm_t *vm, Object *obj)
 {
-    if (obj == NULL || obj->is_marked)
+    if (obj == NULL)
         return;
-    obj->is_marked = true;
 
-    // Recursively mark any referenced objects based on the object type.
+    mark_push(vm, obj);
+    drain_marks(vm);
+}
+
+/**
+ * Applies a visitor to every object value stored in a list.
+ *
+ * @param ctx The context passed on to the visitor.
+ * @param list The list of values (may be NULL).
+ * @param visit The visitor.
+ */
+static void visit_values(void *ctx, list_t *list, gc_visit visit)
+{
+    if (!list)
+        return;
+
+    int size = list_size(list);
+    for (int i = 0; i < size; i++)
+    {
+        Value *val = (Value *)list_getAt(list, i);
+        if (val && IS_OBJ(*val))
+            visit(ctx, AS_OBJ(*val));
+    }
+}
+
+/**
+ * @brief Applies a visitor to every object referenced by an object.
+ *
+ * The object itself is not visited. This is shared by the marker
+ * of minor collections, by the incremental marker of full collections and
+ * by the parallel mark workers. It only reads the object, so several
+ * threads may traverse the heap at once.
+ *
+ * @param ctx The context passed on to the visitor.
+ * @param obj The object whose children are visited.
+ * @param visit The visitor.
+ */
+void visit_children(void *ctx, Object *obj, gc_visit visit)
+{
     switch (obj->type)
     {
     case OBJ_LIST:
-    {
-        // Mark the elements of a list
-        PiList *list = (PiList *)obj;
-        int size = LIST_SIZE(list->items);
-        for (int i = 0; i < size; i++)
-        {
-            Value *item = (Value *)list_getAt(list->items, i);
-            if (item)
-                mark_value(*item); // Ensure items inside lists are also marked
-        }
+        // Visit the elements of a list (packed numbers hold no references)
+        if (!LIST_PACKED(((PiList *)obj)->items))
+            visit_values(ctx, ((PiList *)obj)->items, visit);
         break;
-    }
 
     case OBJ_MAP:
     {
         PiMap *map = (PiMap *)obj;
 
         if (map->proto)
-            mark_object((Object *)map->proto);
+            visit(ctx, (Object *)map->proto);
+
+        if (map->shape)
+        {
+            for (int i = 0; i < map->shape->count; i++)
+                if (IS_OBJ(map->fields[i]))
+                    visit(ctx, AS_OBJ(map->fields[i]));
+            break;
+        }
 
         table_t *table = map->table;
         if (!table)
@@ -160,34 +216,80 @@ void mark_object(Object *obj)
                 continue;
 
             Value *val = (Value *)item->value;
-            if (val && IS_OBJ(*val))
-                mark_object(AS_OBJ(*val));
+            if (IS_OBJ(*val))
+                visit(ctx, AS_OBJ(*val));
         }
         break;
     }
 
-    case OBJ_CODE:
+    case OBJ_SET:
     {
-        ObjCode *code = (ObjCode *)obj;
-        mark_list(code->data); // if necessary
+        PiSet *set = (PiSet *)obj;
+        for (int i = 0; i < set->count; i++)
+            if (set->entries[i].live && IS_OBJ(set->entries[i].value))
+                visit(ctx, AS_OBJ(set->entries[i].value));
         break;
     }
 
+    case OBJ_HEAP:
+    {
+        PiHeap *heap = (PiHeap *)obj;
+        for (int i = 0; i < heap->size; i++)
+            if (IS_OBJ(heap->entries[i].value))
+                visit(ctx, AS_OBJ(heap->entries[i].value));
+        break;
+    }
+
+    case OBJ_ITER:
+    {
+        PiIter *iter = (PiIter *)obj;
+        visit(ctx, AS_OBJ(iter->source));
+        if (IS_OBJ(iter->value))
+            visit(ctx, AS_OBJ(iter->value));
+        for (int i = 0; i < iter->stage_count; i++)
+            if (IS_OBJ(iter->stages[i].fn))
+                visit(ctx, AS_OBJ(iter->stages[i].fn));
+        break;
+    }
+
+    case OBJ_GEN:
+    {
+        // Only a suspended generator holds its frame; a running one is on the stack
+        PiGen *gen = (PiGen *)obj;
+        visit(ctx, gen->function);
+        for (int i = 0; i < gen->slot_count; i++)
+            if (IS_OBJ(gen->slots[i]))
+                visit(ctx, AS_OBJ(gen->slots[i]));
+        for (int i = 0; i < gen->iter_count; i++)
+            visit(ctx, gen->iters[i]);
+        for (int i = 0; i < gen->upvalue_count; i++)
+            if (IS_OBJ(gen->upvalues[i].upvalue->value))
+                visit(ctx, AS_OBJ(gen->upvalues[i].upvalue->value));
+        break;
+    }
+
+    case OBJ_CODE:
+        // Code holds only bytes; its constants are rooted through vm->constants
+        break;
+
     case OBJ_FUN:
     {
         Function *fn = (Function *)obj;
 
-        mark_list(fn->params);
+        visit_values(ctx, fn->params, visit);
 
         if (fn->body)
-            mark_object((Object *)fn->body);
+            visit(ctx, (Object *)fn->body);
 
+        // Closed upvalues hold their value; open ones point into the stack
         if (fn->upvalues)
             for (int i = 0; i < fn->upvalue_count; i++)
-                mark_object((Object *)fn->upvalues[i]);
+                if (fn->upvalues[i] && fn->upvalues[i]->index == -1 &&
+                    IS_OBJ(fn->upvalues[i]->value))
+                    visit(ctx, AS_OBJ(fn->upvalues[i]->value));
 
         if (fn->instance)
-            mark_object(fn->instance);
+            visit(ctx, fn->instance);
 
         break;
     }
@@ -198,33 +300,65 @@ void mark_object(Object *obj)
 }
 
 /**
- * @brief Sweeps through the VM's object list, freeing unmarked objects.
+ * Applies a visitor to every root of the VM: globals, iterators, constants,
+ * the value stack, the functions of the active frames and open upvalues.
  *
- * This function iterates over the linked list of objects in the virtual machine.
- * It checks each object to see if it is marked. Unmarked objects are considered
- * unreachable and are freed. The function also updates the linked list to remove
- * the freed objects. Marked objects are prepared for the next garbage collection
- * cycle by resetting their mark status.
- *
- * @param vm The virtual machine instance containing the objects to be swept.
+ * @param vm The virtual machine instance.
+ * @param visit The visitor.
  */
+static void visit_roots(vm_t *vm, gc_visit visit)
+{
+    ht_iter it = ht_iterator(vm->globals);
+    while (ht_next(&it))
+    {
+        Value *val = it.value;
+        if (val != NULL && IS_OBJ(*val))
+            visit(vm, AS_OBJ(*val));
+    }
+
+    for (int i = 0; i <= vm->iter_sp; i++)
+        if (vm->iters[i] != NULL)
+            visit(vm, vm->iters[i]);
+
+    visit_values(vm, vm->constants, visit);
+
+    // Stack values
+    for (int i = 0; i < vm->sp; i++)
+        if (IS_OBJ(vm->stack[i]))
+            visit(vm, AS_OBJ(vm->stack[i]));
+
+    for (int i = 0; i < vm->frame_sp; i++)
+    {
+        Frame *frame = vm->frames[i];
+        if (frame != NULL && frame->function != NULL)
+            visit(vm, (Object *)frame->function);
+        if (frame != NULL && frame->generator != NULL)
+            visit(vm, frame->generator);
+    }
+
+    // Current function
+    if (vm->function)
+        visit(vm, vm->function);
+
+    // Open upvalues (linked list)
+    for (UpValue *up = vm->openUpvalues; up != NULL; up = up->next)
+        if (IS_OBJ(up->value))
+            visit(vm, AS_OBJ(up->value));
+}
 
 /**
- * @brief Sweeps through the VM's object list, freeing unmarked objects.
+ * @brief Sweeps the nursery after a minor mark.
  *
- * This function iterates over the linked list of objects in the virtual machine.
- * It checks each object to see if it is marked. Unmarked objects are considered
- * unreachable and are freed. The function also updates the linked list to remove
- * the freed objects. Marked objects are prepared for the next garbage collection
- * cycle by resetting their mark status.
+ * Unmarked young objects are unreachable and are freed. Survivors are
+ * promoted to the old generation. If a full collection is marking, they are
+ * shaded gray so the incremental marker still scans their children.
  *
- * @param vm The virtual machine instance containing the objects to be swept.
+ * @param vm The virtual machine instance.
+ * @param cycle The statistics of the minor collection.
  */
-void sweep(vm_t *vm)
+static void sweep_nursery(vm_t *vm, GCCycle *cycle)
 {
-
     Object *obj = vm->objects;
-    Object *prev = NULL;
 
     while (obj != NULL)
     {
@@ -233,38 +367,43 @@ void sweep(vm_t *vm)
         if (!obj->is_marked)
         {
             // If the object is unmarked, it is unreachable and should be freed
-            obj->in_gcList = false; // Reset the GC tracking flag
-
-            free_object(obj); // Free the memory of the unmarked object
-
-            // Remove the object from the linked list
-            if (prev != NULL)
-                prev->next = next;
-            else
-                vm->objects = next;
+            gc_count_free(cycle, obj);
+            vm->gc_stats.live_bytes -= object_size(obj);
+            free_object(vm, obj);
         }
         else
         {
-            obj->is_marked = false; // Reset the mark for the next GC cycle
-            obj->in_gcList = true;  // Ensure it remains in the GC list
-            prev = obj;             // Move prev to current object
+            // Survivor of the nursery: move it to the old generation
+            cycle->marked++;
+            obj->is_marked = false;
+            obj->generation = GEN_OLD;
+            obj->next = vm->old_objects;
+            vm->old_objects = obj;
+            vm->old_count++;
+
+            if (vm->gc_phase == GC_MARKING)
+                gc_shade(vm, obj);
+            else
+                obj->gc_color = GC_WHITE;
         }
 
         obj = next; // Move to the next object in the list
     }
+
+    vm->objects = NULL;
 }
 
 /**
- * Frees the allocated memory for an object based on its type.
+ * Frees the data structures owned by an object, such as the characters of
+ * a string or the items of a list, but not the object itself.
  *
- * This function will deallocate the memory used by the object and any
- * associated data structures it contains, such as strings or lists.
+ * Only the C allocator is used, so the background sweeper may call this
+ * off the VM thread.
  *
- * @param obj The object to be freed.
+ * @param obj The object whose contents are freed.
  */
-void free_object(Object *obj)
+void release_object(Object *obj)
 {
-
     obj->in_gcList = false; // Prevent stale GC tracking
 
     switch (obj->type)
@@ -290,7 +429,39 @@ void free_object(Object *obj)
         PiMap *map = (PiMap *)obj;
         // Values stored in the table are plain Value cells. Any nested
         // objects are owned by the VM object list and must not be freed here.
-        ht_free(map->table);
+        // Shapes are shared and owned by the VM; only the field array is ours.
+        if (map->shape)
+            free(map->fields);
+        else
+            ht_free(map->table);
+        break;
+    }
+
+    case OBJ_SET:
+    {
+        // Free the entries and the index of the set, not the items
+        set_free((PiSet *)obj);
+        break;
+    }
+
+    case OBJ_HEAP:
+    {
+        // Free the items array and the handles of the priority queue
+        heap_free((PiHeap *)obj);
+        break;
+    }
+
+    case OBJ_ITER:
+    {
+        // Free the stages of the iterator, not its source
+        iter_free((PiIter *)obj);
+        break;
+    }
+
+    case OBJ_GEN:
+    {
+        // Free the saved frame of the generator
+        gen_free((PiGen *)obj);
         break;
     }
 
@@ -299,6 +470,8 @@ void free_object(Object *obj)
         // Free the memory allocated for the code list
         ObjCode *code = (ObjCode *)obj;
         list_free(code->data);
+        if (code->lines)
+            list_free(code->lines);
         break;
     }
 
@@ -337,8 +510,23 @@ void free_object(Object *obj)
         // Handle other object types if needed
         break;
     }
-    // Free the memory allocated for the object itself
-    free(obj);
+}
+
+/**
+ * Frees the allocated memory for an object based on its type.
+ *
+ * This function will deallocate the memory used by the object and any
+ * associated data structures it contains, such as strings or lists.
+ *
+ * @param vm The virtual machine whose pool the object came from.
+ * @param obj The object to be freed.
+ */
+void free_object(vm_t *vm, Object *obj)
+{
+    release_object(obj);
+
+    // Return the memory of the object itself to the pool
+    pool_free(vm->pool, obj);
 }
 
 /**
@@ -347,76 +535,517 @@ void free_object(Object *obj)
  * This function checks the type of the Value and frees any associated
  * objects if necessary. It then frees the Value struct itself.
  *
+ * @param vm The virtual machine that owns the value.
  * @param val The Value to be freed.
  */
-void free_value(Value *val)
+void free_value(vm_t *vm, Value *val)
 {
     if (val == NULL)
         return;
 
     // If the value is an object, free the associated object.
     if (val->type == VAL_OBJ)
-        free_object(AS_OBJ(*val));
+        free_object(vm, AS_OBJ(*val));
 
     // Free the allocated Value struct.
     free(val);
 }
 
 /**
- * Marks all roots: typically the VM's stack, global variables, etc.
+ * Adds a young object to the VM's remembered set.
+ *
+ * A young object is remembered when it is stored into an old object (or
+ * somewhere the collector does not trace, like a closed upvalue), and the
+ * next minor collection treats it as a root. Remembering the stored object
+ * rather than the old container keeps minor collections from rescanning
+ * large old lists and maps that only had a few slots written.
  *
- * This function traverses all reachable objects from the roots and marks them
- * as live. This is the first step of the garbage collection process.
+ * @param vm The virtual machine instance.
+ * @param obj The object to remember.
  */
-void mark_roots(vm_t *vm)
+void gc_remember(vm_t *vm, Object *obj)
 {
-    // Stack values
-    for (int i = 0; i < vm->sp; i++)
-        mark_value(vm->stack[i]);
+    if (obj->generation != GEN_YOUNG || !obj->in_gcList || obj->remembered)
+        return;
 
-    // If your VM has global variables or other roots (e.g. open upvalues, etc.),
-    // mark them here as well.
+    if (vm->remembered_count == vm->remembered_capacity)
+    {
+        vm->remembered_capacity = vm->remembered_capacity ? vm->remembered_capacity * 2 : 64;
+        vm->remembered = (Object **)reallocate(vm->remembered, 0,
+                                               sizeof(Object *) * vm->remembered_capacity);
+    }
 
-    for (int i = 0; i < vm->frame_sp; i++)
+    obj->remembered = true;
+    vm->remembered[vm->remembered_count++] = obj;
+}
+
+/**
+ * Empties the remembered set.
+ *
+ * @param vm The virtual machine instance.
+ */
+static void clear_remembered(vm_t *vm)
+{
+    for (int i = 0; i < vm->remembered_count; i++)
+        vm->remembered[i]->remembered = false;
+    vm->remembered_count = 0;
+}
+
+/**
+ * Run a minor garbage collection cycle.
+ *
+ * Only the young generation is collected: marking stops at old objects, the
+ * remembered set supplies the young objects referenced from old ones, and
+ * survivors are promoted. The work done is proportional to the roots, the
+ * remembered set and the nursery, not to the size of the old generation.
+ *
+ * @param vm The virtual machine instance.
+ */
+void minor_gc(vm_t *vm)
+{
+    GCCycle cycle = {0};
+    double start = gc_clock_ms();
+
+    young_only = true;
+
+    visit_roots(vm, mark_push);
+
+    for (int i = 0; i < vm->remembered_count; i++)
+        mark_push(vm, vm->remembered[i]);
+    clear_remembered(vm);
+
+    drain_marks(vm);
+
+    young_only = false;
+
+    // Freed cells go straight back to their free lists; slabs are only
+    // compacted by full collections.
+    sweep_nursery(vm, &cycle);
+
+    gc_count_pause(&vm->gc_stats, &cycle, start);
+    gc_cycle_end(&vm->gc_stats, &cycle, false, vm->old_count);
+}
+
+/**
+ * Shades an object gray: it is known to be reachable but its children have
+ * not been scanned yet.
+ *
+ * @param vm The virtual machine instance.
+ * @param obj The object to shade.
+ */
+void gc_shade(vm_t *vm, Object *obj)
+{
+    if (obj == NULL || obj->gc_color != GC_WHITE)
+        return;
+
+    obj->gc_color = GC_GRAY;
+    mark_stack_push(&vm->gc_stack, obj);
+
+    // Young objects waiting on the gray stack must survive minor collections
+    gc_remember(vm, obj);
+}
+
+/**
+ * Shades the next GC_SCAN_CHUNK elements of the list being scanned in parts.
+ *
+ * @param vm The virtual machine instance.
+ */
+static void scan_chunk(vm_t *vm)
+{
+    list_t *items = ((PiList *)vm->gc_scan)->items;
+    int end = vm->gc_scan_index + GC_SCAN_CHUNK;
+
+    if (end >= list_size(items))
     {
-        Frame *frame = vm->frames[i];
-        if (frame != NULL && frame->function != NULL)
-            mark_object((Object *)frame->function);
+        end = list_size(items);
+        vm->gc_scan = NULL;
     }
 
-    // Current function
-    if (vm->function)
-        mark_object(vm->function);
+    for (int i = vm->gc_scan_index; i < end; i++)
+    {
+        // Fetch the header of an element a few slots ahead
+        if (i + GC_PREFETCH_DEPTH < end)
+        {
+            Value *ahead = (Value *)list_getAt(items, i + GC_PREFETCH_DEPTH);
+            if (IS_OBJ(*ahead))
+                GC_PREFETCH(AS_OBJ(*ahead));
+        }
 
-    // Open upvalues (linked list)
-    UpValue *up = vm->openUpvalues;
-    while (up != NULL)
+        Value *val = (Value *)list_getAt(items, i);
+        if (IS_OBJ(*val))
+            gc_shade(vm, AS_OBJ(*val));
+    }
+    vm->gc_scan_index = end;
+}
+
+/**
+ * Performs one unit of marking work: scans a gray object (its children are
+ * shaded and it becomes black) or the next chunk of a large list.
+ *
+ * Lists longer than GC_SCAN_CHUNK are turned black first and then scanned a
+ * chunk at a time, so a single huge list does not blow the slice budget.
+ * Being black, writes into them go through the write barrier meanwhile.
+ *
+ * @param vm The virtual machine instance.
+ * @return The amount of work done (a chunk counts as GC_STEP_CHECK
+ *         objects), or 0 if there was nothing left to mark.
+ */
+static int mark_step(vm_t *vm)
+{
+    if (vm->gc_scan)
     {
-        mark_value(up->value);
-        up = up->next;
+        scan_chunk(vm);
+        return GC_STEP_CHECK;
     }
+
+    MarkStack *gray = &vm->gc_stack;
+    if (gray->count == 0)
+        return 0;
+
+    Object *obj = gray->items[--gray->count];
+    obj->gc_color = GC_BLACK;
+
+    // The next gray object is scanned right after this one
+    if (gray->count > 0)
+        GC_PREFETCH(gray->items[gray->count - 1]);
+
+    if (obj->type == OBJ_LIST && list_size(((PiList *)obj)->items) > GC_SCAN_CHUNK &&
+        !LIST_PACKED(((PiList *)obj)->items))
+    {
+        vm->gc_scan = obj;
+        vm->gc_scan_index = 0;
+        return 1;
+    }
+
+    visit_children(vm, obj, shade_visit);
+    return 1;
+}
+
+/**
+ * Returns the helper threads of the collector, starting them if needed.
+ *
+ * Helpers are only considered on heaps of GC_PARALLEL_MIN old objects or
+ * more, and never outnumber the processors; whether a cycle actually uses
+ * them is then decided by the measurements in the pool (see gc_gate_pick()).
+ *
+ * @param vm The virtual machine instance.
+ * @return The worker pool, or NULL if the collector runs single-threaded.
+ */
+static GCWorkers *get_workers(vm_t *vm)
+{
+    int threads = vm->gc_threads < gc_cpu_count() ? vm->gc_threads : gc_cpu_count();
+    if (threads <= 1 || vm->old_count < GC_PARALLEL_MIN)
+        return NULL;
+
+    if (!vm->gc_workers)
+    {
+        vm->gc_workers = gc_workers_create(threads - 1);
+        if (!vm->gc_workers)
+            vm->gc_threads = 1; // Threads are not available on this platform
+    }
+
+    return vm->gc_workers;
+}
+
+/**
+ * Drains the gray stack on all collector threads, when the current cycle
+ * was set to mark with the helpers.
+ *
+ * @param vm The virtual machine instance.
+ */
+static void mark_parallel(vm_t *vm)
+{
+    GCWorkers *pool = vm->gc_workers;
+    if (!pool || !pool->measuring || !pool->mark.helpers)
+        return;
+
+    // Finish a list that was being scanned in chunks
+    while (vm->gc_scan)
+        scan_chunk(vm);
+
+    gc_mark_parallel(vm, pool);
+}
+
+/**
+ * Sets the number of threads used by the collector.
+ *
+ * A background sweep in progress is completed and the helper threads are
+ * stopped; new ones are started when next needed.
+ *
+ * @param vm The virtual machine instance.
+ * @param threads The number of threads, the VM thread included.
+ */
+void gc_set_threads(vm_t *vm, int threads)
+{
+    if (vm->gc_workers)
+    {
+        if (vm->gc_workers->sweeping)
+            gc_sweep_finish(vm, vm->gc_workers, true);
+
+        gc_workers_destroy(vm->gc_workers);
+        vm->gc_workers = NULL;
+    }
+
+    vm->gc_threads = threads;
+}
+
+/**
+ * Starts an incremental full collection.
+ *
+ * The roots are shaded gray; the rest of the heap is traced by gc_step().
+ * Should be called right after a minor collection, while the nursery is
+ * empty.
+ *
+ * @param vm The virtual machine instance.
+ */
+void gc_begin(vm_t *vm)
+{
+    if (vm->gc_phase != GC_IDLE)
+        return;
+
+    double start = gc_clock_ms();
+
+    vm->gc_phase = GC_MARKING;
+    visit_roots(vm, shade_visit);
+
+    // Decide whether the helpers mark this cycle, and time it to find out
+    // if they were worth it
+    GCWorkers *pool = get_workers(vm);
+    if (pool)
+        gc_gate_pick(&pool->mark);
+    if (vm->gc_workers)
+        vm->gc_workers->measuring = pool != NULL;
+
+    gc_count_pause(&vm->gc_stats, &vm->gc_stats.current, start);
+}
+
+/**
+ * Ends the mark phase.
+ *
+ * Roots are scanned once more (they are not covered by write barriers) and
+ * the gray stack is drained, then the old generation is handed over to the
+ * sweeper.
+ *
+ * @param vm The virtual machine instance.
+ */
+static void finish_marking(vm_t *vm)
+{
+    visit_roots(vm, shade_visit);
+    while (mark_step(vm))
+        ;
+
+    // Objects promoted from now on go to a fresh list and are not swept.
+    // Large heaps may be swept by a helper thread while the program runs.
+    GCWorkers *pool = vm->gc_workers;
+    if (pool && pool->measuring)
+        pool->objects = vm->old_count;
+
+    if (pool && pool->measuring && gc_gate_pick(&pool->sweep))
+        gc_sweep_start(pool, vm->old_objects);
+    else
+        vm->sweep_objects = vm->old_objects;
+
+    vm->old_objects = NULL;
+    vm->gc_phase = GC_SWEEPING;
+}
+
+/**
+ * Ends a full collection and schedules the next one.
+ *
+ * @param vm The virtual machine instance.
+ */
+static void finish_sweeping(vm_t *vm)
+{
+    // Let the old generation double before the next full collection.
+    int growth = vm->old_count;
+    if (growth < GC_MIN_THRESHOLD)
+        growth = GC_MIN_THRESHOLD;
+    else if (growth > GC_MAX_THRESHOLD)
+        growth = GC_MAX_THRESHOLD;
+    vm->next_major = vm->old_count + growth;
+
+    GCWorkers *pool = vm->gc_workers;
+    if (pool && pool->measuring)
+    {
+        gc_gate_record(&pool->mark, pool->objects);
+        gc_gate_record(&pool->sweep, pool->objects);
+        pool->measuring = false;
+    }
+
+    vm->gc_phase = GC_IDLE;
+}
+
+/**
+ * Adds the time since `*since` to the phase of the current cycle it was
+ * spent in, for the measurements of the helpers.
+ *
+ * @param vm The virtual machine instance.
+ * @param phase The phase the time was spent in.
+ * @param since Start of the time to add; reset to the current time.
+ */
+static void charge_time(vm_t *vm, GCPhase phase, double *since)
+{
+    GCWorkers *pool = vm->gc_workers;
+    if (!pool || !pool->measuring)
+        return;
+
+    double now = gc_clock_ms();
+    GCGate *gate = phase == GC_MARKING ? &pool->mark : &pool->sweep;
+    gate->ms += now - *since;
+    *since = now;
+}
+
+/**
+ * Does the work of one slice of a full collection (see gc_step()).
+ *
+ * @param vm The virtual machine instance.
+ * @param budget The time budget of the slice in milliseconds (0 = no limit).
+ * @return true if no collection is in progress after the slice.
+ */
+static bool run_slice(vm_t *vm, double budget)
+{
+    double start = gc_clock_ms();
+    double deadline = start + budget;
+    int work = 0;
+
+    // Without a time limit the gray objects may as well be shared out
+    if (vm->gc_phase == GC_MARKING && budget == 0)
+        mark_parallel(vm);
+
+    while (vm->gc_phase == GC_MARKING)
+    {
+        int done = mark_step(vm);
+        if (done == 0)
+        {
+            finish_marking(vm);
+            charge_time(vm, GC_MARKING, &start);
+            break;
+        }
+
+        work += done;
+        if (budget > 0 && work >= GC_STEP_CHECK)
+        {
+            work = 0;
+            if (gc_clock_ms() >= deadline)
+            {
+                charge_time(vm, GC_MARKING, &start);
+                return false;
+            }
+        }
+    }
+
+    if (vm->gc_phase == GC_SWEEPING && vm->gc_workers && vm->gc_workers->sweeping &&
+        !gc_sweep_finish(vm, vm->gc_workers, budget == 0))
+    {
+        charge_time(vm, GC_SWEEPING, &start);
+        return false;
+    }
+
+    while (vm->gc_phase == GC_SWEEPING)
+    {
+        // Cells freed by the background sweeper go back to the pool first
+        if (vm->dead_cells)
+        {
+            Object *cell = vm->dead_cells;
+            vm->dead_cells = cell->next;
+            pool_free(vm->pool, cell);
+        }
+        else
+        {
+            Object *obj = vm->sweep_objects;
+            if (obj == NULL)
+            {
+                charge_time(vm, GC_SWEEPING, &start);
+                finish_sweeping(vm);
+                break;
+            }
+            vm->sweep_objects = obj->next;
+
+            if (obj->gc_color == GC_WHITE)
+            {
+                gc_count_free(&vm->gc_stats.current, obj);
+                vm->gc_stats.live_bytes -= object_size(obj);
+                free_object(vm, obj);
+                vm->old_count--;
+            }
+            else
+            {
+                vm->gc_stats.current.marked++;
+                obj->gc_color = GC_WHITE; // Reset the color for the next cycle
+                obj->next = vm->old_objects;
+                vm->old_objects = obj;
+            }
+        }
+
+        if (budget > 0 && ++work >= GC_STEP_CHECK)
+        {
+            work = 0;
+            if (gc_clock_ms() >= deadline)
+            {
+                charge_time(vm, GC_SWEEPING, &start);
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Performs one slice of an incremental full collection.
+ *
+ * Gray objects are scanned, then dead old objects are freed, until the
+ * time budget runs out. The clock is checked every GC_STEP_CHECK units of
+ * work (an object, or a chunk of a large list).
+ *
+ * On large heaps with helper threads, an unbounded slice may mark on all
+ * collector threads, and the sweep may run on a helper thread: slices then
+ * only wait for it (if unbounded) and return the freed cells to the pool.
+ * Either is kept only while it is measured to cost the VM thread less than
+ * doing the work alone.
+ *
+ * @param vm The virtual machine instance.
+ * @param budget The time budget of the slice in milliseconds (0 = no limit).
+ * @return true if no collection is in progress after the slice.
+ */
+bool gc_step(vm_t *vm, double budget)
+{
+    if (vm->gc_phase == GC_IDLE)
+        return true;
+
+    double start = gc_clock_ms();
+    bool done = run_slice(vm, budget);
+
+    gc_count_pause(&vm->gc_stats, &vm->gc_stats.current, start);
+    if (done)
+        gc_cycle_end(&vm->gc_stats, &vm->gc_stats.current, true, vm->old_count);
+
+    return done;
 }
 
 /**
- * Run a full garbage collection cycle.
+ * Run a full garbage collection cycle without interruption.
  *
- * This will mark all reachable objects (by traversing the roots), and then
- * sweep the heap to free any unreachable objects.
+ * A collection already in progress is completed first, then a new one
+ * marks all reachable objects (by traversing the roots) and sweeps the old
+ * generation.
  *
  * @param vm The virtual machine instance.
  */
 void run_gc(vm_t *vm)
 {
+    gc_step(vm, 0);
 
-    mark_globals(vm);
-    mark_iters(vm);
-    mark_constants(vm);
+    minor_gc(vm);
+    gc_begin(vm);
+    gc_step(vm, 0);
 
-    // Mark all roots: typically the VM's stack, global variables, etc.
-    mark_roots(vm);
+    vm->counter = 0;
+    vm->obj_count = vm->old_count;
 
-    // Sweep the heap to free any unreachable objects.
-    sweep(vm);
+    // Re-thread the freed cells so the next allocations are packed together.
+    // Incremental cycles skip this: it walks every slab in one go.
+    pool_rebuild(vm->pool);
 }
 
 /**
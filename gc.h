@@ -3,21 +3,107 @@
 #include "pi_object.h"
 #include "pi_vm.h"
 
+// Units of work (objects or list chunks) between two clock checks of an
+// incremental slice.
+#define GC_STEP_CHECK 64
+
+// Lists longer than this are scanned this many elements at a time.
+#define GC_SCAN_CHUNK 1024
+
+// Number of objects the marker keeps in flight between prefetching an
+// object header and scanning it.
+#define GC_PREFETCH_DEPTH 8
+
+// Issues a prefetch for an object header that will be scanned shortly.
+#if defined(__GNUC__)
+#define GC_PREFETCH(ptr) __builtin_prefetch(ptr)
+#else
+#define GC_PREFETCH(ptr) ((void)(ptr))
+#endif
+
+// Callback applied to every object reached by a traversal.
+typedef void (*gc_visit)(void *ctx, Object *obj);
+
 void *reallocate(void *ptr, size_t o_size, size_t n_size);
 
 void mark_constants(vm_t *vm);
 
-void mark_value(Value val);
-void mark_object(Object *obj);
-void mark_roots(vm_t *vm);
-void mark_globals(vm_t *vm);
-void mark_iters(vm_t *vm);
+void mark_value(vm_t *vm, Value val);
+void mark_object(vm_t *vm, Object *obj);
 
-void sweep(vm_t *vm);
+void visit_children(void *ctx, Object *obj, gc_visit visit);
 
-void free_object(Object *obj);
-void free_value(Value *val);
+void release_object(Object *obj);
+void free_object(vm_t *vm, Object *obj);
+void free_value(vm_t *vm, Value *val);
 
 void run_gc(vm_t *vm);
+void minor_gc(vm_t *vm);
+
+void gc_begin(vm_t *vm);
+bool gc_step(vm_t *vm, double budget);
+void gc_set_threads(vm_t *vm, int threads);
+void gc_shade(vm_t *vm, Object *obj);
+void gc_remember(vm_t *vm, Object *obj);
+
+/**
+ * Pushes an object onto a mark stack, growing it when full.
+ *
+ * @param stack The stack.
+ * @param obj The object to push.
+ */
+static inline void mark_stack_push(MarkStack *stack, Object *obj)
+{
+    if (stack->count == stack->capacity)
+    {
+        stack->capacity = stack->capacity ? stack->capacity * 2 : 256;
+        stack->items = (Object **)reallocate(stack->items, 0, sizeof(Object *) * stack->capacity);
+    }
+    stack->items[stack->count++] = obj;
+}
+
+/**
+ * Write barrier: must be called when a value is stored into an object.
+ *
+ * A young value stored into an old object is remembered, so minor
+ * collections don't need to scan the old generation. While a full
+ * collection is marking, a white value stored into a black object is
+ * shaded so the incremental marker does not miss it.
+ *
+ * @param vm The virtual machine instance.
+ * @param owner The object being written to.
+ * @param value The value being stored.
+ */
+static inline void write_barrier(vm_t *vm, Object *owner, Value value)
+{
+    if (!IS_OBJ(value))
+        return;
+
+    if (owner->generation == GEN_OLD && AS_OBJ(value)->generation == GEN_YOUNG)
+        gc_remember(vm, AS_OBJ(value));
+
+    if (vm->gc_phase == GC_MARKING && owner->gc_color == GC_BLACK)
+        gc_shade(vm, AS_OBJ(value));
+}
+
+/**
+ * Write barrier for stores the collector does not trace from an owner
+ * object (closed upvalues). The value is handled as if its owner were old
+ * and black.
+ *
+ * @param vm The virtual machine instance.
+ * @param value The value being stored.
+ */
+static inline void write_barrier_value(vm_t *vm, Value value)
+{
+    if (!IS_OBJ(value))
+        return;
+
+    if (AS_OBJ(value)->generation == GEN_YOUNG)
+        gc_remember(vm, AS_OBJ(value));
+
+    if (vm->gc_phase == GC_MARKING)
+        gc_shade(vm, AS_OBJ(value));
+}
 
 #endif // GC_H
\ No newline at end of file
@@ -0,0 +1,226 @@
+#include <stdlib.h>
+#include <string.h>
+#include <SDL2/SDL.h>
+
+#include "gc_stats.h"
+#include "pi_func.h"
+
+// Names of the object types, in o_type order
+static const char *type_names[GC_TYPE_COUNT] = {
+    "string", "list", "map", "range", "function", "code",
+    "file", "image", "sprite", "model3d", "sound", "set", "pqueue", "iterator", "generator"};
+
+/**
+ * Returns a monotonic timestamp in milliseconds.
+ */
+double gc_clock_ms(void)
+{
+    return SDL_GetPerformanceCounter() * 1000.0 / SDL_GetPerformanceFrequency();
+}
+
+/**
+ * Returns the number of bytes allocated for an object itself, not counting
+ * the buffers it owns (the characters of a string, the items of a list...).
+ *
+ * @param obj The object.
+ * @return The size of the object's structure.
+ */
+size_t object_size(Object *obj)
+{
+    switch (obj->type)
+    {
+    case OBJ_STRING:
+        return sizeof(PiString);
+    case OBJ_LIST:
+        return sizeof(PiList);
+    case OBJ_MAP:
+        return sizeof(PiMap);
+    case OBJ_RANGE:
+        return sizeof(PiRange);
+    case OBJ_FUN:
+        return sizeof(Function);
+    case OBJ_CODE:
+        return sizeof(ObjCode);
+    case OBJ_FILE:
+        return sizeof(ObjFile);
+    case OBJ_IMAGE:
+        return sizeof(ObjImage);
+    case OBJ_SPRITE:
+        return sizeof(ObjSprite);
+    case OBJ_MODEL3D:
+        return sizeof(ObjModel3d);
+    case OBJ_SOUND:
+        return sizeof(ObjSound);
+    case OBJ_SET:
+        return sizeof(PiSet);
+    case OBJ_HEAP:
+        return sizeof(PiHeap);
+    case OBJ_ITER:
+        return sizeof(PiIter);
+    case OBJ_GEN:
+        return sizeof(PiGen);
+    default:
+        return sizeof(Object);
+    }
+}
+
+/**
+ * Returns the name of an object type, as reported by the statistics.
+ *
+ * @param type The object type (an o_type).
+ * @return The type name.
+ */
+const char *gc_type_name(int type)
+{
+    return type >= 0 && type < GC_TYPE_COUNT ? type_names[type] : "undefined";
+}
+
+/**
+ * Initializes the collector statistics and opens the CSV log if the
+ * GC_LOG_ENV environment variable is set.
+ *
+ * The variable names a file the log is appended to, or is "-" to write
+ * it to stderr. A header line is written when the log is empty.
+ *
+ * @param stats The statistics to initialize.
+ */
+void gc_stats_init(GCStats *stats)
+{
+    memset(stats, 0, sizeof(GCStats));
+    stats->start_ms = gc_clock_ms();
+
+    const char *path = getenv(GC_LOG_ENV);
+    if (!path || !*path)
+        return;
+
+    if (strcmp(path, "-") == 0)
+        stats->log = stderr;
+    else
+    {
+        stats->log = fopen(path, "a");
+        if (!stats->log)
+        {
+            fprintf(stderr, "[gc] Could not open the log file '%s'.\n", path);
+            return;
+        }
+        fseek(stats->log, 0, SEEK_END);
+    }
+
+    if (stats->log == stderr || ftell(stats->log) == 0)
+    {
+        fprintf(stats->log, "time_ms,kind,pause_ms,max_slice_ms,marked,freed,freed_bytes,live_objects,live_bytes");
+        for (int i = 0; i < GC_TYPE_COUNT; i++)
+            fprintf(stats->log, ",%s_freed,%s_freed_bytes", type_names[i], type_names[i]);
+        fprintf(stats->log, "\n");
+    }
+}
+
+/**
+ * Closes the CSV log of the collector statistics.
+ *
+ * @param stats The statistics.
+ */
+void gc_stats_free(GCStats *stats)
+{
+    if (stats->log && stats->log != stderr)
+        fclose(stats->log);
+    stats->log = NULL;
+}
+
+/**
+ * Counts a freed object in the statistics of a collection.
+ *
+ * @param cycle The collection.
+ * @param obj The object being freed.
+ */
+void gc_count_free(GCCycle *cycle, Object *obj)
+{
+    size_t size = object_size(obj);
+
+    cycle->freed++;
+    cycle->freed_bytes += size;
+
+    if (obj->type < GC_TYPE_COUNT)
+    {
+        cycle->freed_by_type[obj->type]++;
+        cycle->freed_bytes_by_type[obj->type] += size;
+    }
+}
+
+/**
+ * Records a pause of the collector that started at `start_ms` and ends now.
+ *
+ * @param stats The statistics.
+ * @param cycle The collection the pause belongs to.
+ * @param start_ms The clock when the pause started.
+ */
+void gc_count_pause(GCStats *stats, GCCycle *cycle, double start_ms)
+{
+    double pause = gc_clock_ms() - start_ms;
+
+    cycle->pause_ms += pause;
+    if (pause > cycle->max_slice_ms)
+        cycle->max_slice_ms = pause;
+
+    stats->total_pause_ms += pause;
+    if (pause > stats->max_pause_ms)
+        stats->max_pause_ms = pause;
+}
+
+/**
+ * Adds the marked and freed counts of one set of counters to another.
+ *
+ * @param cycle The counters to add to.
+ * @param from The counters to add.
+ */
+void gc_stats_merge(GCCycle *cycle, const GCCycle *from)
+{
+    cycle->marked += from->marked;
+    cycle->freed += from->freed;
+    cycle->freed_bytes += from->freed_bytes;
+
+    for (int i = 0; i < GC_TYPE_COUNT; i++)
+    {
+        cycle->freed_by_type[i] += from->freed_by_type[i];
+        cycle->freed_bytes_by_type[i] += from->freed_bytes_by_type[i];
+    }
+}
+
+/**
+ * Records the end of a collection: its counters become the last minor or
+ * full collection of the statistics, and a line is written to the log.
+ *
+ * @param stats The statistics.
+ * @param cycle The counters of the collection. They are reset afterwards.
+ * @param major Whether this was a full cycle rather than a minor collection.
+ * @param live_objects The number of objects still alive.
+ */
+void gc_cycle_end(GCStats *stats, GCCycle *cycle, bool major, size_t live_objects)
+{
+    if (major)
+    {
+        stats->major = *cycle;
+        stats->major_count++;
+    }
+    else
+    {
+        stats->minor = *cycle;
+        stats->minor_count++;
+    }
+
+    if (stats->log)
+    {
+        fprintf(stats->log, "%.3f,%s,%.3f,%.3f,%d,%d,%zu,%zu,%zu",
+                gc_clock_ms() - stats->start_ms, major ? "major" : "minor",
+                cycle->pause_ms, cycle->max_slice_ms, cycle->marked, cycle->freed,
+                cycle->freed_bytes, live_objects, stats->live_bytes);
+
+        for (int i = 0; i < GC_TYPE_COUNT; i++)
+            fprintf(stats->log, ",%d,%zu", cycle->freed_by_type[i], cycle->freed_bytes_by_type[i]);
+
+        fprintf(stats->log, "\n");
+        fflush(stats->log);
+    }
+
+    memset(cycle, 0, sizeof(GCCycle));
+}
@@ -0,0 +1,55 @@
+#ifndef GC_STATS_H
+#define GC_STATS_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "pi_object.h"
+
+#define GC_TYPE_COUNT (OBJ_GEN + 1) // Number of object types
+#define GC_LOG_ENV "PI_GC_LOG"        // Environment variable naming the CSV log
+
+// Counters of one collection: a minor collection, or a full cycle with
+// all its slices.
+typedef struct
+{
+    double pause_ms;     // Time spent collecting
+    double max_slice_ms; // Longest uninterrupted pause
+    int marked;          // Objects found alive
+    int freed;           // Objects freed
+    size_t freed_bytes;
+    int freed_by_type[GC_TYPE_COUNT];
+    size_t freed_bytes_by_type[GC_TYPE_COUNT];
+} GCCycle;
+
+typedef struct
+{
+    size_t live_bytes; // Bytes of the objects tracked by the collector
+
+    int minor_count;       // Minor collections run
+    int major_count;       // Full cycles completed
+    double total_pause_ms; // Time spent collecting since start
+    double max_pause_ms;   // Longest uninterrupted pause since start
+
+    GCCycle minor;   // Last minor collection
+    GCCycle major;   // Last completed full cycle
+    GCCycle current; // Full cycle in progress
+
+    double start_ms; // Clock at VM start, for the log timestamps
+    FILE *log;       // CSV log (NULL unless GC_LOG_ENV is set)
+} GCStats;
+
+double gc_clock_ms(void);
+size_t object_size(Object *obj);
+const char *gc_type_name(int type);
+
+void gc_stats_init(GCStats *stats);
+void gc_stats_free(GCStats *stats);
+
+void gc_count_free(GCCycle *cycle, Object *obj);
+void gc_count_pause(GCStats *stats, GCCycle *cycle, double start_ms);
+void gc_stats_merge(GCCycle *cycle, const GCCycle *from);
+void gc_cycle_end(GCStats *stats, GCCycle *cycle, bool major, size_t live_objects);
+
+#endif
@@ -0,0 +1,566 @@
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "gc_worker.h"
+#include "gc.h"
+#include "pi_pool.h"
+#include "common.h"
+
+/**
+ * Returns the number of processors available to the program.
+ *
+ * @return The number of online processors (at least 1).
+ */
+int gc_cpu_count(void)
+{
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+#endif
+}
+
+/**
+ * Makes room for at least `extra` more objects on a mark stack.
+ *
+ * @param stack The stack.
+ * @param extra The number of objects about to be added.
+ */
+static void reserve(MarkStack *stack, int extra)
+{
+    if (stack->count + extra <= stack->capacity)
+        return;
+
+    int capacity = stack->capacity ? stack->capacity : 256;
+    while (capacity < stack->count + extra)
+        capacity *= 2;
+
+    stack->items = (Object **)reallocate(stack->items, 0, sizeof(Object *) * capacity);
+    stack->capacity = capacity;
+}
+
+/**
+ * Moves the older half of a marker's private objects to its shared stack,
+ * if the shared stack has run dry.
+ *
+ * The oldest entries tend to root the largest unexplored subgraphs, which
+ * makes them the most useful ones to hand out.
+ *
+ * @param queue The queue of the calling marker.
+ */
+static void share_work(GCQueue *queue)
+{
+    MarkStack *local = &queue->local;
+
+    if (local->count < GC_SHARE_MIN * 2 ||
+        __atomic_load_n(&queue->shared.count, __ATOMIC_ACQUIRE) > 0)
+        return;
+
+    int half = local->count / 2;
+
+    // Only the owner adds to its shared stack, so it is still empty here
+    pthread_mutex_lock(&queue->lock);
+    reserve(&queue->shared, half);
+    memcpy(queue->shared.items, local->items, sizeof(Object *) * half);
+    __atomic_store_n(&queue->shared.count, half, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&queue->lock);
+
+    local->count -= half;
+    memmove(local->items, local->items + half, sizeof(Object *) * local->count);
+}
+
+/**
+ * Takes half of the objects on a queue's shared stack.
+ *
+ * @param victim The queue to take from (possibly the caller's own).
+ * @param local The private stack of the caller.
+ * @return true if any objects were taken.
+ */
+static bool steal_from(GCQueue *victim, MarkStack *local)
+{
+    if (__atomic_load_n(&victim->shared.count, __ATOMIC_ACQUIRE) == 0)
+        return false;
+
+    pthread_mutex_lock(&victim->lock);
+
+    int count = victim->shared.count;
+    int take = (count + 1) / 2;
+
+    reserve(local, take);
+    memcpy(local->items + local->count, victim->shared.items + count - take, sizeof(Object *) * take);
+    local->count += take;
+    __atomic_store_n(&victim->shared.count, count - take, __ATOMIC_RELEASE);
+
+    pthread_mutex_unlock(&victim->lock);
+    return take > 0;
+}
+
+/**
+ * Refills the private stack of a marker, from its own shared stack first
+ * and then from the other markers'.
+ *
+ * @param pool The worker pool.
+ * @param self The index of the calling marker.
+ * @param markers The number of markers taking part.
+ * @return true if work was found.
+ */
+static bool find_work(GCWorkers *pool, int self, int markers)
+{
+    MarkStack *local = &pool->queues[self].local;
+
+    for (int i = 0; i < markers; i++)
+        if (steal_from(&pool->queues[(self + i) % markers], local))
+            return true;
+
+    return false;
+}
+
+/**
+ * Checks without locking whether any marker has shared work.
+ *
+ * @param pool The worker pool.
+ * @param markers The number of markers taking part.
+ * @return true if some shared stack looked non-empty.
+ */
+static bool has_shared_work(GCWorkers *pool, int markers)
+{
+    for (int i = 0; i < markers; i++)
+        if (__atomic_load_n(&pool->queues[i].shared.count, __ATOMIC_ACQUIRE) > 0)
+            return true;
+
+    return false;
+}
+
+/**
+ * Visitor of the parallel markers: shades a white object gray and pushes
+ * it on the marker's private stack.
+ *
+ * The color is claimed with a compare-and-swap, so an object reached by
+ * several markers at once is scanned only once.
+ *
+ * @param ctx The queue of the marker.
+ * @param obj The object to shade.
+ */
+static void shade_parallel(void *ctx, Object *obj)
+{
+    GCColor white = GC_WHITE;
+
+    if (__atomic_load_n(&obj->gc_color, __ATOMIC_RELAXED) != GC_WHITE)
+        return;
+
+    if (!__atomic_compare_exchange_n(&obj->gc_color, &white, GC_GRAY, false,
+                                     __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        return;
+
+    mark_stack_push(&((GCQueue *)ctx)->local, obj);
+}
+
+/**
+ * Marks gray objects until every marker runs out of work.
+ *
+ * Each marker works off its private stack and periodically shares half of
+ * it. A marker with nothing left steals from the others; once all of them
+ * are idle at the same time the heap is fully marked. An idle marker's own
+ * shared stack is always empty, so no work can be left behind.
+ *
+ * @param pool The worker pool.
+ * @param self The index of the calling marker (0 is the VM thread).
+ */
+static void mark_loop(GCWorkers *pool, int self)
+{
+    GCQueue *queue = &pool->queues[self];
+    MarkStack *local = &queue->local;
+    int markers = pool->count + 1;
+    int work = 0;
+
+    for (;;)
+    {
+        while (local->count > 0)
+        {
+            Object *obj = local->items[--local->count];
+
+            // The next object is scanned right after this one
+            if (local->count > 0)
+                GC_PREFETCH(local->items[local->count - 1]);
+
+            __atomic_store_n(&obj->gc_color, GC_BLACK, __ATOMIC_RELAXED);
+            visit_children(queue, obj, shade_parallel);
+
+            if (++work >= GC_STEP_CHECK)
+            {
+                work = 0;
+                share_work(queue);
+            }
+        }
+
+        if (find_work(pool, self, markers))
+            continue;
+
+        __atomic_add_fetch(&pool->idle, 1, __ATOMIC_SEQ_CST);
+
+        for (;;)
+        {
+            if (__atomic_load_n(&pool->idle, __ATOMIC_SEQ_CST) == markers)
+                return;
+
+            if (!has_shared_work(pool, markers))
+            {
+                sched_yield();
+                continue;
+            }
+
+            __atomic_sub_fetch(&pool->idle, 1, __ATOMIC_SEQ_CST);
+            if (find_work(pool, self, markers))
+                break;
+            __atomic_add_fetch(&pool->idle, 1, __ATOMIC_SEQ_CST);
+        }
+    }
+}
+
+/**
+ * Sweeps the objects handed to the pool by gc_sweep_start().
+ *
+ * Dead objects have their contents freed right away; their cells are
+ * collected on a list and given back to the pool by the VM thread, since
+ * the pool is not thread-safe. Survivors are whitened for the next cycle.
+ *
+ * @param pool The worker pool.
+ */
+static void sweep_loop(GCWorkers *pool)
+{
+    Object *obj = pool->sweep_list;
+    Object *survivors = NULL, *tail = NULL, *dead = NULL;
+    GCCycle swept = {0};
+
+    while (obj)
+    {
+        Object *next = obj->next;
+
+        if (obj->gc_color == GC_WHITE)
+        {
+            gc_count_free(&swept, obj);
+            release_object(obj);
+
+            if (obj->pool_class == POOL_NONE)
+                free(obj);
+            else
+            {
+                obj->next = dead;
+                dead = obj;
+            }
+        }
+        else
+        {
+            swept.marked++;
+            obj->gc_color = GC_WHITE; // Reset the color for the next cycle
+
+            if (tail)
+                tail->next = obj;
+            else
+                survivors = obj;
+            tail = obj;
+        }
+
+        obj = next;
+    }
+
+    if (tail)
+        tail->next = NULL;
+
+    pool->sweep_list = NULL;
+    pool->survivors = survivors;
+    pool->survivors_tail = tail;
+    pool->dead = dead;
+    pool->swept = swept;
+}
+
+/**
+ * Body of a helper thread: waits for jobs and runs them until the pool is
+ * destroyed.
+ *
+ * @param arg The helper's GCHelper.
+ * @return NULL.
+ */
+static void *helper_main(void *arg)
+{
+    GCHelper *helper = (GCHelper *)arg;
+    GCWorkers *pool = helper->pool;
+    unsigned seen = 0;
+
+    pthread_mutex_lock(&pool->lock);
+    for (;;)
+    {
+        while (pool->epoch == seen && !pool->quit)
+            pthread_cond_wait(&pool->wake, &pool->lock);
+
+        if (pool->quit)
+            break;
+
+        seen = pool->epoch;
+        GCJob job = pool->job;
+        pthread_mutex_unlock(&pool->lock);
+
+        if (job == GC_JOB_MARK)
+            mark_loop(pool, helper->id);
+        else if (job == GC_JOB_SWEEP && helper->id == 1)
+            sweep_loop(pool);
+
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->active == 0)
+            pthread_cond_broadcast(&pool->done);
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    return NULL;
+}
+
+/**
+ * Hands a job to every helper thread. Waits for the previous job first.
+ *
+ * @param pool The worker pool.
+ * @param job The job to run.
+ */
+static void start_job(GCWorkers *pool, GCJob job)
+{
+    pthread_mutex_lock(&pool->lock);
+    while (pool->active > 0)
+        pthread_cond_wait(&pool->done, &pool->lock);
+
+    pool->job = job;
+    pool->epoch++;
+    pool->active = pool->count;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+/**
+ * Checks whether the helpers have finished their current job.
+ *
+ * @param pool The worker pool.
+ * @param wait Whether to block until they have.
+ * @return true if no helper is still working.
+ */
+static bool job_done(GCWorkers *pool, bool wait)
+{
+    pthread_mutex_lock(&pool->lock);
+    while (wait && pool->active > 0)
+        pthread_cond_wait(&pool->done, &pool->lock);
+
+    bool done = pool->active == 0;
+    pthread_mutex_unlock(&pool->lock);
+
+    return done;
+}
+
+/**
+ * Starts a pool of collector helper threads.
+ *
+ * @param count The number of helpers to start.
+ * @return The pool, or NULL if no thread could be started.
+ */
+GCWorkers *gc_workers_create(int count)
+{
+    GCWorkers *pool = (GCWorkers *)calloc(1, sizeof(GCWorkers));
+    if (!pool)
+        error("[gc_workers_create] Memory allocation failed.");
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+    pthread_cond_init(&pool->done, NULL);
+
+    for (int i = 0; i < GC_MAX_THREADS; i++)
+        pthread_mutex_init(&pool->queues[i].lock, NULL);
+
+    if (count > GC_MAX_THREADS - 1)
+        count = GC_MAX_THREADS - 1;
+
+    for (int i = 0; i < count; i++)
+    {
+        GCHelper *helper = &pool->helpers[i];
+        helper->pool = pool;
+        helper->id = i + 1;
+
+        if (pthread_create(&helper->thread, NULL, helper_main, helper) != 0)
+            break;
+        pool->count++;
+    }
+
+    if (pool->count == 0)
+    {
+        gc_workers_destroy(pool);
+        return NULL;
+    }
+
+    return pool;
+}
+
+/**
+ * Stops the helper threads of a pool and frees it.
+ *
+ * A job in progress is allowed to finish; the results of a background
+ * sweep that was not collected with gc_sweep_finish() are dropped.
+ *
+ * @param pool The pool to destroy.
+ */
+void gc_workers_destroy(GCWorkers *pool)
+{
+    if (!pool)
+        return;
+
+    pthread_mutex_lock(&pool->lock);
+    while (pool->active > 0)
+        pthread_cond_wait(&pool->done, &pool->lock);
+
+    pool->quit = true;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (int i = 0; i < pool->count; i++)
+        pthread_join(pool->helpers[i].thread, NULL);
+
+    for (int i = 0; i < GC_MAX_THREADS; i++)
+    {
+        pthread_mutex_destroy(&pool->queues[i].lock);
+        free(pool->queues[i].local.items);
+        free(pool->queues[i].shared.items);
+    }
+
+    pthread_cond_destroy(&pool->done);
+    pthread_cond_destroy(&pool->wake);
+    pthread_mutex_destroy(&pool->lock);
+
+    free(pool);
+}
+
+/**
+ * Decides whether the helpers take part in a phase of the next cycle.
+ *
+ * Each way is measured once, then the cheaper one is used; the other is
+ * tried again every GC_REPROBE cycles.
+ *
+ * @param gate The measurements of the phase.
+ * @return true to use the helpers.
+ */
+bool gc_gate_pick(GCGate *gate)
+{
+    gate->ms = 0;
+
+    if (gate->cost[1] == 0)
+        gate->helpers = true;
+    else if (gate->cost[0] == 0)
+        gate->helpers = false;
+    else
+    {
+        gate->helpers = gate->cost[1] < gate->cost[0];
+        if (++gate->since >= GC_REPROBE)
+        {
+            gate->since = 0;
+            gate->helpers = !gate->helpers;
+        }
+    }
+
+    return gate->helpers;
+}
+
+/**
+ * Records the cost of a phase at the end of a cycle.
+ *
+ * @param gate The measurements of the phase.
+ * @param objects The number of old objects the cycle worked on.
+ */
+void gc_gate_record(GCGate *gate, int objects)
+{
+    if (objects > 0)
+        gate->cost[gate->helpers] = gate->ms / objects;
+}
+
+/**
+ * Drains the gray stack of the VM using the helper threads.
+ *
+ * The VM thread takes part in the marking and returns once every reachable
+ * object is black. Young objects are not remembered along the way, so the
+ * mark phase must end before the mutator runs again.
+ *
+ * @param vm The virtual machine instance.
+ * @param pool The worker pool.
+ */
+void gc_mark_parallel(vm_t *vm, GCWorkers *pool)
+{
+    // Hand the gray stack to the VM thread's queue, where helpers can steal it
+    MarkStack gray = pool->queues[0].shared;
+    pool->queues[0].shared = vm->gc_stack;
+    vm->gc_stack = gray;
+
+    pool->idle = 0;
+
+    start_job(pool, GC_JOB_MARK);
+    mark_loop(pool, 0);
+    job_done(pool, true);
+}
+
+/**
+ * Starts sweeping a list of old objects on a helper thread.
+ *
+ * The list must no longer be reachable from the VM until the sweep is
+ * collected with gc_sweep_finish().
+ *
+ * @param pool The worker pool.
+ * @param objects The objects to sweep.
+ */
+void gc_sweep_start(GCWorkers *pool, Object *objects)
+{
+    pool->sweep_list = objects;
+    pool->survivors = NULL;
+    pool->survivors_tail = NULL;
+    pool->dead = NULL;
+    memset(&pool->swept, 0, sizeof(GCCycle));
+    pool->sweeping = true;
+
+    start_job(pool, GC_JOB_SWEEP);
+}
+
+/**
+ * Collects the result of a background sweep.
+ *
+ * Survivors rejoin the old generation, and the freed cells are left in
+ * `vm->dead_cells` for the VM thread to return to the pool.
+ *
+ * @param vm The virtual machine instance.
+ * @param pool The worker pool.
+ * @param wait Whether to block until the sweep is over.
+ * @return true if the sweep was over and its result collected.
+ */
+bool gc_sweep_finish(vm_t *vm, GCWorkers *pool, bool wait)
+{
+    if (!job_done(pool, wait))
+        return false;
+
+    if (pool->survivors)
+    {
+        pool->survivors_tail->next = vm->old_objects;
+        vm->old_objects = pool->survivors;
+    }
+
+    vm->old_count -= pool->swept.freed;
+    vm->dead_cells = pool->dead;
+
+    gc_stats_merge(&vm->gc_stats.current, &pool->swept);
+    vm->gc_stats.live_bytes -= pool->swept.freed_bytes;
+
+    pool->survivors = NULL;
+    pool->survivors_tail = NULL;
+    pool->dead = NULL;
+    pool->sweeping = false;
+
+    return true;
+}
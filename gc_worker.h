@@ -0,0 +1,94 @@
+#ifndef GC_WORKER_H
+#define GC_WORKER_H
+
+#include <pthread.h>
+#include <stdbool.h>
+
+#include "pi_vm.h"
+#include "gc_stats.h"
+
+#define GC_MAX_THREADS 8        // Upper bound of gc_threads(), the VM thread included
+#define GC_PARALLEL_MIN 100000  // Old generation size from which helper threads are used
+#define GC_SHARE_MIN 32         // A marker keeps at least this many objects to itself
+#define GC_REPROBE 16           // Cycles after which the way measured slower is tried again
+
+// Gray objects of one marking thread. The private stack is only touched by
+// its owner; the shared one is where the owner leaves work for others to
+// steal.
+typedef struct
+{
+    MarkStack local;
+    MarkStack shared;
+    pthread_mutex_t lock; // Guards `shared`
+} GCQueue;
+
+typedef enum
+{
+    GC_JOB_NONE,
+    GC_JOB_MARK,  // Every helper joins the VM thread in draining the gray objects
+    GC_JOB_SWEEP, // The first helper sweeps the old generation in the background
+} GCJob;
+
+// Measured cost of one collection phase, done by the VM thread alone or
+// with the helpers. Each way is tried once, then the cheaper one is kept,
+// with the other retried every GC_REPROBE cycles in case the load changed.
+typedef struct
+{
+    double cost[2]; // VM thread ms per old object, alone [0] and with helpers [1] (0: not measured yet)
+    int since;      // Cycles since the way measured slower was last tried
+    bool helpers;   // Whether the current cycle uses the helpers
+    double ms;      // Time the VM thread spent in the phase in the current cycle
+} GCGate;
+
+typedef struct
+{
+    struct GCWorkers *pool;
+    int id; // Index of the helper's queue (the VM thread uses 0)
+    pthread_t thread;
+} GCHelper;
+
+struct GCWorkers
+{
+    int count; // Number of helper threads
+    GCHelper helpers[GC_MAX_THREADS - 1];
+    GCQueue queues[GC_MAX_THREADS];
+
+    pthread_mutex_t lock;
+    pthread_cond_t wake; // Signals a new job to the helpers
+    pthread_cond_t done; // Signals that every helper finished the job
+    GCJob job;
+    unsigned epoch; // Bumped for every job
+    int active;     // Helpers still working on the job
+    bool quit;
+
+    int idle; // Markers out of work (updated atomically)
+
+    // Background sweep
+    Object *sweep_list; // Objects to sweep
+    Object *survivors;  // Live objects, in their original order
+    Object *survivors_tail;
+    Object *dead;  // Freed cells that belong to the pool
+    GCCycle swept; // Marked and freed counts of the sweep
+    bool sweeping;
+
+    // Whether the helpers pay off, measured over whole cycles
+    GCGate mark;
+    GCGate sweep;
+    bool measuring; // The current cycle started with this pool
+    int objects;    // Old objects handed to the sweep of the current cycle
+};
+
+int gc_cpu_count(void);
+
+GCWorkers *gc_workers_create(int count);
+void gc_workers_destroy(GCWorkers *pool);
+
+bool gc_gate_pick(GCGate *gate);
+void gc_gate_record(GCGate *gate, int objects);
+
+void gc_mark_parallel(vm_t *vm, GCWorkers *pool);
+
+void gc_sweep_start(GCWorkers *pool, Object *objects);
+bool gc_sweep_finish(vm_t *vm, GCWorkers *pool, bool wait);
+
+#endif
@@ -2,6 +2,7 @@
 #include "common.h"
 #include "pi_value.h"
 #include "pi_object.h"
+#include "pi_pool.h"
 
 /**
  * @brief Allocates memory for a new list with the given item size and capacity.
@@ -16,17 +17,15 @@
  */
 static list_t *_list_create(int item_size, int capacity)
 {
-    list_t *list = (list_t *)malloc(sizeof(list_t));
-    if (!list)
-    {
-        perror("Failed to allocate memory for list");
-        exit(EXIT_FAILURE);
-    }
+    // Lists made while a VM runs take their header from its pool
+    pool_t *pool = pool_bound();
+    list_t *list = (list_t *)pool_alloc_block(pool, sizeof(list_t));
+    list->pool = pool;
 
     list->data = malloc(item_size * capacity);
     if (!list->data)
     {
-        free(list);
+        pool_free_block(pool, list, sizeof(list_t));
         perror("Failed to allocate memory for list data");
         exit(EXIT_FAILURE);
     }
@@ -34,10 +33,64 @@ static list_t *_list_create(int item_size, int capacity)
     list->i_size = item_size;
     list->size = 0;
     list->capacity = capacity;
+    list->front = 0;
+    list->share = NULL;
 
     return list;
 }
 
+/**
+ * @brief Moves the items of a list back to the start of its array, so the
+ * slots freed at its front can be used at its end.
+ *
+ * @param list The list, which must not be shared.
+ */
+static void list_compact(list_t *list)
+{
+    void *base = LIST_BASE(list);
+    memmove(base, list->data, list->size * list->i_size);
+
+    list->data = base;
+    list->capacity += list->front;
+    list->front = 0;
+}
+
+/**
+ * @brief Makes room for at least one more item at the end of a list.
+ *
+ * The slots freed by removals at the front are reused first if they are
+ * many (a list used as a queue), otherwise the array grows.
+ *
+ * @param list The list, which must be full.
+ */
+static void list_grow(list_t *list)
+{
+    if (list->front > list->size / 2)
+        list_compact(list);
+    // Use a hybrid strategy to determine the new capacity
+    else if (list->capacity < 1024) // Small lists: double the capacity
+        list_expand(list, list->capacity * 2);
+    else // Large lists: increase by 25% or at least 256
+        list_expand(list, list->capacity + list->capacity / 4 + 256);
+}
+
+/**
+ * @brief Drops a list's reference to shared items, freeing them with the
+ * last one.
+ *
+ * Lists may be freed by the background sweeper, hence the atomic count.
+ *
+ * @param share The shared items.
+ */
+static void list_release(list_share *share)
+{
+    if (__atomic_sub_fetch(&share->refs, 1, __ATOMIC_ACQ_REL) == 0)
+    {
+        free(share->base);
+        free(share);
+    }
+}
+
 /**
  * @brief Creates a new list with the given item size and a default capacity.
  *
@@ -62,14 +115,11 @@ list_t *list_create(int i_size)
  */
 void list_add(list_t *list, const void *item)
 {
+    if (list->share)
+        list_unshare(list);
+
     if (list->size == list->capacity)
-    {
-        // Use a hybrid strategy to determine the new capacity
-        if (list->capacity < 1024) // Small lists: double the capacity
-            list_expand(list, list->capacity * 2);
-        else // Large lists: increase by 25% or at least 256
-            list_expand(list, list->capacity + list->capacity / 4 + 256);
-    }
+        list_grow(list);
 
     // Copy the item into the list's data array
     void *target = (byte *)list->data + list->size * list->i_size;
@@ -88,13 +138,25 @@ void list_add(list_t *list, const void *item)
  * @param list The list to insert the item into.
  * @param index The index at which to insert the item. If the index
  *              is negative or greater than the list size, it will
- *              be adjusted accordingly.
+ *              be adjusted accordingly (the size itself appends).
  * @param item A pointer to the item to be inserted into the list.
  */
 void list_addAt(list_t *list, int index, const void *item)
 {
+    if (list->share)
+        list_unshare(list);
+
     // Adjust index for negative values or values greater than the current size
-    int _index = get_index(index, list->size);
+    int _index = index == list->size ? index : get_index(index, list->size);
+
+    if (_index == 0)
+    {
+        list_addFirst(list, item);
+        return;
+    }
+
+    if (list->size == list->capacity)
+        list_grow(list);
 
     // Calculate the target position in memory
     void *target = (byte *)list->data + _index * list->i_size;
@@ -138,6 +200,9 @@ void *list_getAt(list_t *list, int index)
  */
 void list_set(list_t *list, int index, void *item)
 {
+    if (list->share)
+        list_unshare(list);
+
     int _index = get_index(index, list->size);
 
     void *target = (byte *)list->data + (_index * list->i_size);
@@ -181,6 +246,98 @@ list_t *list_copy(list_t *list)
     return copy; // Return the newly created list copy
 }
 
+/**
+ * @brief Creates a list over a range of the items of another list, without
+ * copying them.
+ *
+ * Both lists then share the same items until one of them is modified: every
+ * function that changes a list first calls list_unshare, which gives it its
+ * own copy (copy-on-write). Reading a view is as fast as reading any list.
+ *
+ * @param list The list to take the items from.
+ * @param offset The index of the first item of the view.
+ * @param size The number of items of the view.
+ * @return The new list.
+ */
+list_t *list_view(list_t *list, int offset, int size)
+{
+    if (!list->share)
+    {
+        list_share *share = (list_share *)malloc(sizeof(list_share));
+        if (!share)
+        {
+            perror("Failed to allocate memory for list");
+            exit(EXIT_FAILURE);
+        }
+
+        share->base = LIST_BASE(list);
+        share->capacity = list->capacity + list->front;
+        share->refs = 1;
+        list->share = share;
+        list->front = 0; // Counted in the shared array from now on
+    }
+
+    pool_t *pool = pool_bound();
+    list_t *view = (list_t *)pool_alloc_block(pool, sizeof(list_t));
+    view->pool = pool;
+
+    __atomic_add_fetch(&list->share->refs, 1, __ATOMIC_RELAXED);
+
+    view->data = (byte *)list->data + offset * list->i_size;
+    view->i_size = list->i_size;
+    view->size = size;
+    view->capacity = size;
+    view->front = 0;
+    view->share = list->share;
+
+    return view;
+}
+
+/**
+ * @brief Gives a list its own copy of its items if they are shared with
+ * other lists (see list_view).
+ *
+ * The last list using the shared items takes them back without copying.
+ *
+ * @param list The list about to be modified.
+ */
+void list_unshare(list_t *list)
+{
+    list_share *share = list->share;
+    if (!share)
+        return;
+
+    if (__atomic_load_n(&share->refs, __ATOMIC_ACQUIRE) == 1)
+    {
+        // No other list uses the items: move them to the front of the array
+        if (list->data != share->base)
+            memmove(share->base, list->data, list->size * list->i_size);
+
+        list->data = share->base;
+        list->capacity = share->capacity;
+        free(share);
+    }
+    else
+    {
+        int capacity = list->size > INIT_CAP ? list->size : INIT_CAP;
+        void *data = malloc(capacity * list->i_size);
+        if (!data)
+        {
+            perror("Failed to allocate memory for list data");
+            exit(EXIT_FAILURE);
+        }
+
+        memcpy(data, list->data, list->size * list->i_size);
+        list_release(share);
+
+        list->data = data;
+        list->capacity = capacity;
+    }
+
+    list->front = 0;
+    list->share = NULL;
+}
+
 /**
  * @brief Adds all elements from a list to the end of another list.
  *
@@ -195,6 +352,8 @@ list_t *list_copy(list_t *list)
  */
 list_t *list_addAll(list_t *list, list_t *items)
 {
+    if (list->share)
+        list_unshare(list);
 
     // Calculate the required capacity after adding the new elements
     int size = list->size + items->size;
@@ -223,6 +382,10 @@ list_t *list_addAll(list_t *list, list_t *items)
  * a pointer to the removed element. The list's size is decreased by one. The caller
  * is responsible for freeing the memory allocated for the returned element.
  *
+ * The items on the shorter side of the index are shifted: removing the
+ * first item only moves the start of the list, so a list can be used as
+ * a queue.
+ *
  * @param list The list from which to remove the element.
  * @param index The index of the element to remove.
  * @return A pointer to the removed element.
@@ -230,15 +393,30 @@ list_t *list_addAll(list_t *list, list_t *items)
 
 void *list_remove(list_t *list, int index)
 {
+    if (list->share)
+        list_unshare(list);
+
     index = get_index(index, list->size);
 
     void *target = (byte *)list->data + index * list->i_size;
 
     // Allocate temporary buffer to hold the removed item
     void *removed_item = malloc(list->i_size);
+    memcpy(removed_item, target, list->i_size);
 
-    void *next = (byte *)list->data + (index + 1) * list->i_size;
-    memmove(target, next, (list->size - index - 1) * list->i_size);
+    if (index < list->size / 2)
+    {
+        // Shift the items before it right, the first slot becomes free
+        memmove((byte *)list->data + list->i_size, list->data, index * list->i_size);
+        list->data = (byte *)list->data + list->i_size;
+        list->front++;
+        list->capacity--;
+    }
+    else
+    {
+        void *next = (byte *)list->data + (index + 1) * list->i_size;
+        memmove(target, next, (list->size - index - 1) * list->i_size);
+    }
 
     list->size--;
 
@@ -260,6 +438,9 @@ void *list_pop(list_t *list)
     if (list->size == 0)
         error("[pop] PiList is empty.");
 
+    if (list->share)
+        list_unshare(list);
+
     list->size--;
     void *item = (byte *)list->data + list->size * list->i_size;
     return item;
@@ -268,25 +449,38 @@ void *list_pop(list_t *list)
 /**
  * @brief Prepends an item to the beginning of the list.
  *
- * This function adds the given item to the beginning of the list. If the list is
- * already at capacity, it is first expanded to double its size (or increased by
- * 25% if the current capacity is greater than 1024). The existing items in the
- * list are shifted one position forward and the new item is inserted at the
- * beginning of the list.
+ * The item goes into a free slot before the first item. When there is
+ * none, the items are moved to a new array leaving as many free slots
+ * before them as there are items, so prepending is O(1) amortised.
  *
  * @param list The list to which to prepend the item.
  * @param item The item to prepend to the list.
  */
 void list_addFirst(list_t *list, const void *item)
 {
-    if (list->size == list->capacity)
-        // If the list is at capacity, expand it to double its size or increase by 25%
-        list_expand(list, list->capacity < 1024 ? list->capacity * 2 : list->capacity + list->capacity / 4 + 256);
+    if (list->share)
+        list_unshare(list);
+
+    if (list->front == 0)
+    {
+        int gap = list->size > INIT_CAP ? list->size : INIT_CAP;
+        byte *base = malloc((size_t)(gap + list->capacity) * list->i_size);
+        if (!base)
+        {
+            perror("Failed to allocate memory for list data");
+            exit(EXIT_FAILURE);
+        }
+
+        memcpy(base + gap * list->i_size, list->data, list->size * list->i_size);
+        free(list->data);
+
+        list->data = base + gap * list->i_size;
+        list->front = gap;
+    }
 
-    // Move all existing items one slot forward
-    void *dest = (byte *)list->data + list->i_size;
-    void *src = list->data;
-    memmove(dest, src, list->size * list->i_size);
+    list->data = (byte *)list->data - list->i_size;
+    list->front--;
+    list->capacity++;
 
     // Insert the new item at the beginning
     memcpy(list->data, item, list->i_size);
@@ -306,6 +500,12 @@ void list_addFirst(list_t *list, const void *item)
  */
 void list_expand(list_t *list, int new_cap)
 {
+    if (list->share)
+        list_unshare(list);
+
+    if (list->front)
+        list_compact(list);
+
     void *_value = realloc(list->data, new_cap * list->i_size);
     if (_value == NULL)
     {
@@ -367,6 +567,9 @@ void list_clear(list_t *list)
     if (!list || !list->data)
         return; // Exit if the list or its data is NULL
 
+    if (list->share)
+        list_unshare(list);
+
     // Note: If elements are pointers and need to be freed, uncomment and implement as needed:
     // for (int i = 0; i < list->size; i++) {
     //     free(((void **)list->data)[i]); // Free each element if dynamically allocated
@@ -397,10 +600,15 @@ void list_free(list_t *list)
     if (!list)
         return; // Avoid freeing NULL
 
-    // Free the memory allocated for the data
-    if (list->data)
+    // Free the memory allocated for the data (or release the shared items)
+    if (list->share)
+    {
+        list_release(list->share);
+        list->data = NULL;
+    }
+    else if (list->data)
     {
-        free(list->data);  // Free the memory allocated for the list
+        free(LIST_BASE(list)); // Free the memory allocated for the list
         list->data = NULL; // Set the data pointer to NULL
     }
 
@@ -408,5 +616,5 @@ void list_free(list_t *list)
     list->capacity = 0; // Set the capacity to 0
     list->i_size = 0;   // Set the item size to 0
 
-    free(list); // Free the memory allocated for the list
+    pool_free_block(list->pool, list, sizeof(list_t)); // Free the list header
 }
@@ -8,19 +8,34 @@
 #include <stdbool.h>
 
 typedef struct Value Value;
+struct Pool;
 
 #define MAX_SIZE 20000
 #define LIST_SIZE(l) ((l)->size)
 
 #define LIST_AT(l, i) (*(Value *)list_getAt((l), (i)))
 
+// Start of the array a list's items live in, before its free front slots
+#define LIST_BASE(l) ((void *)((char *)(l)->data - (size_t)(l)->front * (l)->i_size))
+
+// Items shared by a list and the views over them (see list_view)
+typedef struct
+{
+    void *base;   // Start of the shared array
+    int capacity; // Capacity of the shared array
+    int refs;     // Number of lists using the array
+} list_share;
+
 // Define the PiList structure
 typedef struct
 {
-    void *data;   // Pointer to the array of items
-    int i_size;   // Size of each item
-    int size;     // Current number of items
-    int capacity; // Maximum number of items before resizing
+    void *data;        // Pointer to the array of items
+    int i_size;        // Size of each item
+    int size;          // Current number of items
+    int capacity;      // Maximum number of items before resizing (counted from data)
+    int front;         // Free slots before data, used to add and remove items at the front
+    list_share *share; // Set while the items are shared with views (copied on write)
+    struct Pool *pool; // Pool the header was taken from (NULL: malloc)
 } list_t;
 
 // create a new PiList
@@ -41,6 +56,12 @@ int list_size(list_t *list);
 
 list_t *list_copy(list_t *list);
 
+// create a list over a range of the items of another one, without copying
+list_t *list_view(list_t *list, int offset, int size);
+
+// give the list its own copy of its items if they are shared
+void list_unshare(list_t *list);
+
 list_t *list_addAll(list_t *list, list_t *items);
 
 void *list_pop(list_t *list);
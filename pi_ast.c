@@ -0,0 +1,141 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "pi_ast.h"
+
+/**
+ * Creates an empty syntax tree arena.
+ *
+ * @return A pointer to the new arena.
+ */
+ast_t *ast_create(void)
+{
+    ast_t *ast = malloc(sizeof(ast_t));
+    ast->chunks = NULL;
+    return ast;
+}
+
+/**
+ * Frees an arena and every node allocated from it.
+ *
+ * @param ast The arena to free.
+ */
+void ast_free(ast_t *ast)
+{
+    ast_chunk *chunk = ast->chunks;
+    while (chunk)
+    {
+        ast_chunk *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    free(ast);
+}
+
+/**
+ * Allocates zeroed memory from the arena. The memory lives until the
+ * arena is freed.
+ *
+ * @param ast The arena to allocate from.
+ * @param size The number of bytes to allocate.
+ * @return A pointer to the memory.
+ */
+void *ast_alloc(ast_t *ast, size_t size)
+{
+    size = (size + 7) & ~(size_t)7; // Keeps pointers and doubles aligned
+
+    ast_chunk *chunk = ast->chunks;
+    if (chunk == NULL || chunk->used + size > chunk->size)
+    {
+        size_t bytes = size > AST_CHUNK_SIZE ? size : AST_CHUNK_SIZE;
+        chunk = malloc(sizeof(ast_chunk) + bytes);
+        if (chunk == NULL)
+        {
+            fprintf(stderr, "Memory allocation failed\n");
+            exit(EXIT_FAILURE);
+        }
+        chunk->used = 0;
+        chunk->size = bytes;
+        chunk->next = ast->chunks;
+        ast->chunks = chunk;
+    }
+
+    void *memory = chunk->data + chunk->used;
+    chunk->used += size;
+    memset(memory, 0, size);
+    return memory;
+}
+
+/**
+ * Copies the text of a token into the arena.
+ *
+ * @param ast The arena to allocate from.
+ * @param token The token (usually an identifier).
+ * @return The null-terminated text of the token.
+ */
+char *ast_name(ast_t *ast, token_t token)
+{
+    char *name = ast_alloc(ast, token.length + 1);
+    memcpy(name, token.start, token.length);
+    return name;
+}
+
+/**
+ * Creates a node of the given type, reported at the position of a token.
+ *
+ * @param ast The arena to allocate from.
+ * @param type The type of the node.
+ * @param token The token the node's instruction is reported at.
+ * @return The new node, with every other field zeroed.
+ */
+node_t *new_node(ast_t *ast, node_type type, token_t token)
+{
+    node_t *node = ast_alloc(ast, sizeof(node_t));
+    node->type = type;
+    node->pos.line = token.line;
+    node->pos.column = token.column;
+    return node;
+}
+
+/**
+ * Appends a node to a node list, growing it in the arena.
+ *
+ * @param ast The arena to allocate from.
+ * @param list The list to append to.
+ * @param node The node to append (may be NULL, e.g. a missing initializer).
+ */
+void node_add(ast_t *ast, node_list_t *list, node_t *node)
+{
+    if (list->size == list->capacity)
+    {
+        int capacity = list->capacity == 0 ? 4 : list->capacity * 2;
+        node_t **items = ast_alloc(ast, capacity * sizeof(node_t *));
+        if (list->size > 0)
+            memcpy(items, list->items, list->size * sizeof(node_t *));
+        list->items = items;
+        list->capacity = capacity;
+    }
+    list->items[list->size++] = node;
+}
+
+/**
+ * Checks if an expression can be the target of an assignment: a variable,
+ * a field or an item (not a slice).
+ *
+ * @param node The expression.
+ * @return True if a value can be stored to it.
+ */
+bool is_assignable(node_t *node)
+{
+    switch (node->type)
+    {
+    case NODE_IDENTIFIER:
+    case NODE_FIELD:
+        return true;
+    case NODE_INDEX:
+        return !node->data.index.is_slice;
+    default:
+        return false;
+    }
+}
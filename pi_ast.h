@@ -0,0 +1,295 @@
+#ifndef PI_AST_H
+#define PI_AST_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "pi_token.h"
+#include "pi_value.h"
+#include "pi_opcode.h"
+
+#define AST_CHUNK_SIZE (64 * 1024) // Bytes per arena chunk
+
+// Kinds of syntax tree nodes
+typedef enum
+{
+    // Expressions
+    NODE_LITERAL,     // Number, string, boolean or nil constant
+    NODE_IDENTIFIER,  // Variable name
+    NODE_UNARY,       // Prefix operator (OP_UNARY)
+    NODE_BINARY,      // Infix operator (OP_BINARY or OP_COMPARE)
+    NODE_CONDITIONAL, // cond ? a : b
+    NODE_RANGE,       // a..b or a..b:step
+    NODE_LIST,        // [a, b, ...]
+    NODE_OBJECT,      // {key: value, method() {...}, ...}
+    NODE_FUNCTION,    // Function declaration, function expression, arrow or method
+    NODE_CALL,        // f(args)
+    NODE_INDEX,       // a[i] or a[start:stop:step]
+    NODE_FIELD,       // a.name
+    NODE_ASSIGN,      // target = value, target += value, ...
+    NODE_WALRUS,      // name <- value
+    NODE_UPDATE,      // ++x, --x, x++, x--
+
+    // Statements
+    NODE_BLOCK,     // { ... }
+    NODE_VAR,       // let a = 1, b
+    NODE_IF,        // if / elif / else
+    NODE_WHILE,     // while cond body
+    NODE_FOR,       // for name in iterable body
+    NODE_BREAK,     // break
+    NODE_CONTINUE,  // continue
+    NODE_RETURN,    // return [value]
+    NODE_YIELD,     // yield [value]
+    NODE_DEBUG,     // debug
+    NODE_EXPR_STMT, // An expression evaluated for its effect
+    NODE_PROGRAM    // The statements of a script
+} node_type;
+
+// How a function node was written
+typedef enum
+{
+    FUNC_DECL,   // fun name(params) {...}
+    FUNC_EXPR,   // fun(params) {...}
+    FUNC_ARROW,  // (params) -> body or name -> body
+    FUNC_METHOD  // key(params) {...} in an object literal
+} func_kind;
+
+// Where a variable lives, as found by the resolver (see pi_resolve.c)
+typedef enum
+{
+    REF_GLOBAL,  // Index into the global names
+    REF_LOCAL,   // Stack slot of the enclosing function
+    REF_UPVALUE  // Index into the upvalues of the enclosing function
+} ref_type;
+
+// A source position instructions are reported at
+typedef struct
+{
+    int line;
+    int column;
+} pos_t;
+
+typedef struct node_t node_t;
+
+// A growable array of nodes kept in the arena
+typedef struct
+{
+    node_t **items;
+    int size;
+    int capacity;
+} node_list_t;
+
+// A captured variable of a function, in the order OP_PUSH_CLOSURE reads them
+typedef struct
+{
+    int index;     // Slot (is_local) or upvalue index in the enclosing function
+    bool is_local; // Captured from the enclosing function's own locals
+} capture_t;
+
+struct node_t
+{
+    node_type type;
+    pos_t pos; // Position of the node's own instruction
+    pos_t end; // Last token of a member expression (line 0 if none)
+
+    union
+    {
+        struct
+        {
+            Value value;
+        } literal;
+
+        struct
+        {
+            char *name;
+            ref_type ref; // Set by the resolver
+            int index;    // Slot, upvalue or global name index
+        } ident;
+
+        struct
+        {
+            int op; // Index into unary_ops
+            node_t *operand;
+        } unary;
+
+        struct
+        {
+            OpCode opcode; // OP_BINARY or OP_COMPARE
+            int op;        // Index into bin_ops or comp_ops
+            node_t *left;
+            node_t *right;
+        } binary;
+
+        struct
+        {
+            node_t *cond;
+            node_t *then;
+            node_t *other;
+            pos_t then_pos; // First token of the `then` branch
+        } conditional;
+
+        struct
+        {
+            node_t *from;
+            node_t *to;
+            node_t *step; // NULL if omitted
+        } range;
+
+        struct
+        {
+            node_list_t items;
+        } list;
+
+        struct
+        {
+            char **keys;        // One key per value
+            node_list_t values; // Values, methods are NODE_FUNCTION
+        } object;
+
+        struct
+        {
+            func_kind kind;
+            char *name;            // Declared name or method key, NULL otherwise
+            node_t *decl;          // Identifier the declaration binds (FUNC_DECL)
+            node_list_t params;    // Identifiers of the parameters
+            node_list_t defaults;  // Default value of each parameter, or NULL
+            node_list_t body;      // Statements of a block body
+            node_t *expr;          // Expression body of an arrow, or NULL
+            bool has_this;         // Written inside an object literal: slot 0 is `this`
+            bool is_ctor;          // Method named `constructor`
+            bool is_generator;     // The body yields (set by the resolver)
+            capture_t *captures;   // Upvalues (set by the resolver)
+            int capture_count;     // Number of captures
+            pos_t params_pos;      // Token the parameter defaults are reported at
+            pos_t lbrace;          // '{' of a block body, or the start of an expression body
+            pos_t rbrace;          // '}' of a block body
+        } func;
+
+        struct
+        {
+            node_t *callee;
+            node_list_t args;
+        } call;
+
+        struct
+        {
+            node_t *object;
+            node_t *start; // The index, or the start of a slice (NULL: 0)
+            node_t *stop;  // End of a slice (NULL: to the end)
+            node_t *step;  // Step of a slice (NULL: 1)
+            bool is_slice;
+            pos_t colon; // First ':' of a slice
+        } index;
+
+        struct
+        {
+            node_t *object;
+            char *name;
+        } field;
+
+        struct
+        {
+            tk_type op; // TK_ASSIGN or a compound assignment
+            node_t *target;
+            node_t *value;
+        } assign;
+
+        struct
+        {
+            node_t *target; // Identifier
+            node_t *value;
+        } walrus;
+
+        struct
+        {
+            int op;      // 5 (++) or 6 (--), the index into unary_ops
+            bool prefix; // ++x (the new value) or x++ (the old value)
+            node_t *target;
+        } update;
+
+        struct
+        {
+            node_list_t body;
+            int pops; // Locals declared in the block (set by the resolver)
+        } block;
+
+        struct
+        {
+            node_list_t names; // Identifiers declared
+            node_list_t inits; // Initializer of each name, or NULL
+        } var;
+
+        struct
+        {
+            node_t *cond;
+            node_t *then;
+            node_t *other;   // Next elif (a NODE_IF with is_elif) or the else body
+            bool is_elif;    // This node is an elif of the node before it
+            pos_t cond_pos;  // Token the conditional jump is reported at
+            pos_t other_pos; // The elif or else keyword that follows
+        } if_stmt;
+
+        struct
+        {
+            node_t *cond;
+            node_t *body;
+            pos_t cond_pos; // First token of the condition
+        } while_stmt;
+
+        struct
+        {
+            node_t *var; // Identifier of the loop variable
+            node_t *iterable;
+            node_list_t body; // Statements, in the scope of the loop variable
+            int pops;         // Loop variable and body locals (set by the resolver)
+            pos_t iter_pos;   // First token of the iterable
+        } for_stmt;
+
+        struct
+        {
+            int pops;    // Locals to drop before leaving the loop (set by the resolver)
+            bool is_for; // The loop is a for-in loop, with an iterator to drop
+        } jump;
+
+        struct
+        {
+            node_t *value; // NULL if omitted
+        } ret;
+
+        struct
+        {
+            node_t *expr;
+        } expr_stmt;
+
+        struct
+        {
+            node_list_t body;
+        } program;
+    } data;
+};
+
+// A chunk of memory nodes are carved from
+typedef struct ast_chunk
+{
+    struct ast_chunk *next;
+    size_t used;
+    size_t size;
+    char data[];
+} ast_chunk;
+
+// Owns every node of a syntax tree, freed all at once
+typedef struct
+{
+    ast_chunk *chunks;
+} ast_t;
+
+ast_t *ast_create(void);
+void ast_free(ast_t *ast);
+void *ast_alloc(ast_t *ast, size_t size);
+char *ast_name(ast_t *ast, token_t token);
+
+node_t *new_node(ast_t *ast, node_type type, token_t token);
+void node_add(ast_t *ast, node_list_t *list, node_t *node);
+bool is_assignable(node_t *node);
+
+#endif
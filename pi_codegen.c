@@ -0,0 +1,727 @@
+#include <stdlib.h>
+
+#include "pi_codegen.h"
+#include "pi_object.h"
+#include "string.h"
+
+/*
+ * Bytecode generation from the resolved and folded syntax tree. Every
+ * instruction is reported at the source position of the node it comes from
+ * (see set_pos), which is what runtime errors and the line tables show.
+ */
+
+typedef struct
+{
+    compiler_t *comp; // Compiler the code is emitted to
+    node_t *func;     // Function being generated (NULL: global code)
+} codegen_t;
+
+static void gen_expr(codegen_t *cg, node_t *node);
+static void gen_stmt(codegen_t *cg, node_t *node);
+static void gen_assign(codegen_t *cg, node_t *node, bool load);
+
+/**
+ * Sets the source position the next instructions are reported at.
+ *
+ * @param comp The compiler instance.
+ * @param pos The position (ignored if line is 0).
+ */
+static void set_pos(compiler_t *comp, pos_t pos)
+{
+    if (pos.line == 0)
+        return;
+
+    comp->current_line = pos.line;
+    comp->current_col = pos.column;
+}
+
+/**
+ * Emits a load of a constant.
+ *
+ * @param comp The compiler instance.
+ * @param value The constant.
+ */
+static void load_const(compiler_t *comp, Value value)
+{
+    emit_16w(comp, OP_LOAD_CONST, store_const(comp, value));
+}
+
+/**
+ * Stores a name as a string constant.
+ *
+ * @param comp The compiler instance.
+ * @param name The name (a field name or an object key).
+ * @return The index of the constant.
+ */
+static int name_const(compiler_t *comp, const char *name)
+{
+    return store_const(comp, NEW_OBJ(new_pistring(string_copy(name))));
+}
+
+/**
+ * Emits a load of a resolved variable.
+ *
+ * @param comp The compiler instance.
+ * @param ident The identifier.
+ */
+static void load(compiler_t *comp, node_t *ident)
+{
+    switch (ident->data.ident.ref)
+    {
+    case REF_LOCAL:
+        emit_8w(comp, OP_LOAD_LOCAL, ident->data.ident.index);
+        break;
+    case REF_UPVALUE:
+        emit_8w(comp, OP_LOAD_UPVALUE, ident->data.ident.index);
+        break;
+    case REF_GLOBAL:
+        emit_8w(comp, OP_LOAD_GLOBAL, ident->data.ident.index);
+        break;
+    }
+}
+
+/**
+ * Emits a store to a resolved variable.
+ *
+ * @param comp The compiler instance.
+ * @param ident The identifier.
+ */
+static void store(compiler_t *comp, node_t *ident)
+{
+    switch (ident->data.ident.ref)
+    {
+    case REF_LOCAL:
+        emit_8w(comp, OP_STORE_LOCAL, ident->data.ident.index);
+        break;
+    case REF_UPVALUE:
+        emit_8w(comp, OP_STORE_UPVALUE, ident->data.ident.index);
+        break;
+    case REF_GLOBAL:
+        emit_8w(comp, OP_STORE_GLOBAL, ident->data.ident.index);
+        break;
+    }
+}
+
+/**
+ * Emits the store of the value on top of the stack to an assignment target:
+ * a variable, a field or an item.
+ *
+ * @param cg The generator.
+ * @param target The target.
+ */
+static void gen_store(codegen_t *cg, node_t *target)
+{
+    compiler_t *comp = cg->comp;
+
+    switch (target->type)
+    {
+    case NODE_IDENTIFIER:
+        set_pos(comp, target->pos);
+        store(comp, target);
+        break;
+
+    case NODE_FIELD:
+        gen_expr(cg, target->data.field.object);
+        set_pos(comp, target->pos);
+        emit_field(comp, OP_SET_FIELD, name_const(comp, target->data.field.name));
+        break;
+
+    case NODE_INDEX:
+        gen_expr(cg, target->data.index.object);
+        set_pos(comp, target->pos);
+        gen_expr(cg, target->data.index.start);
+        emit(comp, OP_SET_ITEM);
+        break;
+
+    default:
+        break;
+    }
+
+    set_pos(comp, target->end);
+}
+
+/**
+ * Emits the implicit return of a function body: `this` for a constructor,
+ * nil otherwise.
+ *
+ * @param comp The compiler instance.
+ * @param fn The function.
+ */
+static void gen_implicitReturn(compiler_t *comp, node_t *fn)
+{
+    if (fn->data.func.is_ctor && fn->data.func.kind != FUNC_DECL)
+        emit_8u(comp, OP_LOAD_LOCAL, 0);
+    else
+        emit(comp, OP_PUSH_NIL);
+    emit(comp, OP_RETURN);
+}
+
+/**
+ * Emits a function: the defaults of its parameters, its code in a context of
+ * its own, then the instructions that create it (see pop_function). A global
+ * function declaration is stored by name.
+ *
+ * @param cg The generator.
+ * @param fn The function.
+ */
+static void gen_function(codegen_t *cg, node_t *fn)
+{
+    compiler_t *comp = cg->comp;
+    node_list_t *body = &fn->data.func.body;
+
+    set_pos(comp, fn->data.func.params_pos);
+
+    if (fn->data.func.has_this)
+        emit(comp, OP_PUSH_NIL);
+
+    for (int i = 0; i < fn->data.func.defaults.size; i++)
+    {
+        node_t *value = fn->data.func.defaults.items[i];
+        if (value != NULL)
+            gen_expr(cg, value);
+        else
+            emit(comp, OP_PUSH_NIL);
+    }
+
+    push_function(comp, fn->data.func.name != NULL ? string_copy(fn->data.func.name) : NULL);
+
+    node_t *enclosing = cg->func;
+    cg->func = fn;
+
+    for (int i = 0; i < body->size; i++)
+        gen_stmt(cg, body->items[i]);
+
+    bool returns = body->size > 0 && body->items[body->size - 1]->type == NODE_RETURN;
+
+    switch (fn->data.func.kind)
+    {
+    case FUNC_DECL:
+        if (!returns)
+        {
+            // Mark where the implicit return comes from
+            set_pos(comp, fn->data.func.rbrace);
+            gen_implicitReturn(comp, fn);
+        }
+        break;
+
+    case FUNC_ARROW:
+        if (fn->data.func.expr != NULL)
+        {
+            // Return the value of the expression body
+            gen_expr(cg, fn->data.func.expr);
+            set_pos(comp, fn->data.func.lbrace);
+            emit(comp, OP_RETURN);
+            break;
+        }
+
+        if (body->size == 0)
+        {
+            set_pos(comp, fn->data.func.lbrace); // Set position at '{' for empty arrow block
+            gen_implicitReturn(comp, fn);
+        }
+        else if (!returns)
+        {
+            set_pos(comp, fn->data.func.rbrace);
+            gen_implicitReturn(comp, fn);
+        }
+        set_pos(comp, fn->data.func.rbrace);
+        break;
+
+    case FUNC_EXPR:
+    case FUNC_METHOD:
+        if (!returns)
+            gen_implicitReturn(comp, fn);
+        break;
+    }
+
+    cg->func = enclosing;
+
+    for (int i = 0; i < fn->data.func.capture_count; i++)
+        add_upvalue(comp, fn->data.func.captures[i].index, fn->data.func.captures[i].is_local);
+    comp->current->is_generator = fn->data.func.is_generator;
+
+    pop_function(comp, fn->data.func.params.size + (fn->data.func.has_this ? 1 : 0));
+
+    node_t *decl = fn->data.func.decl;
+    if (decl != NULL && decl->data.ident.ref == REF_GLOBAL)
+    {
+        // Mark function definition location before storing it
+        set_pos(comp, decl->pos);
+        store(comp, decl);
+    }
+}
+
+/**
+ * Emits a call. A direct call on a built-in passes its arguments in place on
+ * the stack, and is bound to the built-in table when the program never
+ * assigns to the name (see bind_builtin).
+ *
+ * @param cg The generator.
+ * @param call The call node.
+ */
+static void gen_call(codegen_t *cg, node_t *call)
+{
+    compiler_t *comp = cg->comp;
+    node_t *callee = call->data.call.callee;
+    node_list_t *args = &call->data.call.args;
+
+    bool is_native = callee->type == NODE_IDENTIFIER && callee->data.ident.ref == REF_GLOBAL &&
+                     is_builtin(comp, callee->data.ident.name);
+    int builtin = is_native ? bind_builtin(comp, callee->data.ident.name) : -1;
+
+    if (builtin != -1)
+        set_pos(comp, callee->pos); // The built-in is not loaded
+    else
+        gen_expr(cg, callee);
+
+    for (int i = 0; i < args->size; i++)
+        gen_expr(cg, args->items[i]);
+
+    set_pos(comp, call->pos);
+    if (builtin != -1)
+        emit_builtin(comp, builtin, args->size);
+    else
+        emit_8w(comp, is_native ? OP_CALL_NATIVE : OP_CALL_FUNCTION, args->size);
+}
+
+/**
+ * Returns the operator of a compound assignment.
+ *
+ * @param op The assignment token.
+ * @return The index of the operator in bin_ops.
+ */
+static int compound_op(tk_type op)
+{
+    switch (op)
+    {
+    case TK_PLUS_ASSIGN:
+        return 0; // "+"
+    case TK_MINUS_ASSIGN:
+        return 1; // "-"
+    case TK_MULT_ASSIGN:
+        return 2; // "*"
+    case TK_DIV_ASSIGN:
+        return 3; // "/"
+    case TK_MOD_ASSIGN:
+        return 4; // "%"
+    case TK_BITAND_ASSIGN:
+        return 8; // "&"
+    case TK_BITOR_ASSIGN:
+        return 9; // "|"
+    case TK_XOR_ASSIGN:
+        return 10; // "^"
+    default:
+        return -1;
+    }
+}
+
+/**
+ * Emits an assignment. In a chain such as "a = b = 0", the assignment to b
+ * runs first and a is assigned the value stored to b.
+ *
+ * @param cg The generator.
+ * @param node The assignment node.
+ * @param load True to leave the value assigned on the stack.
+ */
+static void gen_assign(codegen_t *cg, node_t *node, bool load)
+{
+    compiler_t *comp = cg->comp;
+    tk_type op = node->data.assign.op;
+    node_t *target = node->data.assign.target;
+    node_t *value = node->data.assign.value;
+
+    if (value->type == NODE_ASSIGN)
+        gen_assign(cg, value, false);
+
+    // Sync the runtime error position to the target
+    set_pos(comp, node->pos);
+
+    // Load the target for compound assignments
+    if (op != TK_ASSIGN)
+        gen_expr(cg, target);
+
+    gen_expr(cg, value->type == NODE_ASSIGN ? value->data.assign.target : value);
+
+    if (op != TK_ASSIGN)
+        emit_8u(comp, OP_BINARY, compound_op(op));
+
+    gen_store(cg, target);
+
+    if (load)
+        gen_expr(cg, target);
+}
+
+/**
+ * Emits an expression, leaving its value on the stack.
+ *
+ * @param cg The generator.
+ * @param node The expression.
+ */
+static void gen_expr(codegen_t *cg, node_t *node)
+{
+    compiler_t *comp = cg->comp;
+
+    switch (node->type)
+    {
+    case NODE_LITERAL:
+        set_pos(comp, node->pos);
+        load_const(comp, node->data.literal.value);
+        break;
+
+    case NODE_IDENTIFIER:
+        set_pos(comp, node->pos);
+        load(comp, node);
+        break;
+
+    case NODE_UNARY:
+        gen_expr(cg, node->data.unary.operand);
+        set_pos(comp, node->pos);
+        emit_8u(comp, OP_UNARY, node->data.unary.op);
+        break;
+
+    case NODE_BINARY:
+        gen_expr(cg, node->data.binary.left);
+        gen_expr(cg, node->data.binary.right);
+        set_pos(comp, node->pos);
+        emit_8u(comp, node->data.binary.opcode, node->data.binary.op);
+        break;
+
+    case NODE_CONDITIONAL:
+    {
+        gen_expr(cg, node->data.conditional.cond);
+        int then_jump = emit_16u(comp, OP_JUMP_IF_FALSE, 0);
+
+        set_pos(comp, node->data.conditional.then_pos);
+        gen_expr(cg, node->data.conditional.then);
+        int else_jump = emit_16u(comp, OP_JUMP, 0);
+
+        patch_jump(comp, then_jump);
+        gen_expr(cg, node->data.conditional.other);
+        patch_jump(comp, else_jump);
+        break;
+    }
+
+    case NODE_RANGE:
+        gen_expr(cg, node->data.range.from);
+        gen_expr(cg, node->data.range.to);
+        if (node->data.range.step != NULL)
+            gen_expr(cg, node->data.range.step);
+        else
+            emit(comp, OP_PUSH_NIL);
+        set_pos(comp, node->pos);
+        emit(comp, OP_PUSH_RANGE);
+        break;
+
+    case NODE_LIST:
+        set_pos(comp, node->pos);
+        for (int i = 0; i < node->data.list.items.size; i++)
+            gen_expr(cg, node->data.list.items.items[i]);
+        emit_16w(comp, OP_PUSH_LIST, node->data.list.items.size);
+        break;
+
+    case NODE_OBJECT:
+        set_pos(comp, node->pos);
+        for (int i = 0; i < node->data.object.values.size; i++)
+        {
+            // Each value is followed by its key
+            int index = name_const(comp, node->data.object.keys[i]);
+            gen_expr(cg, node->data.object.values.items[i]);
+            emit_16w(comp, OP_LOAD_CONST, index);
+        }
+        emit_16w(comp, OP_PUSH_MAP, node->data.object.values.size);
+        break;
+
+    case NODE_FUNCTION:
+        gen_function(cg, node);
+        break;
+
+    case NODE_CALL:
+        gen_call(cg, node);
+        break;
+
+    case NODE_INDEX:
+        gen_expr(cg, node->data.index.object);
+        set_pos(comp, node->pos);
+        if (!node->data.index.is_slice)
+        {
+            gen_expr(cg, node->data.index.start);
+            emit(comp, OP_GET_ITEM);
+            break;
+        }
+
+        // A missing start is 0, a missing stop the end (infinity) and a missing step 1
+        if (node->data.index.start != NULL)
+            gen_expr(cg, node->data.index.start);
+        else
+            load_const(comp, NEW_NUM(0));
+
+        if (node->data.index.stop != NULL)
+            gen_expr(cg, node->data.index.stop);
+        else
+            emit_16w(comp, OP_LOAD_CONST, 1);
+
+        if (node->data.index.step != NULL)
+            gen_expr(cg, node->data.index.step);
+        else
+            load_const(comp, NEW_NUM(1));
+
+        set_pos(comp, node->data.index.colon); // Set the position to the start of the slice
+        emit(comp, OP_PUSH_SLICE);
+        break;
+
+    case NODE_FIELD:
+        gen_expr(cg, node->data.field.object);
+        set_pos(comp, node->pos);
+        // Constant keys get a dedicated opcode carrying an inline cache
+        emit_field(comp, OP_GET_FIELD, name_const(comp, node->data.field.name));
+        break;
+
+    case NODE_ASSIGN:
+        gen_assign(cg, node, true);
+        break;
+
+    case NODE_WALRUS:
+        set_pos(comp, node->pos);
+        gen_expr(cg, node->data.walrus.value);
+        emit(comp, OP_DUP_TOP);
+        store(comp, node->data.walrus.target);
+        break;
+
+    case NODE_UPDATE:
+    {
+        node_t *target = node->data.update.target;
+        gen_expr(cg, target);
+
+        // ++x leaves the new value, x++ the old one
+        if (node->data.update.prefix)
+        {
+            set_pos(comp, node->pos);
+            emit_8u(comp, OP_UNARY, node->data.update.op);
+            emit(comp, OP_DUP_TOP);
+        }
+        else
+        {
+            emit(comp, OP_DUP_TOP);
+            set_pos(comp, node->pos);
+            emit_8u(comp, OP_UNARY, node->data.update.op);
+        }
+        gen_store(cg, target);
+        break;
+    }
+
+    default:
+        break;
+    }
+
+    set_pos(comp, node->end);
+}
+
+/**
+ * Emits an if statement and its elif and else branches.
+ *
+ * @param cg The generator.
+ * @param stmt The if node.
+ */
+static void gen_if(codegen_t *cg, node_t *stmt)
+{
+    compiler_t *comp = cg->comp;
+
+    int count = 0;
+    for (node_t *branch = stmt; branch != NULL && branch->type == NODE_IF; branch = branch->data.if_stmt.other)
+        count++;
+
+    // The jumps from the end of each branch to the end of the statement
+    int *end_jumps = malloc(count * sizeof(int));
+    int jump_count = 0;
+
+    node_t *branch = stmt;
+    while (true)
+    {
+        gen_expr(cg, branch->data.if_stmt.cond);
+        set_pos(comp, branch->data.if_stmt.cond_pos);
+        int then_jump = emit_16u(comp, OP_JUMP_IF_FALSE, 0);
+
+        gen_stmt(cg, branch->data.if_stmt.then);
+
+        node_t *other = branch->data.if_stmt.other;
+        if (other != NULL)
+        {
+            set_pos(comp, branch->data.if_stmt.other_pos);
+            end_jumps[jump_count++] = emit_16u(comp, OP_JUMP, 0);
+        }
+        patch_jump(comp, then_jump);
+
+        if (other != NULL && other->type == NODE_IF && other->data.if_stmt.is_elif)
+        {
+            branch = other;
+            continue;
+        }
+
+        if (other != NULL)
+        {
+            set_pos(comp, branch->data.if_stmt.other_pos);
+            gen_stmt(cg, other);
+        }
+        break;
+    }
+
+    for (int i = 0; i < jump_count; i++)
+        patch_jump(comp, end_jumps[i]);
+    free(end_jumps);
+}
+
+/**
+ * Emits a statement.
+ *
+ * @param cg The generator.
+ * @param node The statement.
+ */
+static void gen_stmt(codegen_t *cg, node_t *node)
+{
+    compiler_t *comp = cg->comp;
+
+    switch (node->type)
+    {
+    case NODE_BLOCK:
+        for (int i = 0; i < node->data.block.body.size; i++)
+            gen_stmt(cg, node->data.block.body.items[i]);
+        emit_pop(comp, node->data.block.pops);
+        break;
+
+    case NODE_VAR:
+        for (int i = 0; i < node->data.var.names.size; i++)
+        {
+            node_t *name = node->data.var.names.items[i];
+            node_t *init = node->data.var.inits.items[i];
+
+            if (init != NULL)
+                gen_expr(cg, init);
+            else
+                emit(comp, OP_PUSH_NIL);
+
+            // A local stays in its slot on the stack
+            if (name->data.ident.ref == REF_GLOBAL)
+                store(comp, name);
+        }
+        break;
+
+    case NODE_FUNCTION:
+        gen_function(cg, node);
+        break;
+
+    case NODE_IF:
+        gen_if(cg, node);
+        break;
+
+    case NODE_WHILE:
+    {
+        // Record the address to jump back to for looping
+        int start = code_size(comp);
+
+        gen_expr(cg, node->data.while_stmt.cond);
+        set_pos(comp, node->data.while_stmt.cond_pos);
+        int exit = emit_16u(comp, OP_JUMP_IF_FALSE, 0);
+
+        push_loop(comp, start);
+        gen_stmt(cg, node->data.while_stmt.body);
+        pop_loop(comp, start);
+
+        patch_jump(comp, exit);
+        break;
+    }
+
+    case NODE_FOR:
+    {
+        gen_expr(cg, node->data.for_stmt.iterable);
+        set_pos(comp, node->data.for_stmt.iter_pos); // associate with iterable expression
+        emit(comp, OP_PUSH_ITER);
+
+        set_pos(comp, node->data.for_stmt.var->pos); // mark the loop start
+        int address = emit_16u(comp, OP_LOOP, 0);
+
+        push_loop(comp, address - 2);
+        for (int i = 0; i < node->data.for_stmt.body.size; i++)
+            gen_stmt(cg, node->data.for_stmt.body.items[i]);
+        emit_pop(comp, node->data.for_stmt.pops);
+        pop_loop(comp, address - 2);
+
+        patch_jump(comp, address);
+        break;
+    }
+
+    case NODE_BREAK:
+        set_pos(comp, node->pos);
+        if (node->data.jump.is_for)
+            emit(comp, OP_POP_ITER);
+        emit_pop(comp, node->data.jump.pops);
+        push_break(comp, emit_jump(comp, 0));
+        break;
+
+    case NODE_CONTINUE:
+        set_pos(comp, node->pos);
+        emit_pop(comp, node->data.jump.pops);
+        emit_loop(comp, get_continue(comp));
+        break;
+
+    case NODE_RETURN:
+        set_pos(comp, node->pos);
+        if (cg->func != NULL && cg->func->data.func.is_ctor)
+            emit_8u(comp, OP_LOAD_LOCAL, 0);
+        else if (node->data.ret.value != NULL)
+            gen_expr(cg, node->data.ret.value);
+        else
+            load_const(comp, NEW_NIL());
+        emit(comp, OP_RETURN);
+        break;
+
+    case NODE_YIELD:
+        set_pos(comp, node->pos);
+        if (node->data.ret.value != NULL)
+            gen_expr(cg, node->data.ret.value);
+        else
+            emit(comp, OP_PUSH_NIL);
+        emit(comp, OP_YIELD);
+        break;
+
+    case NODE_DEBUG:
+        emit(comp, OP_DEBUG);
+        break;
+
+    case NODE_EXPR_STMT:
+    {
+        node_t *expr = node->data.expr_stmt.expr;
+
+        // An assignment statement leaves nothing on the stack
+        if (expr->type == NODE_ASSIGN)
+            gen_assign(cg, expr, false);
+        else
+        {
+            gen_expr(cg, expr);
+            if (!comp->is_repl)
+                emit(comp, OP_POP); // Emit POP only if not in REPL mode
+        }
+        break;
+    }
+
+    case NODE_PROGRAM:
+        for (int i = 0; i < node->data.program.body.size; i++)
+            gen_stmt(cg, node->data.program.body.items[i]);
+        break;
+
+    default:
+        break;
+    }
+}
+
+/**
+ * Generates the bytecode of a resolved program into the global context of
+ * the compiler.
+ *
+ * @param comp The compiler instance.
+ * @param program The program node.
+ */
+void generate(compiler_t *comp, node_t *program)
+{
+    codegen_t cg = {comp, NULL};
+    gen_stmt(&cg, program);
+}
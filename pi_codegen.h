@@ -0,0 +1,9 @@
+#ifndef PI_CODEGEN_H
+#define PI_CODEGEN_H
+
+#include "pi_ast.h"
+#include "pi_compiler.h"
+
+void generate(compiler_t *comp, node_t *program);
+
+#endif // PI_CODEGEN_H
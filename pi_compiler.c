@@ -4,6 +4,7 @@
 #include <stdarg.h>
 #include <stdio.h>
 #include <math.h>
+#include <limits.h>
 
 #include "pi_compiler.h"
 #include "pi_object.h"
@@ -12,9 +13,16 @@
 #include "common.h"
 #include "list.h"
 #include "string.h"
+#include "pi_set.h"
 
 #include "builtin/pi_builtin.h"
 
+// Initial number of slots of the hash index over the constants
+#define CONST_MIN_SLOTS 64
+
+static void rebuild_consts(compiler_t *comp);
+static int emit_pair(compiler_t *comp, OpCode opcode, int first, int second);
+
 static const char *op_names[] = {
     [0x4] = "RETURN_VALUE",
     [0x5] = "LOAD_CONST",
@@ -53,6 +61,12 @@ static const char *op_names[] = {
     [0x29] = "UNARY_OP",
     [0x2a] = "DEBUG_OP",
     [0x2b] = "POP_ITER",
+    [0x2c] = "GET_FIELD",
+    [0x2d] = "SET_FIELD",
+    [0x2e] = "YIELD",
+    [0x2f] = "CALL_NATIVE",
+    [0x30] = "CALL_BUILTIN",
+    [0x31] = "WIDE",
     [0x3c] = "CLOSE_UPVALUE",
 };
 
@@ -71,11 +85,10 @@ static context_t *create_context(bool is_function, list_t *code, char *fun_name)
     context_t *context = malloc(sizeof(context_t));
 
     context->upvalues = list_create(sizeof(upvalue_t));
-    context->locals = stack_create(sizeof(local_t));
-    context->instrs = list_create(sizeof(instr_t));
+    context->lines = list_create(sizeof(line_t));
 
     context->is_function = is_function;
-    context->depth = 0;
+    context->is_generator = false;
     context->code = code;
 
     if (fun_name == NULL && is_function)
@@ -90,23 +103,9 @@ static context_t *create_context(bool is_function, list_t *code, char *fun_name)
     return context;
 }
 
-/**
- * Frees the contents of an instr_t struct.
- * This includes dynamically allocated strings and operand arrays.
- * @param instr The instruction to free.
- */
-static void free_instr(instr_t *instr)
-{
-    free(instr->descr);
-    free(instr->fun_name);
-    free(instr->operands);
-    free(instr);
-}
-
 /**
  * Frees the contents of a context_t struct.
- * This includes its upvalues, locals, and instruction metadata.
- * It also handles nested freeing for instr_t.
+ * This includes its upvalues, locals, and line table.
  * @param context The context to free.
  */
 static void free_context(context_t *context)
@@ -114,25 +113,9 @@ static void free_context(context_t *context)
     // Free upvalues
     list_free(context->upvalues);
 
-    // Free locals (local_t structs contain strdup'd names)
-    while (!is_empty(context->locals))
-    {
-        local_t *local = (local_t *)pop(context->locals);
-        free(local->name);
-        free(local);
-    }
-    stack_free(context->locals);
-
-    // Free instrs list and their contents
-    if (context->instrs)
-    {
-        while (!list_isEmpty(context->instrs))
-        {
-            instr_t *instr = (instr_t *)list_pop(context->instrs);
-            free_instr(instr);
-        }
-        list_free(context->instrs);
-    }
+    // A function's line table moves to its code object (see pop_function)
+    if (context->lines)
+        list_free(context->lines);
 
     free(context->fun_name);
     free(context);
@@ -197,8 +180,8 @@ static upvalue_t *create_upvalue(int index, bool is_local)
  *
  * This function allocates memory for a compiler structure and initializes its
  * members. It creates empty lists for the code, constants, names, and
- * instruction metadata. It also initializes the stack of local variables, the
- * stack of contexts, the stack of objects, and the stack of loops.
+ * the line table. It also initializes the stack of contexts and the stack
+ * of loops.
  *
  * @return A pointer to the newly initialized compiler instance.
  */
@@ -212,6 +195,9 @@ compiler_t *init_compiler()
     comp->code = list_create(sizeof(uint8_t));
     comp->constants = list_create(sizeof(Value));
 
+    comp->const_slots = NULL;
+    comp->const_capacity = 0;
+
     // Initialize the constants list with NaN, Infinity, true, and false
     list_add(comp->constants, &NEW_NUM(NAN));
     list_add(comp->constants, &NEW_NUM(INFINITY));
@@ -219,8 +205,12 @@ compiler_t *init_compiler()
     list_add(comp->constants, &NEW_BOOL(true));
     list_add(comp->constants, &NEW_BOOL(false));
 
+    // Hash index over the constants (see store_const)
+    rebuild_consts(comp);
+
     // names for storing the names of the global variables
     comp->names = list_create(sizeof(String));
+    comp->name_table = ht_create(sizeof(int));
     comp->builtin_names = list_create(sizeof(String));
 
     // Register built-in constant names
@@ -231,23 +221,22 @@ compiler_t *init_compiler()
     for (int i = 0; i < BUILTIN_FUNC_COUNT; i++)
         list_add(comp->builtin_names, new_string(builtin_functions[i].name));
 
+    // Built-in names the program assigns to, which calls can't be bound to
+    comp->shadowed = list_create(sizeof(String));
+
     // Initialize stack_t members
-    comp->locals = stack_create(sizeof(local_t));
     comp->contexts = stack_create(sizeof(context_t));
     comp->loops = stack_create(sizeof(loop_t));
-    comp->objects = stack_create(sizeof(String));
-    comp->name = "";
 
     // Initialize the current <global> context
     comp->current = create_context(false, comp->code, NULL);
 
-    // Initialize instruction table with global scope
-    comp->instrs = ht_create(sizeof(list_t));
+    comp->lines = comp->current->lines;
 
-    comp->is_lookUp = false;
-    comp->is_upvalue = false;
     comp->is_repl = false;
 
+    comp->ic_count = 0;
+
     push(comp->contexts, comp->current);
 
     return comp;
@@ -313,354 +302,22 @@ void add_code(compiler_t *comp, byte _byte)
 }
 
 /**
- * @brief Checks if the current scope is a local scope.
- *
- * This function determines whether the current compilation context
- * is within a local scope. A local scope is identified by having
- * a scope depth greater than zero or by being within a function context.
- *
- * @param comp A pointer to the compiler instance containing the current context.
- * @return true if the current scope is local, false otherwise.
- */
-bool is_localScope(compiler_t *comp)
-{
-    // A scope is considered local if its depth is greater than zero
-    // or if it is within a function context.
-    return comp->current->depth > 0 || comp->current->is_function;
-}
-
-/**
- * Pushes a new object onto the stack of objects being allocated.
- *
- * This function is used to manage the allocation of objects
- * within the compiler's current context. It ensures that the
- * new object is added to the stack unless a lookup operation
- * is being performed.
- *
- * @param comp A pointer to the compiler instance containing the current context.
- */
-void push_object(compiler_t *comp)
-{
-    if (!comp->is_lookUp)
-        // Push a new object onto the stack using the current variable name
-        push(comp->objects, new_string(comp->name));
-}
-
-/**
- * Pops the current object from the stack of objects being allocated.
- *
- * This function is used to manage the allocation of objects
- * within the compiler's current context. It ensures that the
- * current object is removed from the stack unless a lookup operation
- * is being performed.
- *
- * @param comp A pointer to the compiler instance containing the current context.
- */
-void pop_object(compiler_t *comp)
-{
-    if (!comp->is_lookUp)
-        // Pop the current object from the stack of objects being allocated
-        pop(comp->objects);
-}
-
-/**
- * Checks if the compiler is currently compiling an object.
- *
- * @param comp[in] A pointer to the compiler instance containing the current context.
- * @return true if the compiler is compiling an object, false otherwise.
- */
-bool is_object(compiler_t *comp)
-{
-    return !is_empty(comp->objects);
-}
-
-/**
- * Determines if the current context is a constructor function.
- *
- * This function checks whether the compiler is currently
- * compiling a function named "constructor" within an object context.
- *
- * @param comp A pointer to the compiler instance containing the current context.
- * @return true if the current context is a constructor function, false otherwise.
- */
-bool is_constructor(compiler_t *comp)
-{
-    // Check if the current context is an object and a function
-    if (is_object(comp) && comp->current->is_function)
-        // Compare the current function name with "constructor"
-        return strcmp(comp->current->fun_name, "constructor") == 0;
-
-    return false;
-}
-/**
- * Checks if the compiler is currently performing a lookup operation.
- *
- * This function returns the status of the is_lookUp flag in the compiler
- * instance, indicating whether a lookup operation is in progress.
- *
- * @param comp A pointer to the compiler instance containing the lookup flag.
- * @return true if a lookup operation is in progress, false otherwise.
- */
-bool is_lookUp(compiler_t *comp)
-{
-    return comp->is_lookUp;
-}
-
-/**
- * @brief Sets the lookup flag in the compiler and returns the previous value.
- *
- * This function is used to control whether the compiler is currently
- * performing a lookup operation. It is used to prevent the compiler
- * from capturing variables that are not intended to be captured.
- *
- * @param comp A pointer to the compiler instance containing the lookup flag.
- * @param value The new value for the lookup flag.
- * @return The previous value of the lookup flag.
- */
-bool look_up(compiler_t *comp, bool value)
-{
-    // Store the current value of the lookup flag
-    bool look_up = comp->is_lookUp;
-
-    // Update the lookup flag with the new value
-    comp->is_lookUp = value;
-
-    // Return the previous value of the lookup flag
-    return look_up;
-}
-
-/**
- * Prints the current local variables in the compiler
- *
- * This function is used for debugging purposes and prints the current
- * local variables in the compiler to the console. It prints the name,
- * depth, and whether the variable is captured as an upvalue.
- *
- * @param comp A pointer to the compiler instance containing the locals stack.
- */
-void print_locals(compiler_t *comp)
-{
-    printf("Locals stack (top to bottom):\n");
-
-    // Iterate from top to bottom of the stack.
-    local_t *local = (local_t *)top(comp->current->locals);
-    printf("Local: name = %s, depth = %d, is_captured = %s\n",
-           local->name,
-           local->depth,
-           local->is_captured ? "true" : "false");
-
-    printf("\n");
-}
-
-/**
- * @brief Adds a new local variable to the current scope.
- *
- * This function checks if the variable with the given name already exists
- * in the current scope. If it does, an error is reported. Otherwise, it
- * allocates a new local variable, sets its properties, and pushes it onto
- * the stack of local variables.
- *
- * @param comp[in] A pointer to the compiler instance.
- * @param name[in] The name of the local variable to add.
- */
-void add_local(compiler_t *comp, char *name)
-{
-    stack_t *locals = comp->current->locals;
-
-    // Check for name conflict ONLY in current block
-    for (int i = stack_size(locals) - 1; i >= 0; i--)
-    {
-        local_t *local = (local_t *)stack_getAt(locals, i);
-
-        if (local->depth < comp->current->depth)
-            break; // Stop checking once we’re outside the current block
-
-        if (strcmp(local->name, name) == 0)
-            p_errorf(comp->current_line, comp->current_col,
-                     "Name already declared in this scope: [%s]", name);
-    }
-
-    // Allocate and initialize a new local variable
-    local_t *local = malloc(sizeof(local_t));
-    local->name = strdup(name); // Allocate and copy name string
-    local->depth = comp->current->depth;
-    local->is_captured = false;
-
-    // Push the new local variable onto the stack
-    push(locals, local);
-}
-
-/**
- * @brief Retrieves the index of a local or upvalue variable by name.
- *
- * This function searches for a variable with the given name in the
- * current context. It first attempts to resolve the variable as a
- * local variable. If it is not found, it checks for the variable as
- * an upvalue, updating the compiler's state to indicate the result.
- *
- * @param comp[in] A pointer to the compiler instance.
- * @param name[in] The name of the variable to retrieve.
- * @return The index of the variable if found, otherwise -1.
- */
-int get_local(compiler_t *comp, char *name)
-{
-    // Initialize the variable index to -1
-    int index = -1;
-    // Determine the current depth of the context stack
-    int depth = stack_size(comp->contexts) - 1;
-    // Reset the upvalue flag
-    comp->is_upvalue = false;
-
-    // Attempt to resolve the variable as a local variable
-    index = resolve_local(comp, depth, name);
-    if (index != -1)
-        return index;
-    else
-    {
-        // Attempt to resolve the variable as an upvalue
-        index = resolve_upvalue(comp, depth, name);
-        // Update the upvalue flag if found
-        comp->is_upvalue = true;
-    }
-    // Return the resolved index or -1 if not found
-    return index;
-}
-
-/**
- * @brief Retrieves the number of local variables at a given depth.
+ * Adds an upvalue to the function being compiled.
  *
- * This function calculates the number of local variables declared
- * at or above a given depth. It iterates through the stack of local
- * variables, counting the number of variables until it finds a
- * variable with a depth less than the given depth.
- *
- * @param comp[in] A pointer to the compiler instance.
- * @param depth[in] The depth at which to retrieve the local variable count.
- * @return The number of local variables at the given depth.
- */
-int get_localSize(compiler_t *comp, int depth)
-{
-    int size = 0;
-
-    stack_t *locals = comp->current->locals;
-    int l_size = stack_size(locals);
-
-    for (int i = l_size - 1; i >= 0; i--)
-    {
-        local_t *local = (local_t *)stack_getAt(locals, i);
-        if (local->depth >= depth)
-            size++;
-        else
-            break;
-    }
-    return size;
-}
-
-/**
- * @brief Resolves a local variable in the current context.
- *
- * This function searches for a local variable with the given name
- * in the current context. It iterates through the stack of local
- * variables and checks each variable for a match with the given
- * name.
- *
- * @param comp[in] A pointer to the compiler instance.
- * @param depth[in] The depth of the context to search.
- * @param name[in] The name of the variable to search for.
- * @return The index of the variable if found, otherwise -1.
- */
-int resolve_local(compiler_t *comp, int depth, char *name)
-{
-    int index = -1;
-    local_t *local;
-    context_t *context = stack_getAt(comp->contexts, depth);
-    // Iterate through the stack of local variables in reverse order
-    for (int i = stack_size(context->locals) - 1; i >= 0; i--)
-    {
-        local = (local_t *)stack_getAt(context->locals, i);
-        // Check if the current local variable matches the given name
-        if (strcmp(local->name, name) == 0)
-        {
-            index = i;
-            break;
-        }
-    }
-    // Return the resolved index or -1 if not found
-    return index;
-}
-
-/**
- * @brief Resolves an upvalue in the current context.
- *
- * This function attempts to resolve a variable as an upvalue by first
- * checking the enclosing local scope and then any existing upvalues.
- *
- * @param comp[in] A pointer to the compiler instance.
- * @param depth[in] The depth of the context to search.
- * @param name[in] The name of the variable to search for.
- * @return The index of the upvalue if found, otherwise -1.
- */
-int resolve_upvalue(compiler_t *comp, int depth, char *name)
-{
-    // Base case: if the depth is 0, stop searching and return -1
-    if (depth == 0)
-        return -1;
-
-    // Attempt to resolve the variable as a local variable in the enclosing scope
-    int index = resolve_local(comp, depth - 1, name);
-    if (index != -1)
-        // Add the local variable as an upvalue and return its index
-        return add_upvalue(comp, depth, index, true);
-
-    // Attempt to resolve the variable as an upvalue in the enclosing scope
-    int upvalue = resolve_upvalue(comp, depth - 1, name);
-    if (upvalue != -1)
-        // Add the existing upvalue and return its index
-        return add_upvalue(comp, depth, upvalue, false);
-
-    // If the variable cannot be resolved as an upvalue, return -1
-    return -1;
-}
-
-/**
- * Adds an upvalue to the given context.
- *
- * This function adds an upvalue to the given context if it does not already
- * exist. It returns the index of the upvalue in the context's upvalue list.
+ * The captures of a function are found by the resolver (see pi_resolve.c),
+ * which also gives each one its index, so they are added in order.
  *
  * @param comp[in] The compiler instance.
- * @param depth[in] The depth of the context to modify.
- * @param index[in] The index of the variable to add as an upvalue.
+ * @param index[in] The index of the captured variable in the enclosing function.
  * @param is_local[in] A flag indicating if the variable is a local variable or
  *                     an upvalue from an outer scope.
  * @return The index of the upvalue in the context's upvalue list.
  */
-int add_upvalue(compiler_t *comp, int depth, int index, bool is_local)
+int add_upvalue(compiler_t *comp, int index, bool is_local)
 {
-    // Get the context at the given depth
-    context_t *current = stack_getAt(comp->contexts, depth);
-
-    // Check if the upvalue already exists in the context's upvalue list
-    int size = list_size(current->upvalues);
-    for (int i = 0; i < size; i++)
-    {
-        // Get the upvalue at the current index
-        upvalue_t *_upvalue = (upvalue_t *)list_getAt(current->upvalues, i);
-
-        // If the upvalue already exists, return its index
-        if (_upvalue->index == index && _upvalue->is_local == is_local)
-            return i;
-    }
-
-    // If the upvalue does not exist, create a new upvalue structure and add it to
-    // the context's upvalue list
-    upvalue_t *upvalue = malloc(sizeof(upvalue_t));
-    upvalue->index = index;
-    upvalue->is_local = is_local;
-    list_add(current->upvalues, upvalue);
-
-    // Return the index of the new upvalue
-    return size - 1;
+    upvalue_t upvalue = {is_local, index};
+    list_add(comp->current->upvalues, &upvalue);
+    return list_size(comp->current->upvalues) - 1;
 }
 
 /**
@@ -684,98 +341,56 @@ bool is_builtin(compiler_t *comp, const char *name)
 }
 
 /**
- * Adds a new variable to the current scope.
- * If the variable is local, it checks if the variable is already declared.
- * If the variable is global, it stores the variable in the global scope.
+ * Records that the program assigns to a built-in name, so calls on it
+ * always look the global up.
+ *
  * @param comp The compiler instance.
- * @param name The name of the variable to add.
+ * @param name The name assigned to.
  */
-void add_variable(compiler_t *comp, char *name)
+void shadow_builtin(compiler_t *comp, const char *name)
 {
-    int g_index = -1;
-    // Check if the variable is local or global
-    if (is_localScope(comp))
-    {
-        // Add the local variable to the current scope
-        add_local(comp, name);
-    }
-    else
-    {
-        // Check if the global variable already exists
-        g_index = name_index(comp, name);
-        if (g_index != -1 || is_builtin(comp, name))
-            // Error if the variable already exists
-            p_errorf(comp->current_line, comp->current_col, "Name already exists [%s]", name);
-
-        // Store the global variable
-        g_index = store_name(comp, name);
-        emit_8u(comp, OP_STORE_GLOBAL, name, g_index);
-    }
+    if (is_builtin(comp, name) && !is_shadowed(comp, name))
+        list_add(comp->shadowed, new_string(name));
 }
 
 /**
- * Stores a variable in the current scope.
- * If the variable is local, it checks if the variable is already declared.
- * If the variable is global, it stores the variable in the global scope.
+ * Checks if the program assigns to the given built-in name.
+ *
  * @param comp The compiler instance.
- * @param name The name of the variable to store.
+ * @param name The name to check.
+ * @return True if the name was recorded by shadow_builtin.
  */
-void store_variable(compiler_t *comp, char *name)
+bool is_shadowed(compiler_t *comp, const char *name)
 {
-    // If the variable is local, check if the variable is already declared
-    if (is_localScope(comp))
-    {
-        int index = get_local(comp, name);
-        if (index != -1)
-            // Store the variable in the local scope
-            emit_8u(comp, comp->is_upvalue ? OP_STORE_UPVALUE : OP_STORE_LOCAL, name, index);
-        else
-        {
-            // Store the variable in the global scope
-            int g_index = store_name(comp, name);
-            emit_8u(comp, OP_STORE_GLOBAL, name, g_index);
-        }
-    }
-    else
-    {
-        // Store the variable in the global scope
-        int g_index = store_name(comp, name);
-        emit_8u(comp, OP_STORE_GLOBAL, name, g_index);
-    }
+    for (int i = 0; i < comp->shadowed->size; i++)
+        if (strcmp(string_get(comp->shadowed, i), name) == 0)
+            return true;
+    return false;
 }
 
 /**
- * Loads a variable from the current scope or global scope.
+ * Binds a call to a built-in function at compile time.
  *
- * This function attempts to load a variable by its name from the current
- * local scope first. If the variable is not found locally, it attempts
- * to load it from the global scope.
+ * A call on a built-in function the program never assigns to can index the
+ * built-in table directly instead of loading the function by name. In the
+ * REPL a later line could still assign to the name, so nothing is bound
+ * there.
  *
- * @param comp A pointer to the compiler instance.
- * @param name The name of the variable to load.
+ * @param comp The compiler instance.
+ * @param name The name of the callee.
+ * @return The index of the function in builtin_functions, or -1.
  */
-void load_variable(compiler_t *comp, char *name)
+int bind_builtin(compiler_t *comp, const char *name)
 {
-    // Attempt to find the variable in the local scope
-    int index = get_local(comp, name);
-    if (index != -1)
-    {
-        // Emit an instruction to load from the appropriate scope
-        if (comp->is_upvalue)
-            emit_8u(comp, OP_LOAD_UPVALUE, name, index);
-        else
-            emit_8u(comp, OP_LOAD_LOCAL, name, index);
-    }
-    else
+    if (comp->is_repl || is_shadowed(comp, name))
+        return -1;
+
+    for (int i = 0; i < BUILTIN_FUNC_COUNT; i++)
     {
-        // Attempt to find the variable in the global scope
-        int g_index = name_index(comp, name);
-        if (g_index == -1)
-            // If not found, store the name in the global scope
-            g_index = store_name(comp, name);
-        // Emit an instruction to load from the global scope
-        emit_8u(comp, OP_LOAD_GLOBAL, name, g_index);
+        if (strcmp(builtin_functions[i].name, name) == 0)
+            return i;
     }
+    return -1; // A built-in constant
 }
 
 /**
@@ -787,15 +402,9 @@ void load_variable(compiler_t *comp, char *name)
  */
 int name_index(compiler_t *comp, char *name)
 {
-    // Iterate through the list of names in the compiler
-    for (int i = 0; i < comp->names->size; i++)
-    {
-        char *_name = string_get(comp->names, i);
-        // Compare the current name with the target name
-        if (strcmp(_name, name) == 0)
-            return i; // Return the index if a match is found
-    }
-    return -1; // Return -1 if the name is not found in the list
+    // The names are indexed by a hash table from name to position
+    int *index = ht_get(comp->name_table, name);
+    return index != NULL ? *index : -1;
 }
 
 /**
@@ -818,54 +427,11 @@ int store_name(compiler_t *comp, char *name)
     // Add the name to the list of names
     list_add(comp->names, new_string(name));
 
-    // Return the new index
-    return comp->names->size - 1;
-}
-
-/**
- * Removes a specified number of local variables from the current context's local stack.
- * This function is used to manage scope by clearing locals when a scope is exited.
- *
- * @param comp A pointer to the compiler instance containing the current context.
- * @param size The number of local variables to remove from the stack.
- */
-void remove_locals(compiler_t *comp, int size)
-{
-    // Pop the specified number of local variables from the stack
-    while (size-- > 0)
-        pop(comp->current->locals);
-}
-
-/**
- * Increments the depth of the current scope in the compiler.
- * This function is used to manage scope levels by increasing
- * the depth whenever a new scope is entered.
- *
- * @param comp A pointer to the compiler instance containing the current context.
- */
-void push_scope(compiler_t *comp)
-{
-    // Increment the depth of the current scope
-    comp->current->depth++;
-}
+    index = comp->names->size - 1;
+    ht_put(comp->name_table, name, &index);
 
-/**
- * Decrements the depth of the current scope in the compiler.
- * This function is used to manage scope levels by decreasing
- * the depth whenever a scope is exited.
- *
- * @param comp A pointer to the compiler instance containing the current context.
- */
-void pop_scope(compiler_t *comp)
-{
-    // Get the number of local variables at the current depth
-    int size = emit_pop(comp, comp->current->depth);
-
-    // Remove the local variables from the stack
-    remove_locals(comp, size);
-
-    // Decrement the depth of the current scope
-    comp->current->depth--;
+    // Return the new index
+    return index;
 }
 
 /**
@@ -874,16 +440,13 @@ void pop_scope(compiler_t *comp)
  *
  * @param comp A pointer to the compiler instance.
  * @param address The address to jump to for continuing the loop.
- * @param is_for A boolean indicating if the loop is a for-loop.
  */
-void push_loop(compiler_t *comp, int address, bool is_for)
+void push_loop(compiler_t *comp, int address)
 {
     loop_t *loop = (loop_t *)malloc(sizeof(loop_t)); // Allocate memory for a new loop
 
     loop->_continue = address;                // Set the continue address
-    loop->depth = comp->current->depth;       // Set the loop depth based on the current scope depth
     loop->breaks = stack_create(sizeof(int)); // Create a stack to hold break addresses
-    loop->is_for = is_for;                    // Indicate if the loop is a for-loop
 
     push(comp->loops, loop); // Push the new loop onto the stack
 }
@@ -900,10 +463,8 @@ void pop_loop(compiler_t *comp, int address)
     loop_t *loop = (loop_t *)pop(comp->loops); // Pop the current loop from the stack
     stack_t *breaks = loop->breaks;            // Get the stack of break addresses
 
-    int16_t offset = address - comp->code->size; // Calculate the offset to the continue address
-
     // Emit a jump instruction to the continue address
-    emit_16u(comp, OP_JUMP, "", offset);
+    emit_loop(comp, address);
 
     // Patch the break instructions to jump to the continue address
     while (is_empty(breaks) == false)      // While there are still break addresses
@@ -941,42 +502,6 @@ int get_continue(compiler_t *comp)
 {
     return ((loop_t *)top(comp->loops))->_continue;
 }
-/**
- * Checks if the current loop is a for-loop.
- *
- * @param comp A pointer to the compiler instance.
- * @return true if the current loop is a for-loop, false otherwise.
- */
-bool is_forLoop(compiler_t *comp)
-{
-    return ((loop_t *)top(comp->loops))->is_for; // Check if the current loop is a for-loop
-}
-
-/**
- * Checks if the compiler is currently inside a loop.
- *
- * @param comp[in] A pointer to the compiler instance.
- * @return true if the compiler is inside a loop, false otherwise.
- */
-bool in_loop(compiler_t *comp)
-{
-    return !is_empty(comp->loops); // Check if the loops stack is empty
-}
-
-/**
- * Retrieves the depth of the current loop context.
- *
- * This function accesses the top loop context from the loops stack
- * and returns the depth at which the loop is currently operating.
- *
- * @param comp A pointer to the compiler instance.
- * @return The depth of the current loop context.
- */
-int loop_depth(compiler_t *comp)
-{
-    // Return the depth of the loop at the top of the loops stack
-    return ((loop_t *)top(comp->loops))->depth;
-}
 
 /**
  * Pushes a new function context onto the stack of contexts.
@@ -988,22 +513,12 @@ int loop_depth(compiler_t *comp)
  */
 void push_function(compiler_t *comp, char *name)
 {
-    if (!comp->is_lookUp)
-    {
-        // Store the current context depth and push a new context
-        ((context_t *)top(comp->contexts))->depth = comp->current->depth;
-        context_t *context = create_context(true, list_create(sizeof(uint8_t)), name);
-        push(comp->contexts, context);
-
-        // Initialize instruction list for this function
-        list_t *instrs = list_create(sizeof(instr_t));
-        ht_put(comp->instrs, strdup(context->fun_name), instrs);
-
-        // Update the current context to the new one
-        comp->current = (context_t *)top(comp->contexts);
-        comp->code = comp->current->code;
-        comp->locals = comp->current->locals;
-    }
+    context_t *context = create_context(true, list_create(sizeof(uint8_t)), name);
+    push(comp->contexts, context);
+
+    // Update the current context to the new one
+    comp->current = (context_t *)top(comp->contexts);
+    comp->code = comp->current->code;
 }
 
 /**
@@ -1018,59 +533,91 @@ void push_function(compiler_t *comp, char *name)
  */
 void pop_function(compiler_t *comp, int params)
 {
-    if (!comp->is_lookUp)
-    {
-        char *name = comp->current->fun_name;
+    char *name = comp->current->fun_name;
 
-        list_t *instrs = ht_get(comp->instrs, name);
+    int uv_size = list_size(comp->current->upvalues);
+    list_t *upvalues = comp->current->upvalues;
 
-        // Move all instructions from current context to the hash table
-        for (int i = 0; i < comp->current->instrs->size; i++)
-        {
-            instr_t *instr = list_getAt(comp->current->instrs, i);
-            list_add(instrs, instr);
-        }
+    ObjCode *code = (ObjCode *)new_code(comp->code);
+    code->is_generator = comp->current->is_generator;
+    code->lines = comp->current->lines;
+    int c_index = store_const(comp, NEW_OBJ(code));
 
-        ht_put(comp->instrs, name, comp->current->instrs);
+    context_t *context = (context_t *)pop(comp->contexts);
 
-        int uv_size = list_size(comp->current->upvalues);
-        list_t *upvalues = comp->current->upvalues;
+    comp->current = (context_t *)top(comp->contexts);
+    comp->code = comp->current->code;
 
-        ObjCode *code = (ObjCode *)new_code(comp->code);
-        int c_index = store_const(comp, NEW_OBJ(code));
+    free(context);
 
-        context_t *context = (context_t *)pop(comp->contexts);
+    int n_index = store_const(comp, NEW_OBJ(new_pistring(name)));
 
-        comp->current = (context_t *)top(comp->contexts);
-        comp->code = comp->current->code;
-        comp->locals = comp->current->locals;
+    emit_16w(comp, OP_LOAD_CONST, n_index);
+    emit_16w(comp, OP_LOAD_CONST, c_index);
 
-        free(context);
+    for (int i = 0; i < uv_size; i++)
+    {
+        upvalue_t *upvalue = (upvalue_t *)list_getAt(upvalues, i);
+        int index = store_const(comp, NEW_NUM(upvalue->index));
+        emit_16w(comp, OP_LOAD_CONST, index);
+        index = store_const(comp, NEW_BOOL(upvalue->is_local));
+        emit_16w(comp, OP_LOAD_CONST, index);
+    }
+    list_free(upvalues);
 
-        int n_index = store_const(comp, NEW_OBJ(new_pistring(name)));
+    if (uv_size > 0)
+        emit_pair(comp, OP_PUSH_CLOSURE, params, uv_size);
+    else
+        emit_8w(comp, OP_PUSH_FUNCTION, params);
+}
 
-        emit_16u(comp, OP_LOAD_CONST, name, n_index);
+/**
+ * Finds the slot of a constant in the hash index of the constant pool.
+ *
+ * Constants are keyed like the items of a set: numbers by their bits,
+ * strings by their characters and other objects by their address (see
+ * value_hash and set_same).
+ *
+ * @param comp A pointer to the compiler instance.
+ * @param value The constant to look up.
+ * @return The slot holding the constant, or the empty slot it belongs in.
+ */
+static int find_const(compiler_t *comp, Value value)
+{
+    int mask = comp->const_capacity - 1;
+    int i = value_hash(value) & mask;
 
-        char code_descr[32];
-        snprintf(code_descr, sizeof(code_descr), "<code: 0x%04X>", code->hash);
+    // The index is at most half full, so the loop ends on an empty slot
+    for (;;)
+    {
+        int slot = comp->const_slots[i];
+        if (slot == 0 || set_same(*(Value *)list_getAt(comp->constants, slot - 1), value))
+            return i;
+        i = (i + 1) & mask;
+    }
+}
 
-        emit_16u(comp, OP_LOAD_CONST, code_descr, c_index);
+/**
+ * Rebuilds the hash index of the constant pool, large enough for the
+ * constants to fill at most a quarter of it.
+ *
+ * @param comp A pointer to the compiler instance.
+ */
+static void rebuild_consts(compiler_t *comp)
+{
+    int capacity = CONST_MIN_SLOTS;
+    while (capacity < comp->constants->size * 4)
+        capacity *= 2;
 
-        for (int i = 0; i < uv_size; i++)
-        {
-            upvalue_t *upvalue = (upvalue_t *)list_getAt(upvalues, i);
-            int index = store_const(comp, NEW_NUM(upvalue->index));
-            emit_16u(comp, OP_LOAD_CONST, itos(upvalue->index), index);
-            index = store_const(comp, NEW_BOOL(upvalue->is_local));
-            emit_16u(comp, OP_LOAD_CONST, upvalue->is_local ? "true" : "false", index);
-        }
+    free(comp->const_slots);
+    comp->const_slots = calloc(capacity, sizeof(int));
+    comp->const_capacity = capacity;
 
-        if (uv_size > 0)
-            emit_16u(comp, OP_PUSH_CLOSURE, name, (params << 8) | uv_size);
-        else
-            emit_8u(comp, OP_PUSH_FUNCTION, name, (byte)params);
-    }
+    // Slots hold the index of a constant plus one, 0 is empty
+    for (int i = 0; i < comp->constants->size; i++)
+        comp->const_slots[find_const(comp, *(Value *)list_getAt(comp->constants, i))] = i + 1;
 }
+
 /**
  * Stores a value in the list of constants of the compiler.
  * If the value already exists in the list, its index is returned.
@@ -1081,21 +628,74 @@ void pop_function(compiler_t *comp, int params)
  */
 int store_const(compiler_t *comp, Value value)
 {
-    Value _value;
-    // Iterate through the list of constants to see if the value already exists
-    for (int i = 0; i < comp->constants->size; i++)
-    {
-        _value = *(Value *)list_getAt(comp->constants, i);
-        // Check if the value already exists in the list
-        if (equals(_value, value))
-            return i;
-    }
+    int slot = find_const(comp, value);
+    if (comp->const_slots[slot] != 0)
+        return comp->const_slots[slot] - 1;
+
     // Add the value to the list if it doesn't already exist
     list_add(comp->constants, &value);
+    comp->const_slots[slot] = comp->constants->size;
+
+    if (comp->constants->size * 2 > comp->const_capacity)
+        rebuild_consts(comp);
+
     // Return the index of the value in the list
     return comp->constants->size - 1;
 }
 
+/**
+ * Records the source position of an instruction in a line table.
+ * A new entry is only added when the position differs from the one of the
+ * previous instruction, so a line table holds one entry per run.
+ *
+ * @param lines The line table of the code the instruction is added to.
+ * @param offset The bytecode offset of the instruction.
+ * @param line The line number in the source code.
+ * @param column The column number in the source code.
+ */
+static void add_line(list_t *lines, int offset, int line, int column)
+{
+    if (lines->size > 0)
+    {
+        line_t *last = list_getAt(lines, lines->size - 1);
+        if (last->line == line && last->column == column)
+            return;
+    }
+
+    line_t entry = {offset, line, column};
+    list_add(lines, &entry);
+}
+
+/**
+ * Finds the source position of the instruction at a bytecode offset with a
+ * binary search of the line table.
+ *
+ * @param lines The line table of the code (may be NULL).
+ * @param offset The bytecode offset of the instruction.
+ * @return The entry of the run holding the offset, or NULL if there is none.
+ */
+const line_t *find_line(list_t *lines, int offset)
+{
+    if (lines == NULL || lines->size == 0)
+        return NULL;
+
+    const line_t *entries = (const line_t *)lines->data;
+    if (entries[0].offset > offset)
+        return NULL;
+
+    // The last entry starting at or before the offset
+    int low = 0, high = lines->size - 1;
+    while (low < high)
+    {
+        int mid = (low + high + 1) / 2;
+        if (entries[mid].offset <= offset)
+            low = mid;
+        else
+            high = mid - 1;
+    }
+    return &entries[low];
+}
+
 /**
  * Adds a bytecode instruction to the code list of the compiler.
  * The instruction may have zero or more operands. The bytecode
@@ -1104,57 +704,33 @@ int store_const(compiler_t *comp, Value value)
  * added is returned as the result.
  *
  * @param comp A pointer to the compiler instance containing the code and
- *             instructions lists.
+ *             line table.
  * @param opcode The opcode of the instruction to be added.
- * @param descr A description of the instruction to be added to the instruction
- *              list.
  * @param num_operands The number of operands of the instruction to be added.
  * @param ... The number of operands of the instruction to be added.
  * @return The index of the last bytecode element added, or -1 if an error occurs.
  */
-static int _emit(compiler_t *comp, OpCode opcode, char *descr, int num_operands, int line, int column, ...)
+static int _emit(compiler_t *comp, OpCode opcode, int num_operands, int line, int column, ...)
 {
-    if (comp->code == NULL || comp->instrs == NULL || comp->is_lookUp)
+    if (comp->code == NULL)
         return -1;
 
-    int size = list_size(comp->code);
+    add_line(comp->current->lines, list_size(comp->code), line, column);
 
     // Emit opcode
     uint8_t _opcode = (uint8_t)opcode;
     list_add(comp->code, &_opcode);
 
     // Emit operands
-    uint8_t *operands = malloc(sizeof(uint8_t) * num_operands);
-    if (!operands)
-        return -1;
-
     va_list args;
     va_start(args, column); // column is now the last named param before variadic args
     for (int i = 0; i < num_operands; i++)
     {
         uint8_t operand = (uint8_t)va_arg(args, int);
         list_add(comp->code, &operand);
-        operands[i] = operand;
     }
     va_end(args);
 
-    // Create instruction info with line/column/description
-    instr_t *instr = malloc(sizeof(instr_t));
-    instr->descr = strdup(descr);
-    instr->line = line;
-    instr->column = column;
-    instr->offset = size;
-    if (comp->current->fun_name != NULL)
-        instr->fun_name = strdup(comp->current->fun_name);
-    else
-        instr->fun_name = NULL;
-
-    instr->opcode = opcode;
-    instr->num_operands = num_operands;
-    instr->operands = operands;
-
-    list_add(comp->current->instrs, instr);
-
     return comp->code->size - 1;
 }
 
@@ -1166,7 +742,7 @@ static int _emit(compiler_t *comp, OpCode opcode, char *descr, int num_operands,
  */
 int emit(compiler_t *comp, OpCode opcode)
 {
-    return _emit(comp, opcode, "", 0, comp->current_line, comp->current_col);
+    return _emit(comp, opcode, 0, comp->current_line, comp->current_col);
 }
 
 /**
@@ -1174,13 +750,12 @@ int emit(compiler_t *comp, OpCode opcode)
  * The operand is a single byte in the bytecode.
  * @param comp A pointer to the compiler instance containing the code list.
  * @param opcode The opcode to be added to the code list.
- * @param descr A description of the instruction to be added to the instruction list.
  * @param operand The single operand of the instruction to be added to the code list.
  * @return The index of the last bytecode element added, or -1 if an error occurs.
  */
-int emit_8u(compiler_t *comp, OpCode opcode, char *descr, int operand)
+int emit_8u(compiler_t *comp, OpCode opcode, int operand)
 {
-    return _emit(comp, opcode, descr, 1, comp->current_line, comp->current_col, operand);
+    return _emit(comp, opcode, 1, comp->current_line, comp->current_col, operand);
 }
 
 /**
@@ -1188,29 +763,118 @@ int emit_8u(compiler_t *comp, OpCode opcode, char *descr, int operand)
  * The operand is a 16-bit short in the bytecode.
  * @param comp A pointer to the compiler instance containing the code list.
  * @param opcode The opcode to be added to the code list.
- * @param descr A description of the instruction to be added to the instruction list.
  * @param operand The 16-bit short operand of the instruction to be added to the code list.
  * @return The index of the last bytecode element added, or -1 if an error occurs.
  */
-int emit_16u(compiler_t *comp, OpCode opcode, char *descr, int operand)
+int emit_16u(compiler_t *comp, OpCode opcode, int operand)
 {
     byte op1 = (byte)((operand >> 8) & 0xff);
     byte op2 = (byte)(operand & 0xff);
-    return _emit(comp, opcode, descr, 2, comp->current_line, comp->current_col, op1, op2);
+    return _emit(comp, opcode, 2, comp->current_line, comp->current_col, op1, op2);
+}
+
+/**
+ * Emits an instruction with an 8-bit operand, or with an OP_WIDE prefix and
+ * a 16-bit operand when the operand does not fit in a byte.
+ * @param comp A pointer to the compiler instance containing the code list.
+ * @param opcode The opcode to be added to the code list.
+ * @param operand The operand of the instruction (a slot, a name index or a count).
+ * @return The index of the last bytecode element added, or -1 if an error occurs.
+ */
+int emit_8w(compiler_t *comp, OpCode opcode, int operand)
+{
+    if (operand <= UINT8_MAX)
+        return emit_8u(comp, opcode, operand);
+
+    if (operand > UINT16_MAX)
+        p_errorf(comp->current_line, comp->current_col, "Operand of %s out of range [%d]", op_names[opcode], operand);
+
+    return _emit(comp, OP_WIDE, 3, comp->current_line, comp->current_col,
+                 opcode, (operand >> 8) & 0xff, operand & 0xff);
+}
+
+/**
+ * Emits an instruction with a 16-bit operand, or with an OP_WIDE prefix and
+ * a 32-bit operand when the operand does not fit in a short.
+ * @param comp A pointer to the compiler instance containing the code list.
+ * @param opcode The opcode to be added to the code list.
+ * @param operand The operand of the instruction (a constant index or a count).
+ * @return The index of the last bytecode element added, or -1 if an error occurs.
+ */
+int emit_16w(compiler_t *comp, OpCode opcode, int operand)
+{
+    if (operand <= UINT16_MAX)
+        return emit_16u(comp, opcode, operand);
+
+    return _emit(comp, OP_WIDE, 5, comp->current_line, comp->current_col, opcode,
+                 (operand >> 24) & 0xff, (operand >> 16) & 0xff, (operand >> 8) & 0xff, operand & 0xff);
+}
+
+/**
+ * Emits an instruction with two 8-bit operands, as 16-bit operands after an
+ * OP_WIDE prefix when either does not fit in a byte.
+ * @param comp A pointer to the compiler instance containing the code list.
+ * @param opcode OP_CALL_BUILTIN or OP_PUSH_CLOSURE.
+ * @param first The first operand.
+ * @param second The second operand.
+ * @return The index of the last bytecode element added, or -1 if an error occurs.
+ */
+static int emit_pair(compiler_t *comp, OpCode opcode, int first, int second)
+{
+    if (first <= UINT8_MAX && second <= UINT8_MAX)
+        return _emit(comp, opcode, 2, comp->current_line, comp->current_col, first, second);
+
+    if (first > UINT16_MAX || second > UINT16_MAX)
+        p_errorf(comp->current_line, comp->current_col, "Operand of %s out of range", op_names[opcode]);
+
+    return _emit(comp, OP_WIDE, 5, comp->current_line, comp->current_col, opcode,
+                 (first >> 8) & 0xff, first & 0xff, (second >> 8) & 0xff, second & 0xff);
+}
+
+/**
+ * Emits a field access with a constant key and its own inline cache.
+ * The key constant index and the cache index are both 16-bit shorts, or
+ * 32-bit after an OP_WIDE prefix when either does not fit.
+ * @param comp A pointer to the compiler instance containing the code list.
+ * @param opcode OP_GET_FIELD or OP_SET_FIELD.
+ * @param index The constant pool index of the field name.
+ * @return The index of the last bytecode element added, or -1 if an error occurs.
+ */
+int emit_field(compiler_t *comp, OpCode opcode, int index)
+{
+    int cache = comp->ic_count++;
+    if (index > UINT16_MAX || cache > UINT16_MAX)
+        return _emit(comp, OP_WIDE, 9, comp->current_line, comp->current_col, opcode,
+                     (index >> 24) & 0xff, (index >> 16) & 0xff, (index >> 8) & 0xff, index & 0xff,
+                     (cache >> 24) & 0xff, (cache >> 16) & 0xff, (cache >> 8) & 0xff, cache & 0xff);
+
+    return _emit(comp, opcode, 4, comp->current_line, comp->current_col,
+                 (index >> 8) & 0xff, index & 0xff, (cache >> 8) & 0xff, cache & 0xff);
+}
+
+/**
+ * Emits a call to a built-in function bound at compile time.
+ * @param comp A pointer to the compiler instance containing the code list.
+ * @param index The index of the function in builtin_functions.
+ * @param argc The number of arguments on the stack.
+ * @return The index of the last bytecode element added, or -1 if an error occurs.
+ */
+int emit_builtin(compiler_t *comp, int index, int argc)
+{
+    return emit_pair(comp, OP_CALL_BUILTIN, index, argc);
 }
 
 /**
  * Emits the OP_POP_N instruction to pop a certain number of local variables
  * from the stack. If the size is 1, it emits the OP_POP instruction instead.
  * @param comp A pointer to the compiler instance containing the code list.
- * @param depth The depth of the local variables to pop.
+ * @param size The number of local variables to pop.
  * @return The number of local variables popped from the stack.
  */
-int emit_pop(compiler_t *comp, int depth)
+int emit_pop(compiler_t *comp, int size)
 {
-    int size = get_localSize(comp, depth);
     if (size > 1)
-        emit_8u(comp, OP_POP_N, "", (uint8_t)size); // Pop multiple locals
+        emit_8w(comp, OP_POP_N, size); // Pop multiple locals
     else if (size == 1)
         emit(comp, OP_POP); // Pop a single local
     return size;
@@ -1225,7 +889,7 @@ int emit_pop(compiler_t *comp, int depth)
 int emit_jump(compiler_t *comp, int address)
 {
     // Emit a jump instruction with the given address
-    emit_16u(comp, OP_JUMP, "", address);
+    emit_16u(comp, OP_JUMP, address);
     // Return the index of the last bytecode element added
     return comp->code->size - 1;
 }
@@ -1234,35 +898,42 @@ int emit_jump(compiler_t *comp, int address)
  * @brief Patches the jump instruction at the given address with the correct offset.
  *
  * This function calculates the offset for a jump instruction and updates the bytecode
- * and instruction metadata accordingly.
+ * accordingly.
  *
- * @param comp A pointer to the compiler instance containing the bytecode and metadata.
+ * @param comp A pointer to the compiler instance containing the bytecode.
  * @param address The address of the jump instruction to be patched.
  */
 void patch_jump(compiler_t *comp, int address)
 {
-    if (!comp->is_lookUp)
-    {
-        // Calculate the offset for the jump instruction
-        int offset = comp->code->size - (address - 2);
+    // Calculate the offset for the jump instruction
+    int offset = comp->code->size - (address - 2);
+
+    // Jumps are emitted before their target is known, so they keep a
+    // 16-bit offset
+    if (offset > INT16_MAX)
+        p_error("Block too large to jump over, split it into functions.", comp->current_line, comp->current_col);
+
+    // Update the bytecode with the calculated offset
+    uint8_t *code = (uint8_t *)comp->code->data;
+    code[address - 1] = (offset >> 8) & 0xff;
+    code[address] = offset & 0xff;
+}
 
-        // Update the bytecode with the calculated offset
-        uint8_t *code = (uint8_t *)comp->code->data;
-        code[address - 1] = (offset >> 8) & 0xff;
-        code[address] = offset & 0xff;
+/**
+ * Emits a jump back to an address already emitted, such as the start of a
+ * loop.
+ *
+ * @param comp A pointer to the compiler instance containing the bytecode.
+ * @param address The address to jump back to.
+ * @return The index of the last bytecode element added.
+ */
+int emit_loop(compiler_t *comp, int address)
+{
+    int offset = address - comp->code->size; // Calculate the offset to the address
+    if (offset < INT16_MIN)
+        p_error("Loop body too large to jump back over, split it into functions.", comp->current_line, comp->current_col);
 
-        // Update the instruction metadata with the new operands
-        for (int i = list_size(comp->current->instrs) - 1; i >= 0; i--)
-        {
-            instr_t *instr = list_getAt(comp->current->instrs, i);
-            if (instr->offset == address - 2)
-            {
-                instr->operands[0] = (offset >> 8) & 0xff;
-                instr->operands[1] = offset & 0xff;
-                break;
-            }
-        }
-    }
+    return emit_16u(comp, OP_JUMP, offset);
 }
 
 /**
@@ -1279,154 +950,212 @@ int code_size(compiler_t *comp)
     return comp->code->size;
 }
 
+// Operator names, indexed by the operand of OP_COMPARE, OP_BINARY and OP_UNARY
+extern char *comp_ops[];
+extern char *bin_ops[];
+extern char *unary_ops[];
+
+// Reads a big-endian operand of the given width from the bytecode
+static int read_operand(uint8_t *code, int pc, int width)
+{
+    int value = 0;
+    for (int i = 0; i < width; i++)
+        value = (value << 8) | code[pc + i];
+    return value;
+}
+
 /**
- * Disassembles the compiled bytecode for debugging purposes.
- *
- * This function outputs the disassembled instructions of the compiled
- * bytecode, differentiating between global and function-specific instructions.
- * It provides a human-readable format with color-coded elements for better
- * visibility.
- *
- * @param comp The compiler instance containing the bytecode and metadata.
+ * Writes a description of the operand of an instruction for the
+ * disassembler: the constant loaded, the global name, the operator or the
+ * built-in function. Descriptions are only made here, not when compiling.
+ *
+ * @param comp The compiler instance holding the constants and names.
+ * @param opcode The opcode of the instruction.
+ * @param operand The first operand of the instruction.
+ * @param buffer The buffer to write the description to.
+ * @param size The size of the buffer.
  */
+static void describe(compiler_t *comp, uint8_t opcode, int operand, char *buffer, size_t size)
+{
+    buffer[0] = '\0';
+    switch (opcode)
+    {
+    case OP_LOAD_CONST:
+    case OP_GET_FIELD:
+    case OP_SET_FIELD:
+    {
+        Value value = *(Value *)list_getAt(comp->constants, operand);
+        if (IS_OBJ(value) && OBJ_TYPE(value) == OBJ_CODE)
+        {
+            snprintf(buffer, size, "<code: 0x%04X>", AS_CODE(value)->hash);
+            break;
+        }
+        char *str = as_string(value);
+        snprintf(buffer, size, "%.20s%s", str, strlen(str) > 20 ? "..." : "");
+        free(str);
+        break;
+    }
+    case OP_STORE_GLOBAL:
+    case OP_LOAD_GLOBAL:
+        snprintf(buffer, size, "%s", string_get(comp->names, operand));
+        break;
+    case OP_COMPARE:
+        snprintf(buffer, size, "%s", comp_ops[operand]);
+        break;
+    case OP_BINARY:
+        snprintf(buffer, size, "%s", bin_ops[operand]);
+        break;
+    case OP_UNARY:
+        snprintf(buffer, size, "%s", unary_ops[operand]);
+        break;
+    case OP_CALL_BUILTIN:
+        snprintf(buffer, size, "%s", builtin_functions[operand].name);
+        break;
+    default:
+        break;
+    }
+}
 
-void dis(compiler_t *comp)
+/**
+ * Disassembles a block of bytecode, then the functions it defines.
+ *
+ * @param comp The compiler instance holding the constants and names.
+ * @param name The name of the function, or "global scope".
+ * @param code The bytecode.
+ * @param lines The line table of the bytecode.
+ */
+static void dis_code(compiler_t *comp, const char *name, list_t *code, list_t *lines)
 {
+    printf("\n\033[1;36m== Disassembly of %s ==\033[0m\n\n", name);
 
-    printf("disassembling...\n");
+    // The functions defined by this code, disassembled after it
+    typedef struct
+    {
+        char *name;
+        ObjCode *code;
+    } function_t;
 
-    // Ensure global scope instructions are in the hash table
-    if (stack_size(comp->contexts) > 0)
+    uint8_t *bytes = (uint8_t *)code->data;
+    list_t *functions = list_create(sizeof(function_t));
+    char *fun_name = "<FUN>";
+
+    int pc = 0;
+    while (pc < code->size)
     {
-        context_t *global_ctx = (context_t *)stack_getAt(comp->contexts, 0);
-        ht_put(comp->instrs, "<global>", global_ctx->instrs);
-    }
+        int offset = pc;
+        uint8_t opcode = bytes[pc++];
+
+        // OP_WIDE doubles the width of the operands of the next instruction
+        int width = 1;
+        if (opcode == OP_WIDE)
+        {
+            opcode = bytes[pc++];
+            width = 2;
+        }
+
+        int first = -1, second = -1;
+        switch (opcode)
+        {
+        case OP_STORE_GLOBAL:
+        case OP_LOAD_GLOBAL:
+        case OP_STORE_LOCAL:
+        case OP_LOAD_LOCAL:
+        case OP_LOAD_UPVALUE:
+        case OP_STORE_UPVALUE:
+        case OP_BINARY:
+        case OP_COMPARE:
+        case OP_UNARY:
+        case OP_POP_N:
+        case OP_CALL_FUNCTION:
+        case OP_CALL_NATIVE:
+        case OP_PUSH_FUNCTION:
+            first = read_operand(bytes, pc, width);
+            pc += width;
+            break;
 
-    // Get all function names in order
-    char **scope_names = ht_keys(comp->instrs);
+        case OP_CALL_BUILTIN:
+        case OP_PUSH_CLOSURE:
+            first = read_operand(bytes, pc, width);
+            second = read_operand(bytes, pc + width, width);
+            pc += 2 * width;
+            break;
 
-    int size = ht_length(comp->instrs);
+        case OP_LOAD_CONST:
+        case OP_PUSH_LIST:
+        case OP_PUSH_MAP:
+            first = read_operand(bytes, pc, 2 * width);
+            pc += 2 * width;
+            break;
 
-    for (int i = 0; i < size; i++)
-    {
-        char *scope_name = scope_names[i];
-        list_t *instrs = ht_get(comp->instrs, scope_name);
+        case OP_GET_FIELD:
+        case OP_SET_FIELD:
+            first = read_operand(bytes, pc, 2 * width);
+            second = read_operand(bytes, pc + 2 * width, 2 * width);
+            pc += 4 * width;
+            break;
 
-        printf("\n\033[1;36m== Disassembly of %s ==\033[0m\n\n",
-               strcmp(scope_name, "<global>") == 0 ? "global scope" : scope_name);
+        case OP_JUMP_IF_FALSE:
+        case OP_JUMP_IF_TRUE:
+        case OP_JUMP:
+        case OP_LOOP:
+            // Jumps are relative to the opcode, LOOP exits to the same place
+            first = (int16_t)read_operand(bytes, pc, 2);
+            second = offset + first;
+            pc += 2;
+            break;
 
-        if (!instrs)
-            continue;
+        default:
+            break;
+        }
+
+        char descr[32];
+        describe(comp, opcode, first, descr, sizeof(descr));
 
-        int line = 0, pc = 0;
-        for (int j = 0; j < instrs->size; j++)
+        // Functions are pushed as a name constant, then a code constant
+        if (opcode == OP_LOAD_CONST)
         {
-            instr_t *instr = (instr_t *)list_getAt(instrs, j);
-            OpCode opcode = instr->opcode;
-            uint8_t *operands = instr->operands;
-            char *descr = instr->descr;
-
-            char line_buf[256] = {0};
-
-            switch (opcode)
-            {
-            case OP_STORE_GLOBAL:
-            case OP_STORE_LOCAL:
-            case OP_LOAD_GLOBAL:
-            case OP_LOAD_LOCAL:
-            case OP_LOAD_UPVALUE:
-            case OP_STORE_UPVALUE:
-            case OP_BINARY:
-            case OP_COMPARE:
-            case OP_UNARY:
-            case OP_POP_N:
-            case OP_CALL_FUNCTION:
-            case OP_PUSH_FUNCTION:
-                snprintf(line_buf, sizeof(line_buf),
-                         "\033[38;2;107;107;107m%-4d\033[0m: "
-                         "\033[38;2;139;0;0m%-15s\033[0m "
-                         "\033[38;2;184;134;11m%-5d\033[0m",
-                         line++, op_names[opcode], operands[0]);
-                line++;
-                pc++;
-                break;
-
-            case OP_JUMP_IF_FALSE:
-            case OP_JUMP:
-            case OP_LOOP:
-            {
-                int offset = (int16_t)((operands[0] << 8) | operands[1]);
-                int target = instr->offset + offset;
-
-                snprintf(line_buf, sizeof(line_buf),
-                         offset < 0
-                             ? "\033[38;2;107;107;107m%-4d\033[0m: \033[38;2;139;0;0m%-14s\033[0m "
-                               "\033[38;2;184;134;11m%-6d\033[0m \033[38;2;34;139;34m[<< %-3d]\033[0m\n"
-                             : "\033[38;2;107;107;107m%-4d\033[0m: \033[38;2;139;0;0m%-14s\033[0m "
-                               "\033[38;2;184;134;11m%-6d\033[0m \033[38;2;34;139;34m[>> %-3d]\033[0m\n",
-                         line++, op_names[opcode], offset, target);
-                line += 2;
-                pc += 2;
-
-                printf("%s", line_buf);
-                continue;
-            }
-
-            case OP_LOAD_CONST:
-            case OP_PUSH_LIST:
-            case OP_PUSH_MAP:
-                snprintf(line_buf, sizeof(line_buf),
-                         "\033[38;2;107;107;107m%-4d\033[0m: "
-                         "\033[38;2;139;0;0m%-15s\033[0m "
-                         "\033[38;2;184;134;11m%-5d\033[0m",
-                         line++, op_names[opcode], (int16_t)((operands[0] << 8) | operands[1]));
-                line += 2;
-                pc += 2;
-                break;
-
-            case OP_PUSH_CLOSURE:
-                snprintf(line_buf, sizeof(line_buf),
-                         "\033[38;2;107;107;107m%-4d\033[0m: "
-                         "\033[38;2;139;0;0m%-15s\033[0m "
-                         "\033[38;2;184;134;11m%d %3d\033[0m",
-                         line++, op_names[opcode], operands[0], operands[1]);
-                line += 2;
-                pc += 2;
-                break;
-
-            default:
-                snprintf(line_buf, sizeof(line_buf),
-                         "\033[38;2;107;107;107m%-4d\033[0m: "
-                         "\033[38;2;139;0;0m%-15s\033[0m",
-                         line++, op_names[opcode]);
-                break;
-            }
-
-            // Print description
-            if (descr && strcmp(descr, "") != 0)
-            {
-                if (strlen(descr) > 20)
-                {
-                    char short_descr[21];
-                    strncpy(short_descr, descr, 20);
-                    short_descr[20] = '\0';
-                    strcat(line_buf, " \033[38;2;34;139;34m[");
-                    strcat(line_buf, short_descr);
-                    strcat(line_buf, "...]\033[0m\n");
-                }
-                else
-                {
-                    strcat(line_buf, " \033[38;2;34;139;34m[");
-                    strcat(line_buf, descr);
-                    strcat(line_buf, "]\033[0m\n");
-                }
-            }
-            else
-                strcat(line_buf, "\n");
-
-            printf("%s", line_buf);
+            Value value = *(Value *)list_getAt(comp->constants, first);
+            if (IS_STRING(value))
+                fun_name = AS_CSTRING(value);
+            else if (IS_OBJ(value) && OBJ_TYPE(value) == OBJ_CODE)
+                list_add(functions, &(function_t){fun_name, AS_CODE(value)});
         }
+
+        const line_t *line = find_line(lines, offset);
+        printf("\033[38;2;107;107;107m%-5d %4d\033[0m  \033[38;2;139;0;0m%s%-15s\033[0m",
+               offset, line ? line->line : -1, width == 2 ? "WIDE " : "", op_names[opcode]);
+        if (second != -1 && first != -1)
+            printf(" \033[38;2;184;134;11m%d %d\033[0m", first, second);
+        else if (first != -1)
+            printf(" \033[38;2;184;134;11m%d\033[0m", first);
+        if (descr[0] != '\0')
+            printf(" \033[38;2;34;139;34m[%s]\033[0m", descr);
+        printf("\n");
+    }
+
+    for (int i = 0; i < functions->size; i++)
+    {
+        function_t *function = list_getAt(functions, i);
+        dis_code(comp, function->name, function->code->data, function->code->lines);
     }
+    list_free(functions);
+}
+
+/**
+ * Disassembles the compiled bytecode for debugging purposes.
+ *
+ * This function outputs the disassembled instructions of the global code,
+ * then of each function it defines, with the bytecode offset and source
+ * line of each instruction. The operands are described from the constants
+ * and names of the compiler, as the instructions themselves carry no
+ * description.
+ *
+ * @param comp The compiler instance containing the bytecode.
+ */
+void dis(compiler_t *comp)
+{
+    printf("disassembling...\n");
+    dis_code(comp, "global scope", comp->code, comp->lines);
 }
 
 /**
@@ -1504,11 +1233,15 @@ void free_compiler(compiler_t *comp)
     // Free the constant values list
     list_free(comp->constants); // Values are copied, not pointers to new allocations
 
+    free(comp->const_slots);
+
     // Free the variable names list and their contents
     list_free(comp->names);
+    ht_free(comp->name_table);
 
     // Free the built-in names list and their contents
     list_free(comp->builtin_names);
+    list_free(comp->shadowed);
 
     // Free the contexts stack and their contents
     while (!is_empty(comp->contexts))
@@ -1526,25 +1259,6 @@ void free_compiler(compiler_t *comp)
     }
     stack_free(comp->loops);
 
-    // Free the objects stack (it contains String* but these are transient and not part of output bytecode)
-    stack_free(comp->objects);
-
-    // Free the instruction table (ht_create(sizeof(list_t)) - list_t* values)
-    char **keys = ht_keys(comp->instrs);
-    for (int i = 0; i < ht_length(comp->instrs); i++)
-    {
-        char *key = keys[i];
-        list_t *instr_list = (list_t *)ht_get(comp->instrs, key);
-        while (!list_isEmpty(instr_list))
-        {
-            instr_t *instr = (instr_t *)list_pop(instr_list);
-            free_instr(instr);
-        }
-        list_free(instr_list);
-        free(key); // Free the key string from the hash table
-    }
-    ht_free(comp->instrs);
-
     // Free the compiler structure itself
     free(comp);
 }
@@ -1564,6 +1278,8 @@ void reset_compiler(compiler_t *comp)
     // 1. Deep free existing resources
     list_free(comp->code);
     list_free(comp->names);
+    ht_free(comp->name_table);
+    list_free(comp->shadowed);
 
     while (!is_empty(comp->contexts))
     {
@@ -1579,40 +1295,21 @@ void reset_compiler(compiler_t *comp)
     }
     stack_free(comp->loops);
 
-    stack_free(comp->objects);
-
-    char **keys = ht_keys(comp->instrs);
-    for (int i = 0; i < ht_length(comp->instrs); i++)
-    {
-        char *key = keys[i];
-        list_t *instr_list = (list_t *)ht_get(comp->instrs, key);
-        while (!list_isEmpty(instr_list))
-        {
-            instr_t *instr = (instr_t *)list_pop(instr_list);
-            free_instr(instr);
-        }
-        list_free(instr_list);
-        free(key);
-    }
-    ht_free(comp->instrs);
-
     // 2. Re-initialize all fields as in init_compiler
     comp->code = list_create(sizeof(uint8_t));
     comp->names = list_create(sizeof(String));
+    comp->name_table = ht_create(sizeof(int));
+    comp->shadowed = list_create(sizeof(String));
 
-    comp->locals = stack_create(sizeof(local_t));
     comp->contexts = stack_create(sizeof(context_t));
     comp->loops = stack_create(sizeof(loop_t));
-    comp->objects = stack_create(sizeof(String));
-    comp->name = "";
 
     comp->current = create_context(false, comp->code, NULL);
+    comp->lines = comp->current->lines;
 
-    comp->instrs = ht_create(sizeof(list_t));
-
-    comp->is_lookUp = false;
-    comp->is_upvalue = false;
     comp->is_repl = false;
 
+    comp->ic_count = 0;
+
     push(comp->contexts, comp->current);
 }
@@ -0,0 +1,270 @@
+#include <math.h>
+#include <limits.h>
+
+#include "pi_fold.h"
+
+/*
+ * Constant folding on the syntax tree: arithmetic and bitwise operations on
+ * number literals are replaced by a literal of their result, computed the
+ * way OP_BINARY and OP_UNARY compute it. Folding runs bottom up, so nested
+ * constant expressions such as (2 + 3) * 4 fold to one literal. Operators
+ * whose result depends on runtime state, or that would convert an out of
+ * range number to an int, are left alone.
+ */
+
+static void fold_list(node_list_t *list);
+
+/**
+ * Reads the number of a number literal.
+ *
+ * @param node The node.
+ * @param number Receives the number.
+ * @return True if the node is a number literal.
+ */
+static bool const_number(node_t *node, double *number)
+{
+    if (node->type != NODE_LITERAL || !IS_NUM(node->data.literal.value))
+        return false;
+
+    *number = AS_NUM(node->data.literal.value);
+    return true;
+}
+
+// True if the number converts to an int without overflow
+static bool fits_int(double number)
+{
+    return number >= INT_MIN && number <= INT_MAX;
+}
+
+/**
+ * Turns an operation into a number literal, reported where the operation was.
+ *
+ * @param node The folded operation.
+ * @param number The value of the operation.
+ */
+static void to_literal(node_t *node, double number)
+{
+    node->type = NODE_LITERAL;
+    node->data.literal.value = NEW_NUM(number);
+}
+
+/**
+ * Folds a binary operation on two number literals.
+ *
+ * @param node The binary node.
+ */
+static void fold_binary(node_t *node)
+{
+    double a, b, result;
+    int op = node->data.binary.op;
+
+    if (node->data.binary.opcode != OP_BINARY ||
+        !const_number(node->data.binary.left, &a) || !const_number(node->data.binary.right, &b))
+        return;
+
+    switch (op)
+    {
+    case 0: // "+"
+        result = a + b;
+        break;
+    case 1: // "-"
+        result = a - b;
+        break;
+    case 2: // "*"
+        result = a * b;
+        break;
+    case 3: // "/"
+        result = b == 0.0 ? INFINITY : a / b;
+        break;
+    case 4: // "%"
+        if (!fits_int(a) || !fits_int(b) || (int)b == -1)
+            return;
+        result = (int)b == 0 ? NAN : (int)a % (int)b;
+        break;
+    case 7: // "**"
+        result = pow(a, b);
+        break;
+    case 8: // "&"
+    case 9: // "|"
+    case 10: // "^"
+        if (!fits_int(a) || !fits_int(b))
+            return;
+        result = op == 8 ? (int)a & (int)b : op == 9 ? (int)a | (int)b : (int)a ^ (int)b;
+        break;
+    case 11: // "<<"
+    case 12: // ">>"
+        if (!fits_int(a) || b < 0 || b >= 32)
+            return;
+        result = op == 11 ? (int)((unsigned)(int)a << (int)b) : (int)a >> (int)b;
+        break;
+    default:
+        return;
+    }
+
+    to_literal(node, result);
+}
+
+/**
+ * Folds a unary plus, minus or bitwise not of a number literal.
+ *
+ * @param node The unary node.
+ */
+static void fold_unary(node_t *node)
+{
+    double a;
+    if (!const_number(node->data.unary.operand, &a))
+        return;
+
+    switch (node->data.unary.op)
+    {
+    case 0: // "+"
+        break;
+    case 1: // "-"
+        a = -a;
+        break;
+    case 3: // "~"
+        if (!fits_int(a))
+            return;
+        a = ~(int)a;
+        break;
+    default:
+        return;
+    }
+
+    to_literal(node, a);
+}
+
+/**
+ * Folds the constant expressions of a node and its children.
+ *
+ * @param node The node (may be NULL).
+ */
+void fold(node_t *node)
+{
+    if (node == NULL)
+        return;
+
+    switch (node->type)
+    {
+    case NODE_LITERAL:
+    case NODE_IDENTIFIER:
+    case NODE_BREAK:
+    case NODE_CONTINUE:
+    case NODE_DEBUG:
+        break;
+
+    case NODE_UNARY:
+        fold(node->data.unary.operand);
+        fold_unary(node);
+        break;
+
+    case NODE_BINARY:
+        fold(node->data.binary.left);
+        fold(node->data.binary.right);
+        fold_binary(node);
+        break;
+
+    case NODE_CONDITIONAL:
+        fold(node->data.conditional.cond);
+        fold(node->data.conditional.then);
+        fold(node->data.conditional.other);
+        break;
+
+    case NODE_RANGE:
+        fold(node->data.range.from);
+        fold(node->data.range.to);
+        fold(node->data.range.step);
+        break;
+
+    case NODE_LIST:
+        fold_list(&node->data.list.items);
+        break;
+
+    case NODE_OBJECT:
+        fold_list(&node->data.object.values);
+        break;
+
+    case NODE_FUNCTION:
+        fold_list(&node->data.func.defaults);
+        fold_list(&node->data.func.body);
+        fold(node->data.func.expr);
+        break;
+
+    case NODE_CALL:
+        fold(node->data.call.callee);
+        fold_list(&node->data.call.args);
+        break;
+
+    case NODE_INDEX:
+        fold(node->data.index.object);
+        fold(node->data.index.start);
+        fold(node->data.index.stop);
+        fold(node->data.index.step);
+        break;
+
+    case NODE_FIELD:
+        fold(node->data.field.object);
+        break;
+
+    case NODE_ASSIGN:
+        fold(node->data.assign.target);
+        fold(node->data.assign.value);
+        break;
+
+    case NODE_WALRUS:
+        fold(node->data.walrus.value);
+        break;
+
+    case NODE_UPDATE:
+        fold(node->data.update.target);
+        break;
+
+    case NODE_BLOCK:
+        fold_list(&node->data.block.body);
+        break;
+
+    case NODE_VAR:
+        fold_list(&node->data.var.inits);
+        break;
+
+    case NODE_IF:
+        fold(node->data.if_stmt.cond);
+        fold(node->data.if_stmt.then);
+        fold(node->data.if_stmt.other);
+        break;
+
+    case NODE_WHILE:
+        fold(node->data.while_stmt.cond);
+        fold(node->data.while_stmt.body);
+        break;
+
+    case NODE_FOR:
+        fold(node->data.for_stmt.iterable);
+        fold_list(&node->data.for_stmt.body);
+        break;
+
+    case NODE_RETURN:
+    case NODE_YIELD:
+        fold(node->data.ret.value);
+        break;
+
+    case NODE_EXPR_STMT:
+        fold(node->data.expr_stmt.expr);
+        break;
+
+    case NODE_PROGRAM:
+        fold_list(&node->data.program.body);
+        break;
+    }
+}
+
+/**
+ * Folds the nodes of a list.
+ *
+ * @param list The nodes (some may be NULL).
+ */
+static void fold_list(node_list_t *list)
+{
+    for (int i = 0; i < list->size; i++)
+        fold(list->items[i]);
+}
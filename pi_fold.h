@@ -0,0 +1,8 @@
+#ifndef PI_FOLD_H
+#define PI_FOLD_H
+
+#include "pi_ast.h"
+
+void fold(node_t *node);
+
+#endif // PI_FOLD_H
@@ -24,6 +24,7 @@ Frame *create_frame(int pc, int sp, int bp, list_t *code, int iters_top, int ip,
     frame->iters_top = iters_top;
 
     frame->function = fn;
+    frame->generator = NULL;
 
     return frame;
 }
@@ -18,6 +18,7 @@ typedef struct
     int iters_top; // to track the state of iterators stack
 
     Function *function;
+    struct Object *generator; // The generator this frame runs the body of, if any
 } Frame;
 
 Frame *create_frame(int pc, int sp, int bp, list_t *code, int iters_top, int ip, Function *fn);
@@ -1,6 +1,8 @@
 #include <stdint.h>
 #include "pi_func.h"
 #include "pi_object.h"
+#include "pi_pool.h"
+#include "pi_gen.h"
 
 /**
  * Create a new function object.
@@ -18,20 +20,22 @@
 Object *new_func(char *name, ObjCode *body, list_t *params, UpValue **upvalues, Object *instance)
 {
 
-    // Allocate and verify memory
-    Object *object = (Object *)malloc(sizeof(Function));
+    // Allocate memory from the object pool
+    Object *object = pool_alloc(pool_bound(), sizeof(Function));
 
     // Initialize object header
     object->type = OBJ_FUN;
     object->is_marked = false;
     object->in_gcList = false;
+    object->generation = GEN_YOUNG;
+    object->remembered = false;
     object->gc_color = GC_WHITE;
     object->next = NULL;
 
     Function *fn = (Function *)object;
 
     // Handle function name (make copy if needed)
-    fn->name = name ? strdup(name) : strdup("<FUN>");
+    fn->name = name ? string_copy(name) : string_copy("<FUN>");
 
     // Handle parameters
     fn->params = params ? params : list_create(sizeof(Value));
@@ -79,6 +83,9 @@ Value *new_native(const char *name, native_func func)
     val->data.object->type = OBJ_FUN;
     val->data.object->is_marked = true;
     val->data.object->in_gcList = false;
+    val->data.object->pool_class = POOL_NONE;
+    val->data.object->generation = GEN_OLD; // Natives live as long as the VM
+    val->data.object->remembered = false;
     val->data.object->gc_color = GC_WHITE;
     val->data.object->next = NULL;
 
@@ -86,14 +93,17 @@ Value *new_native(const char *name, native_func func)
     Function *fn = (Function *)val->data.object;
 
     // Assign function properties
-    fn->name = strdup(name); // Allocate and copy name string
+    fn->name = string_copy(name); // Allocate and copy name string
 
     fn->params = NULL;
     fn->body = NULL;
 
     fn->is_native = true;
+    fn->is_method = false;
     fn->native = func;
 
+    fn->upvalues = NULL;
+    fn->upvalue_count = 0;
     fn->instance = NULL;
 
     return val;
@@ -114,7 +124,22 @@ Value call_func(vm_t *vm, Function *function, size_t argc, Value *argv)
 {
     // If the function is a native function, call it directly
     if (function->is_native)
+    {
+        // Bound natives (the methods of iterators) get their instance first
+        if (function->is_method && function->instance)
+        {
+            Value fargs[argc + 1];
+            fargs[0] = NEW_OBJ(function->instance);
+            memcpy(fargs + 1, argv, sizeof(Value) * argc);
+            return function->native(vm, argc + 1, fargs);
+        }
         return function->native(vm, argc, argv);
+    }
+
+    // Calling a generator function only creates the generator: the body
+    // runs when it is resumed
+    if (function->body->is_generator)
+        return NEW_OBJ(gen_create(vm, function, argc, argv));
 
     // Push the current frame onto the call stack
     Frame *frame = create_frame(vm->pc, vm->sp, vm->bp,
@@ -161,11 +186,17 @@ Value call_func(vm_t *vm, Function *function, size_t argc, Value *argv)
 
     vm->stack[vm->sp] = NEW_OBJ(add_obj(vm, new_list(_args)));
 
-    // Start executing the function body
+    // Start executing the function body. The VM reads the upvalues of the
+    // running function from vm->function, which is restored on return.
     vm->sp++;
 
+    Object *caller = vm->function;
+    vm->function = (Object *)function;
+
     run(vm);
 
+    vm->function = caller;
+
     // Pop the return value from the stack
     vm->sp--;
     return vm->stack[vm->sp];
@@ -6,8 +6,6 @@
 #include "pi_value.h"
 #include "pi_vm.h"
 
-#define MAX_UPVALUES 32
-
 typedef Value (*native_func)(vm_t *vm, int argc, Value *argv);
 
 typedef struct Function
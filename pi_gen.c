@@ -0,0 +1,196 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "pi_gen.h"
+#include "gc.h"
+
+/**
+ * Creates a generator for a call to a generator function. The body does
+ * not run yet: its first frame is laid out as call_func would, with the
+ * parameters (the arguments, or the defaults) followed by the list of all
+ * the arguments, and kept in the generator until it is resumed.
+ *
+ * @param vm The virtual machine instance.
+ * @param function The generator function.
+ * @param argc The number of arguments.
+ * @param argv The arguments.
+ * @return The new generator, tracked by the collector.
+ */
+Object *gen_create(vm_t *vm, Function *function, int argc, Value *argv)
+{
+    PiGen *gen = (PiGen *)add_obj(vm, new_gen((Object *)function));
+
+    // Bound methods get their instance as the first argument
+    Value fargs[argc + 1];
+    if (function->is_method)
+    {
+        fargs[0] = function->instance == NULL ? NEW_NIL() : NEW_OBJ(add_obj(vm, function->instance));
+        memcpy(fargs + 1, argv, sizeof(Value) * argc);
+        argv = fargs;
+        argc++;
+    }
+
+    int params = list_size(function->params);
+    gen->slots = malloc(sizeof(Value) * (params + 1));
+    gen->slot_count = params + 1;
+
+    list_t *args = list_create(sizeof(Value));
+    for (int i = 0; i < argc; i++)
+        list_add(args, &argv[i]);
+
+    for (int i = 0; i < params; i++)
+        gen->slots[i] = i < argc ? argv[i] : *(Value *)list_getAt(function->params, i);
+    gen->slots[params] = NEW_OBJ(add_obj(vm, new_list(args)));
+
+    return (Object *)gen;
+}
+
+/**
+ * Runs a generator until its next yield or the end of its body.
+ *
+ * The saved frame is moved back onto the VM stack, so resuming costs about
+ * as much as a call: one frame and a copy of the generator's locals.
+ *
+ * @param vm The virtual machine instance.
+ * @param gen The generator.
+ * @param value Set to the yielded value, or to the returned one.
+ * @return true if the generator yielded, false if it is done.
+ */
+bool gen_resume(vm_t *vm, PiGen *gen, Value *value)
+{
+    if (gen->state == GEN_DONE)
+    {
+        *value = NEW_NIL();
+        return false;
+    }
+
+    if (gen->state == GEN_RUNNING)
+        vm_error(vm, "Generator is already running.");
+
+    if (vm->sp + gen->slot_count >= STACK_MAX || vm->iter_sp + gen->iter_count >= ITER_MAX)
+        vm_error(vm, "Stack overflow: Attempted to push onto a full stack");
+
+    Function *function = (Function *)gen->function;
+
+    Frame *frame = create_frame(vm->pc, vm->sp, vm->bp,
+                                vm->code, vm->iter_sp, vm->ip, function);
+    frame->generator = (Object *)gen;
+    push_frame(vm, frame);
+
+    vm->code = function->body->data;
+    vm->pc = gen->pc;
+    vm->ip = 0;
+    vm->bp = vm->sp;
+
+    memcpy(&vm->stack[vm->bp], gen->slots, sizeof(Value) * gen->slot_count);
+    vm->sp = vm->bp + gen->slot_count;
+
+    for (int i = 0; i < gen->iter_count; i++)
+        vm->iters[++vm->iter_sp] = gen->iters[i];
+
+    // Captured variables live on the stack again while the body runs
+    for (int i = 0; i < gen->upvalue_count; i++)
+    {
+        UpValue *upvalue = gen->upvalues[i].upvalue;
+        upvalue->index = vm->bp + gen->upvalues[i].slot;
+        vm->stack[upvalue->index] = upvalue->value;
+        upvalue->next = vm->openUpvalues;
+        vm->openUpvalues = upvalue;
+    }
+
+    // The frame is on the stack now, where the collector finds it
+    gen->slot_count = 0;
+    gen->iter_count = 0;
+    gen->upvalue_count = 0;
+    gen->state = GEN_RUNNING;
+
+    Object *caller = vm->function;
+    vm->function = gen->function;
+
+    run(vm);
+
+    vm->function = caller;
+
+    // OP_YIELD and OP_RETURN both leave their value on the caller's stack
+    vm->sp--;
+    *value = vm->stack[vm->sp];
+
+    if (gen->state == GEN_RUNNING)
+    {
+        gen->state = GEN_DONE;
+        gen_free(gen);
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Saves the frame of a running generator before its body yields: the
+ * locals and temporaries between the base and the top of the stack, the
+ * iterators of the for loops it is in, and the upvalues captured from it,
+ * which are closed until it resumes.
+ *
+ * @param vm The virtual machine instance.
+ * @param gen The generator, whose frame is the current one.
+ * @param pc Where the body resumes.
+ */
+void gen_suspend(vm_t *vm, PiGen *gen, int pc)
+{
+    Frame *frame = vm->frames[vm->frame_sp - 1];
+
+    gen->slot_count = vm->sp - vm->bp;
+    gen->slots = realloc(gen->slots, sizeof(Value) * (gen->slot_count + 1));
+    memcpy(gen->slots, &vm->stack[vm->bp], sizeof(Value) * gen->slot_count);
+
+    gen->iter_count = vm->iter_sp - frame->iters_top;
+    gen->iters = realloc(gen->iters, sizeof(Object *) * (gen->iter_count + 1));
+    memcpy(gen->iters, &vm->iters[frame->iters_top + 1], sizeof(Object *) * gen->iter_count);
+
+    // The generator may be old, and black during a full collection
+    for (int i = 0; i < gen->slot_count; i++)
+        write_barrier(vm, (Object *)gen, gen->slots[i]);
+    for (int i = 0; i < gen->iter_count; i++)
+        write_barrier(vm, (Object *)gen, NEW_OBJ(gen->iters[i]));
+
+    UpValue **link = &vm->openUpvalues;
+    while (*link != NULL)
+    {
+        UpValue *upvalue = *link;
+        if (upvalue->index < vm->bp || upvalue->index >= vm->sp)
+        {
+            link = &upvalue->next;
+            continue;
+        }
+
+        *link = upvalue->next;
+
+        gen->upvalues = realloc(gen->upvalues, sizeof(GenUpvalue) * (gen->upvalue_count + 1));
+        gen->upvalues[gen->upvalue_count++] = (GenUpvalue){upvalue, upvalue->index - vm->bp};
+
+        upvalue->value = vm->stack[upvalue->index];
+        upvalue->index = -1;
+        write_barrier_value(vm, upvalue->value);
+    }
+
+    gen->pc = pc;
+    gen->state = GEN_SUSPENDED;
+}
+
+/**
+ * Frees the saved frame of a generator, but not the generator itself.
+ *
+ * @param gen The generator.
+ */
+void gen_free(PiGen *gen)
+{
+    free(gen->slots);
+    free(gen->iters);
+    free(gen->upvalues);
+    gen->slots = NULL;
+    gen->iters = NULL;
+    gen->upvalues = NULL;
+    gen->slot_count = 0;
+    gen->iter_count = 0;
+    gen->upvalue_count = 0;
+}
@@ -0,0 +1,16 @@
+#ifndef PI_GEN_H
+#define PI_GEN_H
+
+#include <stdbool.h>
+
+#include "pi_value.h"
+#include "pi_object.h"
+#include "pi_func.h"
+#include "pi_vm.h"
+
+Object *gen_create(vm_t *vm, Function *function, int argc, Value *argv);
+bool gen_resume(vm_t *vm, PiGen *gen, Value *value);
+void gen_suspend(vm_t *vm, PiGen *gen, int pc);
+void gen_free(PiGen *gen);
+
+#endif // PI_GEN_H
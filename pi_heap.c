@@ -0,0 +1,230 @@
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "pi_heap.h"
+
+// Each item has up to 4 children: a shallower heap than a binary one, and
+// the children of an item sit next to each other in memory
+#define HEAP_ARITY 4
+#define HEAP_MIN_CAP 16
+
+/**
+ * Checks if an item of a priority queue comes before another one: lower
+ * priorities first, then the first one pushed.
+ */
+static inline bool before(const HeapEntry *a, const HeapEntry *b)
+{
+    return a->priority < b->priority || (a->priority == b->priority && a->order < b->order);
+}
+
+/**
+ * Stores an item at a position of the heap and records it for its handle.
+ */
+static inline void place(PiHeap *heap, int index, HeapEntry entry)
+{
+    heap->entries[index] = entry;
+    heap->positions[entry.handle] = index;
+}
+
+/**
+ * Moves an item up the heap until its parent comes before it.
+ *
+ * @param heap The priority queue.
+ * @param index The position of the item.
+ */
+static void sift_up(PiHeap *heap, int index)
+{
+    HeapEntry entry = heap->entries[index];
+
+    while (index > 0)
+    {
+        int parent = (index - 1) / HEAP_ARITY;
+        if (!before(&entry, &heap->entries[parent]))
+            break;
+
+        place(heap, index, heap->entries[parent]);
+        index = parent;
+    }
+
+    place(heap, index, entry);
+}
+
+/**
+ * Moves an item down the heap until it comes before all its children.
+ *
+ * @param heap The priority queue.
+ * @param index The position of the item.
+ */
+static void sift_down(PiHeap *heap, int index)
+{
+    HeapEntry entry = heap->entries[index];
+
+    for (;;)
+    {
+        int first = index * HEAP_ARITY + 1;
+        if (first >= heap->size)
+            break;
+
+        // Find the child that comes first
+        int last = first + HEAP_ARITY < heap->size ? first + HEAP_ARITY : heap->size;
+        int best = first;
+        for (int child = first + 1; child < last; child++)
+            if (before(&heap->entries[child], &heap->entries[best]))
+                best = child;
+
+        if (!before(&heap->entries[best], &entry))
+            break;
+
+        place(heap, index, heap->entries[best]);
+        index = best;
+    }
+
+    place(heap, index, entry);
+}
+
+/**
+ * Grows an array of a priority queue, exiting if memory runs out.
+ */
+static void *grow(void *array, int capacity, size_t item_size)
+{
+    void *grown = realloc(array, capacity * item_size);
+    if (!grown)
+    {
+        perror("Failed to allocate memory for priority queue");
+        exit(EXIT_FAILURE);
+    }
+    return grown;
+}
+
+/**
+ * Gives out a handle for a new item, reusing those of popped items.
+ *
+ * @param heap The priority queue.
+ * @return The handle.
+ */
+static int new_handle(PiHeap *heap)
+{
+    if (heap->free_count > 0)
+        return heap->free_handles[--heap->free_count];
+
+    if (heap->handle_count == heap->handle_capacity)
+    {
+        heap->handle_capacity = heap->handle_capacity ? heap->handle_capacity * 2 : HEAP_MIN_CAP;
+        heap->positions = grow(heap->positions, heap->handle_capacity, sizeof(int));
+        heap->free_handles = grow(heap->free_handles, heap->handle_capacity, sizeof(int));
+    }
+
+    return heap->handle_count++;
+}
+
+/**
+ * Adds an item to a priority queue.
+ *
+ * The caller is responsible for the write barrier.
+ *
+ * @param heap The priority queue.
+ * @param value The item.
+ * @param priority Its priority, lower priorities are popped first.
+ * @return A handle to change the priority of the item (see heap_update),
+ *         valid until the item is popped.
+ */
+int heap_push(PiHeap *heap, Value value, double priority)
+{
+    if (heap->size == heap->capacity)
+    {
+        heap->capacity = heap->capacity ? heap->capacity * 2 : HEAP_MIN_CAP;
+        heap->entries = grow(heap->entries, heap->capacity, sizeof(HeapEntry));
+    }
+
+    int handle = new_handle(heap);
+    heap->entries[heap->size] = (HeapEntry){priority, heap->order++, handle, value};
+    sift_up(heap, heap->size++);
+
+    return handle;
+}
+
+/**
+ * Reads the item with the lowest priority, without removing it.
+ *
+ * @param heap The priority queue.
+ * @param value Set to the item.
+ * @param priority Set to its priority (may be NULL).
+ * @return false if the queue is empty.
+ */
+bool heap_peek(PiHeap *heap, Value *value, double *priority)
+{
+    if (heap->size == 0)
+        return false;
+
+    *value = heap->entries[0].value;
+    if (priority)
+        *priority = heap->entries[0].priority;
+    return true;
+}
+
+/**
+ * Removes the item with the lowest priority (the first pushed of those
+ * with the same priority).
+ *
+ * @param heap The priority queue.
+ * @param value Set to the item.
+ * @param priority Set to its priority (may be NULL).
+ * @return false if the queue is empty.
+ */
+bool heap_pop(PiHeap *heap, Value *value, double *priority)
+{
+    if (!heap_peek(heap, value, priority))
+        return false;
+
+    int handle = heap->entries[0].handle;
+    heap->positions[handle] = -1;
+    heap->free_handles[heap->free_count++] = handle;
+
+    if (--heap->size > 0)
+    {
+        heap->entries[0] = heap->entries[heap->size];
+        sift_down(heap, 0);
+    }
+
+    return true;
+}
+
+/**
+ * Changes the priority of a queued item, moving it up or down the heap.
+ *
+ * @param heap The priority queue.
+ * @param handle The handle returned by heap_push for the item.
+ * @param priority The new priority.
+ * @return false if the handle is not that of a queued item.
+ */
+bool heap_update(PiHeap *heap, int handle, double priority)
+{
+    if (handle < 0 || handle >= heap->handle_count || heap->positions[handle] < 0)
+        return false;
+
+    int index = heap->positions[handle];
+    double old = heap->entries[index].priority;
+    heap->entries[index].priority = priority;
+
+    if (priority < old)
+        sift_up(heap, index);
+    else if (priority > old)
+        sift_down(heap, index);
+
+    return true;
+}
+
+/**
+ * Frees the arrays of a priority queue, but not the queue itself.
+ *
+ * @param heap The priority queue.
+ */
+void heap_free(PiHeap *heap)
+{
+    free(heap->entries);
+    free(heap->positions);
+    free(heap->free_handles);
+    heap->entries = NULL;
+    heap->positions = NULL;
+    heap->free_handles = NULL;
+}
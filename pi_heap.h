@@ -0,0 +1,15 @@
+#ifndef PI_HEAP_H
+#define PI_HEAP_H
+
+#include <stdbool.h>
+
+#include "pi_value.h"
+#include "pi_object.h"
+
+int heap_push(PiHeap *heap, Value value, double priority);
+bool heap_pop(PiHeap *heap, Value *value, double *priority);
+bool heap_peek(PiHeap *heap, Value *value, double *priority);
+bool heap_update(PiHeap *heap, int handle, double priority);
+void heap_free(PiHeap *heap);
+
+#endif // PI_HEAP_H
@@ -0,0 +1,211 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "pi_iter.h"
+#include "pi_func.h"
+#include "pi_set.h"
+#include "pi_gen.h"
+#include "gc.h"
+
+/**
+ * Creates a new iterator with the source and the stages of an iterator,
+ * followed by one more stage. The stages are copied, so an iterator can be
+ * extended more than once and each pipeline keeps its own counts.
+ *
+ * @param iter The iterator to extend.
+ * @param type The type of the new stage.
+ * @param fn The function of a map or filter stage.
+ * @param count The count of a take or skip stage.
+ * @return The new iterator.
+ */
+PiIter *iter_extend(PiIter *iter, stage_type type, Value fn, int count)
+{
+    PiIter *next = (PiIter *)new_iter(iter->source);
+
+    next->stage_count = iter->stage_count + 1;
+    next->stages = malloc(sizeof(IterStage) * next->stage_count);
+    if (iter->stage_count > 0)
+        memcpy(next->stages, iter->stages, sizeof(IterStage) * iter->stage_count);
+
+    next->stages[iter->stage_count] = (IterStage){type, fn, count, 0};
+    iter_rewind(next);
+
+    return next;
+}
+
+/**
+ * Moves an iterator back to the first item of its source.
+ *
+ * @param iter The iterator.
+ */
+void iter_rewind(PiIter *iter)
+{
+    iter->index = 0;
+    iter->current = IS_RANGE(iter->source) ? AS_RANGE(iter->source)->start : 0;
+    iter->value = NEW_NIL();
+    iter->done = false;
+
+    for (int i = 0; i < iter->stage_count; i++)
+        iter->stages[i].seen = 0;
+}
+
+/**
+ * Reads the next item of the source of an iterator.
+ *
+ * Maps give their keys, as in a for loop. Generators are resumed, and are
+ * not started again by iter_rewind.
+ *
+ * @param vm The virtual machine instance.
+ * @param iter The iterator.
+ * @param value Set to the item.
+ * @return false at the end of the source.
+ */
+static bool source_next(vm_t *vm, PiIter *iter, Value *value)
+{
+    Value source = iter->source;
+
+    switch (OBJ_TYPE(source))
+    {
+    case OBJ_LIST:
+    {
+        list_t *items = AS_LIST(source)->items;
+        if (iter->index >= (int)items->size)
+            return false;
+        *value = list_value(items, iter->index++);
+        return true;
+    }
+
+    case OBJ_RANGE:
+    {
+        PiRange *range = AS_RANGE(source);
+        if (range->step > 0 ? iter->current >= range->end : iter->current <= range->end)
+            return false;
+        *value = NEW_NUM(iter->current);
+        iter->current += range->step;
+        return true;
+    }
+
+    case OBJ_STRING:
+    {
+        PiString *string = AS_STRING(source);
+        if ((size_t)iter->index >= string->length)
+            return false;
+        char *_char = malloc(2); // 1 char + null terminator
+        _char[0] = string->chars[iter->index++];
+        _char[1] = '\0';
+        *value = NEW_OBJ(add_obj(vm, new_pistring(_char)));
+        return true;
+    }
+
+    case OBJ_SET:
+    {
+        PiSet *set = AS_SET(source);
+        while (iter->index < set->count && !set->entries[iter->index].live)
+            iter->index++;
+        if (iter->index >= set->count)
+            return false;
+        *value = set->entries[iter->index++].value;
+        return true;
+    }
+
+    case OBJ_MAP:
+    {
+        PiMap *map = AS_MAP(source);
+        if (iter->index >= map_size(map))
+            return false;
+        char *key = map_keyAt(map, iter->index++);
+        *value = NEW_OBJ(add_obj(vm, new_pistring(string_copy(key))));
+        return true;
+    }
+
+    case OBJ_GEN:
+        return gen_resume(vm, AS_GEN(source), value);
+
+    default:
+        return false;
+    }
+}
+
+/**
+ * Produces the next item of an iterator.
+ *
+ * Each item of the source goes through all the stages before the next one
+ * is read, so a pipeline makes a single pass and builds no intermediate
+ * lists. Once a take stage is full the source is not read any further.
+ *
+ * The stage functions can run a collection: the iterator must be reachable
+ * (on the stack or the iterator stack) while it is pulled.
+ *
+ * @param vm The virtual machine instance.
+ * @param iter The iterator.
+ * @param value Set to the item.
+ * @return false once the iterator is exhausted.
+ */
+bool iter_pull(vm_t *vm, PiIter *iter, Value *value)
+{
+    Value item;
+
+    while (!iter->done && source_next(vm, iter, &item))
+    {
+        bool keep = true;
+
+        // The item is kept in the iterator while the stage functions run
+        iter->value = item;
+        write_barrier(vm, (Object *)iter, item);
+
+        for (int i = 0; i < iter->stage_count && keep; i++)
+        {
+            IterStage *stage = &iter->stages[i];
+
+            switch (stage->type)
+            {
+            case STAGE_MAP:
+                iter->value = call_func(vm, AS_FUN(stage->fn), 1, &iter->value);
+                write_barrier(vm, (Object *)iter, iter->value);
+                break;
+
+            case STAGE_FILTER:
+                keep = as_bool(call_func(vm, AS_FUN(stage->fn), 1, &iter->value));
+                break;
+
+            case STAGE_SKIP:
+                if (stage->seen < stage->count)
+                {
+                    stage->seen++;
+                    keep = false;
+                }
+                break;
+
+            case STAGE_TAKE:
+                if (stage->seen >= stage->count)
+                {
+                    iter->done = true;
+                    keep = false;
+                }
+                else if (++stage->seen == stage->count)
+                    iter->done = true; // This item is the last one
+                break;
+            }
+        }
+
+        if (keep)
+        {
+            *value = iter->value;
+            return true;
+        }
+    }
+
+    iter->value = NEW_NIL();
+    return false;
+}
+
+/**
+ * Frees the stages of an iterator, but not the iterator itself.
+ *
+ * @param iter The iterator.
+ */
+void iter_free(PiIter *iter)
+{
+    free(iter->stages);
+    iter->stages = NULL;
+}
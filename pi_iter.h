@@ -0,0 +1,15 @@
+#ifndef PI_ITER_H
+#define PI_ITER_H
+
+#include <stdbool.h>
+
+#include "pi_value.h"
+#include "pi_object.h"
+#include "pi_vm.h"
+
+PiIter *iter_extend(PiIter *iter, stage_type type, Value fn, int count);
+void iter_rewind(PiIter *iter);
+bool iter_pull(vm_t *vm, PiIter *iter, Value *value);
+void iter_free(PiIter *iter);
+
+#endif // PI_ITER_H
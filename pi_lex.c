@@ -16,12 +16,19 @@ static void l_error(const char *message)
 
 // Function to initialize the scanner instance
 void init_scanner(char *source)
+{
+    init_buffer(source, strlen(source));
+}
+
+// Function to initialize the scanner over a buffer of the given length
+void init_buffer(const char *source, int length)
 {
 
     // Allocate memory for the scanner instance
     scanner = (scanner_t *)malloc(sizeof(scanner_t));
 
     scanner->source = source;
+    scanner->length = length;
 
     scanner->size = 0;
 
@@ -363,15 +370,12 @@ void scan_token()
             while (is_validID(peek(0)))
                 next();
 
-            char *name = substring(scanner->source, scanner->start, scanner->current);
-            tk_type type = find_kw(name);
+            tk_type type = find_kwSpan(scanner->source + scanner->start, scanner->current - scanner->start);
 
             if (type == TK_INVALID)
                 add_token(TK_ID);
             else
                 add_token(type);
-
-            free(name);
         }
         break;
     }
@@ -383,13 +387,16 @@ char next()
 {
     scanner->current++;
     scanner->column++;
+    // The buffer may not be null-terminated, so reads past its end give '\0'
+    if (scanner->current > scanner->length)
+        return '\0';
     return scanner->source[scanner->current - 1];
 }
 
 // Function to peek a character with an offset
 char peek(int offset)
 {
-    if (scanner->current + offset >= strlen(scanner->source))
+    if (scanner->current + offset >= scanner->length)
         return '\0';
     return scanner->source[scanner->current + offset];
 }
@@ -427,7 +434,7 @@ bool match(char expected)
 void add_token(tk_type type)
 {
 
-    char *start = scanner->source + scanner->start;
+    const char *start = scanner->source + scanner->start;
     int length = scanner->current - scanner->start;
 
     int index = scanner->size; // Current token index
@@ -486,7 +493,7 @@ void add_token(tk_type type)
 
 bool is_AtEnd()
 {
-    return scanner->current >= strlen(scanner->source);
+    return scanner->current >= scanner->length;
 }
 
 bool is_digit(char ch)
@@ -15,8 +15,9 @@
  */
 typedef struct
 {
-    char *source;    // Pointer to the source code string
-    token_t *tokens; // Array of tokens generated from the source code
+    const char *source; // Pointer to the source code (not necessarily null-terminated)
+    int length;         // Length of the source code in bytes
+    token_t *tokens;    // Array of tokens generated from the source code
 
     int capacity; // Maximum capacity of the tokens array
     int size;     // Current number of tokens stored
@@ -39,6 +40,14 @@ typedef struct
  */
 void init_scanner(char *source);
 
+/**
+ * Initializes the scanner with a buffer of source code, such as a mapped file.
+ * Tokens point into the buffer, which must outlive them.
+ * @param source The source code to be tokenized.
+ * @param length The length of the source code in bytes.
+ */
+void init_buffer(const char *source, int length);
+
 /**
  * Retrieves the next token from the source code.
  * @return Pointer to the token structure.
@@ -65,7 +65,7 @@ void set_source(const char *_source)
 {
     if (source)
         free(source);
-    source = strdup(_source);
+    source = string_copy(_source);
 }
 
 EMSCRIPTEN_KEEPALIVE
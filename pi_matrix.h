@@ -0,0 +1,14 @@
+#ifndef PI_MATRIX_H
+#define PI_MATRIX_H
+
+#include "pi_vm.h"
+
+// Block sizes of the matrix product. A block of B (MAT_BLOCK_K rows of
+// MAT_BLOCK_J numbers) stays in cache while every row of A is run over it.
+#define MAT_BLOCK_K 64
+#define MAT_BLOCK_J 256
+
+void mat_multiply(const double *a, const double *b, double *c, int m, int n, int p);
+Value mat_product(vm_t *vm, PiList *A, PiList *B);
+
+#endif
@@ -1,16 +1,21 @@
 #include <math.h>
 #include <string.h>
 #include "pi_object.h"
+#include "pi_pool.h"
+#include "pi_set.h"
+#include "pi_iter.h"
 #include "common.h"
 
 #define CREATE_OBJ(obj, type) (obj *)create_obj(sizeof(obj), type)
 
 static Object *create_obj(size_t size, o_type type)
 {
-    Object *obj = (Object *)malloc(size);
+    Object *obj = pool_alloc(pool_bound(), size);
     obj->type = type;
     obj->is_marked = false;
     obj->in_gcList = false;
+    obj->generation = GEN_YOUNG;
+    obj->remembered = false;
     obj->gc_color = GC_WHITE;
 
     return obj;
@@ -112,7 +117,7 @@ PiString *copy_pistring(char *chars, int length)
 /**
  * Creates a new PiList object containing the given list of items.
  *
- * @param items The list of items to contain in the new PiList object.
+ * @param items The items of the new PiList, Values or packed doubles.
  * @return The newly created PiList object.
  */
 Object *new_list(list_t *items)
@@ -120,12 +125,134 @@ Object *new_list(list_t *items)
     PiList *list = CREATE_OBJ(PiList, OBJ_LIST);
     list->items = items;
     list->current = 0;
-    list->is_numeric = false;
+    list->is_numeric = LIST_PACKED(items);
+    list->is_matrix = false;
     list->cols = -1;
     list->rows = -1;
     return (Object *)list;
 }
 
+/**
+ * Packs the items of a list as raw doubles if they are all numbers.
+ *
+ * A packed list takes half the memory of a list of Values and its items
+ * are read without checking their type. The list is unpacked again as
+ * soon as something else than a number is stored in it.
+ *
+ * @param list The list to pack.
+ * @return true if the list is packed, false if it holds non-numbers.
+ */
+bool list_pack(PiList *list)
+{
+    list_t *items = list->items;
+    if (LIST_PACKED(items))
+        return true;
+
+    Value *values = (Value *)items->data;
+    for (int i = 0; i < items->size; i++)
+        if (!IS_NUM(values[i]))
+            return false;
+
+    if (items->share)
+        list_unshare(items);
+    values = (Value *)items->data;
+
+    double *data = malloc(items->capacity * sizeof(double));
+    if (!data)
+    {
+        perror("Failed to allocate memory for list data");
+        exit(EXIT_FAILURE);
+    }
+
+    for (int i = 0; i < items->size; i++)
+        data[i] = AS_NUM(values[i]);
+
+    free(LIST_BASE(items));
+    items->data = data;
+    items->front = 0;
+    items->i_size = sizeof(double);
+    list->is_numeric = true;
+    return true;
+}
+
+/**
+ * Returns the items of a list as Values, unpacking them if needed.
+ *
+ * The list_t itself is kept, so pointers to it stay valid.
+ *
+ * @param list The list.
+ * @return The items of the list, stored as Values.
+ */
+list_t *list_values(PiList *list)
+{
+    list_t *items = list->items;
+    if (!LIST_PACKED(items))
+        return items;
+
+    if (items->share)
+        list_unshare(items);
+
+    Value *data = malloc(items->capacity * sizeof(Value));
+    if (!data)
+    {
+        perror("Failed to allocate memory for list data");
+        exit(EXIT_FAILURE);
+    }
+
+    double *numbers = (double *)items->data;
+    for (int i = 0; i < items->size; i++)
+        data[i] = NEW_NUM(numbers[i]);
+
+    free(LIST_BASE(items));
+    items->data = data;
+    items->front = 0;
+    items->i_size = sizeof(Value);
+    return items;
+}
+
+/**
+ * Stores an item into a list, unpacking the list if the item is not a
+ * number.
+ *
+ * @param list The list.
+ * @param index The index of the item, negative indices count from the end.
+ * @param value The item.
+ */
+void list_store(PiList *list, int index, Value value)
+{
+    if (LIST_PACKED(list->items))
+    {
+        if (IS_NUM(value))
+        {
+            list_set(list->items, index, &AS_NUM(value));
+            return;
+        }
+        list->is_numeric = false;
+    }
+    list_set(list_values(list), index, &value);
+}
+
+/**
+ * Appends an item to a list, unpacking the list if the item is not a
+ * number.
+ *
+ * @param list The list.
+ * @param value The item.
+ */
+void list_push(PiList *list, Value value)
+{
+    if (LIST_PACKED(list->items))
+    {
+        if (IS_NUM(value))
+        {
+            list_add(list->items, &AS_NUM(value));
+            return;
+        }
+        list->is_numeric = false;
+    }
+    list_add(list_values(list), &value);
+}
+
 /**
  * Creates a new PiMap object from a given table.
  *
@@ -141,7 +268,7 @@ Object *new_map(table_t *table, bool is_instance)
     map->table = table;
 
     // Initialize the iterator for the object
-    map->it = ht_iterator(table);
+    map->current = 0;
 
     // Store whether this object is an instance of another object
     map->is_instance = is_instance;
@@ -149,6 +276,34 @@ Object *new_map(table_t *table, bool is_instance)
     // Set the prototype to NULL
     map->proto = NULL;
 
+    // Plain maps keep their values in the table
+    map->shape = NULL;
+    map->fields = NULL;
+    map->capacity = 0;
+
+    return (Object *)map;
+}
+
+/**
+ * Creates a new instance map laid out by the given shape.
+ *
+ * The instance stores its fields in a dense array indexed by the slots
+ * of the shape instead of a hash table. All fields start out as nil.
+ *
+ * @param shape The shape describing the fields of the instance.
+ * @return The newly created PiMap object.
+ */
+Object *new_instance(Shape *shape)
+{
+    PiMap *map = (PiMap *)new_map(NULL, true);
+
+    map->shape = shape;
+    map->capacity = shape->count > 4 ? shape->count : 4;
+    map->fields = (Value *)malloc(sizeof(Value) * map->capacity);
+
+    for (int i = 0; i < shape->count; i++)
+        map->fields[i] = NEW_NIL();
+
     return (Object *)map;
 }
 
@@ -236,11 +391,124 @@ ObjSprite *new_sprite(uint16_t width, uint16_t height, uint8_t *data)
     return sprite;
 }
 
+/**
+ * Moves the fields of a shaped instance into a hash table.
+ *
+ * Used when an instance grows too many fields to stay in the shape tree.
+ * After this call the map behaves exactly like a plain map.
+ *
+ * @param map The shaped map to convert.
+ */
+static void map_toTable(PiMap *map)
+{
+    table_t *table = ht_create(sizeof(Value));
+
+    for (int i = 0; i < map->shape->count; i++)
+        ht_put(table, shape_key(map->shape, i), &map->fields[i]);
+
+    free(map->fields);
+    map->fields = NULL;
+    map->capacity = 0;
+    map->shape = NULL;
+    map->table = table;
+}
+
+/**
+ * Looks up the storage cell of a key in a PiMap.
+ *
+ * @param map The map to search.
+ * @param key The key to look up.
+ * @return A pointer to the stored value, or NULL if the key does not exist.
+ */
+Value *map_lookup(PiMap *map, const char *key)
+{
+    if (map->shape)
+    {
+        int slot = shape_slot(map->shape, key);
+        return slot < 0 ? NULL : &map->fields[slot];
+    }
+
+    return (Value *)ht_get(map->table, key);
+}
+
+/**
+ * Stores a value under a key in a PiMap, adding the key if needed.
+ *
+ * Adding a key to a shaped instance moves it to the child shape for
+ * that key, so instances that grow the same way keep sharing shapes.
+ *
+ * @param map The map in which to store the value.
+ * @param key The key with which to associate the value.
+ * @param value The value to store.
+ */
+void map_put(PiMap *map, const char *key, Value value)
+{
+    // A table shared by clone() is copied on the first write
+    if (map->table)
+        map->table = ht_unshare(map->table);
+
+    Value *cell = map_lookup(map, key);
+    if (cell)
+    {
+        *cell = value;
+        return;
+    }
+
+    if (map->shape && map->shape->count >= SHAPE_MAX_FIELDS)
+        map_toTable(map);
+
+    if (!map->shape)
+    {
+        ht_put(map->table, key, &value);
+        return;
+    }
+
+    Shape *shape = shape_add(map->shape, key);
+    if (shape->count > map->capacity)
+    {
+        map->capacity *= 2;
+        map->fields = (Value *)realloc(map->fields, sizeof(Value) * map->capacity);
+    }
+
+    map->fields[shape->count - 1] = value;
+    map->shape = shape;
+}
+
+/**
+ * Returns the key at the given position in insertion order.
+ *
+ * @param map The map to query.
+ * @param index The position of the key (0 <= index < map_size(map)).
+ * @return The key. The string is owned by the map (or its shape).
+ */
+char *map_keyAt(PiMap *map, int index)
+{
+    if (map->shape)
+        return shape_key(map->shape, index);
+
+    return ht_keys(map->table)[index];
+}
+
+/**
+ * Returns the value at the given position in insertion order.
+ *
+ * @param map The map to query.
+ * @param index The position of the value (0 <= index < map_size(map)).
+ * @return A pointer to the stored value.
+ */
+Value *map_valueAt(PiMap *map, int index)
+{
+    if (map->shape)
+        return &map->fields[index];
+
+    return (Value *)ht_get(map->table, ht_keys(map->table)[index]);
+}
+
 /**
  * Retrieves the value associated with a given key from a PiMap.
  *
  * This function searches for the specified key in the map's
- * underlying table. If the key exists, it returns the corresponding
+ * storage. If the key exists, it returns the corresponding
  * value. Otherwise, it returns a nil value.
  *
  * @param map The map from which to retrieve the value.
@@ -250,9 +518,16 @@ ObjSprite *new_sprite(uint16_t width, uint16_t height, uint8_t *data)
  */
 Value map_get(PiMap *map, Value key)
 {
+    // String keys can be looked up without converting them first
+    if (IS_STRING(key))
+    {
+        Value *item = map_lookup(map, AS_CSTRING(key));
+        return item ? *item : NEW_NIL();
+    }
+
     char *key_str = as_string(key);
-    // Attempt to retrieve the item from the hash table using the key
-    void *item = ht_get(map->table, key_str);
+    // Attempt to retrieve the item using the key
+    Value *item = map_lookup(map, key_str);
     free(key_str);
 
     // Check if the item was found; if not, return nil
@@ -260,14 +535,14 @@ Value map_get(PiMap *map, Value key)
         return NEW_NIL();
 
     // Return the found value
-    return *(Value *)item;
+    return *item;
 }
 
 /**
  * Checks if a given key exists in a PiMap.
  *
  * This function searches for the specified key in the map's
- * underlying table. If the key exists, it returns true.
+ * storage. If the key exists, it returns true.
  * Otherwise, it returns false.
  *
  * @param map The map to search for the given key.
@@ -276,8 +551,11 @@ Value map_get(PiMap *map, Value key)
  */
 bool map_has(PiMap *map, Value key)
 {
+    if (IS_STRING(key))
+        return map_lookup(map, AS_CSTRING(key)) != NULL;
+
     char *key_str = as_string(key);
-    bool found = ht_get(map->table, key_str) != NULL;
+    bool found = map_lookup(map, key_str) != NULL;
     free(key_str);
     return found;
 }
@@ -285,10 +563,10 @@ bool map_has(PiMap *map, Value key)
 /**
  * Sets the value associated with a given key in a PiMap.
  *
- * This function either creates a new key-value pair in the map's
- * underlying table or updates the value associated with an existing
- * key. If the key does not exist in the table, it is added. If the
- * key already exists, its associated value is updated.
+ * This function either creates a new key-value pair in the map
+ * or updates the value associated with an existing key. If the
+ * key does not exist in the map, it is added. If the key already
+ * exists, its associated value is updated.
  *
  * @param map The map in which to set the value.
  * @param key The key with which to associate the value.
@@ -296,28 +574,49 @@ bool map_has(PiMap *map, Value key)
  */
 void map_set(PiMap *map, Value key, Value value)
 {
+    if (IS_STRING(key))
+    {
+        map_put(map, AS_CSTRING(key), value);
+        return;
+    }
+
     char *key_str = as_string(key);
-    // Attempt to set the item in the hash table using the key
-    bool updated = ht_set(map->table, key_str, &value);
+    map_put(map, key_str, value);
+    free(key_str);
+}
 
-    // If the key does not exist in the table, add it
-    if (!updated)
-        ht_put(map->table, key_str, &value);
+/**
+ * Sets a value under a key computed at runtime.
+ *
+ * Keys written through the index operator are open-ended, so a new one
+ * moves a shaped instance to dictionary mode instead of adding a shape
+ * transition that would never be shared and never be freed.
+ *
+ * @param map The map in which to set the value.
+ * @param key The key with which to associate the value.
+ * @param value The value to associate with the given key.
+ */
+void map_setDynamic(PiMap *map, Value key, Value value)
+{
+    if (map->shape && !map_has(map, key))
+        map_toTable(map);
 
-    free(key_str);
+    map_set(map, key, value);
 }
 
 /**
  * Returns the size of a PiMap.
  *
- * This function returns the number of key-value pairs in the map's
- * underlying table.
+ * This function returns the number of key-value pairs in the map.
  *
  * @param map The map for which to return the size.
  * @return The number of key-value pairs in the map.
  */
 int map_size(PiMap *map)
 {
+    if (map->shape)
+        return map->shape->count;
+
     return map->table->size;
 }
 
@@ -361,6 +660,8 @@ Object *new_code(list_t *code)
 
     // Store the code list in the object
     c->data = code;
+    c->is_generator = false;
+    c->lines = NULL;
 
     return (Object *)c;
 }
@@ -389,6 +690,95 @@ Object *new_range(double start, double end, double step)
     return (Object *)range;
 }
 
+/**
+ * Creates a new empty set. Its storage is allocated by the first set_add.
+ *
+ * @return A pointer to the newly created set object.
+ */
+Object *new_set(void)
+{
+    PiSet *set = CREATE_OBJ(PiSet, OBJ_SET);
+
+    set->entries = NULL;
+    set->count = 0;
+    set->size = 0;
+    set->capacity = 0;
+    set->slots = NULL;
+    set->slot_count = 0;
+    set->current = 0;
+
+    return (Object *)set;
+}
+
+/**
+ * Creates a new empty priority queue. Its storage is allocated by the
+ * first heap_push.
+ *
+ * @return A pointer to the newly created priority queue object.
+ */
+Object *new_heap(void)
+{
+    PiHeap *heap = CREATE_OBJ(PiHeap, OBJ_HEAP);
+
+    heap->entries = NULL;
+    heap->size = 0;
+    heap->capacity = 0;
+    heap->positions = NULL;
+    heap->handle_count = 0;
+    heap->handle_capacity = 0;
+    heap->free_handles = NULL;
+    heap->free_count = 0;
+    heap->order = 0;
+
+    return (Object *)heap;
+}
+
+/**
+ * Creates a new iterator over a list, range, string, set or map, with no
+ * stages yet (see pi_iter.c).
+ *
+ * @param source The collection to iterate.
+ * @return A pointer to the newly created iterator object.
+ */
+Object *new_iter(Value source)
+{
+    PiIter *iter = CREATE_OBJ(PiIter, OBJ_ITER);
+
+    iter->source = source;
+    iter->index = 0;
+    iter->current = 0;
+    iter->stages = NULL;
+    iter->stage_count = 0;
+    iter->value = NEW_NIL();
+    iter->done = false;
+
+    return (Object *)iter;
+}
+
+/**
+ * Creates a new generator for a generator function, not started yet. Its
+ * first frame is laid out by gen_create.
+ *
+ * @param function The generator function.
+ * @return A pointer to the newly created generator object.
+ */
+Object *new_gen(Object *function)
+{
+    PiGen *gen = CREATE_OBJ(PiGen, OBJ_GEN);
+
+    gen->function = function;
+    gen->slots = NULL;
+    gen->slot_count = 0;
+    gen->iters = NULL;
+    gen->iter_count = 0;
+    gen->upvalues = NULL;
+    gen->upvalue_count = 0;
+    gen->pc = 0;
+    gen->state = GEN_SUSPENDED;
+
+    return (Object *)gen;
+}
+
 /**
  * Resets the given iterable object to its initial state.
  *
@@ -416,12 +806,20 @@ void iter_reset(Object *col)
         ((PiString *)col)->current = 0;
         break;
     case OBJ_MAP:
-    {
         // Reset the map's iterator to its first key-value pair
-        PiMap *map = (PiMap *)col;
-        ht_reset(&map->it);
+        ((PiMap *)col)->current = 0;
+        break;
+    case OBJ_SET:
+        // Reset the set's iterator to its first item
+        ((PiSet *)col)->current = 0;
+        break;
+    case OBJ_ITER:
+        // Start the pipeline again from the first item of its source
+        iter_rewind((PiIter *)col);
+        break;
+    case OBJ_GEN:
+        // Generators carry on from where they are
         break;
-    }
     default:
         // Raise an error if the object type is not iterable
         fprintf(stderr, "Object type is not iterable.\n");
@@ -468,7 +866,12 @@ bool iter_hasNext(Object *col)
     {
         PiMap *map = (PiMap *)col;
         // Check if there are more key-value pairs to iterate
-        return ht_hasNext(&map->it);
+        return map->current < map_size(map);
+    }
+    else if (type == OBJ_SET)
+    {
+        // Skip the removed items
+        return set_advance((PiSet *)col);
     }
     return false;
 }
@@ -491,7 +894,7 @@ Value iter_next(Object *col)
     if (type == OBJ_LIST)
     {
         PiList *list = (PiList *)col;
-        Value value = *(Value *)list_getAt(list->items, list->current);
+        Value value = list_value(list->items, list->current);
         list->current++;
         return value;
     }
@@ -515,8 +918,14 @@ Value iter_next(Object *col)
     else if (type == OBJ_MAP)
     {
         PiMap *map = (PiMap *)col;
-        ht_next(&map->it);
-        return *(Value *)map->it.value;
+        return *map_valueAt(map, map->current++);
+    }
+    else if (type == OBJ_SET)
+    {
+        PiSet *set = (PiSet *)col;
+        if (set_advance(set))
+            return set->entries[set->current++].value;
+        return NEW_NIL();
     }
 
     fprintf(stderr, "Invalid col type for iteration.\n");
@@ -527,7 +936,8 @@ Value iter_next(Object *col)
  * @brief Check if an object is iterable.
  *
  * This function determines whether a given object can be iterated over.
- * Supported iterable types include lists, strings, ranges, and maps.
+ * Supported iterable types include lists, strings, ranges, maps, sets,
+ * iterators and generators.
  *
  * @param obj The object to check for iterability.
  * @return true if the object is iterable, false otherwise.
@@ -543,6 +953,9 @@ bool is_iterable(Object *obj)
     case OBJ_STRING:
     case OBJ_RANGE:
     case OBJ_MAP:
+    case OBJ_SET:
+    case OBJ_ITER:
+    case OBJ_GEN:
         return true; // Return true for iterable types
     default:
         return false; // Return false for non-iterable types
@@ -612,11 +1025,16 @@ Value get_slice(Object *sequence, double start, double end, double step)
         else
             _end = get_index((int)end, size);
 
-        // Create the sliced list
-        list_t *s_list = list_create(sizeof(Value));
+        // Contiguous slices share the items of the list until either is
+        // modified (see list_view)
+        if (_step == 1 && _end > _start)
+            return NEW_OBJ(new_list(list_view(list->items, _start, _end - _start)));
+
+        // Create the sliced list (packed if the list is)
+        list_t *s_list = list_create(list->items->i_size);
         while (sign * (_end - _start) > 0)
         {
-            Value *item = (Value *)list_getAt(list->items, _start);
+            void *item = list_getAt(list->items, _start);
             list_add(s_list, item); // Add the item to the sublist
             _start += _step;
         }
@@ -7,6 +7,7 @@
 #include "pi_value.h"
 #include "list.h"
 #include "pi_table.h"
+#include "pi_shape.h"
 #include "common.h"
 #include "audio.h"
 
@@ -22,8 +23,12 @@
 #define IS_MODEL(o) IS_OBJ_TYPE(o, OBJ_MODEL3D)
 #define IS_IMAGE(o) IS_OBJ_TYPE(o, OBJ_IMAGE)
 #define IS_SPRITE(o) IS_OBJ_TYPE(o, OBJ_SPRITE)
+#define IS_SET(o) IS_OBJ_TYPE(o, OBJ_SET)
+#define IS_HEAP(o) IS_OBJ_TYPE(o, OBJ_HEAP)
+#define IS_ITER(o) IS_OBJ_TYPE(o, OBJ_ITER)
+#define IS_GEN(o) IS_OBJ_TYPE(o, OBJ_GEN)
 
-#define IS_COLLECTION(o) (IS_LIST(o) || IS_MAP(o) || IS_STRING(o))
+#define IS_COLLECTION(o) (IS_LIST(o) || IS_MAP(o) || IS_STRING(o) || IS_SET(o) || IS_HEAP(o))
 
 #define IS_SEQUENCE(o) (IS_LIST(o) || IS_STRING(o))
 
@@ -36,20 +41,27 @@
 #define AS_FILE(o) ((ObjFile *)AS_OBJ(o))
 #define AS_IMAGE(o) ((ObjImage *)AS_OBJ(o))
 #define AS_SPRITE(o) ((ObjSprite *)AS_OBJ(o))
+#define AS_SET(o) ((PiSet *)AS_OBJ(o))
+#define AS_HEAP(o) ((PiHeap *)AS_OBJ(o))
+#define AS_ITER(o) ((PiIter *)AS_OBJ(o))
+#define AS_GEN(o) ((PiGen *)AS_OBJ(o))
 
 #define AS_CSTRING(o) AS_STRING(o)->chars
 
-#define AS_CLIST(o) AS_LIST(o)->items
+#define AS_CLIST(o) list_values(AS_LIST(o)) // Unpacks a packed list
 #define AS_CMAP(o) AS_MAP(o)->table
 
 #define PISTR_SIZE(o) AS_STRING(o)->length
-#define PIMAP_SIZE(o) AS_MAP(o)->table->size
+#define PIMAP_SIZE(o) map_size(AS_MAP(o))
 #define PILIST_SIZE(o) AS_LIST(o)->items->size
 
 #define COL_LENGTH(o) (IS_LIST(o) ? PILIST_SIZE(o) : PISTR_SIZE(o))
 
 #define PILIST_GETAT(o, i, t) (*(t *)list_getAt(AS_CLIST(o), i))
 
+// Whether the items of a list are stored as raw doubles (see list_pack)
+#define LIST_PACKED(l) ((l)->i_size == sizeof(double))
+
 typedef enum
 {
     OBJ_STRING,
@@ -62,7 +74,11 @@ typedef enum
     OBJ_IMAGE,
     OBJ_SPRITE,
     OBJ_MODEL3D,
-    OBJ_SOUND
+    OBJ_SOUND,
+    OBJ_SET,
+    OBJ_HEAP,
+    OBJ_ITER,
+    OBJ_GEN
 } o_type;
 
 typedef enum
@@ -72,11 +88,17 @@ typedef enum
     GC_BLACK  // Marked and all children processed
 } GCColor;
 
+#define GEN_YOUNG 0 // Allocated since the last collection (nursery)
+#define GEN_OLD 1   // Survived a collection, only scanned by full collections
+
 struct Object
 {
     o_type type;
-    bool is_marked; // Flag to indicate if the object is marked for garbage collection
-    bool in_gcList; // Flag to indicate if the object is in the GC list
+    bool is_marked;     // Flag to indicate if the object is marked for garbage collection
+    bool in_gcList;     // Flag to indicate if the object is in the GC list
+    uint8_t pool_class; // Size class the object was allocated from (POOL_NONE for malloc)
+    uint8_t generation; // GEN_YOUNG or GEN_OLD
+    bool remembered;    // Flag to indicate if the object is in the VM's remembered set
 
     GCColor gc_color;
 
@@ -110,6 +132,7 @@ typedef struct
 
     int current;     // Iterator state
     bool is_numeric; // Flag to indicate if the list contains only double values
+                     // (such lists store raw doubles, see list_pack)
     bool is_matrix;  // Flag to indicate if the list is a 2D matrix
 
     // Matrix dimensions
@@ -121,21 +144,144 @@ typedef struct
 typedef struct PiMap
 {
     Object object;
-    table_t *table;
+    table_t *table; // Key-value storage (NULL while the map has a shape)
     bool is_instance;
 
     struct PiMap *proto; // Prototype map for inheritance and method lookup
 
-    // int current; // Iterator state
-    ht_iter it;
+    // Instances built by construct() keep their fields in a dense array
+    // laid out by a shape shared with every instance of the same layout.
+    Shape *shape;
+    Value *fields;
+    int capacity;
+
+    int current; // Iterator state
 } PiMap;
 
+// An item of a set, kept in insertion order
+typedef struct
+{
+    Value value;
+    uint32_t hash;
+    bool live; // false once the item is removed, until the set is compacted
+} SetEntry;
+
+typedef struct
+{
+    Object object;
+    SetEntry *entries; // Items in insertion order, including removed ones
+    int count;         // Number of entries, removed ones included
+    int size;          // Number of items in the set
+    int capacity;      // Capacity of the entries
+
+    // Open addressing index over the entries (see pi_set.c)
+    int *slots;
+    int slot_count; // A power of two
+
+    int current; // Iterator state
+} PiSet;
+
+// An item of a priority queue
+typedef struct
+{
+    double priority;
+    uint64_t order; // Insertion order, so equal priorities are popped first in, first out
+    int handle;     // Identifies the item for heap_update while it is queued
+    Value value;
+} HeapEntry;
+
+typedef struct
+{
+    Object object;
+    HeapEntry *entries; // A 4-ary min-heap ordered by priority (see pi_heap.c)
+    int size;
+    int capacity;
+
+    // Position of each handle's item in the entries (-1 once popped)
+    int *positions;
+    int handle_count;    // Number of handles given out
+    int handle_capacity; // Capacity of the positions and of free_handles
+    int *free_handles;   // Handles of popped items, given out again
+    int free_count;
+
+    uint64_t order; // Next insertion order
+} PiHeap;
+
+typedef enum
+{
+    STAGE_MAP,
+    STAGE_FILTER,
+    STAGE_TAKE,
+    STAGE_SKIP
+} stage_type;
+
+// A step of an iterator pipeline
+typedef struct
+{
+    stage_type type;
+    Value fn;  // Function of a map or filter stage
+    int count; // Number of items a take or skip stage lets through or drops
+    int seen;  // Number of items the stage has seen in this pass
+} IterStage;
+
+typedef struct
+{
+    Object object;
+    Value source; // The list, range, string, set, map or generator the items come from
+
+    // Position in the source, kept apart from the source's own iterator
+    // state so the source can be looped over while the iterator runs
+    int index;
+    double current; // Next number of a range
+
+    IterStage *stages; // Applied in order to each item, in a single pass
+    int stage_count;
+
+    Value value; // Item going through the stages, kept alive for the GC
+    bool done;   // Set once a take stage is full
+} PiIter;
+
+typedef enum
+{
+    GEN_SUSPENDED, // Not started yet, or stopped at a yield
+    GEN_RUNNING,
+    GEN_DONE // The body returned
+} gen_state;
+
+// An upvalue captured in the frame of a suspended generator
+typedef struct
+{
+    UpValue *upvalue;
+    int slot; // Position of the captured variable in the frame
+} GenUpvalue;
+
+typedef struct
+{
+    Object object;
+    Object *function; // The generator function
+
+    // The frame of the body while it is suspended (see pi_gen.c): its part
+    // of the value stack, the iterators of its for loops and the upvalues
+    // captured from it. They are moved back to the VM when it resumes.
+    Value *slots;
+    int slot_count;
+    Object **iters;
+    int iter_count;
+    GenUpvalue *upvalues;
+    int upvalue_count;
+
+    int pc; // Where the body resumes
+    gen_state state;
+} PiGen;
+
 typedef struct
 {
     Object object;
     list_t *data;
 
     uint32_t hash;
+    bool is_generator; // The function contains a yield (see pi_gen.c)
+    list_t *lines;     // Line table of the code (see line_t in pi_compiler.h)
 } ObjCode;
 
 typedef struct
@@ -188,8 +334,13 @@ Object *new_pistring(char *str);
 PiString *copy_pistring(char *chars, int length);
 
 Object *new_list(list_t *items);
+bool list_pack(PiList *list);
+list_t *list_values(PiList *list);
+void list_store(PiList *list, int index, Value value);
+void list_push(PiList *list, Value value);
 
 Object *new_map(table_t *table, bool is_instance);
+Object *new_instance(Shape *shape);
 
 Object *new_file(FILE *file, char *filename, char *mode);
 ObjModel3d *new_model3d(triangle *triangles, int count, ObjImage *texture);
@@ -199,12 +350,23 @@ ObjSprite *new_sprite(uint16_t width, uint16_t height, uint8_t *data);
 
 Value map_get(PiMap *map, Value key);
 void map_set(PiMap *map, Value key, Value value);
+void map_setDynamic(PiMap *map, Value key, Value value);
 bool map_has(PiMap *map, Value key);
 
+Value *map_lookup(PiMap *map, const char *key);
+void map_put(PiMap *map, const char *key, Value value);
+char *map_keyAt(PiMap *map, int index);
+Value *map_valueAt(PiMap *map, int index);
+
 int map_size(PiMap *map);
 
 Object *new_range(double start, double end, double step);
 
+Object *new_set(void);
+Object *new_heap(void);
+Object *new_iter(Value source);
+Object *new_gen(Object *function);
+
 uint32_t code_hash(uint8_t *code);
 Object *new_code(list_t *code);
 
@@ -213,6 +375,21 @@ bool iter_hasNext(Object *col);
 Value iter_next(Object *col);
 bool is_iterable(Object *obj);
 int get_index(int index, int length);
+
+/**
+ * Reads an item of a list whether its items are packed or not.
+ *
+ * @param items The items of the list (PiList.items).
+ * @param index The index of the item, negative indices count from the end.
+ * @return The item.
+ */
+static inline Value list_value(list_t *items, int index)
+{
+    if (LIST_PACKED(items))
+        return NEW_NUM(*(double *)list_getAt(items, index));
+    return *(Value *)list_getAt(items, index);
+}
+
 Value get_slice(Object *sequence, double start, double end, double step);
 
 void free_sound(ObjSound *sound);
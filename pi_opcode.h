@@ -47,6 +47,12 @@ typedef enum
     OP_UNARY = 0x29,
     OP_DEBUG = 0x2a,
     OP_POP_ITER = 0x2b,
+    OP_GET_FIELD = 0x2c,
+    OP_SET_FIELD = 0x2d,
+    OP_YIELD = 0x2e,
+    OP_CALL_NATIVE = 0x2f,
+    OP_CALL_BUILTIN = 0x30,
+    OP_WIDE = 0x31,
     OP_CLOSE_UPVALUE = 0x3c,
 } OpCode;
 
@@ -6,50 +6,55 @@
 #include <math.h>
 #include "pi_parser.h"
 #include "pi_compiler.h"
+#include "pi_resolve.h"
+#include "pi_fold.h"
+#include "pi_codegen.h"
 #include "pi_opcode.h"
 #include "pi_object.h"
 #include "string.h"
 
+// Most parameters a function can declare
+#define MAX_PARAMS 255
+
 char *comp_ops[] = {"==", "!=", ">", "<", ">=", "<=", "in"};
 char *bin_ops[] = {"+", "-", "*", "/", "%", "&&", "||", "**", "&", "|", "^", "<<", ">>", ">>>", ".", "is"};
 char *unary_ops[] = {"+", "-", "!", "~", "#", "++", "--", "typeof"};
 
 // Function prototypes for static functions
-static void program(parser_t *parser);
-static void declaration(parser_t *parser);
-static void var_decl(parser_t *parser);
-static void func_decl(parser_t *parser);
-static void statement(parser_t *parser);
-static void expr_state(parser_t *parser);
-static void block(parser_t *parser);
-static void if_stmt(parser_t *parser);
-static void while_stmt(parser_t *parser);
-static void for_stmt(parser_t *parser);
-static void break_stmt(parser_t *parser);
-static void continue_stmt(parser_t *parser);
-static void return_stmt(parser_t *parser);
-static void print(parser_t *parser);
-static void variable(parser_t *parser);
-static void expr(parser_t *parser);
-static void assignment(parser_t *parser, bool emit_load);
-static void cond_expr(parser_t *parser);
-static void or_expr(parser_t *parser);
-static void and_expr(parser_t *parser);
-static void in_expr(parser_t *parser);
-static void range_expr(parser_t *parser);
-static void bitOr_expr(parser_t *parser);
-static void xor_expr(parser_t *parser);
-static void bitAnd_expr(parser_t *parser);
-static void shift_expr(parser_t *parser);
-static void equality_expr(parser_t *parser);
-static void compare_expr(parser_t *parser);
-static void add_expr(parser_t *parser);
-static void dot_expr(parser_t *parser);
-static void mult_expr(parser_t *parser);
-static void exp_expr(parser_t *parser);
-static void member_expr(parser_t *parser);
-static void unary_expr(parser_t *parser);
-static void primary(parser_t *parser);
+static node_t *program(parser_t *parser);
+static node_t *declaration(parser_t *parser);
+static node_t *var_decl(parser_t *parser);
+static node_t *func_decl(parser_t *parser);
+static node_t *statement(parser_t *parser);
+static node_t *expr_state(parser_t *parser);
+static node_t *block(parser_t *parser);
+static node_t *if_stmt(parser_t *parser);
+static node_t *while_stmt(parser_t *parser);
+static node_t *for_stmt(parser_t *parser);
+static node_t *break_stmt(parser_t *parser);
+static node_t *continue_stmt(parser_t *parser);
+static node_t *return_stmt(parser_t *parser);
+static node_t *yield_stmt(parser_t *parser);
+static node_t *expr(parser_t *parser);
+static node_t *assignment(parser_t *parser);
+static node_t *cond_expr(parser_t *parser);
+static node_t *or_expr(parser_t *parser);
+static node_t *and_expr(parser_t *parser);
+static node_t *in_expr(parser_t *parser);
+static node_t *range_expr(parser_t *parser);
+static node_t *bitOr_expr(parser_t *parser);
+static node_t *xor_expr(parser_t *parser);
+static node_t *bitAnd_expr(parser_t *parser);
+static node_t *shift_expr(parser_t *parser);
+static node_t *equality_expr(parser_t *parser);
+static node_t *compare_expr(parser_t *parser);
+static node_t *add_expr(parser_t *parser);
+static node_t *dot_expr(parser_t *parser);
+static node_t *mult_expr(parser_t *parser);
+static node_t *exp_expr(parser_t *parser);
+static node_t *member_expr(parser_t *parser);
+static node_t *unary_expr(parser_t *parser);
+static node_t *primary(parser_t *parser);
 
 /**
  * Peeks at the current token from the tokens array.
@@ -96,18 +101,6 @@ static token_t previous(parser_t *parser)
     return parser->tokens[parser->current - 1];
 }
 
-/**
- * Checks if a given token is a delimiter.
- * A delimiter is a token that delimits (or separates) other tokens. In this
- * case, the only delimiter is the semicolon (;).
- * @param token the token to check
- * @return true if the token is a delimiter, false otherwise
- */
-static bool is_delimiter(parser_t *parser, token_t token)
-{
-    return token.type == TK_SEMICOLON;
-}
-
 /**
  * Advances the parser to the next token and returns the previous token.
  * @return the previous token
@@ -115,13 +108,7 @@ static bool is_delimiter(parser_t *parser, token_t token)
 static token_t next(parser_t *parser)
 {
     if (!is_atEnd(parser))
-    {
         parser->current++;
-
-        token_t tok = peek(parser);
-        if (!is_delimiter(parser, tok))
-            parser->last = tok;
-    }
     return previous(parser);
 }
 
@@ -246,16 +233,6 @@ static void advance(parser_t *parser)
         parser->current++; // Move to the next token
 }
 
-/**
- * Advances the parser by a given number of steps. This is used to skip over
- * tokens that are not of interest when parsing.
- * @param steps the number of steps to advance the parser
- **/
-static void skip(parser_t *parser, int steps)
-{
-    parser->current += steps;
-}
-
 /**
  * Consumes tokens if they exist in the given types.
  *
@@ -302,24 +279,6 @@ static bool consume_ifExist(parser_t *parser, int t_count, ...)
     return consumed;
 }
 
-/**
- * Updates the parser's current position to match the given token's position.
- *
- * This function sets the current line and column of the parser's compiler
- * to the line and column positions of the provided token.
- *
- * @param parser The parser whose position is to be updated.
- * @param token The token whose position is used to update the parser's position.
- */
-void set_pos(parser_t *parser, token_t token)
-{
-    // Set the current line of the compiler to the token's line
-    parser->comp->current_line = token.line;
-
-    // Set the current column of the compiler to the token's column
-    parser->comp->current_col = token.column;
-}
-
 /**
  * Checks if there is a line break between the previous and current token.
  *
@@ -352,41 +311,65 @@ bool need_delimiter(parser_t *parser)
     // If we get here, we don't need a delimiter
     return false;
 }
+
 /**
- * Checks if the current token is an assignment operator.
- * The function verifies if the parser is in a store state and if the current
- * token matches any of the assignment operators. If so, it resets the store
- * state and returns true.
+ * Returns the position of a token, for the fields of a node.
  *
- * @return true if the current token is an assignment operator, false otherwise
+ * @param token The token.
+ * @return The line and column of the token.
  */
-static bool is_assign(parser_t *parser)
+static pos_t token_pos(token_t token)
 {
-    // Check if the parser is in a store state and the current token is an assignment operator
-    if (parser->is_store && check_n(parser, 11, TK_ASSIGN, TK_PLUS_ASSIGN, TK_MINUS_ASSIGN, TK_DIV_ASSIGN, TK_MULT_ASSIGN,
-                                    TK_MOD_ASSIGN, TK_BITOR_ASSIGN, TK_XOR_ASSIGN, TK_BITAND_ASSIGN, TK_INCR, TK_DECR))
-    {
-        parser->is_store = false; // Reset the store state
-        return true;              // Return true as the token is an assignment operator
-    }
-    return false; // Return false if no assignment operator is found
+    pos_t pos = {token.line, token.column};
+    return pos;
 }
 
 /**
- * Marks a range of tokens as skipped tokens.
+ * Creates a node reported at the position of a token.
  *
- * This function iterates over a range of tokens and sets the skip flag
- * to true for each of them. This is used to skip over tokens that are not
- * of interest when parsing.
+ * @param parser The parser whose arena the node is allocated from.
+ * @param type The type of the node.
+ * @param token The token the node's instruction is reported at.
+ * @return The new node.
+ */
+static node_t *node(parser_t *parser, node_type type, token_t token)
+{
+    return new_node(parser->ast, type, token);
+}
+
+/**
+ * Creates an identifier node for a name token.
+ *
+ * @param parser The parser whose arena the node is allocated from.
+ * @param token The name token.
+ * @return The new identifier, resolved later (see pi_resolve.c).
+ */
+static node_t *identifier(parser_t *parser, token_t token)
+{
+    node_t *ident = node(parser, NODE_IDENTIFIER, token);
+    ident->data.ident.name = ast_name(parser->ast, token);
+    return ident;
+}
+
+/**
+ * Creates a binary operation node.
  *
- * @param start the starting index of the range of tokens to be marked
- * @param end the ending index of the range of tokens to be marked
+ * @param parser The parser whose arena the node is allocated from.
+ * @param opcode OP_BINARY or OP_COMPARE.
+ * @param op The index of the operator in bin_ops or comp_ops.
+ * @param token The operator token.
+ * @param left The left operand.
+ * @param right The right operand.
+ * @return The new node.
  */
-void mark_tokens(parser_t *parser, int start, int end)
+static node_t *binary(parser_t *parser, OpCode opcode, int op, token_t token, node_t *left, node_t *right)
 {
-    // Iterate over the range of tokens and mark them as skipped
-    for (int i = start; i < end; i++)
-        parser->tokens[i].skip = true;
+    node_t *bin = node(parser, NODE_BINARY, token);
+    bin->data.binary.opcode = opcode;
+    bin->data.binary.op = op;
+    bin->data.binary.left = left;
+    bin->data.binary.right = right;
+    return bin;
 }
 
 /**
@@ -405,11 +388,10 @@ parser_t *init_parser(compiler_t *comp, token_t *tokens, ParserMode mode)
     parser->tokens = tokens;
 
     // Set initial states for parser flags
-    parser->access = false;   // Indicates whether access is allowed
-    parser->current = 0;      // Start at the first token
-    parser->is_store = false; // Store flag set to false
-    parser->is_return = false;
+    parser->current = 0; // Start at the first token
     parser->has_walrus = false;
+    parser->objects = 0;
+    parser->ast = NULL;
 
     // Initialize the compiler associated with the parser
     parser->comp = comp;
@@ -424,97 +406,72 @@ parser_t *init_parser(compiler_t *comp, token_t *tokens, ParserMode mode)
 
 /**
  * Parses the provided tokens according to the language's grammar rules.
- * Generates bytecode by calling the emit() function from the compiler module.
+ *
+ * The tokens are parsed into a syntax tree (see pi_ast.h), which then goes
+ * through the passes of the front end: the resolver binds every name to a
+ * local, an upvalue or a global (pi_resolve.c), constant expressions are
+ * folded (pi_fold.c) and the bytecode is generated from the tree
+ * (pi_codegen.c).
+ *
  * @param parser the parser structure containing the tokens to be parsed
  */
 void parse(parser_t *parser)
 {
+    node_t *tree;
+    parser->ast = ast_create();
+
     if (parser->mode == MODE_REPL)
     {
         // In REPL mode, parse only a single expression statement.
-        if (!is_atEnd(parser))        
-            expr_state(parser);        
+        tree = node(parser, NODE_PROGRAM, peek(parser));
+        if (!is_atEnd(parser))
+            node_add(parser->ast, &tree->data.program.body, expr_state(parser));
     }
     else
     {
         // In file mode, parse the entire program.
-        program(parser);
+        tree = program(parser);
     }
 
+    resolve(parser->comp, parser->ast, tree);
+    fold(tree);
+    generate(parser->comp, tree);
+
     // Emit HALT bytecode to indicate the end of the program
     emit(parser->comp, OP_HALT);
+
+    ast_free(parser->ast);
+    parser->ast = NULL;
 }
 
 /**
- * Parses all declarations within the program.
- * This function performs two passes over the tokens:
- * 1. Hoists functions and collects globals.
- * 2. Parses remaining statements while skipping processed tokens.
+ * Program -> Declaration* EOF
+ * Parses the entire program consisting of declarations and a terminating EOF.
+ *
+ * Top level functions and globals are hoisted: their declarations run before
+ * the other statements of the program, in source order.
  *
  * @param parser The parser structure containing the tokens to be parsed.
+ * @return The program node.
  */
-static void declarations(parser_t *parser)
+static node_t *program(parser_t *parser)
 {
-    int depth = 0;
+    node_t *tree = node(parser, NODE_PROGRAM, peek(parser));
+    node_list_t statements = {0};
 
-    // First pass: Hoist functions and collect globals
     while (!is_atEnd(parser))
     {
-        // Track block depth to ignore inner declarations
-        if (check(parser, TK_LBRACE))
-            depth++;
-        else if (check(parser, TK_RBRACE))
-            depth--;
-
-        // Skip inner block declarations
-        if (depth > 0)
-        {
-            next(parser);
-            continue;
-        }
-
-        // Hoist function declarations
-        if (match(parser, TK_FUN) && !match(parser, TK_LPAREN))
-        {
-            int start = parser->current - 1; // Start at 'fun'
-            func_decl(parser);               // Parse and hoist function
-            int end = parser->current;
-            mark_tokens(parser, start, end); // Mark tokens as processed
-        }
-        // Collect global variable declarations
-        else if (match(parser, TK_LET))
-        {
-            int start = parser->current - 1; // Start at 'let'
-            var_decl(parser);                // Parse variable declaration
-            int end = parser->current;
-            mark_tokens(parser, start, end); // Mark tokens as processed
-        }
+        node_t *stmt = declaration(parser);
+        if (stmt->type == NODE_VAR || stmt->type == NODE_FUNCTION)
+            node_add(parser->ast, &tree->data.program.body, stmt);
         else
-            next(parser); // Move to the next token
+            node_add(parser->ast, &statements, stmt);
     }
 
-    // Reset parser position for second pass
-    parser->current = 0;
-
-    // Second pass: Parse remaining code (skipping processed tokens)
-    while (!is_atEnd(parser))
-    {
-        // Skip tokens marked as processed
-        if (parser->tokens[parser->current].skip)
-            next(parser);
-        else
-            statement(parser); // Parse remaining statements
-    }
-}
+    for (int i = 0; i < statements.size; i++)
+        node_add(parser->ast, &tree->data.program.body, statements.items[i]);
 
-/**
- * Program -> Declaration* EOF
- * Parses the entire program consisting of declarations and a terminating EOF.
- */
-static void program(parser_t *parser)
-{
-    // Parse the program
-    declarations(parser);
+    return tree;
 }
 
 /**
@@ -522,542 +479,449 @@ static void program(parser_t *parser)
  * a function declaration, or a statement.
  * Declaration -> VarDecl | FunDecl | Statement
  * @param parser The parser structure containing the tokens to be parsed.
+ * @return The declaration or statement node.
  */
-static void declaration(parser_t *parser)
+static node_t *declaration(parser_t *parser)
 {
     // Check if the declaration is a variable declaration using 'let'
     if (match(parser, TK_LET))
-        var_decl(parser); // Parse the variable declaration
-    // Check if the declaration is a function declaration using 'fun'
-    else if (match(parser, TK_FUN))
-        func_decl(parser);
+        return var_decl(parser);
+
+    // A function declaration, `fun (` starts a function expression
+    if (check(parser, TK_FUN) && peek_next(parser).type == TK_ID)
+    {
+        next(parser);
+        return func_decl(parser);
+    }
+
     // If not a variable or function declaration, parse as a statement
-    else
-        statement(parser); // Parse as a statement
+    return statement(parser);
 }
 
 /**
- * var_decl -> "let" IDENT EQUAL expr
- * A variable declaration is a statement that declares a variable.
+ * var_decl -> "let" IDENT ("=" expr)? ("," IDENT ("=" expr)?)*
+ * A variable declaration is a statement that declares one or more variables.
+ * @param parser The parser structure containing the tokens to be parsed.
+ * @return The declaration node.
  */
-static void var_decl(parser_t *parser)
+static node_t *var_decl(parser_t *parser)
 {
+    node_t *decl = node(parser, NODE_VAR, previous(parser));
+
     do
     {
-        variable(parser);
+        // Parse the variable name
+        token_t token = consume(parser, TK_ID, "Expect variable name");
+        node_t *init = NULL;
+
+        // Check if the variable is being assigned a value
+        if (match(parser, TK_ASSIGN))
+            init = assignment(parser);
+
+        node_add(parser->ast, &decl->data.var.names, identifier(parser, token));
+        node_add(parser->ast, &decl->data.var.inits, init);
     } while (match(parser, TK_COMMA));
+
     consume_ifExist(parser, 1, TK_SEMICOLON);
+    return decl;
 }
 
 /**
- * variable -> IDENT
- * A variable is a name that can be used to refer to a value.
- * It is used to parse a variable in a variable declaration.
+ * Creates a function node. Functions written inside an object literal get
+ * `this` as their first local, and the method named `constructor` returns it.
+ *
+ * @param parser The parser structure containing the tokens to be parsed.
+ * @param kind How the function is written.
+ * @param token The token the function is reported at.
+ * @param name The name of the function, or NULL.
+ * @return The new function node.
  */
-static void variable(parser_t *parser)
+static node_t *function(parser_t *parser, func_kind kind, token_t token, char *name)
 {
-    int index = -1;
+    node_t *fn = node(parser, NODE_FUNCTION, token);
+    fn->data.func.kind = kind;
+    fn->data.func.name = name;
+    fn->data.func.has_this = parser->objects > 0 && kind != FUNC_DECL;
+    fn->data.func.is_ctor = parser->objects > 0 && name != NULL && strcmp(name, "constructor") == 0;
+    return fn;
+}
 
-    // Parse the variable name
-    token_t token = consume(parser, TK_ID, "Expect variable name");
-    char *name = token_value(token);
+/**
+ * param_list -> IDENT ("=" expr)? ( "," IDENT ("=" expr)? )*
+ *
+ * Parses the parameter list of a function, after its '('.
+ * @param parser The parser structure containing the tokens to be parsed.
+ * @param fn The function the parameters belong to.
+ */
+static void param_list(parser_t *parser, node_t *fn)
+{
+    // parse the parameter list until the right parenthesis is encountered
+    if (check(parser, TK_RPAREN))
+        return;
 
-    // parser->comp->name = strdup(name); // Store the variable name;
+    do
+    {
+        if (fn->data.func.params.size >= MAX_PARAMS)
+            p_errorf(peek(parser).line, peek(parser).column, "Can't have more than %d parameters.", MAX_PARAMS);
 
-    // Check if the variable is being assigned a value
-    if (match(parser, TK_ASSIGN))
-        assignment(parser, true);
+        // parse the parameter name
+        token_t name = consume(parser, TK_ID, "Expect parameter name.");
+        node_add(parser->ast, &fn->data.func.params, identifier(parser, name));
 
-    else
-        emit(parser->comp, OP_PUSH_NIL);
+        // parse the default value if it is present
+        node_add(parser->ast, &fn->data.func.defaults, match(parser, TK_ASSIGN) ? expr(parser) : NULL);
 
-    // Store the variable
-    add_variable(parser->comp, name);
+        // continue parsing the parameter list if there is a comma
+    } while (match(parser, TK_COMMA));
 }
 
 /**
- * param_list -> IDENT ( COMMA IDENT )* ( COMMA )?
+ * Parses the statements of a function body up to its '}', after its '{'.
  *
- * param_list parses a parameter list for a function declaration.
- * It returns a list of strings, where each string is the name of a parameter.
- * @returns a list of strings, where each string is the name of a parameter
+ * @param parser The parser structure containing the tokens to be parsed.
+ * @param fn The function the body belongs to.
  */
-static list_t *param_list(parser_t *parser)
+static void function_body(parser_t *parser, node_t *fn)
 {
-    int size = 0;
-    token_t name;
-    list_t *params = list_create(sizeof(String));
-
-    set_pos(parser, previous(parser));
-
-    if (is_object(parser->comp))
-        emit(parser->comp, OP_PUSH_NIL);
+    fn->data.func.lbrace = token_pos(previous(parser));
 
-    // parse the parameter list until the right parenthesis is encountered
-    if (!check(parser, TK_RPAREN))
+    while (!check(parser, TK_RBRACE) && !is_atEnd(parser))
     {
-        do
-        {
-            if (size >= 32)
-                p_error("Can't have more than 32 parameters.", peek(parser).line, peek(parser).column);
-
-            // parse the parameter name
-            name = consume(parser, TK_ID, "Expect parameter name.");
-            list_add(params, new_string(token_value(name)));
-
-            // parse the default value if it is present
-            if (match(parser, TK_ASSIGN))
-                expr(parser);
-            else
-                emit(parser->comp, OP_PUSH_NIL);
-
-            // increment the parameter counter
-            size++;
-
-            // continue parsing the parameter list if there is a comma
-        } while (match(parser, TK_COMMA));
+        node_t *stmt = declaration(parser);
+        node_add(parser->ast, &fn->data.func.body, stmt);
+
+        // Nothing can follow the return at the end of a declared function
+        if (fn->data.func.kind == FUNC_DECL && stmt->type == NODE_RETURN &&
+            !check(parser, TK_RBRACE) && !is_atEnd(parser))
+            p_errorf(peek(parser).line, peek(parser).column,
+                     "Unreachable code after final return statement");
     }
 
-    return params;
+    fn->data.func.rbrace = token_pos(peek(parser));
+    consume(parser, TK_RBRACE, "Expect '}' after function body.");
 }
+
 /**
  * func_decl -> "fun" IDENT "(" param_list ")" block
  * Parses a function declaration, which is a statement that declares a function.
  * @param parser The parser structure containing the tokens to be parsed.
+ * @return The function node.
  */
-static void func_decl(parser_t *parser)
+static node_t *func_decl(parser_t *parser)
 {
-    token_t token = previous(parser);
-
-    if (match(parser, TK_ID))
-    {
-        token_t id_token = previous(parser); // Capture token for position
-        char *name = token_value(id_token);
-
-        if (is_localScope(parser->comp))
-            add_local(parser->comp, name);
-
-        consume(parser, TK_LPAREN, "Expect '(' after function name.");
-        list_t *params = param_list(parser);
-        int size = list_size(params);
-        consume(parser, TK_RPAREN, "Expect ')' before function body.");
-        consume(parser, TK_LBRACE, "Expect '{' before function body.");
-        token = previous(parser);
-
-        push_function(parser->comp, name);
-
-        // Add parameters as locals
-        for (int i = 0; i < size; i++)
-            add_local(parser->comp, string_get(params, i));
-        add_local(parser->comp, "args");
-
-        bool hit_finalReturn = false;
-
-        while (!check(parser, TK_RBRACE) && !is_atEnd(parser))
-        {
-            if (hit_finalReturn)
-            {
-                token_t _token = peek(parser);
-                p_errorf(_token.line, _token.column,
-                         "Unreachable code after final return statement");
-            }
-
-            if (check(parser, TK_RETURN))
-            {
-                declaration(parser);
-                hit_finalReturn = true;
-                continue;
-            }
-
-            declaration(parser);
-        }
-
-        // Implicit return if no return seen
-        if (!parser->is_return)
-        {
-            // ⬇️ Important: Mark where the implicit return comes from
-            token_t rbrace = peek(parser);
-            set_pos(parser, rbrace);
-            emit(parser->comp, OP_PUSH_NIL);
-            emit(parser->comp, OP_RETURN);
-        }
-
-        parser->is_return = false;
-
-        consume(parser, TK_RBRACE, "Expect '}' after function body.");
+    token_t id_token = consume(parser, TK_ID, "Expect function name");
 
-        pop_function(parser->comp, size);
+    node_t *fn = function(parser, FUNC_DECL, id_token, ast_name(parser->ast, id_token));
+    fn->data.func.decl = identifier(parser, id_token);
 
-        if (!is_localScope(parser->comp))
-        {
-            // ⬇️ Mark function definition location before storing it
-            set_pos(parser, id_token);
-            emit_8u(parser->comp, OP_STORE_GLOBAL, name, store_name(parser->comp, name));
-        }
-    }
-    else
-        p_error("Expect function name", token.line, token.column);
+    consume(parser, TK_LPAREN, "Expect '(' after function name.");
+    fn->data.func.params_pos = token_pos(previous(parser));
+    param_list(parser, fn);
+    consume(parser, TK_RPAREN, "Expect ')' before function body.");
+    consume(parser, TK_LBRACE, "Expect '{' before function body.");
+    function_body(parser, fn);
 
     consume_ifExist(parser, 1, TK_SEMICOLON);
+    return fn;
 }
 
 /**
- * Outputs a debug operation for the parser.
- * Emits the OP_DEBUG operation and consumes an optional semicolon.
+ * Parses a debug statement.
+ * Consumes an optional semicolon.
  * @param parser The parser object used for parsing.
+ * @return The debug node.
  */
-static void debug(parser_t *parser)
+static node_t *debug(parser_t *parser)
 {
-    emit(parser->comp, OP_DEBUG);             // Emit the debug operation
+    node_t *stmt = node(parser, NODE_DEBUG, previous(parser));
     consume_ifExist(parser, 1, TK_SEMICOLON); // Consume a semicolon if it exists
+    return stmt;
 }
+
 /**
  * statement -> block | if_stmt | while_stmt | for_stmt | break_stmt | continue_stmt | return_stmt | expr_state
  * Parses a statement, which is a single expression or a block of expressions.
  * @param parser The parser object used for parsing.
+ * @return The statement node.
  */
-static void statement(parser_t *parser)
+static node_t *statement(parser_t *parser)
 {
-    if (match(parser, TK_LBRACE))
+    if (check(parser, TK_LBRACE))
     {
         // Look ahead to check if it's an object literal (key: value format)
-        int current = parser->current; // Save current position
+        token_t key = peek_next(parser);
+        if ((key.type == TK_STR || key.type == TK_ID || key.type == TK_NUM ||
+             key.type == TK_FALSE || key.type == TK_TRUE) &&
+            parser->tokens[parser->current + 2].type == TK_COLON)
+            return expr_state(parser);
 
-        if (match_n(parser, 5, TK_STR, TK_ID, TK_NUM, TK_FALSE, TK_TRUE) && match(parser, TK_COLON))
-        {
-            // If we find key-value pattern, reset position and parse as object
-            parser->current = current - 1;
-            primary(parser);
-        }
-        else
-        {
-            // Otherwise, parse as a block
-            parser->current = current; // Restore position
-            block(parser);
-        }
+        // Otherwise, parse as a block
+        next(parser);
+        return block(parser);
     }
     else if (match(parser, TK_IF))
-        if_stmt(parser);
+        return if_stmt(parser);
     else if (match(parser, TK_WHILE))
-        while_stmt(parser);
+        return while_stmt(parser);
     else if (match(parser, TK_FOR))
-        for_stmt(parser);
+        return for_stmt(parser);
     else if (match(parser, TK_BREAK))
-        break_stmt(parser);
+        return break_stmt(parser);
     else if (match(parser, TK_CONTINUE))
-        continue_stmt(parser);
+        return continue_stmt(parser);
     else if (match(parser, TK_RETURN))
-        return_stmt(parser);
+        return return_stmt(parser);
+    else if (match(parser, TK_YIELD))
+        return yield_stmt(parser);
     else if (match(parser, TK_DEBUG))
-        debug(parser);
+        return debug(parser);
     else
-        expr_state(parser);
+        return expr_state(parser);
 }
 
 /**
- * Executes a block of code by creating a new scope.
- * Parses and processes declarations until a closing brace '}' or end of input is encountered.
- * Pops the scope after processing the block, ensuring proper scope management.
- * Consumes the closing brace token to validate block syntax.
- * @returns nothing
+ * Checks if a statement leaves the block it is in.
+ *
+ * @param stmt The statement.
+ * @return True for return, break and continue.
  */
-static void block(parser_t *parser)
+static bool is_exit(node_t *stmt)
 {
-    // Create a new scope for the block
-    push_scope(parser->comp);
-
-    // Parse and process declarations until the closing brace or end of input is encountered
-    while (!check(parser, TK_RBRACE) && !is_atEnd(parser) && !parser->is_return)
-        declaration(parser);
+    return stmt->type == NODE_RETURN || stmt->type == NODE_BREAK || stmt->type == NODE_CONTINUE;
+}
 
-    if (parser->is_return && !check(parser, TK_RBRACE))
-        p_error("Unreachable code after return statement.", peek(parser).line, peek(parser).column);
+/**
+ * block -> "{" declaration* "}"
+ * Parses the declarations of a block, after its '{', up to the closing brace.
+ * A block is a scope of its own (see pi_resolve.c).
+ * @param parser The parser object used for parsing.
+ * @return The block node.
+ */
+static node_t *block(parser_t *parser)
+{
+    node_t *scope = node(parser, NODE_BLOCK, previous(parser));
 
-    parser->is_return = false;
+    // Parse and process declarations until the closing brace or end of input is encountered
+    while (!check(parser, TK_RBRACE) && !is_atEnd(parser))
+    {
+        node_t *stmt = declaration(parser);
+        node_add(parser->ast, &scope->data.block.body, stmt);
 
-    // Pop the scope after processing the block
-    pop_scope(parser->comp);
+        if (is_exit(stmt) && !check(parser, TK_RBRACE))
+            p_error("Unreachable code after return statement.", peek(parser).line, peek(parser).column);
+    }
 
     // Consume the closing brace token to validate block syntax
     consume(parser, TK_RBRACE, "Expect '}' after block.");
+    return scope;
 }
 
 /**
- * print -> primary
- * Parses a print statement, which is a statement that prints its argument to the console.
- * Emits the OP_PRINT bytecode to print the result of the expression.
- * Consumes the semicolon token to validate the statement syntax.
- * @returns nothing
+ * Parses the body of an if, elif, else or while: a block or a single
+ * statement.
+ * @param parser The parser object used for parsing.
+ * @return The body node.
  */
-static void print(parser_t *parser)
+static node_t *body(parser_t *parser)
 {
-    primary(parser);                          // Parse the expression to be printed
-    emit(parser->comp, OP_PRINT);             // Emit bytecode to print the result of the expression
-    consume_ifExist(parser, 1, TK_SEMICOLON); // Consume the semicolon token to validate the statement syntax
+    if (match(parser, TK_LBRACE))
+        return block(parser);
+    return statement(parser);
 }
 
 /**
- * condition -> "(" expr ")" condition?
+ * condition -> "(" expr ")" | expr
  *
- * Parses a condition expression, which is an expression enclosed in parentheses.
+ * Parses a condition expression, which may be enclosed in parentheses.
  * The condition expression is parsed by calling the cond_expr() function.
  * @param parser The parser object used for parsing.
+ * @return The condition node.
  */
-static void condition(parser_t *parser)
+static node_t *condition(parser_t *parser)
 {
     bool has_parens = match(parser, TK_LPAREN); // Match and consume '(' if present
 
-    cond_expr(parser); // Your existing function to parse the condition expression
+    node_t *cond = cond_expr(parser);
 
     if (has_parens)
         consume(parser, TK_RPAREN, "Expect ')' after condition.");
+    return cond;
 }
+
 /**
  * if_stmt -> "if" "(" expr ")" block ("elif" "(" expr ")" block)* ("else" block)?
- * Parses an if statement with optional elif and else clauses.
+ * Parses an if statement with optional elif and else clauses. Each elif is
+ * an if node in the `other` branch of the one before it.
+ * @param parser The parser object used for parsing.
+ * @return The if node.
  */
-static void if_stmt(parser_t *parser)
+static node_t *if_stmt(parser_t *parser)
 {
-    token_t start = peek(parser); // capture for accurate position
-    condition(parser);
-
-    set_pos(parser, start);
-    int then_jump = emit_16u(parser->comp, OP_JUMP_IF_FALSE, "", 0);
-
-    if (match(parser, TK_LBRACE))
-        block(parser);
-    else
-    {
-        statement(parser);
-        parser->is_return = false;
-    }
-
-    int end_jumps[256];
-    int jump_count = 0;
-
-    if (check(parser, TK_ELIF) || check(parser, TK_ELSE))
-    {
-        set_pos(parser, peek(parser));
-        end_jumps[jump_count++] = emit_16u(parser->comp, OP_JUMP, "", 0);
-    }
+    node_t *stmt = node(parser, NODE_IF, previous(parser));
 
-    patch_jump(parser->comp, then_jump);
+    stmt->data.if_stmt.cond_pos = token_pos(peek(parser)); // capture for accurate position
+    stmt->data.if_stmt.cond = condition(parser);
+    stmt->data.if_stmt.then = body(parser);
 
-    while (match(parser, TK_ELIF))
+    node_t *last = stmt;
+    while (check(parser, TK_ELIF) || check(parser, TK_ELSE))
     {
-        token_t elif_tok = previous(parser);
-        condition(parser);
-
-        set_pos(parser, elif_tok);
-        then_jump = emit_16u(parser->comp, OP_JUMP_IF_FALSE, "", 0);
-
-        if (match(parser, TK_LBRACE))
-            block(parser);
-        else
-        {
-            statement(parser);
-            parser->is_return = false;
-        }
+        last->data.if_stmt.other_pos = token_pos(peek(parser));
 
-        if (check(parser, TK_ELIF) || check(parser, TK_ELSE))
+        if (match(parser, TK_ELSE))
         {
-            set_pos(parser, peek(parser));
-            end_jumps[jump_count++] = emit_16u(parser->comp, OP_JUMP, "", 0);
+            last->data.if_stmt.other = body(parser);
+            break;
         }
 
-        patch_jump(parser->comp, then_jump);
-    }
-
-    if (match(parser, TK_ELSE))
-    {
-        token_t else_tok = previous(parser);
-        set_pos(parser, else_tok);
-
-        patch_jump(parser->comp, then_jump);
+        token_t elif_tok = next(parser);
+        node_t *elif = node(parser, NODE_IF, elif_tok);
+        elif->data.if_stmt.is_elif = true;
+        elif->data.if_stmt.cond_pos = token_pos(elif_tok);
+        elif->data.if_stmt.cond = condition(parser);
+        elif->data.if_stmt.then = body(parser);
 
-        if (match(parser, TK_LBRACE))
-            block(parser);
-        else
-        {
-            statement(parser);
-            parser->is_return = false;
-        }
+        last->data.if_stmt.other = elif;
+        last = elif;
     }
-    else
-        patch_jump(parser->comp, then_jump);
 
-    for (int i = 0; i < jump_count; i++)
-        patch_jump(parser->comp, end_jumps[i]);
+    return stmt;
 }
 
 /**
  * while_stmt -> "while" "(" expr ")" block
  * Parses a while loop, which repeatedly executes a block as long as a condition is true.
  * @param parser The parser object used for parsing.
+ * @return The while node.
  */
-static void while_stmt(parser_t *parser)
+static node_t *while_stmt(parser_t *parser)
 {
-    // Record the address to jump back to for looping
-    int jump = code_size(parser->comp);
+    node_t *stmt = node(parser, NODE_WHILE, previous(parser));
 
     // Capture the starting position of the condition for error reporting
-    token_t cond_start = peek(parser);
-
-    // Parse the loop condition
-    condition(parser);
-
-    // Set the parser position to the start of the condition
-    set_pos(parser, cond_start);
-
-    // Emit a conditional jump instruction to exit the loop if the condition is false
-    int address = emit_16u(parser->comp, OP_JUMP_IF_FALSE, "", 0);
-
-    // Push a new loop context onto the stack
-    push_loop(parser->comp, jump, false);
-
-    // Check if the loop body is enclosed in braces and parse accordingly
-    if (match(parser, TK_LBRACE))
-        block(parser);
-    else
-    {
-        statement(parser);
-        parser->is_return = false;
-    }
-
-    // Pop the loop context and patch the jump address to loop back
-    pop_loop(parser->comp, jump);
-    patch_jump(parser->comp, address);
+    stmt->data.while_stmt.cond_pos = token_pos(peek(parser));
+    stmt->data.while_stmt.cond = condition(parser);
+    stmt->data.while_stmt.body = body(parser);
+    return stmt;
 }
 
 /**
  * for_stmt -> "for" "(" IDENT "in" expr ")" block
  * Parses a for-in loop, which iterates over the elements of an iterable.
+ * The loop variable and the statements of the body share one scope.
+ * @param parser The parser object used for parsing.
+ * @return The for node.
  */
-static void for_stmt(parser_t *parser)
+static node_t *for_stmt(parser_t *parser)
 {
+    node_t *stmt = node(parser, NODE_FOR, previous(parser));
     bool has_parens = match(parser, TK_LPAREN);
 
     token_t init = consume(parser, TK_ID, "Invalid for-loop left-hand side. Expect identifier.");
+    stmt->data.for_stmt.var = identifier(parser, init);
 
     consume(parser, TK_IN, "Expect 'in' keyword after loop variable.");
 
-    token_t cond_tok = peek(parser);
-    cond_expr(parser);
+    stmt->data.for_stmt.iter_pos = token_pos(peek(parser));
+    stmt->data.for_stmt.iterable = cond_expr(parser);
 
     if (has_parens)
         consume(parser, TK_RPAREN, "Expect ')' after iterable expression.");
 
-    set_pos(parser, cond_tok); // associate with iterable expression
-    emit(parser->comp, OP_PUSH_ITER);
-
-    set_pos(parser, init); // mark the loop start
-    int address = emit_16u(parser->comp, OP_LOOP, "", 0);
-
-    push_scope(parser->comp);
-
-    add_variable(parser->comp, token_value(init));
-    push_loop(parser->comp, address - 2, true);
-
     if (match(parser, TK_LBRACE))
     {
         while (!check(parser, TK_RBRACE) && !is_atEnd(parser))
-            declaration(parser);
+            node_add(parser->ast, &stmt->data.for_stmt.body, declaration(parser));
 
         consume(parser, TK_RBRACE, "Expect '}' after block.");
     }
     else
-    {
-        statement(parser);
-        parser->is_return = false;
-    }
+        node_add(parser->ast, &stmt->data.for_stmt.body, statement(parser));
 
-    pop_scope(parser->comp);
-    pop_loop(parser->comp, address - 2);
-    patch_jump(parser->comp, address);
+    return stmt;
 }
 
 /**
  * break_stmt -> "break"
  * Parses a break statement, which is used to prematurely exit a loop.
- * Emits the OP_POP_ITER bytecode to remove the loop iterator from the stack.
- * If the break statement is inside a for loop, a jump is emitted to the end of
- * the loop. Otherwise, the code will exit the loop and continue executing the
- * code after the loop.
  * @param parser The parser object used for parsing.
+ * @return The break node.
  */
-static void break_stmt(parser_t *parser)
+static node_t *break_stmt(parser_t *parser)
 {
     token_t tok = previous(parser); // 'break' token
-    set_pos(parser, tok);
-
-    if (!in_loop(parser->comp))
-        p_errorf(tok.line, tok.column, "'break' used outside of a loop");
-
-    if (is_forLoop(parser->comp))
-        emit(parser->comp, OP_POP_ITER);
-
-    emit_pop(parser->comp, loop_depth(parser->comp));
-    push_break(parser->comp, emit_jump(parser->comp, 0));
-
-    // Mark this point as a return-like exit to check for unreachable code
-    parser->is_return = true;
+    node_t *stmt = node(parser, NODE_BREAK, tok);
 
     if (need_delimiter(parser))
         p_error("Expected delimiter or newline after 'break'.", tok.line, tok.column);
+    return stmt;
 }
 
 /**
  * continue_stmt -> "continue"
  * Parses a continue statement, which is used to skip the current iteration of a loop.
- * It emits the necessary bytecode to jump to the start of the loop.
  * @param parser The parser object used for parsing.
+ * @return The continue node.
  */
-static void continue_stmt(parser_t *parser)
+static node_t *continue_stmt(parser_t *parser)
 {
     token_t tok = previous(parser); // 'continue' token
-    set_pos(parser, tok);
-
-    if (!in_loop(parser->comp))
-        p_errorf(tok.line, tok.column, "'continue' used outside of a loop");
-
-    int address = get_continue(parser->comp);
-    emit_pop(parser->comp, loop_depth(parser->comp));
-    emit_jump(parser->comp, address);
-
-    parser->is_return = true;
+    node_t *stmt = node(parser, NODE_CONTINUE, tok);
 
     if (need_delimiter(parser))
         p_error("Expected delemiter or newline after 'continue'.", tok.line, tok.column);
+    return stmt;
+}
+
+/**
+ * Checks if a return or yield has no value: the statement ends at the
+ * current token.
+ * @param parser The parser object used for parsing.
+ * @return True if no expression follows.
+ */
+static bool is_endOfStatement(parser_t *parser)
+{
+    return check(parser, TK_SEMICOLON) || check(parser, TK_RBRACE) || is_lineBreak(parser);
 }
 
 /**
  * return_stmt -> "return [expr]?"
  * Parses a return statement, optionally with a return value.
+ * @param parser The parser object used for parsing.
+ * @return The return node.
  */
-static void return_stmt(parser_t *parser)
+static node_t *return_stmt(parser_t *parser)
 {
     token_t tok = previous(parser); // 'return' token
-    set_pos(parser, tok);
-
-    if (is_constructor(parser->comp))
-        emit_8u(parser->comp, OP_LOAD_LOCAL, "this", 0);
-    else
-    {
-        // Check if return is followed by a newline or semicolon => nil
-        if (match(parser, TK_SEMICOLON) || is_lineBreak(parser))
-        {
-            int index = store_const(parser->comp, NEW_NIL());
-            emit_16u(parser->comp, OP_LOAD_CONST, "nil", index);
-        }
-        else
-            expr(parser); // return with value
-    }
+    node_t *stmt = node(parser, NODE_RETURN, tok);
 
-    emit(parser->comp, OP_RETURN);
-    parser->is_return = true;
+    if (!is_endOfStatement(parser))
+        stmt->data.ret.value = expr(parser);
 
     if (need_delimiter(parser))
         p_error("Expected delemiter or newline after return.", tok.line, tok.column);
+    return stmt;
+}
+
+/**
+ * yield_stmt -> "yield" [expr]
+ * Parses a yield statement, which suspends the generator it is in and hands
+ * the value of the expression (nil if there is none) to its caller. A
+ * function containing a yield is a generator (see pi_gen.c).
+ * @param parser The parser object used for parsing.
+ * @return The yield node.
+ */
+static node_t *yield_stmt(parser_t *parser)
+{
+    token_t tok = previous(parser); // 'yield' token
+    node_t *stmt = node(parser, NODE_YIELD, tok);
+
+    if (!is_endOfStatement(parser))
+        stmt->data.ret.value = expr(parser);
+
+    if (need_delimiter(parser))
+        p_error("Expected delimiter or newline after yield.", tok.line, tok.column);
+    return stmt;
 }
 
 /**
@@ -1065,51 +929,18 @@ static void return_stmt(parser_t *parser)
  * Parses an expression statement.
  * An expression statement is an expression followed by a semicolon.
  * The expression is evaluated and the result is discarded.
- * @returns nothing
+ * @param parser The parser object used for parsing.
+ * @return The expression statement node.
  */
-static void expr_state(parser_t *parser)
+static node_t *expr_state(parser_t *parser)
 {
-
-    token_t token = peek(parser);
-    bool prev_lookUp, is_assign = false;
-    int current = parser->current;
-
-    // Check if the expression is enclosed in parentheses
-    if (token.type == TK_LPAREN)
-    {
-        prev_lookUp = look_up(parser->comp, true); // Set the look_up flag to true to indicate that the expression is enclosed in parentheses
-        primary(parser);                           // Parse the primary expression
-        look_up(parser->comp, prev_lookUp);        // Reset the look_up flag to false after parsing the expression
-        parser->current = current;                 // Reset the current position to its original value
-    }
-
-    current = parser->current;
-
-    prev_lookUp = look_up(parser->comp, true);
-
-    // Check if the expression is an assignment expression
-    cond_expr(parser);
-    token = peek(parser);
-    if (token.type >= TK_ASSIGN && token.type <= TK_MOD_ASSIGN)
-        is_assign = true;
-    look_up(parser->comp, prev_lookUp);
-
-    parser->current = current;
-
-    expr(parser); // Parse the expression
-
-    // Check if the expression is an assignment expression
-    // If it is, do not emit the POP bytecode
-    // The assignment expression is handled separately
-    if (!is_assign)
-    {
-        if (!parser->comp->is_repl)
-            emit(parser->comp, OP_POP); // Emit POP only if not in REPL mode
-    }
+    node_t *stmt = node(parser, NODE_EXPR_STMT, peek(parser));
+    stmt->data.expr_stmt.expr = expr(parser);
 
     // Check for statement separation
     if (need_delimiter(parser))
         p_error("Expected delemiter between statements.", peek(parser).line, peek(parser).column);
+    return stmt;
 }
 
 /**
@@ -1117,221 +948,73 @@ static void expr_state(parser_t *parser)
  * Parses an expression, which is a statement that assigns a value to a variable.
  * The assignment expression can be a simple assignment or a compound assignment
  * like +=, -=, \*=, /=, %=, |=, ^=, or &=.
- * @returns nothing
+ * @param parser The parser object used for parsing.
+ * @return The expression node.
  */
-static void expr(parser_t *parser)
+static node_t *expr(parser_t *parser)
 {
-    assignment(parser, false); // Parse the assignment expression
+    return assignment(parser);
 }
 
 /**
- * Initializes a new assign_t structure with the given fields.
- * @param left the first index of left hand side of the assignment
- * @param right the first index of right hand side of the assignment
- * @param op the operator used in the assignment
- * @return a pointer to the newly allocated assign_t structure
+ * assignment -> cond_expr (("=" | "+=" | "-=" | ...) assignment)?
+ * Parses an assignment expression, which is a statement that assigns a value
+ * to a variable, a field or an item. Assignments are right associative, so
+ * "a = b = c = d = 0" assigns 0 to d first.
+ * @param parser The parser object used for parsing.
+ * @return The expression node.
  */
-static assign_t *init_assign(int left, int right, tk_type op)
+static node_t *assignment(parser_t *parser)
 {
-    // Allocate memory for a new assign_t structure
-    assign_t *assign = malloc(sizeof(assign_t));
+    token_t first = peek(parser);
+    node_t *target = cond_expr(parser);
+
+    if (!match_n(parser, 9, TK_ASSIGN, TK_PLUS_ASSIGN, TK_MINUS_ASSIGN, TK_DIV_ASSIGN, TK_MULT_ASSIGN,
+                 TK_MOD_ASSIGN, TK_BITOR_ASSIGN, TK_XOR_ASSIGN, TK_BITAND_ASSIGN))
+        return target;
 
-    // Initialize fields
-    assign->left = left;
-    assign->right = right;
-    assign->op = op;
+    tk_type op = previous(parser).type;
 
+    if (target->type == NODE_INDEX && target->data.index.is_slice)
+        p_error("Cannot assign to slice", first.line, first.column);
+    if (!is_assignable(target))
+        p_error("Invalid assignment target", first.line, first.column);
+
+    // Reported at the target, like the store
+    node_t *assign = node(parser, NODE_ASSIGN, first);
+    assign->data.assign.op = op;
+    assign->data.assign.target = target;
+    assign->data.assign.value = assignment(parser);
     return assign;
 }
 
 /**
- * assignment -> condition
- * Parses an assignment expression, which is a statement that assigns a value
- * to a variable. It supports compound assignments like +=, -=, \*=, /=, %=,
- * |=, ^=, and &=.
- * @returns nothing
- */
-static void assignment(parser_t *parser, bool emit_load)
-{
-    tk_type op;
-    stack_t *assigns = stack_create(sizeof(assign_t));
-    int left = parser->current, right;
-    bool prev_lookUp = look_up(parser->comp, true);
-
-    // First pass: collect assignments in the stack without emitting bytecode
-    // This is done to handle the case where there are multiple assignments in
-    // a single expression, e.g. "a = b = c = d = 0".
-    cond_expr(parser);
-    while (match_n(parser, 9, TK_ASSIGN, TK_PLUS_ASSIGN, TK_MINUS_ASSIGN, TK_DIV_ASSIGN, TK_MULT_ASSIGN,
-                   TK_MOD_ASSIGN, TK_BITOR_ASSIGN, TK_XOR_ASSIGN, TK_BITAND_ASSIGN))
-    {
+ * cond_expr -> or_expr ("?" cond_expr ":" cond_expr)?
+ *
+ * Parse a conditional expression. If the condition is a ternary expression,
+ * parse the expression after the '?' and the expression after the ':'. If the
+ * condition is not a ternary expression, just parse the expression.
+ *
+ * @param parser The parser object used for parsing.
+ * @return The expression node.
+ */
+static node_t *cond_expr(parser_t *parser)
+{
+    node_t *cond = or_expr(parser);
 
-        op = previous(parser).type;
+    if (!match(parser, TK_QUESTION))
+        return cond;
 
-        right = parser->current;
+    node_t *ternary = node(parser, NODE_CONDITIONAL, previous(parser));
+    ternary->data.conditional.cond = cond;
 
-        // Push the assignment information to the stack
-        push(assigns, init_assign(left, right, op));
+    // Sync current token for better runtime error info
+    ternary->data.conditional.then_pos = token_pos(peek(parser));
+    ternary->data.conditional.then = cond_expr(parser);
 
-        // Parse the right-hand side of the assignment
-        cond_expr(parser);
-        left = right;
-    }
-
-    look_up(parser->comp, prev_lookUp);
-
-    // If there was no assignment operator, re-evaluate as a non-assignment
-    if (is_empty(assigns))
-    {
-        parser->current = left;
-        cond_expr(parser); // Re-evaluate as a non-assignment expression
-    }
-    else
-    {
-        int current = parser->current;
-        assign_t *assign;
-
-        // Second pass: pop each assignment and generate bytecode
-        while (!is_empty(assigns))
-        {
-
-            assign = pop(assigns);
-
-            op = assign->op;
-            left = assign->left;
-            right = assign->right;
-
-            token_t lhs = parser->tokens[left];
-
-            if (parser->tokens[left].type != TK_ID)
-                p_error("Invalid assignment target", parser->tokens[left].line, parser->tokens[left].column);
-
-            // Sync the runtime error position to LHS token
-            set_pos(parser, lhs);
-
-            if (op != TK_ASSIGN)
-            {
-                // Load LHS for compound assignments
-                parser->current = left;
-                cond_expr(parser);
-            }
-
-            // Evaluate RHS
-            parser->current = right;
-            cond_expr(parser);
-
-            // Emit the bytecode for compound operation (e.g., `+=`)
-            if (op != TK_ASSIGN)
-            {
-                // Emit the bytecode for the compound assignment
-                switch (op)
-                {
-                case TK_PLUS_ASSIGN:
-                    emit_8u(parser->comp, OP_BINARY, bin_ops[0], 0); // OP_BINARY_ADD
-                    break;
-                case TK_MINUS_ASSIGN:
-                    emit_8u(parser->comp, OP_BINARY, bin_ops[1], 1); // OP_BINARY_SUB
-                    break;
-                case TK_MULT_ASSIGN:
-                    emit_8u(parser->comp, OP_BINARY, bin_ops[2], 2); // OP_BINARY_MUL
-                    break;
-                case TK_DIV_ASSIGN:
-                    emit_8u(parser->comp, OP_BINARY, bin_ops[3], 3); // OP_BINARY_DIV
-                    break;
-                case TK_MOD_ASSIGN:
-                    emit_8u(parser->comp, OP_BINARY, bin_ops[4], 4); // OP_BINARY_MOD
-                    break;
-                case TK_BITOR_ASSIGN:
-                    emit_8u(parser->comp, OP_BINARY, bin_ops[5], 5); // OP_BINARY_BITOR
-                    break;
-                case TK_XOR_ASSIGN:
-                    emit_8u(parser->comp, OP_BINARY, bin_ops[6], 6); // OP_BINARY_XOR
-                    break;
-                case TK_BITAND_ASSIGN:
-                    emit_8u(parser->comp, OP_BINARY, bin_ops[7], 7); // OP_BINARY_BITAND
-                    break;
-                default:
-                    break;
-                }
-            }
-
-            // Store result to LHS
-            parser->current = left;
-            parser->is_store = true;
-            cond_expr(parser);
-        }
-
-        if (emit_load)
-        {
-            parser->current = left;
-            cond_expr(parser);
-        }
-
-        // Restore the original parsing position
-        parser->current = current;
-    }
-}
-
-/**
- * cond_expr -> or_expr ("?" expr ":" expr)?
- *
- * Parse a conditional expression. If the condition is a ternary expression,
- * parse the expression after the '?' and the expression after the ':'. If the
- * condition is not a ternary expression, just parse the expression.
- *
- * @returns nothing
- */
-static void cond_expr(parser_t *parser)
-{
-
-    or_expr(parser);
-
-    if (match(parser, TK_QUESTION))
-    {
-        /*
-         * Emit a jump if the condition is false. The jump offset is initially
-         * set to 0, and the address of the jump instruction is stored in
-         * then_jump. The jump offset is patched later when the actual address
-         * of the target instruction is known.
-         */
-        int then_jump = emit_16u(parser->comp, OP_JUMP_IF_FALSE, "", 0);
-
-        // Sync current token for better runtime error info
-        set_pos(parser, peek(parser));
-
-        /*
-         * Parse the expression after the '?'. This is the expression that will
-         * be executed if the condition is true.
-         */
-        cond_expr(parser);
-
-        /*
-         * Parse the expression after the ':'. This is the expression that will
-         * be executed if the condition is false.
-         */
-        token_t token = consume(parser, TK_COLON, "Expect ':' after '?'");
-        int else_jump = emit_16u(parser->comp, OP_JUMP, "", 0);
-
-        /*
-         * Patch the jump offset of the jump instruction stored in then_jump
-         * with the current instruction address. This will cause the jump
-         * instruction to jump to the instruction after the '?' expression.
-         */
-        patch_jump(parser->comp, then_jump);
-
-        /*
-         * Parse the expression after the ':'. This is the expression that will
-         * be executed if the condition is false.
-         */
-        cond_expr(parser);
-
-        /*
-         * Patch the jump offset of the jump instruction stored in else_jump
-         * with the current instruction address. This will cause the jump
-         * instruction to jump to the instruction after the ':' expression.
-         */
-        patch_jump(parser->comp, else_jump);
-    }
+    consume(parser, TK_COLON, "Expect ':' after '?'");
+    ternary->data.conditional.other = cond_expr(parser);
+    return ternary;
 }
 
 /**
@@ -1339,20 +1022,18 @@ static void cond_expr(parser_t *parser)
  * Parses a logical OR expression, which is an expression that checks if either
  * of two values are true. The syntax for a logical OR expression is [value1 or
  * value2] or [value1 or value2 or value3].
- * @returns nothing
+ * @param parser The parser object used for parsing.
+ * @return The expression node.
  */
-static void or_expr(parser_t *parser)
+static node_t *or_expr(parser_t *parser)
 {
-    and_expr(parser);
-    // Parse the "or" expression
+    node_t *left = and_expr(parser);
     while (match(parser, TK_OR))
     {
         token_t op_token = previous(parser);
-        and_expr(parser);
-        set_pos(parser, op_token);
-        // Emit bytecode for the logical OR operator
-        emit_8u(parser->comp, OP_BINARY, bin_ops[6], 6);
+        left = binary(parser, OP_BINARY, 6, op_token, left, and_expr(parser));
     }
+    return left;
 }
 
 /**
@@ -1360,297 +1041,242 @@ static void or_expr(parser_t *parser)
  * Parses a logical AND expression, which is an expression that checks if two
  * values are true. The syntax for a logical AND expression is [value1 and value2]
  * or [value1 and value2 and value3].
- * @returns nothing
+ * @param parser The parser object used for parsing.
+ * @return The expression node.
  */
-static void and_expr(parser_t *parser)
+static node_t *and_expr(parser_t *parser)
 {
-    in_expr(parser);
+    node_t *left = in_expr(parser);
     while (match(parser, TK_AND))
     {
         token_t op_token = previous(parser);
-        in_expr(parser);
-        set_pos(parser, op_token);
-        emit_8u(parser->comp, OP_BINARY, bin_ops[5], 5); // Emit bytecode for the "and" operator
+        left = binary(parser, OP_BINARY, 5, op_token, left, in_expr(parser));
     }
+    return left;
 }
 
 /**
  * in_expr -> range_expr ( "in" range_expr )*
  * Parses a membership expression, which is an expression that checks if a
  * value is in a list or tuple. The syntax for a membership expression is
- * [value in list] or [value in list if condition].
- * @returns nothing
+ * [value in list].
+ * @param parser The parser object used for parsing.
+ * @return The expression node.
  */
-static void in_expr(parser_t *parser)
+static node_t *in_expr(parser_t *parser)
 {
-    range_expr(parser);
+    node_t *left = range_expr(parser);
     while (match(parser, TK_IN))
     {
         token_t op_token = previous(parser);
-        range_expr(parser);
-        set_pos(parser, op_token);
-        emit_8u(parser->comp, OP_COMPARE, comp_ops[6], 6); // Emit bytecode for the "in" operator
+        left = binary(parser, OP_COMPARE, 6, op_token, left, range_expr(parser));
     }
+    return left;
 }
 
 /**
- * range_expr -> bitOr_expr ( ".." bitOr_expr (":" expr?)? )?
- * Parses a range expression, which is a form of slicing a list or tuple.
- * The syntax for a range expression is [start..stop] or [start..stop:step],
- * where start, stop, and step are optional and default to 0, the size of the
- * list, and 1, respectively.
- * @returns nothing
+ * range_expr -> bitOr_expr ( ".." bitOr_expr (":" expr)? )?
+ * Parses a range expression. The syntax for a range expression is
+ * [start..stop] or [start..stop:step], where the step defaults to nil.
+ * @param parser The parser object used for parsing.
+ * @return The expression node.
  */
-static void range_expr(parser_t *parser)
+static node_t *range_expr(parser_t *parser)
 {
-    bitOr_expr(parser);
-    if (match(parser, TK_DBDOTS))
-    {
-        token_t op_token = previous(parser);
-        bitOr_expr(parser);
-        if (match(parser, TK_COLON))
-            expr(parser); // parse the step
-        else
-            emit(parser->comp, OP_PUSH_NIL);
-        set_pos(parser, op_token);
-        // generate the bytecode for the range expression here
-        emit(parser->comp, OP_PUSH_RANGE);
-    }
+    node_t *from = bitOr_expr(parser);
+    if (!match(parser, TK_DBDOTS))
+        return from;
+
+    node_t *range = node(parser, NODE_RANGE, previous(parser));
+    range->data.range.from = from;
+    range->data.range.to = bitOr_expr(parser);
+    if (match(parser, TK_COLON))
+        range->data.range.step = expr(parser); // parse the step
+    return range;
 }
 
 /**
  * bitOr_expr -> xor_expr ( "|" xor_expr )*
  * Parses a bitwise OR expression.
- * @returns nothing
+ * @param parser The parser object used for parsing.
+ * @return The expression node.
  */
-static void bitOr_expr(parser_t *parser)
+static node_t *bitOr_expr(parser_t *parser)
 {
-    xor_expr(parser);
+    node_t *left = xor_expr(parser);
     while (match(parser, TK_BITOR))
     {
         token_t op_token = previous(parser);
-        xor_expr(parser);
-        set_pos(parser, op_token);
-        // generate the bytecode for the binary expression here
-        emit_8u(parser->comp, OP_BINARY, bin_ops[9], 9);
+        left = binary(parser, OP_BINARY, 9, op_token, left, xor_expr(parser));
     }
+    return left;
 }
 
 /**
  * xor_expr -> bitAnd_expr ( "^" bitAnd_expr )*
  * Parses a bitwise XOR expression.
- * @returns nothing
+ * @param parser The parser object used for parsing.
+ * @return The expression node.
  */
-static void xor_expr(parser_t *parser)
+static node_t *xor_expr(parser_t *parser)
 {
-    bitAnd_expr(parser);
+    node_t *left = bitAnd_expr(parser);
     while (match(parser, TK_XOR))
     {
         token_t op_token = previous(parser);
-        bitAnd_expr(parser);
-        set_pos(parser, op_token);
-        // generate the bytecode for the binary expression here
-        emit_8u(parser->comp, OP_BINARY, bin_ops[10], 10);
+        left = binary(parser, OP_BINARY, 10, op_token, left, bitAnd_expr(parser));
     }
+    return left;
 }
 
 /**
  * bitAnd_expr -> shift_expr ( "&" shift_expr )*
  * Parses a bitwise AND expression.
- * @returns nothing
+ * @param parser The parser object used for parsing.
+ * @return The expression node.
  */
-static void bitAnd_expr(parser_t *parser)
+static node_t *bitAnd_expr(parser_t *parser)
 {
-    shift_expr(parser);
+    node_t *left = shift_expr(parser);
     while (match(parser, TK_BITAND))
     {
         token_t op_token = previous(parser);
-        shift_expr(parser);
-        set_pos(parser, op_token);
-        // generate the bytecode for the binary expression here
-        emit_8u(parser->comp, OP_BINARY, bin_ops[8], 8);
+        left = binary(parser, OP_BINARY, 8, op_token, left, shift_expr(parser));
     }
+    return left;
 }
 
 /**
  * shift_expr -> equality_expr (("<<" | ">>" | ">>>") equality_expr)*
  * Parses a shift expression, which allows shifting bits to the left or right.
  * The supported operators are <<, >>, and >>> for left, right, and unsigned right shifts respectively.
- * Emits the corresponding bytecode for the parsed expression.
+ * @param parser The parser object used for parsing.
+ * @return The expression node.
  */
-static void shift_expr(parser_t *parser)
+static node_t *shift_expr(parser_t *parser)
 {
-    equality_expr(parser); // Parse the initial equality expression
+    node_t *left = equality_expr(parser); // Parse the initial equality expression
 
     // Loop to handle multiple shift operations
     while (match_n(parser, 3, TK_LSHIFT, TK_RSHIFT, TK_URSHIFT))
     {
-        tk_type op = previous(parser).type; // Get the shift operator
-        token_t op_token = previous(parser);
-        equality_expr(parser); // Parse the right-hand side expression
-        set_pos(parser, op_token);
+        token_t op_token = previous(parser); // Get the shift operator
 
-        // Emit the bytecode for the corresponding shift operation
-        switch (op)
-        {
-        case TK_LSHIFT:
-            emit_8u(parser->comp, OP_BINARY, bin_ops[11], 11); // Emit bytecode for <<
-            break;
-        case TK_RSHIFT:
-            emit_8u(parser->comp, OP_BINARY, bin_ops[12], 12); // Emit bytecode for >>
-            break;
-        case TK_URSHIFT:
-            emit_8u(parser->comp, OP_BINARY, bin_ops[13], 13); // Emit bytecode for >>>
-            break;
-        default:
-            break;
-        }
+        // The index of the <<, >> or >>> operator
+        int index = op_token.type == TK_LSHIFT ? 11 : op_token.type == TK_RSHIFT ? 12 : 13;
+        left = binary(parser, OP_BINARY, index, op_token, left, equality_expr(parser));
     }
+    return left;
 }
 
 /**
- * equality_expr -> compare_expr (("!=" | "==" | "is") compare_expr)*
- * Parses an equality expression, which is an expression that compares two
- * values for equality or inequality. The equality operators are != and ==.
- * Emits the corresponding bytecode for the parsed expression.
+ * equality_expr -> compare_expr ("is" compare_expr)*
+ * Parses a type test. "==" and "!=" chain like the other comparisons
+ * (see compare_expr).
+ * @param parser The parser object used for parsing.
+ * @return The expression node.
  */
-
-static void equality_expr(parser_t *parser)
+static node_t *equality_expr(parser_t *parser)
 {
-    compare_expr(parser);
-    while (match_n(parser, 3, TK_NOT_EQUAL, TK_EQUAL, TK_IS))
+    node_t *left = compare_expr(parser);
+    while (match(parser, TK_IS))
     {
-        tk_type op = previous(parser).type;
         token_t op_token = previous(parser);
-        compare_expr(parser);
-        set_pos(parser, op_token);
-
-        if (op == TK_NOT_EQUAL)
-            // !=
-            emit_8u(parser->comp, OP_COMPARE, comp_ops[3], 3);
-
-        else if (op == TK_EQUAL)
-            // ==
-            emit_8u(parser->comp, OP_COMPARE, comp_ops[2], 2);
-
-        else if (op == TK_IS)
-            // is
-            emit_8u(parser->comp, OP_BINARY, bin_ops[15], 15);
+        left = binary(parser, OP_BINARY, 15, op_token, left, compare_expr(parser));
     }
+    return left;
 }
 
 /**
- * compare_expr -> add_expr ((">" | "<" | ">=" | "<=") add_expr)*
+ * compare_expr -> add_expr (("==" | "!=" | ">" | "<" | ">=" | "<=") add_expr)*
  * Parses a comparison expression, which is an expression that compares two
- * values. The comparison operators are >, <, >=, and <=. Emits the corresponding
- * bytecode for the parsed expression.
- * @returns nothing
+ * values. Comparisons chain: "a < b < c" is "a < b and b < c", with both
+ * comparisons sharing the node of b.
+ * @param parser The parser object used for parsing.
+ * @return The expression node.
  */
-static void compare_expr(parser_t *parser)
+static node_t *compare_expr(parser_t *parser)
 {
     // Parse the first expression (e.g., 'a' in 'a < b < c')
-    add_expr(parser);
-
-    // Store the current token position so we can reparse intermediate values
-    int last_value_pos = -1;
-    int comparison_count = 0;
+    node_t *left = add_expr(parser);
+    node_t *chain = NULL;
 
     while (match_n(parser, 6, TK_EQUAL, TK_NOT_EQUAL, TK_GREATER,
                    TK_LESS, TK_GREATER_EQUAL, TK_LESS_EQUAL))
     {
-        tk_type op = previous(parser).type;
         token_t op_token = previous(parser);
 
-        if (last_value_pos != -1)
-        {
-            // Rewind and reparse the previous right-hand side (e.g., `b`)
-            parser->current = last_value_pos;
-            add_expr(parser); // push `b` again
-            next(parser);     // advance past the operator
-        }
-
-        // Save position before parsing the next expression (e.g., `c`)
-        last_value_pos = parser->current;
-        add_expr(parser); // parse right-hand side
-        set_pos(parser, op_token);
-
-        // Emit the comparison operator
-        int op_index = -1;
-        switch (op)
+        int index = -1;
+        switch (op_token.type)
         {
         case TK_EQUAL:
-            op_index = 0;
+            index = 0;
             break;
         case TK_NOT_EQUAL:
-            op_index = 1;
+            index = 1;
             break;
         case TK_GREATER:
-            op_index = 2;
+            index = 2;
             break;
         case TK_LESS:
-            op_index = 3;
+            index = 3;
             break;
         case TK_GREATER_EQUAL:
-            op_index = 4;
+            index = 4;
             break;
         case TK_LESS_EQUAL:
-            op_index = 5;
+            index = 5;
             break;
         default:
             break;
         }
-        emit_8u(parser->comp, OP_COMPARE, comp_ops[op_index], op_index);
 
-        // If this is not the first comparison, chain it with an AND
-        if (comparison_count > 0)
-            emit_8u(parser->comp, OP_BINARY, bin_ops[5], 5); // logical AND
+        node_t *right = add_expr(parser);
+        node_t *compare = binary(parser, OP_COMPARE, index, op_token, left, right);
 
-        comparison_count++;
+        // If this is not the first comparison, chain it with an AND
+        chain = chain == NULL ? compare : binary(parser, OP_BINARY, 5, op_token, chain, compare);
+        left = right;
     }
+
+    return chain != NULL ? chain : left;
 }
 
 /**
- * add_expr -> mult_expr (("+" | "-") mult_expr)*
+ * add_expr -> dot_expr (("+" | "-") dot_expr)*
  * Parses an addition expression, which is an expression that adds or subtracts
  * two values. The syntax for an addition expression is [value1 + value2] or
- * [value1 - value2]. Emits the corresponding bytecode for the parsed
- * expression.
- * @returns nothing
+ * [value1 - value2].
+ * @param parser The parser object used for parsing.
+ * @return The expression node.
  */
-static void add_expr(parser_t *parser)
+static node_t *add_expr(parser_t *parser)
 {
-    dot_expr(parser); // 👈 changed from mult_expr()
+    node_t *left = dot_expr(parser);
     while (match_n(parser, 2, TK_PLUS, TK_MINUS))
     {
-
         token_t op = previous(parser);
-        dot_expr(parser); // 👈 changed from mult_expr()
-        set_pos(parser, op);
-        if (op.type == TK_PLUS)
-            emit_8u(parser->comp, OP_BINARY, bin_ops[0], 0);
-        else
-            emit_8u(parser->comp, OP_BINARY, bin_ops[1], 1);
+        left = binary(parser, OP_BINARY, op.type == TK_PLUS ? 0 : 1, op, left, dot_expr(parser));
     }
+    return left;
 }
 
 /**
- * dot_expr -> mult_expr ( "." mult_expr )*
+ * dot_expr -> mult_expr ( ".*" mult_expr )*
  * Parses a dot product expression, which is an expression that takes the dot
- * product of two values. The syntax for a dot product expression is
- * [value1 . value2]. Emits the corresponding bytecode for the parsed
- * expression.
- * @returns nothing
+ * product of two values.
+ * @param parser The parser object used for parsing.
+ * @return The expression node.
  */
-static void dot_expr(parser_t *parser)
+static node_t *dot_expr(parser_t *parser)
 {
-    mult_expr(parser); // Parse the left-hand side of the dot product
+    node_t *left = mult_expr(parser); // Parse the left-hand side of the dot product
     while (match(parser, TK_DOT_PROD))
     {
-        token_t op = previous(parser);                     // Save the dot product operator
-        mult_expr(parser);                                 // Parse the right-hand side of the dot product
-        set_pos(parser, op);                               // Set the position to the dot product operator
-        emit_8u(parser->comp, OP_BINARY, bin_ops[14], 14); // Emit the bytecode
+        token_t op = previous(parser); // Save the dot product operator
+        left = binary(parser, OP_BINARY, 14, op, left, mult_expr(parser));
     }
+    return left;
 }
 
 /**
@@ -1658,35 +1284,21 @@ static void dot_expr(parser_t *parser)
  * Parses a multiplication expression, which is an expression that multiplies,
  * divides, or takes the modulus of two values. The syntax for a multiplication
  * expression is [value1 * value2], [value1 / value2], or [value1 % value2].
- * Emits the corresponding bytecode for the parsed expression.
- * @returns nothing
+ * @param parser The parser object used for parsing.
+ * @return The expression node.
  */
-static void mult_expr(parser_t *parser)
+static node_t *mult_expr(parser_t *parser)
 {
-    exp_expr(parser);
+    node_t *left = exp_expr(parser);
     while (match_n(parser, 3, TK_MULT, TK_DIV, TK_MOD))
     {
         token_t op = previous(parser);
-        exp_expr(parser);
-        set_pos(parser, op);
-        switch (op.type)
-        {
-        case TK_MULT:
-            // Emit bytecode for the * operator
-            emit_8u(parser->comp, OP_BINARY, bin_ops[2], 2);
-            break;
-        case TK_DIV:
-            // Emit bytecode for the / operator
-            emit_8u(parser->comp, OP_BINARY, bin_ops[3], 3);
-            break;
-        case TK_MOD:
-            // Emit bytecode for the % operator
-            emit_8u(parser->comp, OP_BINARY, bin_ops[4], 4);
-            break;
-        default:
-            break;
-        }
+
+        // The index of the *, / or % operator
+        int index = op.type == TK_MULT ? 2 : op.type == TK_DIV ? 3 : 4;
+        left = binary(parser, OP_BINARY, index, op, left, exp_expr(parser));
     }
+    return left;
 }
 
 /**
@@ -1695,736 +1307,451 @@ static void mult_expr(parser_t *parser)
  * that can be followed by one or more exponentiation operations.
  * The right-hand side of the "**" operator is recursively parsed as another
  * exponentiation expression.
+ * @param parser The parser object used for parsing.
+ * @return The expression node.
  */
-static void exp_expr(parser_t *parser)
+static node_t *exp_expr(parser_t *parser)
 {
-    unary_expr(parser);             // Parse the base unary expression
-    while (match(parser, TK_POWER)) // Check for the exponentiation operator
+    node_t *left = unary_expr(parser); // Parse the base unary expression
+    while (match(parser, TK_POWER))    // Check for the exponentiation operator
     {
         token_t op = previous(parser);
-        exp_expr(parser); // Recursively parse the exponent
-        set_pos(parser, op);
-        emit_8u(parser->comp, OP_BINARY, bin_ops[7], 7); // Emit bytecode for exponentiation
+        left = binary(parser, OP_BINARY, 7, op, left, exp_expr(parser)); // Recursively parse the exponent
     }
+    return left;
 }
 
 /**
- * unary_expr -> ("+" | "-" | "!" | "~" | "#" | "++" | "--" | "typeof")? member_expr
+ * Creates an increment or decrement node.
+ *
+ * @param parser The parser object used for parsing.
+ * @param op_token The "++" or "--" token.
+ * @param target The variable, field or item updated.
+ * @param operand The token the error is reported at if nothing can be stored to the target.
+ * @param prefix True for ++x, false for x++.
+ * @return The update node.
+ */
+static node_t *update(parser_t *parser, token_t op_token, node_t *target, token_t operand, bool prefix)
+{
+    // Disallow applying ++ or -- to calls and literals
+    if (!is_assignable(target))
+        p_error("Increment/Decrement operations cannot be applied to calls or literals.",
+                operand.line, operand.column);
+
+    node_t *inc = node(parser, NODE_UPDATE, op_token);
+    inc->data.update.op = op_token.type == TK_INCR ? 5 : 6;
+    inc->data.update.prefix = prefix;
+    inc->data.update.target = target;
+    return inc;
+}
+
+/**
+ * unary_expr -> ("+" | "-" | "!" | "~" | "#" | "++" | "--" | "typeof")? member_expr ("++" | "--")?
  * An unary expression is a single value that can be either a primary (e.g.
  * a number, a string) or a single-expression expression (e.g. a variable, a
- * function call). The value of the unary expression is the value of the
- * expression.
+ * function call), with an optional prefix or postfix operator.
+ * @param parser The parser object used for parsing.
+ * @return The expression node.
  */
-static void unary_expr(parser_t *parser)
+static node_t *unary_expr(parser_t *parser)
 {
-    tk_type op;
-    int current;
-
     if (match_n(parser, 8, TK_PLUS, TK_MINUS, TK_NOT, TK_BITNEG, TK_HASH, TK_INCR, TK_DECR, TK_TYPEOF))
     {
-        op = previous(parser).type;
         token_t op_token = previous(parser);
+        tk_type op = op_token.type;
 
         // Handle negative number literals directly
         if (op == TK_MINUS && peek(parser).type == TK_NUM)
         {
             parser->tokens[parser->current].is_negative = true;
-            member_expr(parser);
-            return;
+            return member_expr(parser);
         }
 
-        // Pre-increment / Pre-decrement or other unary ops
-        current = parser->current;
-        member_expr(parser);
-        set_pos(parser, op_token);
+        node_t *operand = member_expr(parser);
 
+        // Pre-increment / Pre-decrement
         if (op == TK_INCR || op == TK_DECR)
-        {
-            token_t target = previous(parser);
-
-            // Disallow applying ++ or -- to literals
-            if (target.type == TK_NUM || target.type == TK_STR || target.type == TK_TRUE ||
-                target.type == TK_FALSE || target.type == TK_NIL)
-                p_error("Increment/Decrement operations cannot be applied to calls or literals.",
-                        target.line, target.column);
+            return update(parser, op_token, operand, previous(parser), true);
 
-            int type = (op == TK_INCR) ? 5 : 6;
-            emit_8u(parser->comp, OP_UNARY, unary_ops[type], type);
-            emit(parser->comp, OP_DUP_TOP);
-
-            parser->current = current;
-            parser->is_store = true;
-            member_expr(parser);
-        }
-        else
+        int type = -1;
+        switch (op)
         {
-            int type = -1;
-            switch (op)
-            {
-            case TK_PLUS:
-                type = 0;
-                break;
-            case TK_MINUS:
-                type = 1;
-                break;
-            case TK_NOT:
-                type = 2;
-                break;
-            case TK_BITNEG:
-                type = 3;
-                break;
-            case TK_HASH:
-                type = 4;
-                break;
-            case TK_TYPEOF:
-                type = 7;
-                break;
-            default:
-                break;
-            }
-            if (type != -1)
-                emit_8u(parser->comp, OP_UNARY, unary_ops[type], type);
+        case TK_PLUS:
+            type = 0;
+            break;
+        case TK_MINUS:
+            type = 1;
+            break;
+        case TK_NOT:
+            type = 2;
+            break;
+        case TK_BITNEG:
+            type = 3;
+            break;
+        case TK_HASH:
+            type = 4;
+            break;
+        case TK_TYPEOF:
+            type = 7;
+            break;
+        default:
+            break;
         }
-    }
-    else
-    {
-        current = parser->current;
-        member_expr(parser);
-        token_t operand = previous(parser);
 
-        // Handle post-increment / post-decrement
-        if (match_n(parser, 2, TK_INCR, TK_DECR))
-        {
-            op = previous(parser).type;
-            token_t op_token = previous(parser);
-
-            if (operand.type == TK_NUM || operand.type == TK_STR || operand.type == TK_TRUE ||
-                operand.type == TK_FALSE || operand.type == TK_NIL)
-                p_error("Increment/Decrement operations cannot be applied to literals.",
-                        operand.line, operand.column);
+        node_t *unary = node(parser, NODE_UNARY, op_token);
+        unary->data.unary.op = type;
+        unary->data.unary.operand = operand;
+        return unary;
+    }
 
-            emit(parser->comp, OP_DUP_TOP);
-            set_pos(parser, op_token);
+    node_t *operand = member_expr(parser);
+    token_t last = previous(parser);
 
-            int type = (op == TK_INCR) ? 5 : 6;
-            emit_8u(parser->comp, OP_UNARY, unary_ops[type], type);
+    // Handle post-increment / post-decrement
+    if (match_n(parser, 2, TK_INCR, TK_DECR))
+        return update(parser, previous(parser), operand, last, false);
 
-            parser->current = current;
-            parser->is_store = true;
-            member_expr(parser);
-            advance(parser); // Skip over the ++ or --
-        }
-    }
+    return operand;
 }
 
 /**
  * slice_expr -> (expr? ":" expr? (":" expr?)?)?
- * Parses a slice expression, which is a form of indexing a list or tuple.
- * The syntax for a slice expression is [start:stop:step], where start, stop, and
- * step are optional and default to 0, the size of the list, and 1, respectively.
- * @returns nothing
+ * Parses the index of an item access, or a slice. The syntax for a slice
+ * expression is [start:stop:step], where start, stop, and step are optional
+ * and default to 0, the size of the list, and 1, respectively.
+ * @param parser The parser object used for parsing.
+ * @param index The index node the parts are stored in.
  */
-static bool slice_expr(parser_t *parser)
+static void slice_expr(parser_t *parser, node_t *index)
 {
-    int index;
-    bool is_slice = false;
     token_t token = peek(parser); // position marking for error reporting
 
-    // Handle the start of the slice
-    if (check(parser, TK_COLON))
-    {
-        // If the start is missing, assume 0
-        index = store_const(parser->comp, NEW_NUM(0));
-        emit_16u(parser->comp, OP_LOAD_CONST, "0", index);
-        is_slice = true;
-    }
-    else
-        cond_expr(parser); // Parse start expression
+    // Handle the start of the slice, 0 if missing
+    if (!check(parser, TK_COLON))
+        index->data.index.start = cond_expr(parser); // Parse start expression
 
     // Check for the first colon (start:end)
     if (match(parser, TK_COLON))
     {
-        is_slice = true;
+        index->data.index.is_slice = true;
         token = previous(parser);
 
-        // Handle the end expression
+        // Handle the end expression, the end of the list if missing
         if (!check(parser, TK_RBRACKET) && !check(parser, TK_COLON))
-            cond_expr(parser);
-        else
-        {
-            // If the end is missing, assume infinity
-            emit_16u(parser->comp, OP_LOAD_CONST, "inf", 1);
-        }
+            index->data.index.stop = cond_expr(parser);
 
-        // Check for the second colon (start:end:step)
-        if (match(parser, TK_COLON))
-        {
-            // Handle the step expression
-            if (!check(parser, TK_RBRACKET))
-                cond_expr(parser);
-            else
-            {
-                // If the step is missing, assume 1
-                index = store_const(parser->comp, NEW_NUM(1));
-                emit_16u(parser->comp, OP_LOAD_CONST, "1", index);
-            }
-        }
-        else
-        {
-            // If step colon is missing, assume 1
-            index = store_const(parser->comp, NEW_NUM(1));
-            emit_16u(parser->comp, OP_LOAD_CONST, "1", index);
-        }
-
-        set_pos(parser, token); // Set the position to the start of the slice
-        // Emit the slice operation
-        emit(parser->comp, OP_PUSH_SLICE);
+        // Check for the second colon (start:end:step), 1 if missing
+        if (match(parser, TK_COLON) && !check(parser, TK_RBRACKET))
+            index->data.index.step = cond_expr(parser);
     }
 
-    return is_slice;
+    index->data.index.colon = token_pos(token);
 }
 
 /**
  * Parses a member expression, which is an expression that accesses a property
  * or method of an object. A member expression can include property access
  * using a dot (.) or bracket ([]) notation, as well as function calls.
- * @returns nothing
+ *
+ * Every node of the chain records its last token in `end`: the instructions
+ * that follow it are reported there.
+ * @param parser The parser object used for parsing.
+ * @return The expression node.
  */
-static void member_expr(parser_t *parser)
+static node_t *member_expr(parser_t *parser)
 {
-    primary(parser); // Parse the primary expression (e.g., variable or literal)
+    node_t *expr_node = primary(parser); // Parse the primary expression (e.g., variable or literal)
+    expr_node->end = token_pos(previous(parser));
 
     while (true)
     {
+        node_t *member;
         token_t token = previous(parser);
 
-        set_pos(parser, token);
         if (match(parser, TK_DOT))
         {
-            token_t token = previous(parser); // For position tracking
             // Handle property access using dot notation
             token_t name = consume(parser, TK_ID, "Expect property name after '.'");
 
-            int index = store_const(parser->comp, new_value(name)); // Store the property name as a constant
-            emit_16u(parser->comp, OP_LOAD_CONST, token_value(name), index);
-
-            if (is_assign(parser))
-                emit(parser->comp, OP_SET_ITEM); // Emit bytecode to set the property value
-            else
-                emit(parser->comp, OP_GET_ITEM); // Emit bytecode to get the property value
+            member = node(parser, NODE_FIELD, token);
+            member->data.field.object = expr_node;
+            member->data.field.name = ast_name(parser->ast, name);
         }
         else if (match(parser, TK_LBRACKET))
         {
-            token_t token = previous(parser);
-            bool is_slice = slice_expr(parser); // Parse the index expression
+            member = node(parser, NODE_INDEX, token);
+            member->data.index.object = expr_node;
+            slice_expr(parser, member); // Parse the index expression
             consume(parser, TK_RBRACKET, "Expect ']' after list index expression");
-
-            if (is_slice && is_assign(parser))
-                p_error("Cannot assign to slice", peek(parser).line, peek(parser).column);
-
-            if (!is_slice)
-            {
-                bool assign = is_assign(parser);
-                emit(parser->comp, assign ? OP_SET_ITEM : OP_GET_ITEM);
-            }
         }
-
         // handle function call
         else if (match(parser, TK_LPAREN))
         {
-            int args = 0;
-            // Handle function call
-            // Call expression logic goes here
+            member = node(parser, NODE_CALL, token);
+            member->data.call.callee = expr_node;
+
             if (!check(parser, TK_RPAREN))
             {
-                expr(parser);
-                args++;
-                while (match(parser, TK_COMMA))
-                {
-                    expr(parser);
-                    args++;
-                }
+                do
+                    node_add(parser->ast, &member->data.call.args, expr(parser));
+                while (match(parser, TK_COMMA));
             }
-            token_t _token = consume(parser, TK_RPAREN, "Expect ')' after function call");
-            set_pos(parser, _token);
-            char *name = strcmp(token_value(token), ")") == 0 ? "<FUN>" : token_value(token);
-            emit_8u(parser->comp, OP_CALL_FUNCTION, name, (byte)args);
+
+            // The call is reported at its ')'
+            token_t rparen = consume(parser, TK_RPAREN, "Expect ')' after function call");
+            member->pos = token_pos(rparen);
         }
         else
             break; // Exit the loop if no member expression is found
+
+        member->end = token_pos(previous(parser));
+        expr_node = member;
     }
+
+    return expr_node;
 }
 
-// Helper to parse the body of an arrow functionstatic void arrow_func(parser_t *parser)
-static void arrow_func(parser_t *parser)
+/**
+ * Parses the body of an arrow function, after its '->': a block, or an
+ * expression whose value is returned.
+ * @param parser The parser object used for parsing.
+ * @param fn The arrow function.
+ */
+static void arrow_func(parser_t *parser, node_t *fn)
 {
     if (match(parser, TK_LBRACE))
     {
-        token_t token = previous(parser); // Save position for setting later
+        fn->data.func.lbrace = token_pos(previous(parser)); // Save position for setting later
 
-        if (check(parser, TK_RBRACE))
-        {
-            set_pos(parser, token); // Set position at '{' for empty arrow block
+        while (!check(parser, TK_RBRACE) && !is_atEnd(parser))
+            node_add(parser->ast, &fn->data.func.body, declaration(parser));
 
-            if (is_constructor(parser->comp))
-                emit_8u(parser->comp, OP_LOAD_LOCAL, "this", 0);
-            else
-                emit(parser->comp, OP_PUSH_NIL);
+        fn->data.func.rbrace = token_pos(peek(parser));
+        consume(parser, TK_RBRACE, "Expect '}' after function body.");
+    }
+    else
+    {
+        fn->data.func.lbrace = token_pos(peek(parser)); // The start of the expression
+        fn->data.func.expr = expr(parser);
+    }
+}
 
-            emit(parser->comp, OP_RETURN);
-            parser->is_return = true;
-        }
-        else
-        {
-            while (!check(parser, TK_RBRACE) && !is_atEnd(parser))
-                declaration(parser);
-        }
+/**
+ * Checks if the '(' just consumed opens the parameters of an arrow
+ * function: its matching ')' is followed by '->'.
+ * @param parser The parser object used for parsing.
+ * @return True for an arrow function, false for a grouped expression.
+ */
+static bool is_arrowParams(parser_t *parser)
+{
+    int depth = 1;
+    for (int i = parser->current; parser->tokens[i].type != TK_EOF; i++)
+    {
+        if (parser->tokens[i].type == TK_LPAREN)
+            depth++;
+        else if (parser->tokens[i].type == TK_RPAREN && --depth == 0)
+            return parser->tokens[i + 1].type == TK_RARROW;
+    }
+    return false;
+}
+
+/**
+ * Parses an object literal after its '{'. Keys are names, strings, numbers
+ * or booleans; a key followed by '(' is a method.
+ * @param parser The parser object used for parsing.
+ * @return The object node.
+ */
+static node_t *object(parser_t *parser)
+{
+    node_t *obj = node(parser, NODE_OBJECT, previous(parser));
+    int capacity = 0;
 
-        if (!parser->is_return)
+    parser->objects++;
+    if (!match(parser, TK_RBRACE))
+    {
+        do
         {
-            token_t token = peek(parser); // Set position before final return
+            token_t key_token = peek(parser);
+            if (!match_n(parser, 5, TK_STR, TK_ID, TK_NUM, TK_FALSE, TK_TRUE))
+                p_error("Unexpected key expression.", key_token.line, key_token.column);
 
-            set_pos(parser, token);
+            char *key = ast_name(parser->ast, key_token);
+            node_t *value;
 
-            if (is_constructor(parser->comp))
-                emit_8u(parser->comp, OP_LOAD_LOCAL, "this", 0);
+            if (match(parser, TK_LPAREN))
+            {
+                // A method: a function with the key as its name
+                value = function(parser, FUNC_METHOD, previous(parser), key);
+                value->data.func.params_pos = token_pos(previous(parser));
+                param_list(parser, value);
+                consume(parser, TK_RPAREN, "Expect ')' before function body.");
+                consume(parser, TK_LBRACE, "Expect '{' before function body.");
+                function_body(parser, value);
+            }
             else
-                emit(parser->comp, OP_PUSH_NIL);
+            {
+                if (strcmp(key, "constructor") == 0)
+                    p_error("Constructor is a reserved keyword.", peek(parser).line, peek(parser).column);
+                consume(parser, TK_COLON, "Expect ':' after object key expression.");
+                value = cond_expr(parser);
+            }
 
-            emit(parser->comp, OP_RETURN);
-            parser->is_return = false;
-        }
+            // Keys are kept next to their values
+            int size = obj->data.object.values.size;
+            if (size == capacity)
+            {
+                capacity = capacity == 0 ? 4 : capacity * 2;
+                char **keys = ast_alloc(parser->ast, capacity * sizeof(char *));
+                if (size > 0)
+                    memcpy(keys, obj->data.object.keys, size * sizeof(char *));
+                obj->data.object.keys = keys;
+            }
+            obj->data.object.keys[size] = key;
+            node_add(parser->ast, &obj->data.object.values, value);
+        } while (match(parser, TK_COMMA) && !check(parser, TK_RBRACE)); // Allow trailing comma
 
-        token_t rbrace = consume(parser, TK_RBRACE, "Expect '}' after function body.");
-        set_pos(parser, rbrace); // Set position at '}'
+        consume(parser, TK_RBRACE, "Expect '}' at the end of map literal.");
     }
-    else
-    {
-        token_t token = peek(parser); // Likely the token just before expression
-        expr(parser);
+    parser->objects--;
 
-        set_pos(parser, token); // Set position of single-expression arrow function
-        emit(parser->comp, OP_RETURN);
-    }
+    return obj;
 }
 
 /**
- * primary -> NUMBER | STRING | "true" | "false" | "nil" | "(" expr ")" |
+ * primary -> NUMBER | STRING | "true" | "false" | "nil" | "inf" | "nan" | "(" expr ")" |
+ *            IDENT | IDENT "->" body | IDENT "<-" cond_expr | "(" params ")" "->" body |
+ *            "[" list "]" | "{" object "}" | "fun" "(" params ")" "{" body "}"
  * Parses a primary expression, which could be a literal, a grouped expression,
- * a variable, a list literal, or a map literal. Emits the corresponding bytecode
- * for the parsed expression.
+ * a variable, a list literal, a map literal or a function.
+ * @param parser The parser object used for parsing.
+ * @return The expression node.
  */
-static void primary(parser_t *parser)
+static node_t *primary(parser_t *parser)
 {
     // Check for literal values (numbers, strings, boolean, nil)
     if (match_n(parser, 7, TK_NUM, TK_STR, TK_TRUE, TK_FALSE, TK_NIL, TK_INF, TK_NAN))
     {
         token_t token = previous(parser);
-        set_pos(parser, token);
+        node_t *literal = node(parser, NODE_LITERAL, token);
 
         if (token.type == TK_NAN)
-            emit_16u(parser->comp, OP_LOAD_CONST, "NAN", 0);
+            literal->data.literal.value = NEW_NUM(NAN);
         else if (token.type == TK_INF)
-            emit_16u(parser->comp, OP_LOAD_CONST, "INF", 0);
+            literal->data.literal.value = NEW_NUM(INFINITY);
         else
-        {
-            int index = store_const(parser->comp, new_value(token));
-            // Emit bytecode to load the constant value
-            emit_16u(parser->comp, OP_LOAD_CONST, token_value(token), index);
-        }
+            literal->data.literal.value = new_value(token);
+        return literal;
     }
-    // Check for grouped expressions
-    else if (match(parser, TK_LPAREN))
+
+    // Check for grouped expressions and arrow functions
+    if (match(parser, TK_LPAREN))
     {
-        int _current = parser->current;
-        set_pos(parser, previous(parser));
+        token_t lparen = previous(parser);
 
-        if (is_lookUp(parser->comp))
+        if (!is_arrowParams(parser))
         {
-            int depth = 1;
-            while (depth > 0 && !is_atEnd(parser))
-            {
-                if (check(parser, TK_RPAREN))
-                    depth--;
-                else if (check(parser, TK_LPAREN))
-                    depth++;
-
-                next(parser); // Move to the next token
-            }
-
-            if (depth != 0)
-                p_error("Unmatched '(' in grouping expression.", peek(parser).line, peek(parser).column);
-
-            if (match(parser, TK_RARROW))
-            {
-                if (match(parser, TK_LBRACE))
-                {
-                    depth = 1;
-                    while (depth > 0 && !is_atEnd(parser))
-                    {
-                        if (check(parser, TK_RBRACE))
-                            depth--;
-                        else if (check(parser, TK_LBRACE))
-                            depth++;
-
-                        if (depth == 0)
-                            break;
-
-                        next(parser); // Move to the next token
-                    }
-
-                    if (depth != 0)
-                        p_error("Unmatched '{' in arrow function.", peek(parser).line, peek(parser).column);
-                    consume(parser, TK_RBRACE, "Expect '}' after arrow function.");
-                }
-                else
-                    expr(parser);
-            }
+            // Parse the expression inside parentheses
+            node_t *inner = assignment(parser);
+            consume(parser, TK_RPAREN, "Expect ')' after expression.");
+            return inner;
         }
-        else
-        {
-            while (!check(parser, TK_RPAREN))
-                next(parser);
-
-            next(parser);
-            // handle arrow functions
-            if (match(parser, TK_RARROW))
-            {
-                parser->current = _current;
-                list_t *params = param_list(parser);
-                int size = list_size(params);
-                consume(parser, TK_RPAREN, "Expect ')' after expression.");
-                consume(parser, TK_RARROW, "Expect '->' after function parameters.");
-
-                push_function(parser->comp, NULL);
-
-                if (is_object(parser->comp))
-                    add_local(parser->comp, "this");
-
-                for (int i = 0; i < size; i++)
-                    add_local(parser->comp, string_get(params, i));
-                add_local(parser->comp, "args");
 
-                arrow_func(parser);
-
-                pop_function(parser->comp, size + (is_object(parser->comp) ? 1 : 0));
-            }
-            else
-            {
-                parser->current = _current;
-                // Parse the expression inside parentheses
-                assignment(parser, true); // Parse the inner expression
-                consume(parser, TK_RPAREN, "Expect ')' after expression.");
-            }
-        }
+        node_t *fn = function(parser, FUNC_ARROW, lparen, NULL);
+        fn->data.func.params_pos = token_pos(lparen);
+        param_list(parser, fn);
+        consume(parser, TK_RPAREN, "Expect ')' after expression.");
+        consume(parser, TK_RARROW, "Expect '->' after function parameters.");
+        arrow_func(parser, fn);
+        return fn;
     }
+
     // Check for variable identifiers
-    else if (match(parser, TK_ID))
+    if (match(parser, TK_ID))
     {
-        char *name = tk_string(previous(parser));
-        set_pos(parser, previous(parser));
-
-        // Lookup for right-associative arrow functions or assignment chains
-        if (is_lookUp(parser->comp) && match(parser, TK_RARROW))
-        {
-            if (match(parser, TK_LBRACE))
-            {
-                int depth = 1;
-                while (depth > 0 && !is_atEnd(parser))
-                {
-                    if (check(parser, TK_RBRACE))
-                        depth--;
-                    else if (check(parser, TK_LBRACE))
-                        depth++;
-
-                    if (depth == 0)
-                        break;
-
-                    next(parser); // Move to the next token
-                }
-
-                if (depth != 0)
-                    p_error("Unmatched '{' in arrow function.", peek(parser).line, peek(parser).column);
-                consume(parser, TK_RBRACE, "Expect '}' after arrow function.");
-            }
-            else
-                expr(parser);
-
-            return;
-        }
+        token_t id = previous(parser);
 
-        // handle arrow functions
+        // handle arrow functions with a single parameter
         if (match(parser, TK_RARROW))
         {
-
-            emit(parser->comp, OP_PUSH_NIL);
-
-            if (is_object(parser->comp))
-                emit(parser->comp, OP_PUSH_NIL);
-
-            push_function(parser->comp, NULL);
-
-            if (is_object(parser->comp))
-                add_local(parser->comp, "this");
-
-            add_local(parser->comp, name);
-            add_local(parser->comp, "args");
-
-            arrow_func(parser);
-
-            pop_function(parser->comp, (is_object(parser->comp) ? 2 : 1));
+            node_t *fn = function(parser, FUNC_ARROW, id, NULL);
+            fn->data.func.params_pos = token_pos(id);
+            node_add(parser->ast, &fn->data.func.params, identifier(parser, id));
+            node_add(parser->ast, &fn->data.func.defaults, NULL);
+            arrow_func(parser, fn);
+            return fn;
         }
-        // First handle potential walrus operator
-        else if (match(parser, TK_LARROW))
-        {
 
+        // handle the walrus operator
+        if (match(parser, TK_LARROW))
+        {
             // Verify we didn't chain assignments
             if (parser->has_walrus)
                 p_error("Chained '<-' operators are not allowed",
                         peek(parser).line, peek(parser).column);
 
-            parser->has_walrus = true;
-            // Parse the right-hand side (disallow chaining)
-            cond_expr(parser); // Use expr() instead of cond_expr() to prevent chaining
+            node_t *walrus = node(parser, NODE_WALRUS, id);
+            walrus->data.walrus.target = identifier(parser, id);
 
+            parser->has_walrus = true;
+            walrus->data.walrus.value = cond_expr(parser);
             parser->has_walrus = false;
-
-            // Duplicate result on stack (if needed by your VM)
-            emit(parser->comp, OP_DUP_TOP);
-
-            // Emit store instruction for lhs variable
-            store_variable(parser->comp, name);
-
-            return;
-        }
-        else
-        {
-            if (is_assign(parser))
-                store_variable(parser->comp, name); // Handle variable assignment
-            else                                    // Load variable value
-                load_variable(parser->comp, name);
+            return walrus;
         }
+
+        return identifier(parser, id);
     }
+
     // Check for list literals
-    else if (match(parser, TK_LBRACKET))
+    if (match(parser, TK_LBRACKET))
     {
-        int size = 0;
-        set_pos(parser, previous(parser));
-        if (match(parser, TK_RBRACKET))
-            emit_16u(parser->comp, OP_PUSH_LIST, "", 0); // Emit empty list
-        else
+        node_t *list = node(parser, NODE_LIST, previous(parser));
+        if (!match(parser, TK_RBRACKET))
         {
             do
             {
-                if (!check(parser, TK_RBRACKET))
-                {
-                    cond_expr(parser); // Parse list elements
-                    size++;
-                }
-                else
-                    // Handle trailing comma case
+                // Handle trailing comma case
+                if (check(parser, TK_RBRACKET))
                     break;
-
+                node_add(parser->ast, &list->data.list.items, cond_expr(parser));
             } while (match(parser, TK_COMMA));
             consume(parser, TK_RBRACKET, "Expect ']' at the end of list literal.");
-            emit_16u(parser->comp, OP_PUSH_LIST, "", size); // Emit list with elements
         }
+        return list;
     }
-    // Check for map / object literals
-    else if (match(parser, TK_LBRACE))
-    {
-        set_pos(parser, previous(parser));
-        if (is_lookUp(parser->comp))
-        {
-            // Verify the map is a valid expression
-            int depth = 1;
-            while (depth > 0 && !is_atEnd(parser))
-            {
-                if (check(parser, TK_LBRACE))
-                    depth++;
-                else if (check(parser, TK_RBRACE))
-                    depth--;
-                next(parser);
-
-                if (depth == 0)
-                    break;
-            }
-
-            if (depth != 0)
-                p_error("Unmatched '}' in map.", peek(parser).line, peek(parser).column);
 
-            return;
-        }
-
-        token_t token = previous(parser);
-        int size = 0;
-
-        push_object(parser->comp);
-        if (match(parser, TK_RBRACE))
-        {
-            pop_object(parser->comp);
-            emit_16u(parser->comp, OP_PUSH_MAP, "", 0); // Emit empty map
-        }
-        else
-        {
-            char *key;
-            int index = 0;
-            do
-            {
-                if (match_n(parser, 5, TK_STR, TK_ID, TK_NUM, TK_FALSE, TK_TRUE))
-                {
-                    key = tk_string(previous(parser));
-                    index = store_const(parser->comp, NEW_OBJ(new_pistring(key)));
-                }
-                else
-                    p_error("Unexpected key expression.", peek(parser).line, peek(parser).column);
-
-                if (match(parser, TK_LPAREN))
-                {
-                    /**
-                     * Parse a function expression as a value in the map.
-                     * The function expression is parsed as a lambda function
-                     * so it can be used as a value in the map.
-                     */
-                    list_t *params = param_list(parser);
-                    int size = list_size(params);
-                    consume(parser, TK_RPAREN, "Expect ')' before function body.");
-                    consume(parser, TK_LBRACE, "Expect '{' before function body.");
-
-                    push_function(parser->comp, key);
-
-                    if (is_object(parser->comp))
-                        add_local(parser->comp, "this");
-
-                    for (int i = 0; i < size; i++)
-                        add_local(parser->comp, string_get(params, i));
-                    add_local(parser->comp, "args");
-
-                    // if (check(parser, TK_RBRACE))
-                    if (match(parser, TK_RBRACE))
-                    {
-                        if (is_constructor(parser->comp))
-                            emit_8u(parser->comp, OP_LOAD_LOCAL, "this", 0);
-                        else
-                            emit(parser->comp, OP_PUSH_NIL);
-                        emit(parser->comp, OP_RETURN);
-                    }
-                    else
-                    {
-                        // Parse the function body
-                        while (!check(parser, TK_RBRACE) && !is_atEnd(parser))
-                            declaration(parser);
-
-                        if (!parser->is_return)
-                        {
-                            if (is_constructor(parser->comp))
-                                emit_8u(parser->comp, OP_LOAD_LOCAL, "this", 0);
-                            else
-                                emit(parser->comp, OP_PUSH_NIL);
-                            emit(parser->comp, OP_RETURN);
-
-                            parser->is_return = false;
-                        }
-                    }
-
-                    pop_function(parser->comp, size + (is_object(parser->comp) ? 1 : 0));
-                    consume(parser, TK_RBRACE, "Expect '}' after function body.");
-                }
-                else
-                {
-                    if (strcmp(key, "constructor") == 0)
-                        p_error("Constructor is a reserved keyword.", peek(parser).line, peek(parser).column);
-                    consume(parser, TK_COLON, "Expect ':' after object key expression.");
-                    cond_expr(parser);
-                }
-
-                // Emit bytecode to load the key as a constant
-                emit_16u(parser->comp, OP_LOAD_CONST, key, index);
-                size++;
-            } while (match(parser, TK_COMMA) && !check(parser, TK_RBRACE)); // Allow trailing comma
-
-            consume(parser, TK_RBRACE, "Expect '}' at the end of map literal.");
-            pop_object(parser->comp);
-            emit_16u(parser->comp, OP_PUSH_MAP, "", size); // Emit map with key-value pairs
-        }
-    }
+    // Check for map / object literals
+    if (match(parser, TK_LBRACE))
+        return object(parser);
 
     // Parse anonymous function expressions
-    else if (match(parser, TK_FUN))
+    if (match(parser, TK_FUN))
     {
-        set_pos(parser, previous(parser));
-        /**
-         * Parses an anonymous function expression.
-         * Anonymous functions are functions that are declared without a name.
-         * They can be used as values in expressions.
-         */
-        compiler_t *comp = parser->comp;
-
-        // Function expressions
+        node_t *fn = function(parser, FUNC_EXPR, previous(parser), NULL);
+
         consume(parser, TK_LPAREN, "Expect '(' after function name.");
-        list_t *params = param_list(parser); // Parse the parameter list
-        int size = list_size(params);        // Get the number of parameters
+        fn->data.func.params_pos = token_pos(previous(parser));
+        param_list(parser, fn); // Parse the parameter list
         consume(parser, TK_RPAREN, "Expect ')' before function body.");
         consume(parser, TK_LBRACE, "Expect '{' before function body.");
-
-        push_function(comp, NULL); // Push the function onto the stack
-
-        if (is_object(comp))
-            add_local(comp, "this"); // Add the "this" variable to the local scope
-
-        // Add the parameters to the local scope
-        for (int i = 0; i < size; i++)
-            add_local(comp, string_get(params, i));
-        add_local(comp, "args"); // Add the "args" variable to the local scope
-
-        if (match(parser, TK_RBRACE))
-        {
-            // If the anonymous function expression is empty, return nil
-            if (is_constructor(comp))
-                emit_8u(comp, OP_LOAD_LOCAL, "this", 0);
-            else
-                emit(comp, OP_PUSH_NIL);
-            emit(comp, OP_RETURN);
-
-            parser->is_return = true;
-        }
-        else
-        {
-            // Parse the function body
-            while (!check(parser, TK_RBRACE) && !is_atEnd(parser))
-                declaration(parser);
-
-            if (!parser->is_return)
-            {
-                // If the anonymous function expression has a return statement
-                if (is_constructor(comp))
-                    emit_8u(comp, OP_LOAD_LOCAL, "this", 0);
-                else
-                    emit(comp, OP_PUSH_NIL);
-                emit(comp, OP_RETURN);
-
-                parser->is_return = true;
-            }
-        }
-
-        pop_function(comp, size + (is_object(parser->comp) ? 1 : 0)); // Pop the function from the stack
-
-        consume(parser, TK_RBRACE, "Expect '}' after function body.");
+        function_body(parser, fn);
+        return fn;
     }
-    else
-        p_error("Expect expression.", previous(parser).line, previous(parser).column); // Handle unexpected tokens
+
+    p_error("Expect expression.", previous(parser).line, previous(parser).column); // Handle unexpected tokens
+    return NULL;
 }
 
 /**
  * Frees the memory allocated for the parser.
  * This function releases all resources held by the parser, including tokens,
- * the associated compiler, and the parser structure itself.
+ * the syntax tree of an unfinished parse and the parser structure itself.
  *
  * @param parser the parser object to free
  */
 void free_parser(parser_t *parser)
 {
-    free(parser->tokens);        // Free the memory allocated for tokens
-    // free_compiler(parser->comp); // Free resources associated with the compiler
-    free(parser);                // Free the parser structure itself
+    if (parser->ast != NULL)
+        ast_free(parser->ast); // A parse stopped by an error keeps its tree
+    free(parser->tokens);      // Free the memory allocated for tokens
+    free(parser);              // Free the parser structure itself
 }
@@ -4,6 +4,7 @@
 #include <stdbool.h>
 #include "pi_token.h"
 #include "pi_compiler.h"
+#include "pi_ast.h"
 
 // Defines the parsing mode, which can affect how source code is interpreted.
 typedef enum
@@ -18,35 +19,20 @@ typedef enum
 typedef struct
 {
     token_t *tokens; // Array of tokens being parsed.
-    token_t last;    // Last token parsed.
     int current;     // Current token index being parsed.
-    bool access;     // Flag indicating whether access to variables is allowed.
-    bool is_store;   // Flag indicating whether a store operation is in progress.
-    bool emit_load;  // Flag indicating whether to emit a LOAD instruction.
-    bool is_assign;  // Flag indicating whether an assignment is in progress.
     bool has_walrus; // Flag indicating whether a walrus operator is in progress.
-    tk_type op;      // Type of operator being parsed (e.g. TK_PLUS, TK_MINUS, etc.).
+    int objects;     // Number of object literals being parsed around the current token.
 
     // Compiler associated with the parser
     compiler_t *comp;
 
-    bool is_return;
+    // Arena of the syntax tree being built (see pi_ast.h)
+    ast_t *ast;
 
     ParserMode mode; // The current parsing mode (file or REPL).
 
 } parser_t;
 
-/**
- * Assignment operation structure.
- */
-typedef struct
-{
-    int left;   // Index of the left-hand side of the assignment.
-    int right;  // Index of the right-hand side of the assignment.
-    tk_type op; // Type of the assignment operator (e.g. TK_ASSIGN, TK_PLUS_EQUAL, etc.).
-
-} assign_t;
-
 parser_t *init_parser(compiler_t *comp, token_t *tokens, ParserMode mode);
 void parse(parser_t *parser);
 void free_parser(parser_t *parser);
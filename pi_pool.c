@@ -0,0 +1,450 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "pi_pool.h"
+#include "pi_object.h"
+#include "common.h"
+
+// Pool of the VM running on this thread (set by pool_bind). The object
+// constructors take no vm_t, so they find their VM's pool here.
+static __thread pool_t *current = NULL;
+
+// Its address identifies the calling thread, without a call to pthread_self
+static __thread char thread_tag;
+
+/**
+ * Returns the address of a cell inside a slab.
+ *
+ * @param slab The slab holding the cell.
+ * @param size The cell size of the slab's class.
+ * @param index The index of the cell.
+ * @return A pointer to the cell, viewed as an object header.
+ */
+static inline Object *cell_at(Slab *slab, size_t size, int index)
+{
+    return (Object *)(slab->cells + (size_t)index * size);
+}
+
+/**
+ * Creates a new, empty object pool.
+ *
+ * No memory is reserved up front; slabs are allocated on first use of
+ * each size class.
+ *
+ * @return A pointer to the newly created pool.
+ */
+pool_t *pool_create(void)
+{
+    pool_t *pool = (pool_t *)calloc(1, sizeof(pool_t));
+    if (!pool)
+        error("[pool_create] Memory allocation failed.");
+
+    for (int i = 0; i < POOL_CLASSES; i++)
+        pool->classes[i].size = (size_t)(i + 1) * POOL_ALIGN;
+
+    for (int i = 0; i < POOL_BLOCK_CLASSES; i++)
+        pool->blocks[i].size = (size_t)(i + 1) * POOL_ALIGN;
+
+    pool->owner = &thread_tag;
+
+    return pool;
+}
+
+/**
+ * Frees a list of slabs.
+ *
+ * @param slab The first slab of the list.
+ */
+static void free_slabs(Slab *slab)
+{
+    while (slab)
+    {
+        Slab *next = slab->next;
+        free(slab);
+        slab = next;
+    }
+}
+
+/**
+ * Frees the header slabs of a pool, and the pool itself.
+ *
+ * @param pool The pool.
+ */
+static void free_pool(pool_t *pool)
+{
+    for (int i = 0; i < POOL_BLOCK_CLASSES; i++)
+        free_slabs(pool->blocks[i].slabs);
+
+    free(pool);
+}
+
+/**
+ * Frees the object slabs of a pool, and the pool itself.
+ *
+ * Any object still living in the pool becomes invalid. List and table
+ * headers may outlive the VM (the compiler frees its lists afterwards), so
+ * the header slabs are freed with the last of them. The collector threads
+ * must be stopped, so that no header is freed meanwhile.
+ *
+ * @param pool The pool to destroy.
+ */
+void pool_destroy(pool_t *pool)
+{
+    if (!pool)
+        return;
+
+    for (int i = 0; i < POOL_CLASSES; i++)
+    {
+        free_slabs(pool->classes[i].slabs);
+        pool->classes[i].slabs = NULL;
+        pool->classes[i].free = NULL;
+    }
+
+    if (current == pool)
+        current = NULL;
+
+    // From now on every header comes back through the remote path
+    size_t remote = __atomic_load_n(&pool->remote_frees, __ATOMIC_ACQUIRE);
+    if (pool->blocks_live == remote)
+    {
+        free_pool(pool);
+        return;
+    }
+
+    pool->blocks_live -= remote;
+    pool->owner = NULL;
+    __atomic_store_n(&pool->remote_frees, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&pool->dead, true, __ATOMIC_RELEASE);
+}
+
+/**
+ * Makes a pool the one used by object constructors on the calling thread.
+ *
+ * The calling thread becomes the pool's owner: other threads that still
+ * have it bound allocate with malloc until they bind it again.
+ *
+ * @param pool The pool to use, or NULL to allocate objects with malloc.
+ */
+void pool_bind(pool_t *pool)
+{
+    current = pool;
+    if (pool)
+        pool->owner = &thread_tag;
+}
+
+/**
+ * Returns the pool the calling thread may allocate from.
+ *
+ * @return The bound pool, or NULL if none is bound or the thread does not
+ *         own it.
+ */
+pool_t *pool_bound(void)
+{
+    return current && current->owner == &thread_tag ? current : NULL;
+}
+
+/**
+ * Adds a new slab to a size class and puts all its cells on the free list.
+ *
+ * @param cls The size class to grow.
+ */
+static void grow_class(PoolClass *cls)
+{
+    int count = (int)((POOL_SLAB_SIZE - sizeof(Slab)) / cls->size);
+
+    Slab *slab = (Slab *)malloc(sizeof(Slab) + (size_t)count * cls->size);
+    if (!slab)
+        error("[pool_alloc] Memory allocation failed.");
+
+    slab->count = count;
+    slab->next = cls->slabs;
+    cls->slabs = slab;
+    cls->slab_count++;
+
+    // Thread the cells in address order so fresh objects are laid out linearly
+    for (int i = count - 1; i >= 0; i--)
+    {
+        Object *cell = cell_at(slab, cls->size, i);
+        cell->pool_class = POOL_FREE;
+        cell->next = cls->free;
+        cls->free = cell;
+    }
+}
+
+/**
+ * Allocates memory for an object.
+ *
+ * Objects up to POOL_MAX_SIZE bytes are carved from the slabs of the pool;
+ * larger objects (or any object when no pool is given) use malloc.
+ * The `pool_class` field of the returned header records where the memory
+ * came from, so pool_free() can return it to the right place.
+ *
+ * @param pool The pool, owned by the calling thread (see pool_bound), or NULL.
+ * @param size The size of the object in bytes.
+ * @return A pointer to uninitialized memory for the object.
+ */
+Object *pool_alloc(pool_t *pool, size_t size)
+{
+    if (!pool || size > POOL_MAX_SIZE)
+    {
+        Object *obj = (Object *)malloc(size);
+        if (!obj)
+            error("[pool_alloc] Memory allocation failed.");
+
+        if (pool)
+            pool->large_allocs++;
+
+        obj->pool_class = POOL_NONE;
+        return obj;
+    }
+
+    int index = (int)((size + POOL_ALIGN - 1) / POOL_ALIGN) - 1;
+    PoolClass *cls = &pool->classes[index];
+
+    if (!cls->free)
+        grow_class(cls);
+
+    Object *obj = cls->free;
+    cls->free = obj->next;
+
+    cls->live++;
+    cls->allocs++;
+
+    obj->pool_class = (uint8_t)(index + 1);
+    return obj;
+}
+
+/**
+ * Returns the memory of an object to where it was allocated from.
+ *
+ * Objects are freed by the collector, which runs on the VM's thread.
+ *
+ * @param pool The pool of the VM that allocated the object.
+ * @param obj The object to release. Its contents must already be freed.
+ */
+void pool_free(pool_t *pool, Object *obj)
+{
+    if (obj->pool_class == POOL_NONE)
+    {
+        free(obj);
+        return;
+    }
+
+    if (obj->pool_class == POOL_FREE)
+        return; // Already released
+
+    PoolClass *cls = &pool->classes[obj->pool_class - 1];
+
+    obj->pool_class = POOL_FREE;
+    obj->next = cls->free;
+    cls->free = obj;
+
+    cls->live--;
+    cls->frees++;
+}
+
+/**
+ * Adds a new slab to a header size class and puts all its blocks on the
+ * owner's free list.
+ *
+ * @param blocks The size class to grow.
+ */
+static void grow_blocks(PoolBlocks *blocks)
+{
+    int count = (int)((POOL_SLAB_SIZE - sizeof(Slab)) / blocks->size);
+
+    Slab *slab = (Slab *)malloc(sizeof(Slab) + (size_t)count * blocks->size);
+    if (!slab)
+        error("[pool_alloc_block] Memory allocation failed.");
+
+    slab->count = count;
+    slab->next = blocks->slabs;
+    blocks->slabs = slab;
+    blocks->slab_count++;
+
+    for (int i = count - 1; i >= 0; i--)
+    {
+        void *block = slab->cells + (size_t)i * blocks->size;
+        *(void **)block = blocks->free;
+        blocks->free = block;
+    }
+}
+
+/**
+ * Allocates the header of a list or a table payload.
+ *
+ * The header must remember the pool it came from (NULL if it was taken
+ * from malloc) and hand it back to pool_free_block().
+ *
+ * @param pool The pool, owned by the calling thread (see pool_bound), or NULL.
+ * @param size The size of the header, at most POOL_BLOCK_MAX bytes.
+ * @return A pointer to uninitialized memory.
+ */
+void *pool_alloc_block(pool_t *pool, size_t size)
+{
+    if (!pool)
+    {
+        void *block = malloc(size);
+        if (!block)
+            error("[pool_alloc_block] Memory allocation failed.");
+        return block;
+    }
+
+    PoolBlocks *blocks = &pool->blocks[(size + POOL_ALIGN - 1) / POOL_ALIGN - 1];
+
+    // Take over everything other threads have freed since the last time
+    if (!blocks->free)
+        blocks->free = __atomic_exchange_n(&blocks->remote, NULL, __ATOMIC_ACQUIRE);
+
+    if (!blocks->free)
+        grow_blocks(blocks);
+
+    void *block = blocks->free;
+    blocks->free = *(void **)block;
+    blocks->allocs++;
+    pool->blocks_live++;
+
+    return block;
+}
+
+/**
+ * Releases a header allocated by pool_alloc_block(), from any thread.
+ *
+ * @param pool The pool the header came from, or NULL if it came from malloc.
+ * @param block The header.
+ * @param size The size it was allocated with.
+ */
+void pool_free_block(pool_t *pool, void *block, size_t size)
+{
+    if (!pool)
+    {
+        free(block);
+        return;
+    }
+
+    PoolBlocks *blocks = &pool->blocks[(size + POOL_ALIGN - 1) / POOL_ALIGN - 1];
+
+    if (pool->owner == &thread_tag)
+    {
+        *(void **)block = blocks->free;
+        blocks->free = block;
+        pool->blocks_live--;
+        return;
+    }
+
+    // The owner only ever takes the whole list, so a plain push is safe
+    void *head = __atomic_load_n(&blocks->remote, __ATOMIC_RELAXED);
+    do
+        *(void **)block = head;
+    while (!__atomic_compare_exchange_n(&blocks->remote, &head, block, true,
+                                        __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+
+    size_t freed = __atomic_add_fetch(&pool->remote_frees, 1, __ATOMIC_ACQ_REL);
+    if (__atomic_load_n(&pool->dead, __ATOMIC_ACQUIRE) && freed == pool->blocks_live)
+        free_pool(pool); // The last header of a destroyed pool
+}
+
+/**
+ * Rebuilds the free lists of a pool after a sweep.
+ *
+ * Free cells are re-threaded in slab address order so that the next
+ * allocations are packed together, and slabs with no live cells are
+ * returned to the system (one empty slab per class is kept as a reserve).
+ *
+ * @param pool The pool to rebuild.
+ */
+void pool_rebuild(pool_t *pool)
+{
+    for (int i = 0; i < POOL_CLASSES; i++)
+    {
+        PoolClass *cls = &pool->classes[i];
+        Object *head = NULL;
+        Object **tail = &head;
+        Slab **link = &cls->slabs;
+        bool kept_empty = false;
+
+        while (*link)
+        {
+            Slab *slab = *link;
+
+            int free_cells = 0;
+            for (int j = 0; j < slab->count; j++)
+                if (cell_at(slab, cls->size, j)->pool_class == POOL_FREE)
+                    free_cells++;
+
+            if (free_cells == slab->count && kept_empty)
+            {
+                *link = slab->next;
+                cls->slab_count--;
+                free(slab);
+                continue;
+            }
+
+            if (free_cells == slab->count)
+                kept_empty = true;
+
+            for (int j = 0; j < slab->count && free_cells > 0; j++)
+            {
+                Object *cell = cell_at(slab, cls->size, j);
+                if (cell->pool_class == POOL_FREE)
+                {
+                    *tail = cell;
+                    tail = &cell->next;
+                    free_cells--;
+                }
+            }
+
+            link = &slab->next;
+        }
+
+        *tail = NULL;
+        cls->free = head;
+    }
+}
+
+/**
+ * Returns the number of slabs a pool holds, for objects and headers.
+ *
+ * @param pool The pool.
+ * @return The slab count.
+ */
+size_t pool_slabs(pool_t *pool)
+{
+    size_t slabs = 0;
+
+    for (int i = 0; i < POOL_CLASSES; i++)
+        slabs += pool->classes[i].slab_count;
+
+    for (int i = 0; i < POOL_BLOCK_CLASSES; i++)
+        slabs += pool->blocks[i].slab_count;
+
+    return slabs;
+}
+
+/**
+ * Prints the allocation statistics of a pool, one line per size class.
+ *
+ * @param pool The pool to report on.
+ */
+void pool_print(pool_t *pool)
+{
+    printf("[POOL] class  slabs     live       allocs        frees\n");
+    for (int i = 0; i < POOL_CLASSES; i++)
+    {
+        PoolClass *cls = &pool->classes[i];
+        if (cls->allocs == 0)
+            continue;
+
+        printf("[POOL] %5zu %6zu %8zu %12zu %12zu\n",
+               cls->size, cls->slab_count, cls->live, cls->allocs, cls->frees);
+    }
+    for (int i = 0; i < POOL_BLOCK_CLASSES; i++)
+    {
+        PoolBlocks *blocks = &pool->blocks[i];
+        if (blocks->allocs == 0)
+            continue;
+
+        printf("[POOL] header %4zu %6zu %21zu\n", blocks->size, blocks->slab_count, blocks->allocs);
+    }
+    printf("[POOL] large allocations: %zu\n", pool->large_allocs);
+}
@@ -0,0 +1,83 @@
+#ifndef PI_POOL_H
+#define PI_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define POOL_ALIGN 16                             // Cell sizes are multiples of this
+#define POOL_MAX_SIZE 128                         // Larger objects fall back to malloc
+#define POOL_CLASSES (POOL_MAX_SIZE / POOL_ALIGN) // Number of size classes
+#define POOL_SLAB_SIZE (16 * 1024)                // Bytes per slab
+
+#define POOL_BLOCK_MAX 64                                // Largest list_t/table_t header kept in the pool
+#define POOL_BLOCK_CLASSES (POOL_BLOCK_MAX / POOL_ALIGN) // Number of header size classes
+
+#define POOL_NONE 0    // Object header tag: allocated with malloc
+#define POOL_FREE 0xff // Object header tag: cell is on a free list
+
+// A slab is one contiguous block carved into cells of a single size class.
+typedef struct Slab
+{
+    struct Slab *next;
+    int count;    // Number of cells in the slab
+    int _pad;     // Keeps the cells 16-byte aligned
+    char cells[]; // Cell storage
+} Slab;
+
+// Free cells and statistics of one size class.
+typedef struct
+{
+    size_t size;         // Cell size in bytes
+    Slab *slabs;         // Slabs owned by this class
+    struct Object *free; // Free list (threaded through the object header)
+
+    size_t slab_count; // Slabs currently held
+    size_t live;       // Cells currently in use
+    size_t allocs;     // Total allocations served
+    size_t frees;      // Total cells returned
+} PoolClass;
+
+// Free blocks of one size for the headers of list and table payloads.
+// Payloads are also released by the background sweeper, so a block freed
+// off the owner thread goes on `remote`, which the owner takes over whole
+// when its own list runs dry.
+typedef struct
+{
+    size_t size;  // Block size in bytes
+    Slab *slabs;  // Slabs owned by this class
+    void *free;   // Free list of the owner thread
+    void *remote; // Blocks freed by other threads (pushed atomically)
+
+    size_t slab_count; // Slabs currently held
+    size_t allocs;     // Total allocations served
+} PoolBlocks;
+
+typedef struct Pool
+{
+    PoolClass classes[POOL_CLASSES];
+    PoolBlocks blocks[POOL_BLOCK_CLASSES];
+    size_t large_allocs; // Allocations too big for any size class
+
+    const void *owner;   // Tag of the only thread that allocates from the pool (see pool_bind)
+    size_t blocks_live;  // Header blocks handed out, less those the owner got back
+    size_t remote_frees; // Header blocks freed by other threads (atomic)
+    bool dead;           // Destroyed while header blocks were still in use
+} pool_t;
+
+pool_t *pool_create(void);
+void pool_destroy(pool_t *pool);
+void pool_bind(pool_t *pool);
+pool_t *pool_bound(void);
+
+struct Object *pool_alloc(pool_t *pool, size_t size);
+void pool_free(pool_t *pool, struct Object *obj);
+void pool_rebuild(pool_t *pool);
+
+void *pool_alloc_block(pool_t *pool, size_t size);
+void pool_free_block(pool_t *pool, void *block, size_t size);
+
+size_t pool_slabs(pool_t *pool);
+void pool_print(pool_t *pool);
+
+#endif
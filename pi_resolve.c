@@ -0,0 +1,583 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "pi_resolve.h"
+#include "list.h"
+
+/*
+ * The resolver binds every name of the syntax tree before any code is
+ * generated. A name is a local of the function it is used in (its stack
+ * slot), an upvalue captured from an enclosing function, or a global. It
+ * also counts the locals each block, loop exit and for-in loop drops, and
+ * reports the scope errors: names declared twice in one block, global names
+ * declared twice, break and continue outside of a loop, and yield outside of
+ * a function.
+ */
+
+// A local variable of the function being resolved
+typedef struct
+{
+    char *name; // Variable name
+    int depth;  // Block depth the variable is declared at
+} local_t;
+
+// A loop enclosing the statements being resolved
+typedef struct
+{
+    int depth;   // Block depth of the first local of the loop
+    bool is_for; // A for-in loop, which keeps an iterator on the stack
+} loop_scope;
+
+// The scope of a function, or of the global code
+typedef struct scope_t
+{
+    struct scope_t *enclosing; // Scope of the enclosing function (NULL: global code)
+    node_t *func;              // The function (NULL: global code)
+    list_t *locals;            // Locals in stack slot order (see local_t)
+    list_t *captures;          // Upvalues in capture order (see capture_t)
+    list_t *loops;             // Enclosing loops of the function (see loop_scope)
+    int depth;                 // Current block depth
+} scope_t;
+
+typedef struct
+{
+    compiler_t *comp; // Compiler the global names are stored in
+    ast_t *ast;       // Arena of the tree, for the capture lists
+    scope_t *scope;   // Innermost scope
+} resolver_t;
+
+static void resolve_node(resolver_t *r, node_t *node);
+
+/**
+ * Enters the scope of a function, or of the global code.
+ *
+ * @param r The resolver.
+ * @param func The function, or NULL for the global code.
+ */
+static void push_scope(resolver_t *r, node_t *func)
+{
+    scope_t *scope = malloc(sizeof(scope_t));
+    scope->enclosing = r->scope;
+    scope->func = func;
+    scope->locals = list_create(sizeof(local_t));
+    scope->captures = list_create(sizeof(capture_t));
+    scope->loops = list_create(sizeof(loop_scope));
+    scope->depth = 0;
+    r->scope = scope;
+}
+
+/**
+ * Leaves the scope of a function, handing its upvalues to the function node.
+ *
+ * @param r The resolver.
+ */
+static void pop_scope(resolver_t *r)
+{
+    scope_t *scope = r->scope;
+    node_t *func = scope->func;
+
+    if (func != NULL && scope->captures->size > 0)
+    {
+        int count = scope->captures->size;
+        func->data.func.captures = ast_alloc(r->ast, count * sizeof(capture_t));
+        memcpy(func->data.func.captures, list_getAt(scope->captures, 0), count * sizeof(capture_t));
+        func->data.func.capture_count = count;
+    }
+
+    r->scope = scope->enclosing;
+    list_free(scope->locals);
+    list_free(scope->captures);
+    list_free(scope->loops);
+    free(scope);
+}
+
+/**
+ * Checks if declarations in the current scope are locals: inside a block or
+ * a function.
+ *
+ * @param r The resolver.
+ * @return True if a declaration is a local, false if it is a global.
+ */
+static bool is_localScope(resolver_t *r)
+{
+    return r->scope->depth > 0 || r->scope->func != NULL;
+}
+
+/**
+ * Counts the locals of the current function declared at or inside a depth.
+ *
+ * @param scope The scope of the function.
+ * @param depth The block depth.
+ * @return The number of locals from the top of the stack declared at or above depth.
+ */
+static int count_locals(scope_t *scope, int depth)
+{
+    int size = 0;
+    for (int i = scope->locals->size - 1; i >= 0; i--)
+    {
+        local_t *local = list_getAt(scope->locals, i);
+        if (local->depth < depth)
+            break;
+        size++;
+    }
+    return size;
+}
+
+/**
+ * Enters a block.
+ *
+ * @param r The resolver.
+ */
+static void begin_block(resolver_t *r)
+{
+    r->scope->depth++;
+}
+
+/**
+ * Leaves a block, dropping its locals.
+ *
+ * @param r The resolver.
+ * @return The number of locals declared in the block.
+ */
+static int end_block(resolver_t *r)
+{
+    scope_t *scope = r->scope;
+    int size = count_locals(scope, scope->depth);
+
+    for (int i = 0; i < size; i++)
+        list_pop(scope->locals);
+
+    scope->depth--;
+    return size;
+}
+
+/**
+ * Finds a local of a function by name, the innermost first.
+ *
+ * @param scope The scope of the function.
+ * @param name The name of the variable.
+ * @return The stack slot of the local, or -1.
+ */
+static int find_local(scope_t *scope, const char *name)
+{
+    for (int i = scope->locals->size - 1; i >= 0; i--)
+    {
+        local_t *local = list_getAt(scope->locals, i);
+        if (strcmp(local->name, name) == 0)
+            return i;
+    }
+    return -1;
+}
+
+/**
+ * Adds an upvalue to a function, unless it already captures the variable.
+ *
+ * @param scope The scope of the function.
+ * @param index The slot or upvalue index of the variable in the enclosing function.
+ * @param is_local True if the variable is a local of the enclosing function.
+ * @return The index of the upvalue.
+ */
+static int add_capture(scope_t *scope, int index, bool is_local)
+{
+    for (int i = 0; i < scope->captures->size; i++)
+    {
+        capture_t *capture = list_getAt(scope->captures, i);
+        if (capture->index == index && capture->is_local == is_local)
+            return i;
+    }
+
+    capture_t capture = {index, is_local};
+    list_add(scope->captures, &capture);
+    return scope->captures->size - 1;
+}
+
+/**
+ * Finds a variable of an enclosing function, capturing it in every function
+ * in between.
+ *
+ * @param scope The scope of the function the variable is used in.
+ * @param name The name of the variable.
+ * @return The index of the upvalue, or -1 if no enclosing function declares it.
+ */
+static int find_capture(scope_t *scope, const char *name)
+{
+    scope_t *enclosing = scope->enclosing;
+    if (enclosing == NULL)
+        return -1;
+
+    int index = find_local(enclosing, name);
+    if (index != -1)
+        return add_capture(scope, index, true);
+
+    index = find_capture(enclosing, name);
+    if (index != -1)
+        return add_capture(scope, index, false);
+
+    return -1;
+}
+
+/**
+ * Binds a use of a name: a local, else an upvalue, else a global.
+ *
+ * @param r The resolver.
+ * @param ident The identifier.
+ */
+static void reference(resolver_t *r, node_t *ident)
+{
+    char *name = ident->data.ident.name;
+
+    int index = find_local(r->scope, name);
+    if (index != -1)
+    {
+        ident->data.ident.ref = REF_LOCAL;
+        ident->data.ident.index = index;
+        return;
+    }
+
+    index = find_capture(r->scope, name);
+    if (index != -1)
+    {
+        ident->data.ident.ref = REF_UPVALUE;
+        ident->data.ident.index = index;
+        return;
+    }
+
+    ident->data.ident.ref = REF_GLOBAL;
+    ident->data.ident.index = store_name(r->comp, name);
+}
+
+/**
+ * Declares a local in the current block.
+ *
+ * @param r The resolver.
+ * @param ident The identifier declared.
+ */
+static void add_local(resolver_t *r, node_t *ident)
+{
+    scope_t *scope = r->scope;
+    char *name = ident->data.ident.name;
+
+    // Check for name conflict ONLY in current block
+    for (int i = scope->locals->size - 1; i >= 0; i--)
+    {
+        local_t *local = list_getAt(scope->locals, i);
+        if (local->depth < scope->depth)
+            break; // Stop checking once we’re outside the current block
+
+        if (strcmp(local->name, name) == 0)
+            p_errorf(ident->pos.line, ident->pos.column,
+                     "Name already declared in this scope: [%s]", name);
+    }
+
+    local_t local = {name, scope->depth};
+    list_add(scope->locals, &local);
+
+    ident->data.ident.ref = REF_LOCAL;
+    ident->data.ident.index = scope->locals->size - 1;
+}
+
+/**
+ * Declares a variable: a local inside a block or a function, a new global
+ * otherwise.
+ *
+ * @param r The resolver.
+ * @param ident The identifier declared.
+ */
+static void declare(resolver_t *r, node_t *ident)
+{
+    if (is_localScope(r))
+    {
+        add_local(r, ident);
+        return;
+    }
+
+    char *name = ident->data.ident.name;
+    if (name_index(r->comp, name) != -1 || is_builtin(r->comp, name))
+        p_errorf(ident->pos.line, ident->pos.column, "Name already exists [%s]", name);
+
+    ident->data.ident.ref = REF_GLOBAL;
+    ident->data.ident.index = store_name(r->comp, name);
+}
+
+/**
+ * Records that the program assigns to or declares a built-in name, so
+ * calls on it can't be bound to the built-in table (see gen_call).
+ *
+ * @param r The resolver.
+ * @param target The node assigned to.
+ */
+static void shadow(resolver_t *r, node_t *target)
+{
+    if (target->type == NODE_IDENTIFIER)
+        shadow_builtin(r->comp, target->data.ident.name);
+}
+
+/**
+ * Resolves the nodes of a list.
+ *
+ * @param r The resolver.
+ * @param list The nodes (some may be NULL).
+ */
+static void resolve_list(resolver_t *r, node_list_t *list)
+{
+    for (int i = 0; i < list->size; i++)
+        resolve_node(r, list->items[i]);
+}
+
+/**
+ * Resolves a function: its declared name and the defaults of its parameters
+ * in the enclosing scope, its body in a scope of its own whose locals start
+ * with `this` (for functions in object literals), the parameters and `args`.
+ *
+ * @param r The resolver.
+ * @param fn The function.
+ */
+static void resolve_function(resolver_t *r, node_t *fn)
+{
+    node_t *decl = fn->data.func.decl;
+
+    // A local function can call itself by name
+    if (decl != NULL)
+    {
+        shadow(r, decl);
+        if (is_localScope(r))
+            add_local(r, decl);
+    }
+
+    resolve_list(r, &fn->data.func.defaults);
+
+    push_scope(r, fn);
+
+    if (fn->data.func.has_this)
+    {
+        local_t local = {"this", 0};
+        list_add(r->scope->locals, &local);
+    }
+
+    for (int i = 0; i < fn->data.func.params.size; i++)
+        add_local(r, fn->data.func.params.items[i]);
+
+    local_t args = {"args", 0};
+    list_add(r->scope->locals, &args);
+
+    resolve_list(r, &fn->data.func.body);
+    resolve_node(r, fn->data.func.expr);
+
+    pop_scope(r);
+
+    // A global function is stored once its body is compiled
+    if (decl != NULL && !is_localScope(r))
+    {
+        decl->data.ident.ref = REF_GLOBAL;
+        decl->data.ident.index = store_name(r->comp, decl->data.ident.name);
+    }
+}
+
+/**
+ * Resolves a break or continue: the locals of the loop it leaves.
+ *
+ * @param r The resolver.
+ * @param jump The break or continue node.
+ * @param keyword The statement, for the error message.
+ */
+static void resolve_jump(resolver_t *r, node_t *jump, const char *keyword)
+{
+    list_t *loops = r->scope->loops;
+    if (loops->size == 0)
+    {
+        p_errorf(jump->pos.line, jump->pos.column, "'%s' used outside of a loop", keyword);
+        return;
+    }
+
+    loop_scope *loop = list_getAt(loops, loops->size - 1);
+    jump->data.jump.pops = count_locals(r->scope, loop->depth);
+    jump->data.jump.is_for = loop->is_for;
+}
+
+/**
+ * Resolves the body of a loop.
+ *
+ * @param r The resolver.
+ * @param depth The block depth of the first local of the loop.
+ * @param is_for True for a for-in loop.
+ * @param body The statements of the body.
+ * @param count The number of statements.
+ */
+static void resolve_loop(resolver_t *r, int depth, bool is_for, node_t **body, int count)
+{
+    loop_scope loop = {depth, is_for};
+    list_add(r->scope->loops, &loop);
+
+    for (int i = 0; i < count; i++)
+        resolve_node(r, body[i]);
+
+    list_pop(r->scope->loops);
+}
+
+/**
+ * Resolves a node and its children.
+ *
+ * @param r The resolver.
+ * @param node The node (may be NULL).
+ */
+static void resolve_node(resolver_t *r, node_t *node)
+{
+    if (node == NULL)
+        return;
+
+    switch (node->type)
+    {
+    case NODE_LITERAL:
+    case NODE_DEBUG:
+        break;
+
+    case NODE_IDENTIFIER:
+        reference(r, node);
+        break;
+
+    case NODE_UNARY:
+        resolve_node(r, node->data.unary.operand);
+        break;
+
+    case NODE_BINARY:
+        resolve_node(r, node->data.binary.left);
+        resolve_node(r, node->data.binary.right);
+        break;
+
+    case NODE_CONDITIONAL:
+        resolve_node(r, node->data.conditional.cond);
+        resolve_node(r, node->data.conditional.then);
+        resolve_node(r, node->data.conditional.other);
+        break;
+
+    case NODE_RANGE:
+        resolve_node(r, node->data.range.from);
+        resolve_node(r, node->data.range.to);
+        resolve_node(r, node->data.range.step);
+        break;
+
+    case NODE_LIST:
+        resolve_list(r, &node->data.list.items);
+        break;
+
+    case NODE_OBJECT:
+        resolve_list(r, &node->data.object.values);
+        break;
+
+    case NODE_FUNCTION:
+        resolve_function(r, node);
+        break;
+
+    case NODE_CALL:
+        resolve_node(r, node->data.call.callee);
+        resolve_list(r, &node->data.call.args);
+        break;
+
+    case NODE_INDEX:
+        resolve_node(r, node->data.index.object);
+        resolve_node(r, node->data.index.start);
+        resolve_node(r, node->data.index.stop);
+        resolve_node(r, node->data.index.step);
+        break;
+
+    case NODE_FIELD:
+        resolve_node(r, node->data.field.object);
+        break;
+
+    case NODE_ASSIGN:
+        shadow(r, node->data.assign.target);
+        resolve_node(r, node->data.assign.target);
+        resolve_node(r, node->data.assign.value);
+        break;
+
+    case NODE_WALRUS:
+        shadow(r, node->data.walrus.target);
+        resolve_node(r, node->data.walrus.value);
+        resolve_node(r, node->data.walrus.target);
+        break;
+
+    case NODE_UPDATE:
+        shadow(r, node->data.update.target);
+        resolve_node(r, node->data.update.target);
+        break;
+
+    case NODE_BLOCK:
+        begin_block(r);
+        resolve_list(r, &node->data.block.body);
+        node->data.block.pops = end_block(r);
+        break;
+
+    case NODE_VAR:
+        for (int i = 0; i < node->data.var.names.size; i++)
+        {
+            node_t *name = node->data.var.names.items[i];
+            resolve_node(r, node->data.var.inits.items[i]);
+            shadow(r, name);
+            declare(r, name);
+        }
+        break;
+
+    case NODE_IF:
+        resolve_node(r, node->data.if_stmt.cond);
+        resolve_node(r, node->data.if_stmt.then);
+        resolve_node(r, node->data.if_stmt.other);
+        break;
+
+    case NODE_WHILE:
+        resolve_node(r, node->data.while_stmt.cond);
+        resolve_loop(r, r->scope->depth + 1, false, &node->data.while_stmt.body, 1);
+        break;
+
+    case NODE_FOR:
+        resolve_node(r, node->data.for_stmt.iterable);
+        begin_block(r);
+        add_local(r, node->data.for_stmt.var);
+        resolve_loop(r, r->scope->depth, true, node->data.for_stmt.body.items, node->data.for_stmt.body.size);
+        node->data.for_stmt.pops = end_block(r);
+        break;
+
+    case NODE_BREAK:
+        resolve_jump(r, node, "break");
+        break;
+
+    case NODE_CONTINUE:
+        resolve_jump(r, node, "continue");
+        break;
+
+    case NODE_YIELD:
+        if (r->scope->func == NULL)
+            p_errorf(node->pos.line, node->pos.column, "'yield' used outside of a function");
+        else
+            r->scope->func->data.func.is_generator = true;
+        resolve_node(r, node->data.ret.value);
+        break;
+
+    case NODE_RETURN:
+        resolve_node(r, node->data.ret.value);
+        break;
+
+    case NODE_EXPR_STMT:
+        resolve_node(r, node->data.expr_stmt.expr);
+        break;
+
+    case NODE_PROGRAM:
+        resolve_list(r, &node->data.program.body);
+        break;
+    }
+}
+
+/**
+ * Resolves the names of a program (see the top of this file).
+ *
+ * @param comp The compiler the global names are stored in.
+ * @param ast The arena of the tree.
+ * @param program The program node.
+ */
+void resolve(compiler_t *comp, ast_t *ast, node_t *program)
+{
+    resolver_t r = {comp, ast, NULL};
+
+    push_scope(&r, NULL);
+    resolve_node(&r, program);
+    pop_scope(&r);
+}
@@ -0,0 +1,9 @@
+#ifndef PI_RESOLVE_H
+#define PI_RESOLVE_H
+
+#include "pi_ast.h"
+#include "pi_compiler.h"
+
+void resolve(compiler_t *comp, ast_t *ast, node_t *program);
+
+#endif // PI_RESOLVE_H
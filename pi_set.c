@@ -0,0 +1,311 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "pi_set.h"
+
+// Slots of the index hold the position of an entry plus one, or one of these
+#define SLOT_EMPTY 0
+#define SLOT_REMOVED -1
+
+#define SET_MIN_SLOTS 8
+
+/**
+ * Mixes the bits of a 64 bit integer (the finalizer of MurmurHash3), so
+ * that close numbers or pointers spread over the whole index.
+ */
+static inline uint32_t mix64(uint64_t bits)
+{
+    bits ^= bits >> 33;
+    bits *= 0xff51afd7ed558ccdULL;
+    bits ^= bits >> 33;
+    bits *= 0xc4ceb9fe1a85ec53ULL;
+    bits ^= bits >> 33;
+    return (uint32_t)bits;
+}
+
+/**
+ * Hashes a value for a set.
+ *
+ * Numbers are hashed by their bits (0 and -0 alike), strings by their
+ * characters and other objects by their address.
+ *
+ * @param value The value to hash.
+ * @return The hash of the value.
+ */
+uint32_t value_hash(Value value)
+{
+    switch (value.type)
+    {
+    case VAL_NUM:
+    {
+        double number = value.data.number == 0 ? 0.0 : value.data.number;
+        uint64_t bits;
+        memcpy(&bits, &number, sizeof(bits));
+        return mix64(bits);
+    }
+    case VAL_BOOL:
+        return value.data.boolean ? 1231 : 1237;
+    case VAL_NIL:
+        return 0;
+    case VAL_OBJ:
+        if (IS_STRING(value))
+            return string_hash(AS_STRING(value)->chars, AS_STRING(value)->length);
+        return mix64((uint64_t)(uintptr_t)AS_OBJ(value));
+    default:
+        return 0;
+    }
+}
+
+/**
+ * Checks if two values are the same item of a set.
+ *
+ * Unlike equals, numbers must be exactly equal (as their hashes are) and
+ * objects other than strings are compared by identity, since lists and
+ * maps can change once they are in the set.
+ *
+ * @param a The first value.
+ * @param b The second value.
+ * @return true if the values are the same item.
+ */
+bool set_same(Value a, Value b)
+{
+    if (a.type != b.type)
+        return false;
+
+    switch (a.type)
+    {
+    case VAL_NUM:
+        return a.data.number == b.data.number;
+    case VAL_BOOL:
+        return a.data.boolean == b.data.boolean;
+    case VAL_NIL:
+        return true;
+    case VAL_OBJ:
+        if (IS_STRING(a) && IS_STRING(b))
+        {
+            PiString *x = AS_STRING(a);
+            PiString *y = AS_STRING(b);
+            return x->length == y->length && memcmp(x->chars, y->chars, x->length) == 0;
+        }
+        return AS_OBJ(a) == AS_OBJ(b);
+    default:
+        return false;
+    }
+}
+
+/**
+ * Looks a value up in the index of a set, probing linearly from its hash.
+ *
+ * @param set The set, which must have an index.
+ * @param value The value to look up.
+ * @param hash The hash of the value.
+ * @param free_slot Set to the first slot the value can be inserted at.
+ * @return The slot of the value, or -1 if it is not in the set.
+ */
+static int find_slot(PiSet *set, Value value, uint32_t hash, int *free_slot)
+{
+    int mask = set->slot_count - 1;
+    int i = hash & mask;
+    *free_slot = -1;
+
+    // The index is never full (see set_add), so the loop ends on an empty slot
+    for (;;)
+    {
+        int slot = set->slots[i];
+
+        if (slot == SLOT_EMPTY)
+        {
+            if (*free_slot < 0)
+                *free_slot = i;
+            return -1;
+        }
+
+        if (slot == SLOT_REMOVED)
+        {
+            if (*free_slot < 0)
+                *free_slot = i;
+        }
+        else
+        {
+            SetEntry *entry = &set->entries[slot - 1];
+            if (entry->hash == hash && set_same(entry->value, value))
+                return i;
+        }
+
+        i = (i + 1) & mask;
+    }
+}
+
+/**
+ * Drops the removed entries of a set and rebuilds its index, large enough
+ * for `needed` items to fill at most half of it.
+ *
+ * The iterator state is moved along with the entries, so a set can grow
+ * while it is iterated.
+ *
+ * @param set The set.
+ * @param needed The number of items the index must hold.
+ */
+static void rebuild(PiSet *set, int needed)
+{
+    int count = 0;
+    int current = set->count;
+
+    for (int i = 0; i < set->count; i++)
+    {
+        if (i == set->current)
+            current = count;
+        if (set->entries[i].live)
+            set->entries[count++] = set->entries[i];
+    }
+
+    set->current = set->current < set->count ? current : count;
+    set->count = count;
+
+    int slot_count = SET_MIN_SLOTS;
+    while (slot_count < needed * 2)
+        slot_count *= 2;
+
+    free(set->slots);
+    set->slots = calloc(slot_count, sizeof(int));
+    set->slot_count = slot_count;
+
+    int mask = slot_count - 1;
+    for (int i = 0; i < count; i++)
+    {
+        int j = set->entries[i].hash & mask;
+        while (set->slots[j] != SLOT_EMPTY)
+            j = (j + 1) & mask;
+        set->slots[j] = i + 1;
+    }
+}
+
+/**
+ * Checks if a value is in a set.
+ *
+ * @param set The set.
+ * @param value The value.
+ * @return true if the value is in the set.
+ */
+bool set_has(PiSet *set, Value value)
+{
+    if (set->size == 0)
+        return false;
+
+    int free_slot;
+    return find_slot(set, value, value_hash(value), &free_slot) >= 0;
+}
+
+/**
+ * Adds a value to a set, after the items already in it.
+ *
+ * The caller is responsible for the write barrier.
+ *
+ * @param set The set.
+ * @param value The value.
+ * @return true if the value was added, false if it was already in the set.
+ */
+bool set_add(PiSet *set, Value value)
+{
+    // Removed entries keep their slot until the next rebuild, so the
+    // entries bound how full the index is
+    if ((set->count + 1) * 4 > set->slot_count * 3)
+        rebuild(set, set->size + 1);
+
+    uint32_t hash = value_hash(value);
+    int free_slot;
+    if (find_slot(set, value, hash, &free_slot) >= 0)
+        return false;
+
+    if (set->count == set->capacity)
+    {
+        set->capacity = set->capacity < SET_MIN_SLOTS ? SET_MIN_SLOTS : set->capacity * 2;
+        set->entries = realloc(set->entries, sizeof(SetEntry) * set->capacity);
+    }
+
+    set->entries[set->count] = (SetEntry){value, hash, true};
+    set->slots[free_slot] = ++set->count;
+    set->size++;
+    return true;
+}
+
+/**
+ * Removes a value from a set.
+ *
+ * The entry of the value is only marked as removed, so the other items
+ * keep their position and a set can shrink while it is iterated.
+ *
+ * @param set The set.
+ * @param value The value.
+ * @return true if the value was removed, false if it was not in the set.
+ */
+bool set_remove(PiSet *set, Value value)
+{
+    if (set->size == 0)
+        return false;
+
+    int free_slot;
+    int i = find_slot(set, value, value_hash(value), &free_slot);
+    if (i < 0)
+        return false;
+
+    SetEntry *entry = &set->entries[set->slots[i] - 1];
+    entry->live = false;
+    entry->value = NEW_NIL(); // Don't keep the value alive
+    set->slots[i] = SLOT_REMOVED;
+    set->size--;
+
+    return true;
+}
+
+/**
+ * Creates a new set with the items of a set, in the same order.
+ *
+ * @param set The set to copy.
+ * @return The new set.
+ */
+PiSet *set_copy(PiSet *set)
+{
+    PiSet *copy = (PiSet *)new_set();
+    if (set->size == 0)
+        return copy;
+
+    copy->capacity = set->size < SET_MIN_SLOTS ? SET_MIN_SLOTS : set->size;
+    copy->entries = malloc(sizeof(SetEntry) * copy->capacity);
+
+    for (int i = 0; i < set->count; i++)
+        if (set->entries[i].live)
+            copy->entries[copy->count++] = set->entries[i];
+
+    // The hashes are kept, only the index is built again
+    copy->size = copy->count;
+    rebuild(copy, copy->size);
+
+    return copy;
+}
+
+/**
+ * Skips the removed entries at the iterator position of a set.
+ *
+ * @param set The set.
+ * @return true if `current` is at an item, false at the end of the set.
+ */
+bool set_advance(PiSet *set)
+{
+    while (set->current < set->count && !set->entries[set->current].live)
+        set->current++;
+    return set->current < set->count;
+}
+
+/**
+ * Frees the entries and the index of a set, but not the set itself.
+ *
+ * @param set The set.
+ */
+void set_free(PiSet *set)
+{
+    free(set->entries);
+    free(set->slots);
+    set->entries = NULL;
+    set->slots = NULL;
+}
@@ -0,0 +1,22 @@
+#ifndef PI_SET_H
+#define PI_SET_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "pi_value.h"
+#include "pi_object.h"
+
+uint32_t value_hash(Value value);
+bool set_same(Value a, Value b);
+
+bool set_has(PiSet *set, Value value);
+bool set_add(PiSet *set, Value value);
+bool set_remove(PiSet *set, Value value);
+void set_free(PiSet *set);
+PiSet *set_copy(PiSet *set);
+
+// Moves `current` to the next item of the set, true if there is one
+bool set_advance(PiSet *set);
+
+#endif // PI_SET_H
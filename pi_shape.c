@@ -0,0 +1,107 @@
+#include <stdlib.h>
+
+#include "pi_shape.h"
+
+/**
+ * Creates a new shape derived from the given parent.
+ *
+ * The new shape starts with a copy of the parent's field layout, so a
+ * field keeps the same slot index in every shape derived from the one
+ * that introduced it.
+ *
+ * @param parent The shape to extend, or NULL to create an empty root shape.
+ * @return A pointer to the newly created shape.
+ */
+Shape *new_shape(Shape *parent)
+{
+    Shape *shape = (Shape *)malloc(sizeof(Shape));
+
+    shape->slots = ht_create(sizeof(int));
+    shape->transitions = NULL;
+    shape->parent = parent;
+    shape->count = 0;
+
+    if (parent)
+    {
+        char **keys = ht_keys(parent->slots);
+        for (int i = 0; i < parent->count; i++)
+            ht_put(shape->slots, keys[i], &i);
+        shape->count = parent->count;
+    }
+
+    return shape;
+}
+
+/**
+ * Returns the shape reached by adding a field to the given shape.
+ *
+ * Transitions are cached on the parent, so every instance that adds the
+ * same keys in the same order ends up sharing a single shape.
+ *
+ * @param shape The current shape of the instance.
+ * @param key The name of the field being added.
+ * @return The shape describing the layout with the new field appended.
+ */
+Shape *shape_add(Shape *shape, const char *key)
+{
+    if (!shape->transitions)
+        shape->transitions = ht_create(sizeof(Shape *));
+
+    Shape **next = (Shape **)ht_get(shape->transitions, key);
+    if (next)
+        return *next;
+
+    Shape *child = new_shape(shape);
+    ht_put(child->slots, key, &child->count);
+    child->count++;
+
+    ht_put(shape->transitions, key, &child);
+    return child;
+}
+
+/**
+ * Looks up the slot index of a field in a shape.
+ *
+ * @param shape The shape to search.
+ * @param key The name of the field.
+ * @return The slot index of the field, or -1 if the shape does not have it.
+ */
+int shape_slot(Shape *shape, const char *key)
+{
+    int *slot = (int *)ht_get(shape->slots, key);
+    return slot ? *slot : -1;
+}
+
+/**
+ * Returns the name of the field stored at the given slot.
+ *
+ * @param shape The shape to query.
+ * @param slot The slot index (0 <= slot < shape->count).
+ * @return The field name. The string is owned by the shape.
+ */
+char *shape_key(Shape *shape, int slot)
+{
+    return ht_keys(shape->slots)[slot];
+}
+
+/**
+ * Frees a shape together with every shape derived from it.
+ *
+ * @param shape The root of the shape tree to free.
+ */
+void free_shape(Shape *shape)
+{
+    if (!shape)
+        return;
+
+    if (shape->transitions)
+    {
+        char **keys = ht_keys(shape->transitions);
+        for (int i = 0; i < ht_length(shape->transitions); i++)
+            free_shape(*(Shape **)ht_get(shape->transitions, keys[i]));
+        ht_free(shape->transitions);
+    }
+
+    ht_free(shape->slots);
+    free(shape);
+}
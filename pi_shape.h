@@ -0,0 +1,35 @@
+#ifndef PI_SHAPE_H
+#define PI_SHAPE_H
+
+#include <stdbool.h>
+
+#include "pi_table.h"
+
+// Instances that grow past this many fields leave the shape tree and
+// fall back to a plain hash table (dictionary mode).
+#define SHAPE_MAX_FIELDS 64
+
+// A shape (hidden class) describes the field layout shared by every
+// instance that was built by adding the same keys in the same order.
+typedef struct Shape
+{
+    table_t *slots;       // Field name -> slot index (keys kept in slot order)
+    table_t *transitions; // Field name -> child Shape* (created lazily)
+    struct Shape *parent; // Shape this one was derived from (NULL for the root)
+    int count;            // Number of fields described by this shape
+} Shape;
+
+// Monomorphic inline cache attached to a constant-key field access site.
+typedef struct
+{
+    Shape *shape; // Last shape seen at this site (NULL when empty)
+    int slot;     // Field slot of the key within that shape
+} InlineCache;
+
+Shape *new_shape(Shape *parent);
+Shape *shape_add(Shape *shape, const char *key);
+int shape_slot(Shape *shape, const char *key);
+char *shape_key(Shape *shape, int slot);
+void free_shape(Shape *shape);
+
+#endif
@@ -7,6 +7,7 @@
 #include "pi_value.h"
 #include "string.h"
 #include "common.h"
+#include "pi_pool.h"
 
 /**
  * FNV-1a hash function
@@ -41,9 +42,10 @@ static inline uint64_t FNV_1a(const char *key)
  */
 table_t *ht_create(size_t i_size)
 {
-    table_t *table = malloc(sizeof(table_t));
-    if (!table)
-        return NULL;
+    // Tables made while a VM runs take their header from its pool
+    pool_t *pool = pool_bound();
+    table_t *table = (table_t *)pool_alloc_block(pool, sizeof(table_t));
+    table->pool = pool;
 
     table->size = 0;
     table->capacity = INIT_CAP;
@@ -51,12 +53,13 @@ table_t *ht_create(size_t i_size)
     table->items = calloc(table->capacity, sizeof(ht_item));
     if (!table->items)
     {
-        free(table);
+        pool_free_block(pool, table, sizeof(table_t));
         return NULL;
     }
 
     table->_keys = calloc(INIT_CAP, sizeof(char *)); // allocate space for key pointers
     table->_last = 0;                                // Initialize _last to the first index
+    table->refs = 1;
 
     return table;
 }
@@ -130,7 +133,7 @@ bool ht_put(table_t *table, const char *key, const void *value)
         table->_last = index;
 
     // Insert new key-value pair
-    char *_key = strdup(key);
+    char *_key = string_copy(key);
 
     void *_value = malloc(table->i_size); // Allocate memory for the value
     memcpy(_value, value, table->i_size); // Copy the value
@@ -205,6 +208,10 @@ void ht_free(table_t *table)
     if (!table)
         return;
 
+    // Still used by another owner (tables may be freed by the background sweeper)
+    if (__atomic_sub_fetch(&table->refs, 1, __ATOMIC_ACQ_REL) > 0)
+        return;
+
     for (int i = 0; i < table->capacity; i++)
     {
         if (table->items[i].key)
@@ -218,7 +225,44 @@ void ht_free(table_t *table)
         free(table->_keys);
 
     free(table->items);
-    free(table);
+    pool_free_block(table->pool, table, sizeof(table_t));
+}
+
+/**
+ * Adds an owner to a table, which is then shared instead of copied.
+ *
+ * Owners must call ht_unshare before writing to the table and ht_free when
+ * they are done with it; the table is freed with its last owner.
+ *
+ * @param table The table to share.
+ * @return The same table.
+ */
+table_t *ht_share(table_t *table)
+{
+    __atomic_add_fetch(&table->refs, 1, __ATOMIC_RELAXED);
+    return table;
+}
+
+/**
+ * Returns a table its owner may write to: the table itself if it is not
+ * shared, otherwise a copy of it (the shared table loses one owner).
+ *
+ * @param table The table about to be modified.
+ * @return The table to use from now on.
+ */
+table_t *ht_unshare(table_t *table)
+{
+    if (__atomic_load_n(&table->refs, __ATOMIC_ACQUIRE) == 1)
+        return table;
+
+    table_t *copy = ht_create(table->i_size);
+
+    // Keys are added in insertion order, which keeps the order of _keys
+    for (int i = 0; i < table->size; i++)
+        ht_put(copy, table->_keys[i], ht_get(table, table->_keys[i]));
+
+    ht_free(table);
+    return copy;
 }
 
 // Iterator functions
@@ -27,6 +27,8 @@ typedef struct
     char **_keys;
 
     int _last;
+    int refs;          // Number of owners sharing the table (copied on write, see ht_share)
+    struct Pool *pool; // Pool the header was taken from (NULL: malloc)
 } table_t;
 
 // Create a table for values of size `i_size`
@@ -41,6 +43,10 @@ int ht_last(table_t *table);
 char **ht_keys(table_t *table);
 void ht_free(table_t *table);
 
+// Share a table between owners until one of them writes to it
+table_t *ht_share(table_t *table);
+table_t *ht_unshare(table_t *table);
+
 typedef struct
 {
     char *key;       // Current key
@@ -5,20 +5,12 @@
 
 #include "pi_token.h"
 
-token_t create_token(tk_type type, char *start, int length, int line, int column)
+token_t create_token(tk_type type, const char *start, int length, int line, int column)
 {
     token_t token;
 
-    // Allocate memory for the token's lexeme and copy it
-    token.start = (char *)malloc(length + 1);
-    if (!token.start)
-    {
-        perror("Failed to allocate memory for token lexeme");
-        exit(EXIT_FAILURE);
-    }
-
-    memcpy(token.start, start, length);
-    token.start[length] = '\0'; // Ensure null termination
+    // The lexeme is not copied: the token is a span of the source buffer
+    token.start = start;
 
     // Set the other token properties
     token.type = type;
@@ -40,7 +32,7 @@ tk_type token_type(token_t token)
 char *token_value(token_t token)
 {
     int length = token.length;
-    char *start = token.start;
+    const char *start = token.start;
 
     // Check if the token is negative and adjust memory allocation
     int _length = token.is_negative ? 1 : 0;      // Add 1 for '-' if negative
@@ -95,6 +87,15 @@ tk_type find_kw(const char *name)
     return TK_INVALID;
 }
 
+// Same as find_kw, for a name that is a span of the source buffer
+tk_type find_kwSpan(const char *start, int length)
+{
+    for (int i = 0; i < KW_NUM; ++i)
+        if (strncmp(keywords[i].name, start, length) == 0 && keywords[i].name[length] == '\0')
+            return keywords[i].type;
+    return TK_INVALID;
+}
+
 double tk_double(const token_t token)
 {
     // Allocate a buffer large enough to hold the token string plus a null terminator.
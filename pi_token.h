@@ -8,7 +8,7 @@
 // Function to convert a void pointer to an integer
 #define cast_int64(x) ((int64_t)x)
 
-#define KW_NUM 23
+#define KW_NUM 24
 
 /*
 ** Single-char tokens (terminal symbols) are represented by their own
@@ -112,6 +112,7 @@ typedef enum
     TK_OR_ASSIGN,
     TK_URSHIFT_ASSIGN,
     TK_IMPORT,
+    TK_YIELD,
     TK_EOF,
     TK_INVALID,
 } tk_type;
@@ -150,12 +151,13 @@ static keyword_t keywords[KW_NUM] = {
     {"typeof", TK_TYPEOF},
     {"debug", TK_DEBUG},
     {"import", TK_IMPORT},
+    {"yield", TK_YIELD},
 };
 
 typedef struct
 {
     tk_type type;
-    char *start;
+    const char *start; // Span of the lexeme in the source buffer (not null-terminated)
     int length;
     int line;
     int column;
@@ -270,12 +272,13 @@ static const char *token_names[] = {
     // Four characters tokens
     "TK_URSHIFT_ASSIGN",
     "TK_IMPORT",
+    "TK_YIELD",
 
     // Special tokens
     "TK_EOF",
 };
 
-token_t create_token(tk_type type, char *start, int length, int line, int column);
+token_t create_token(tk_type type, const char *start, int length, int line, int column);
 tk_type token_type(token_t token);
 char *token_value(token_t token);
 
@@ -285,6 +288,7 @@ int token_column(token_t token);
 const char *token_toString(token_t token);
 
 tk_type find_kw(const char *name);
+tk_type find_kwSpan(const char *start, int length);
 
 double tk_double(const token_t token);
 char *tk_string(const token_t token);
@@ -4,6 +4,7 @@
 #include "pi_value.h"
 #include "pi_object.h"
 #include "pi_func.h"
+#include "pi_set.h"
 
 /**
  * Checks if two values are equal.
@@ -68,8 +69,8 @@ bool equals(Value left, Value right)
 
             for (size_t i = 0; i < LIST_SIZE(a->items); i++)
             {
-                Value item_a = *(Value *)list_getAt(a->items, i);
-                Value item_b = *(Value *)list_getAt(b->items, i);
+                Value item_a = list_value(a->items, i);
+                Value item_b = list_value(b->items, i);
 
                 if (!equals(item_a, item_b))
                     return false; // Found a mismatch
@@ -77,6 +78,21 @@ bool equals(Value left, Value right)
             return true; // All elements are equal
         }
 
+        case OBJ_SET:
+        {
+            PiSet *a = (PiSet *)left.data.object;
+            PiSet *b = (PiSet *)right.data.object;
+
+            if (a->size != b->size)
+                return false;
+
+            // Sets are equal if they hold the same items, in any order
+            for (int i = 0; i < a->count; i++)
+                if (a->entries[i].live && !set_has(b, a->entries[i].value))
+                    return false;
+            return true;
+        }
+
         default:
             // For unsupported object types, fall back to pointer comparison.
             return left.data.object == right.data.object;
@@ -171,9 +187,7 @@ int compare(Value left, Value right)
 
             for (size_t i = 0; i < min_size; i++)
             {
-                Value *l_item = list_getAt(l_list->items, i);
-                Value *r_item = list_getAt(r_list->items, i);
-                int cmp = compare(*l_item, *r_item);
+                int cmp = compare(list_value(l_list->items, i), list_value(r_list->items, i));
                 if (cmp != 0)
                     return cmp;
             }
@@ -181,6 +195,9 @@ int compare(Value left, Value right)
             return (l_size > r_size) ? 1 : (l_size < r_size) ? -1
                                                              : 0;
         }
+        else if (OBJ_TYPE(left) == OBJ_SET && OBJ_TYPE(right) == OBJ_SET)
+            // Sets are not ordered, they only compare as equal or not
+            return equals(left, right) ? 0 : ERROR_COMPARE;
         else
             return ERROR_COMPARE;
 
@@ -273,7 +290,7 @@ Value new_value(token_t token)
         // Convert string token to a string object
         const char *raw = tk_string(token);
         char *unescaped = unescape_string(raw); // Function to unescape special characters
-        val = NEW_OBJ(new_pistring(strdup(unescaped)));
+        val = NEW_OBJ(new_pistring(string_copy(unescaped)));
         free(unescaped); // Free the temporary unescaped string
         break;
     }
@@ -381,7 +398,13 @@ bool as_bool(Value val)
             return LIST_SIZE(AS_LIST(val)->items) > 0;
         case OBJ_MAP:
             // Maps are true if they have key-value pairs
-            return ht_length(AS_MAP(val)->table) > 0;
+            return map_size(AS_MAP(val)) > 0;
+        case OBJ_SET:
+            // Sets are true if they have items
+            return AS_SET(val)->size > 0;
+        case OBJ_HEAP:
+            // Priority queues are true if they have items
+            return AS_HEAP(val)->size > 0;
         case OBJ_RANGE:
             // Ranges are true if start and end are different
             return AS_RANGE(val)->start != AS_RANGE(val)->end;
@@ -427,9 +450,9 @@ char *as_string(Value val)
         return num;
     }
     case VAL_BOOL:
-        return val.data.boolean ? strdup("true") : strdup("false");
+        return val.data.boolean ? string_copy("true") : string_copy("false");
     case VAL_NIL:
-        return strdup("nil");
+        return string_copy("nil");
     case VAL_OBJ:
     {
         switch (AS_OBJ(val)->type)
@@ -437,13 +460,13 @@ char *as_string(Value val)
         case OBJ_STRING:
         {
             char *str = AS_STRING(val)->chars;
-            return strdup(str); // Create a copy
+            return string_copy(str); // Create a copy
         }
         case OBJ_LIST:
         {
-            list_t *list = as_list(val);
+            list_t *list = AS_LIST(val)->items;
             size_t buffer_size = 2; // Start with "[]"
-            char *result = strdup("[");
+            char *result = string_copy("[");
 
             int size = list->size;
             for (size_t i = 0; i < size; i++)
@@ -455,7 +478,7 @@ char *as_string(Value val)
                     strcat(result, ", ");
                 }
 
-                char *item = as_string(*(Value *)list_getAt(list, i));
+                char *item = as_string(list_value(list, i));
                 buffer_size += strlen(item);
                 result = realloc(result, buffer_size);
                 strcat(result, item);
@@ -475,10 +498,10 @@ char *as_string(Value val)
             //     list_t *keys = map->table->_keys;
             //     int size = list_size(keys);
             //     if (size == 0)
-            //         return strdup("{}");
+            //         return string_copy("{}");
 
             //     size_t buffer_size = 2; // Start with "{}"
-            //     char *result = strdup("{");
+            //     char *result = string_copy("{");
 
             //     for (int i = 0; i < size; i++)
             //     {
@@ -511,19 +534,18 @@ char *as_string(Value val)
         case OBJ_MAP:
         {
             PiMap *map = AS_MAP(val);
-            char **keys = map->table->_keys;
-            int size = ht_length(map->table);
+            int size = map_size(map);
 
             if (size == 0)
-                return strdup("{}");
+                return string_copy("{}");
 
             size_t buffer_size = 2; // Start with "{}"
-            char *result = strdup("{");
+            char *result = string_copy("{");
 
             for (int i = 0; i < size; i++)
             {
-                char *key = keys[i];
-                char *value = as_string(*(Value *)ht_get(map->table, key));
+                char *key = map_keyAt(map, i);
+                char *value = as_string(*map_valueAt(map, i));
 
                 // Add comma and space if not the first entry
                 if (i > 0)
@@ -549,6 +571,48 @@ char *as_string(Value val)
             return result;
         }
 
+        case OBJ_SET:
+        {
+            PiSet *set = AS_SET(val);
+            if (set->size == 0)
+                return string_copy("set()"); // "{}" is an empty map
+
+            size_t buffer_size = 3; // Start with "{}"
+            char *result = string_copy("{");
+            bool first = true;
+
+            for (int i = 0; i < set->count; i++)
+            {
+                if (!set->entries[i].live)
+                    continue;
+
+                char *item = as_string(set->entries[i].value);
+                buffer_size += strlen(item) + (first ? 0 : 2); // item and ", "
+                result = realloc(result, buffer_size);
+                if (!first)
+                    strcat(result, ", ");
+                strcat(result, item);
+                free(item);
+                first = false;
+            }
+
+            strcat(result, "}");
+            return result;
+        }
+
+        case OBJ_HEAP:
+        {
+            char *result = (char *)malloc(32);
+            snprintf(result, 32, "<pqueue: %d>", AS_HEAP(val)->size);
+            return result;
+        }
+
+        case OBJ_ITER:
+            return string_copy("<iterator>");
+
+        case OBJ_GEN:
+            return string_copy("<generator>");
+
         case OBJ_FUN:
         {
             Function *fun = AS_FUN(val);
@@ -584,7 +648,7 @@ char *as_string(Value val)
 list_t *as_list(Value val)
 {
     if (val.type == VAL_OBJ && OBJ_TYPE(val) == OBJ_LIST)
-        return AS_LIST(val)->items;
+        return list_values(AS_LIST(val));
 
     error("Expected a list, but got %s", type_name(val));
 }
@@ -642,13 +706,8 @@ Value copy_value(Value val)
         {
             // Deep copy string
             PiString *original = (PiString *)obj;
-            PiString *str = malloc(sizeof(PiString));
-
-            str->object.type = OBJ_STRING;
-            str->length = original->length;
+            PiString *str = copy_pistring(original->chars, original->length);
 
-            str->chars = malloc(str->length + 1);
-            strcpy(str->chars, original->chars);
             copy.data.object = (Object *)str;
             break;
         }
@@ -657,20 +716,27 @@ Value copy_value(Value val)
         {
             // Deep copy list
             PiList *original = (PiList *)obj;
-            PiList *list = malloc(sizeof(PiList));
+            PiList *list;
 
-            list->object.type = OBJ_LIST;
-            list->items = list_create(sizeof(Value)); // PiList contains Value pointers
-            list->current = 0;
-
-            for (size_t i = 0; i < LIST_SIZE(original->items); i++)
+            if (LIST_PACKED(original->items))
             {
-                // original item
-                Value o_item = *(Value *)list_getAt(original->items, i);
-                // copied item
-                Value c_item = copy_value(o_item);
+                // Numbers need no deep copy: share the packed items until
+                // either list is modified
+                list = (PiList *)new_list(list_view(original->items, 0, original->items->size));
+            }
+            else
+            {
+                list = (PiList *)new_list(list_create(sizeof(Value))); // PiList contains Value pointers
+
+                for (size_t i = 0; i < LIST_SIZE(original->items); i++)
+                {
+                    // original item
+                    Value o_item = *(Value *)list_getAt(original->items, i);
+                    // copied item
+                    Value c_item = copy_value(o_item);
 
-                list_add(list->items, &c_item);
+                    list_add(list->items, &c_item);
+                }
             }
 
             copy.data.object = (Object *)list;
@@ -678,7 +744,8 @@ Value copy_value(Value val)
         }
 
         case OBJ_MAP:
-            // PiMap copying not implemented (matches original behavior)
+            // PiMap copying not implemented: maps are shared, not copied
+            copy = val;
             break;
 
         default:
@@ -724,7 +791,7 @@ void print_value(Value val, bool is_root)
             printf("[");
             for (int i = 0; i < size; i++)
             {
-                print_value(*(Value *)list_getAt(items, i), false);
+                print_value(list_value(items, i), false);
                 if (i < size - 1)
                     printf(", ");
                 if (i >= print_limit)
@@ -736,6 +803,31 @@ void print_value(Value val, bool is_root)
             printf("]");
             break;
         }
+        case OBJ_SET:
+        {
+            PiSet *set = AS_SET(val);
+            int printed = 0;
+            printf("{");
+            for (int i = 0; i < set->count; i++)
+            {
+                if (!set->entries[i].live)
+                    continue;
+                print_value(set->entries[i].value, false);
+                if (++printed < set->size)
+                    printf(", ");
+            }
+            printf("}");
+            break;
+        }
+        case OBJ_HEAP:
+            printf("<pqueue: %d>", AS_HEAP(val)->size);
+            break;
+        case OBJ_ITER:
+            printf("<iterator>");
+            break;
+        case OBJ_GEN:
+            printf("<generator>");
+            break;
         case OBJ_RANGE:
         {
             PiRange *r = AS_RANGE(val);
@@ -801,6 +893,14 @@ char *type_name(Value val)
             return "image";
         case OBJ_SPRITE:
             return "sprite";
+        case OBJ_SET:
+            return "set";
+        case OBJ_HEAP:
+            return "pqueue";
+        case OBJ_ITER:
+            return "iterator";
+        case OBJ_GEN:
+            return "generator";
         default:
             return "undefined";
         }
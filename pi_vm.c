@@ -12,12 +12,13 @@
 #include "common.h"
 #include "pi_func.h"
 #include "gc.h"
+#include "gc_worker.h"
+#include "pi_matrix.h"
+#include "pi_iter.h"
+#include "pi_gen.h"
 
 #include "builtin/pi_builtin.h"
 
-#define GC_MIN_THRESHOLD 4096
-#define GC_MAX_THRESHOLD (1024 * 1024 * 8)
-
 static PiMap *define_keys(vm_t *vm)
 {
     table_t *table = ht_create(sizeof(Value));
@@ -77,6 +78,11 @@ vm_t *init_vm(compiler_t *comp, Screen *screen)
     // Allocate memory for the virtual machine instance
     vm_t *vm = (vm_t *)malloc(sizeof(vm_t));
 
+    // Objects created on this thread from now on are carved from this VM's
+    // pool (a thread that runs the VM later binds it again, see vm_run)
+    vm->pool = pool_create();
+    pool_bind(vm->pool);
+
     // Initialize program counter, stack pointer, and base pointer to 0
     vm->pc = 0;
     vm->sp = 0;
@@ -87,12 +93,21 @@ vm_t *init_vm(compiler_t *comp, Screen *screen)
     vm->code = comp->code;
     vm->constants = comp->constants;
     vm->names = comp->names;
-    vm->instrs = comp->instrs;
+    vm->lines = comp->lines;
 
     // Create a hash table to store global variables
     vm->globals = ht_create(sizeof(Value));
 
     vm->objects = NULL;
+    vm->old_objects = NULL;
+    vm->old_count = 0;
+
+    vm->remembered = NULL;
+    vm->remembered_count = 0;
+    vm->remembered_capacity = 0;
+
+    vm->gc_stack = (MarkStack){NULL, 0, 0};
+    vm->mark_stack = (MarkStack){NULL, 0, 0};
 
     for (int i = 0; i < BUILTIN_CONST_COUNT; i++)
         ht_put(vm->globals, builtin_constants[i].name, &builtin_constants[i].value);
@@ -120,9 +135,22 @@ vm_t *init_vm(compiler_t *comp, Screen *screen)
     vm->function = NULL;
 
     vm->next_gc = NEXT_GC;
+    vm->next_major = GC_MIN_THRESHOLD;
     vm->obj_count = 0;
 
-    vm->gc_stack = NULL;
+    vm->gc_phase = GC_IDLE;
+    vm->sweep_objects = NULL;
+    vm->gc_scan = NULL;
+    vm->gc_scan_index = 0;
+    vm->gc_budget = GC_BUDGET;
+    vm->gc_threads = 1; // Helper threads are opt-in, through gc_threads()
+    vm->gc_workers = NULL;
+    vm->dead_cells = NULL;
+    gc_stats_init(&vm->gc_stats);
+
+    vm->shapes = new_shape(NULL);
+    vm->ic_count = comp->ic_count;
+    vm->ics = (InlineCache *)calloc(vm->ic_count ? vm->ic_count : 1, sizeof(InlineCache));
 
     vm->cart = NULL;
 
@@ -154,7 +182,7 @@ void vm_reset(vm_t *vm, compiler_t *comp)
     vm->code = comp->code;
     vm->constants = comp->constants;
     vm->names = comp->names;
-    vm->instrs = comp->instrs;
+    vm->lines = comp->lines;
 
     // Note: vm->globals is NOT reset. This is intentional to allow
     // persistence of global state between script executions in the shell.
@@ -171,6 +199,12 @@ void vm_reset(vm_t *vm, compiler_t *comp)
     vm->openUpvalues = NULL;
     vm->function = NULL;
 
+    // Inline caches belong to the code being loaded. Shapes are kept, since
+    // instances stored in globals survive the reset.
+    free(vm->ics);
+    vm->ic_count = comp->ic_count;
+    vm->ics = (InlineCache *)calloc(vm->ic_count ? vm->ic_count : 1, sizeof(InlineCache));
+
     vm->frameInterval_ms = 1000 / TARGET_FPS;
     vm->last_drawTicks = 0;
 
@@ -203,34 +237,55 @@ inline Object *add_obj(vm_t *vm, Object *obj)
     obj->next = vm->objects;
     vm->objects = obj;
     vm->counter++; // Track new allocations (GC trigger is allocation-driven).
+    vm->gc_stats.live_bytes += object_size(obj);
 
     return obj;
 }
 
 /**
- * Counts the number of objects in the virtual machine's object list.
+ * Runs a garbage collection cycle.
  *
- * This function iterates over the linked list of objects and returns the
- * total count of objects in the list. It is used for debugging purposes
- * to track the number of objects in use.
+ * A minor collection is run each time the nursery fills up. Full
+ * collections are incremental: one is started once the old generation has
+ * grown past `next_major`, and each later minor collection advances it by
+ * one slice (frames drawn with `draw()` add slices of their own).
  *
  * @param vm The virtual machine instance.
- * @return The number of objects in the object list.
  */
-static inline int count_objs(vm_t *vm)
+static void collect(vm_t *vm)
 {
-    int count = 0;
-    Object *obj = vm->objects;
-    while (obj)
-    {
 #ifdef DEBUG
-        // Print debugging information about the object
-        printf("[DEBUG] Counting object at %p\n", (void *)obj);
+    int before = vm->counter + vm->old_count;
 #endif
-        count++;
-        obj = obj->next;
+
+    minor_gc(vm);
+
+    if (vm->gc_phase == GC_IDLE && vm->old_count >= vm->next_major)
+        gc_begin(vm);
+    else if (vm->gc_phase != GC_IDLE)
+    {
+        // Speed up when the mutator outruns the collector, and finish the
+        // cycle at once if the heap keeps growing regardless.
+        if (vm->old_count >= vm->next_major * 4)
+            gc_step(vm, 0);
+        else if (vm->old_count >= vm->next_major * 2)
+            gc_step(vm, vm->gc_budget * 4);
+        else
+            gc_step(vm, vm->gc_budget);
     }
-    return count;
+
+    // Every collection empties the nursery.
+    vm->counter = 0;
+    vm->obj_count = vm->old_count;
+
+#ifdef DEBUG
+    printf("[DEBUG] SP: %d\n", vm->sp);
+    printf("[GC] Running garbage collection (phase %d)...\n", vm->gc_phase);
+    printf("[GC] Before: %d objects in memory\n", before);
+    printf("[GC] After: %d objects in memory\n", vm->old_count);
+    printf("[GC] Collected: %d, Next major at: %d\n", before - vm->old_count, vm->next_major);
+    pool_print(vm->pool);
+#endif
 }
 
 /**
@@ -248,44 +303,36 @@ static inline int count_objs(vm_t *vm)
 
 void vm_error(vm_t *vm, const char *message)
 {
-    instr_t *instr = NULL;
-    char *name = "<global>";
+    // The line table of the function running, or of the global code
+    list_t *lines = vm->lines;
+    char *fun_name = NULL;
 
     if (vm->frame_sp > 0)
     {
         Frame *top = vm->frames[vm->frame_sp - 1];
-        name = top->function->name;
+        lines = top->function->body->lines;
+        fun_name = top->function->name;
     }
 
-    list_t *instrs = ht_get(vm->instrs, name);
-    int size = instrs ? list_size(instrs) : 0;
-
-    for (int i = 0; i < size; i++)
-    {
-        instr_t *cur = (instr_t *)list_getAt(instrs, i);
-
-        if (cur->offset > vm->pc)
-            break;
-        instr = cur;
-    }
+    const line_t *pos = find_line(lines, vm->pc);
 
     if (global_errorHandler)
     {
         char buffer[1024];
-        if (instr && instr->fun_name)
-            snprintf(buffer, sizeof(buffer), "%s (in function '%s')", message, instr->fun_name);
+        if (pos && fun_name)
+            snprintf(buffer, sizeof(buffer), "%s (in function '%s')", message, fun_name);
         else
             snprintf(buffer, sizeof(buffer), "%s", message);
 
-        global_errorHandler(buffer, instr ? instr->line : -1, 0);
+        global_errorHandler(buffer, pos ? pos->line : -1, pos ? pos->column : 0);
         return;
     }
 
-    if (instr)
+    if (pos)
     {
-        fprintf(stderr, "\n\033[1;31m[RUNTIME ERROR] at line %d", instr->line);
-        if (instr->fun_name)
-            fprintf(stderr, " in function '%s'", instr->fun_name);
+        fprintf(stderr, "\n\033[1;31m[RUNTIME ERROR] at line %d", pos->line);
+        if (fun_name)
+            fprintf(stderr, " in function '%s'", fun_name);
         fprintf(stderr, ":\033[0m %s\n\n", message);
     }
     else
@@ -420,6 +467,29 @@ Frame *pop_frame(vm_t *vm)
     return frame;
 }
 
+/**
+ * Pops the current frame and restores the state of the caller: its code,
+ * position, stack and iterators.
+ *
+ * @param vm The virtual machine instance.
+ */
+static void leave_frame(vm_t *vm)
+{
+    Frame *frame = pop_frame(vm);
+
+    while (vm->iter_sp > frame->iters_top)
+        vm->iter_sp--;
+
+    vm->pc = frame->pc;
+    vm->bp = frame->bp;
+    vm->sp = frame->sp;
+    vm->ip = frame->ip;
+
+    vm->code = frame->code;
+
+    free_frame(frame);
+}
+
 /**
  * Reads a name from the list of names stored in the virtual machine.
  *
@@ -461,6 +531,12 @@ static inline int _read_short(uint8_t *code, int pc)
     return (high << 8) | low;      // Combine high and low bytes into a 16-bit short
 }
 
+// Reads the 32-bit operand of a wide instruction
+static inline int _read_int(uint8_t *code, int pc)
+{
+    return (_read_short(code, pc) << 16) | _read_short(code, pc + 2);
+}
+
 static UpValue *capture_upvalue(vm_t *vm, int index)
 {
     UpValue *prev = NULL;
@@ -502,6 +578,7 @@ static void remove_upvalue(vm_t *vm, int index)
     {
         upvalue->index = -1;
         upvalue->value = vm->stack[index];
+        write_barrier_value(vm, upvalue->value);
 
         if (prev == NULL)
             vm->openUpvalues = upvalue->next;
@@ -547,33 +624,39 @@ static Value bind(vm_t *vm, Function *function, Object *instance)
  */
 static Object *construct(vm_t *vm, PiMap *map, size_t argc, Value *argv)
 {
-    // Create a new table for the instance
-    table_t *table = ht_create(sizeof(Value));
-    char **keys = ht_keys(map->table);
-    int size = ht_length(map->table);
+    int size = map_size(map);
+
+    // Instances built from the same prototype share a shape, reached by
+    // adding the prototype keys (minus the constructor) in order.
+    Shape *shape = vm->shapes;
+    for (int i = 0; i < size; i++)
+    {
+        char *key = map_keyAt(map, i);
+        if (strcmp(key, "constructor") != 0)
+            shape = shape_add(shape, key);
+    }
 
     // Create a new map instance and set its prototype
-    Object *instance = new_map(table, true);
+    Object *instance = new_instance(shape);
 
     ((PiMap *)instance)->proto = map;
 
+    Value *fields = ((PiMap *)instance)->fields;
+    int slot = 0;
+
     // Iterate over the keys in the prototype map
-    for (size_t i = 0; i < size; i++)
+    for (int i = 0; i < size; i++)
     {
-
-        char *key = keys[i];
+        char *key = map_keyAt(map, i);
         if (strcmp(key, "constructor") != 0) // Skip the constructor key
         {
-            Value value = *(Value *)ht_get(map->table, key);
+            Value value = *map_valueAt(map, i);
             if (IS_FUN(value))
-            {
                 // Bind function to the new instance
-                Value fn = bind(vm, AS_FUN(value), instance);
-                ht_put(table, key, &fn);
-            }
+                fields[slot++] = bind(vm, AS_FUN(value), instance);
             else
                 // Copy non-function values directly
-                ht_put(table, key, ht_get(map->table, key));
+                fields[slot++] = value;
         }
     }
 
@@ -586,8 +669,8 @@ static Object *construct(vm_t *vm, PiMap *map, size_t argc, Value *argv)
     memcpy(fargs + 1, argv, sizeof(Value) * argc);
 
     // Invoke the constructor if it exists
-    void *item = ht_get(map->table, "constructor");
-    Value constructor = item ? *(Value *)item : NEW_NIL();
+    Value *item = map_lookup(map, "constructor");
+    Value constructor = item ? *item : NEW_NIL();
 
     if (IS_FUN(constructor))
     {
@@ -600,13 +683,108 @@ static Object *construct(vm_t *vm, PiMap *map, size_t argc, Value *argv)
     return instance;
 }
 
+/**
+ * Reads an item from a container (the `container[index]` operator).
+ *
+ * Lists and strings are indexed by number, maps by key. Reading a missing
+ * map key or any index of an empty list yields nil.
+ *
+ * @param vm The virtual machine instance.
+ * @param container The list, map or string to read from.
+ * @param index The index or key of the item.
+ * @return The item at the given index.
+ */
+static Value get_item(vm_t *vm, Value container, Value index)
+{
+    if (!IS_OBJ(container))
+        vm_error(vm, "Unsupported operand type for get item operator.\n");
+
+    switch (OBJ_TYPE(container))
+    {
+    case OBJ_LIST:
+    {
+        list_t *list = AS_LIST(container)->items;
+        if (list->size == 0)
+            return NEW_NIL();
+
+        int _index = as_number(index);
+        return list_value(list, _index); // Avoid unsafe memory access
+    }
+
+    case OBJ_MAP:
+        return map_get(AS_MAP(container), index); // NIL if key not found
+
+    case OBJ_STRING:
+    {
+        char *str = as_string(container);                      // Convert Value to char*
+        int _index = get_index(as_number(index), strlen(str)); // Convert index to int
+
+        // Convert the character to a string (newly allocated)
+        char *_char = malloc(2); // 1 char + null terminator
+        _char[0] = str[_index];
+        _char[1] = '\0';
+        free(str);
+        return NEW_OBJ(add_obj(vm, new_pistring(_char)));
+    }
+
+    case OBJ_ITER:
+        return iter_method(vm, AS_ITER(container), index); // it.map(f), it.take(n)...
+
+    default:
+        vm_error(vm, "Unsupported operand type for get item operator.\n");
+    }
+
+    return NEW_NIL();
+}
+
+/**
+ * Writes an item into a container (the `container[index] = value` operator).
+ *
+ * @param vm The virtual machine instance.
+ * @param container The list or map to write to.
+ * @param index The index or key of the item.
+ * @param value The value to store.
+ */
+static void set_item(vm_t *vm, Value container, Value index, Value value)
+{
+    if (!IS_OBJ(container))
+        vm_error(vm, "Unsupported operand type for set item operator.\n");
+
+    switch (OBJ_TYPE(container))
+    {
+    case OBJ_LIST:
+    {
+        PiList *list = AS_LIST(container);
+        int _index = get_index(as_number(index), list_size(list->items));
+
+        // Numbers stay packed, anything else unpacks the list
+        list_store(list, _index, value);
+        write_barrier(vm, AS_OBJ(container), value);
+        break;
+    }
+
+    case OBJ_MAP:
+        map_setDynamic(AS_MAP(container), index, value);
+        write_barrier(vm, AS_OBJ(container), value);
+        break;
+
+    case OBJ_STRING:
+        vm_error(vm, "Cannot modify immutable string.\n");
+        break;
+
+    default:
+        vm_error(vm, "Unsupported operand type for set item operator.\n");
+    }
+}
+
 void run(vm_t *vm)
 {
     int length = vm->code->size;
     int pc = vm->pc;
 
     uint8_t op;
-    uint16_t index;
+    int index;
+    int operand; // The second operand, for instructions that have two
     int address;
 
     uint8_t *code = (uint8_t *)vm->code->data;
@@ -638,6 +816,7 @@ void run(vm_t *vm)
             // Read a two-byte short value from the bytecode to get the constant index
             index = (code[pc++] << 8);
             index |= code[pc++];
+        load_const:;
             // Get the constant from the constants list using the index
             Value constant = *(Value *)list_getAt(vm->constants, index);
 
@@ -650,6 +829,7 @@ void run(vm_t *vm)
         case OP_STORE_GLOBAL:
         {
             index = code[pc++];
+        store_global:;
             char *name = read_name(vm, index);
 
             Value _newValue = pop_stack(vm);
@@ -661,6 +841,7 @@ void run(vm_t *vm)
         case OP_LOAD_GLOBAL:
         {
             index = code[pc++];
+        load_global:;
             char *name = string_get(vm->names, index);
             Value *_value = ht_get(vm->globals, name);
             if (_value == NULL)
@@ -674,16 +855,18 @@ void run(vm_t *vm)
 
         case OP_LOAD_LOCAL:
         {
-            op = code[pc++];
-            Value value = vm->stack[vm->bp + op];
+            index = code[pc++];
+        load_local:;
+            Value value = vm->stack[vm->bp + index];
             push_stack(vm, value);
             break;
         }
 
         case OP_STORE_LOCAL:
         {
-            op = code[pc++];
-            vm->stack[vm->bp + op] = pop_stack(vm);
+            index = code[pc++];
+        store_local:
+            vm->stack[vm->bp + index] = pop_stack(vm);
             break;
         }
 
@@ -695,8 +878,9 @@ void run(vm_t *vm)
         }
         case OP_POP_N:
         {
-            op = code[pc++];
-            for (int i = 0; i < op; i++)
+            index = code[pc++];
+        pop_n:
+            for (int i = 0; i < index; i++)
             {
                 remove_upvalue(vm, vm->sp - 1);
                 pop_stack(vm);
@@ -817,7 +1001,8 @@ void run(vm_t *vm)
                 if (IS_LIST(left))
                 {
                     PiList *list = AS_LIST(left);
-                    list_add(list->items, &right);
+                    list_push(list, right);
+                    write_barrier(vm, (Object *)list, right);
 
                     // --- Matrix integrity check ---
                     if (list->rows == 1 && list->cols >= 0)
@@ -857,7 +1042,7 @@ void run(vm_t *vm)
                     else
                     {
                         // Not originally a matrix, check if it can now become one
-                        if (list->items->size == 1 && IS_NUM(right) && IS_NUM(((Value *)list->items->data)[0]))
+                        if (list->items->size == 1 && IS_NUM(right) && IS_NUM(list_value(list->items, 0)))
                         {
                             list->is_numeric = true;
                             list->rows = 1;
@@ -890,10 +1075,10 @@ void run(vm_t *vm)
                         PiList *list = AS_LIST(left);
                         for (int i = 0; i < list_size(list->items); i++)
                         {
-                            Value item = *(Value *)list_getAt(list->items, i);
+                            Value item = list_value(list->items, i);
                             if (equals(item, right))
                             {
-                                list_remove(list->items, i);
+                                free(list_remove(list->items, i));
                                 break;
                             }
                         }
@@ -947,70 +1132,40 @@ void run(vm_t *vm)
                 {
                     if (IS_LIST(left) && IS_LIST(right))
                     {
-                        PiList *A = AS_LIST(left);
-                        PiList *B = AS_LIST(right);
-
-                        if (!A->is_numeric || !B->is_numeric)
-                            vm_error(vm, "Matrix multiplication requires numeric lists.");
-
-                        if (A->cols == -1 || B->cols == -1)
-                            vm_error(vm, "Matrix dimensions are not set properly.");
-
-                        if (A->cols != B->rows)
-                            vm_error(vm, "Matrix multiplication dimension mismatch.");
-
-                        int m = A->rows;
-                        int n = A->cols;
-                        int p = B->cols;
-
-                        list_t *result = list_create(sizeof(Value));
-
-                        for (int i = 0; i < m; i++)
-                        {
-                            Value *rowA_val = (Value *)list_getAt(A->items, i);
-                            list_t *rowA = as_list(*rowA_val);
-                            list_t *temp = list_create(sizeof(Value));
-
-                            for (int j = 0; j < p; j++)
-                            {
-                                double sum = 0.0;
-
-                                for (int k = 0; k < n; k++)
-                                {
-                                    // Get A[i][k]
-                                    Value *a_val = (Value *)list_getAt(rowA, k);
-                                    double a = as_number(*a_val);
-
-                                    // Get B[k][j]
-                                    Value *rowB_val = (Value *)list_getAt(B->items, k);
-                                    list_t *rowB = as_list(*rowB_val);
-                                    Value *b_val = (Value *)list_getAt(rowB, j);
-                                    double b = as_number(*b_val);
-
-                                    sum += a * b;
-                                }
-
-                                list_add(temp, &NEW_NUM(sum));
-                            }
-
-                            list_add(result, &NEW_OBJ(new_list(temp)));
-                        }
-
-                        Object *res_obj = add_obj(vm, new_list(result));
-                        ((PiList *)res_obj)->is_numeric = true;
-                        ((PiList *)res_obj)->rows = m;
-                        ((PiList *)res_obj)->cols = p;
-                        push_stack(vm, NEW_OBJ(res_obj));
+                        Value product = mat_product(vm, AS_LIST(left), AS_LIST(right));
+                        push_stack(vm, NEW_OBJ(add_obj(vm, AS_OBJ(product))));
                         break;
                     }
                     else if (IS_LIST(left))
                     {
                         int count = (int)as_number(right); // Assuming `right` is a number
-                        list_t *list = as_list(left);      // Assuming `as_list` returns a `list_t *`
+                        list_t *list = AS_LIST(left)->items; // Repeated as is, packed or not
+                        int size = count > 0 ? list->size * count : 0;
 
                         list_t *result = list_create(list->i_size);
-                        for (int i = 0; i < count; i++)
-                            list_addAll(result, list);
+                        if (size > result->capacity)
+                            list_expand(result, size);
+
+                        if (LIST_PACKED(list) && list->size == 1)
+                        {
+                            // [x] * n: fill the packed items
+                            double fill = *(double *)list->data;
+                            double *items = (double *)result->data;
+                            for (int i = 0; i < size; i++)
+                                items[i] = fill;
+                        }
+                        else if (size > 0)
+                        {
+                            // Copy the list once, then double the copied part
+                            memcpy(result->data, list->data, list->size * list->i_size);
+                            for (int done = list->size; done < size;)
+                            {
+                                int chunk = done < size - done ? done : size - done;
+                                memcpy((byte *)result->data + done * list->i_size, result->data, chunk * list->i_size);
+                                done += chunk;
+                            }
+                        }
+                        result->size = size;
 
                         Object *_result = new_list(result);
                         if (AS_LIST(left)->is_numeric)
@@ -1085,15 +1240,15 @@ void run(vm_t *vm)
                     push_stack(vm, NEW_NUM((int)as_number(left) & (int)as_number(right)));
                 else if (left.type == VAL_OBJ && OBJ_TYPE(left) == OBJ_LIST)
                 {
-                    list_t *list = as_list(left);
-                    list_t *result = list_create(sizeof(Value));
+                    list_t *list = AS_LIST(left)->items;
+                    list_t *result = list_create(sizeof(double));
 
                     int _right = (int)as_number(right);
 
                     for (int i = 0; i < list_size(list); i++)
                     {
-                        Value item = *(Value *)list_getAt(list, i);
-                        list_add(result, &NEW_NUM((int)as_number(item) & _right));
+                        double item = (int)as_number(list_value(list, i)) & _right;
+                        list_add(result, &item);
                     }
                     push_stack(vm, NEW_OBJ(add_obj(vm, new_list(result))));
                 }
@@ -1109,15 +1264,15 @@ void run(vm_t *vm)
                     push_stack(vm, NEW_NUM((int)as_number(left) | (int)as_number(right)));
                 else if (left.type == VAL_OBJ && OBJ_TYPE(left) == OBJ_LIST)
                 {
-                    list_t *list = as_list(left);
-                    list_t *result = list_create(sizeof(Value));
+                    list_t *list = AS_LIST(left)->items;
+                    list_t *result = list_create(sizeof(double));
 
                     int _right = (int)as_number(right);
 
                     for (int i = 0; i < list_size(list); i++)
                     {
-                        Value item = *(Value *)list_getAt(list, i);
-                        list_add(result, &NEW_NUM((int)as_number(item) | _right));
+                        double item = (int)as_number(list_value(list, i)) | _right;
+                        list_add(result, &item);
                     }
                     push_stack(vm, NEW_OBJ(add_obj(vm, new_list(result))));
                 }
@@ -1141,17 +1296,20 @@ void run(vm_t *vm)
                     if (list_size(l_list->items) != 3 || list_size(r_list->items) != 3)
                         vm_error(vm, "Cross product is defined for 3-dimensional vectors only.");
 
-                    Value *a = l_list->items->data;
-                    Value *b = r_list->items->data;
+                    double a[3], b[3];
+                    for (int i = 0; i < 3; i++)
+                    {
+                        a[i] = as_number(list_value(l_list->items, i));
+                        b[i] = as_number(list_value(r_list->items, i));
+                    }
 
-                    double x = as_number(a[1]) * as_number(b[2]) - as_number(a[2]) * as_number(b[1]);
-                    double y = as_number(a[2]) * as_number(b[0]) - as_number(a[0]) * as_number(b[2]);
-                    double z = as_number(a[0]) * as_number(b[1]) - as_number(a[1]) * as_number(b[0]);
+                    double xyz[3] = {a[1] * b[2] - a[2] * b[1],
+                                     a[2] * b[0] - a[0] * b[2],
+                                     a[0] * b[1] - a[1] * b[0]};
 
-                    list_t *res = list_create(sizeof(Value));
-                    list_add(res, &NEW_NUM(x));
-                    list_add(res, &NEW_NUM(y));
-                    list_add(res, &NEW_NUM(z));
+                    list_t *res = list_create(sizeof(double));
+                    for (int i = 0; i < 3; i++)
+                        list_add(res, &xyz[i]);
 
                     push_stack(vm, NEW_OBJ(add_obj(vm, new_list(res))));
                     break;
@@ -1161,15 +1319,15 @@ void run(vm_t *vm)
 
                 else if (left.type == VAL_OBJ && OBJ_TYPE(left) == OBJ_LIST)
                 {
-                    list_t *list = as_list(left);
-                    list_t *result = list_create(sizeof(Value));
+                    list_t *list = AS_LIST(left)->items;
+                    list_t *result = list_create(sizeof(double));
 
                     int _right = (int)as_number(right);
 
                     for (int i = 0; i < list_size(list); i++)
                     {
-                        Value item = *(Value *)list_getAt(list, i);
-                        list_add(result, &NEW_NUM((int)as_number(item) ^ _right));
+                        double item = (int)as_number(list_value(list, i)) ^ _right;
+                        list_add(result, &item);
                     }
                     push_stack(vm, NEW_OBJ(add_obj(vm, new_list(result))));
                 }
@@ -1186,15 +1344,15 @@ void run(vm_t *vm)
 
                 else if (left.type == VAL_OBJ && OBJ_TYPE(left) == OBJ_LIST)
                 {
-                    list_t *list = as_list(left);
-                    list_t *result = list_create(sizeof(Value));
+                    list_t *list = AS_LIST(left)->items;
+                    list_t *result = list_create(sizeof(double));
 
                     int _right = (int)as_number(right);
 
                     for (int i = 0; i < list_size(list); i++)
                     {
-                        Value item = *(Value *)list_getAt(list, i);
-                        list_add(result, &NEW_NUM((int)as_number(item) << _right));
+                        double item = (int)as_number(list_value(list, i)) << _right;
+                        list_add(result, &item);
                     }
                     push_stack(vm, NEW_OBJ(add_obj(vm, new_list(result))));
                 }
@@ -1211,15 +1369,15 @@ void run(vm_t *vm)
 
                 else if (left.type == VAL_OBJ && OBJ_TYPE(left) == OBJ_LIST)
                 {
-                    list_t *list = as_list(left);
-                    list_t *result = list_create(sizeof(Value));
+                    list_t *list = AS_LIST(left)->items;
+                    list_t *result = list_create(sizeof(double));
 
                     int _right = (int)as_number(right);
 
                     for (int i = 0; i < list_size(list); i++)
                     {
-                        Value item = *(Value *)list_getAt(list, i);
-                        list_add(result, &NEW_NUM((int)as_number(item) >> _right));
+                        double item = (int)as_number(list_value(list, i)) >> _right;
+                        list_add(result, &item);
                     }
                     push_stack(vm, NEW_OBJ(add_obj(vm, new_list(result))));
                 }
@@ -1236,15 +1394,15 @@ void run(vm_t *vm)
 
                 else if (left.type == VAL_OBJ && OBJ_TYPE(left) == OBJ_LIST)
                 {
-                    list_t *list = as_list(left);
-                    list_t *result = list_create(sizeof(Value));
+                    list_t *list = AS_LIST(left)->items;
+                    list_t *result = list_create(sizeof(double));
 
                     uint32_t _right = (uint32_t)as_number(right);
 
                     for (int i = 0; i < list_size(list); i++)
                     {
-                        Value item = *(Value *)list_getAt(list, i);
-                        list_add(result, &NEW_NUM((uint32_t)as_number(item) >> _right));
+                        double item = (uint32_t)as_number(list_value(list, i)) >> _right;
+                        list_add(result, &item);
                     }
                     push_stack(vm, NEW_OBJ(add_obj(vm, new_list(result))));
                 }
@@ -1271,11 +1429,22 @@ void run(vm_t *vm)
                         vm_error(vm, "Dot product requires lists of the same length.");
 
                     double result = 0;
-                    for (int i = 0; i < l_size; i++)
+                    if (LIST_PACKED(l_list->items) && LIST_PACKED(r_list->items))
                     {
-                        Value a = *(Value *)list_getAt(l_list->items, i);
-                        Value b = *(Value *)list_getAt(r_list->items, i);
-                        result += as_number(a) * as_number(b);
+                        // Packed vectors: no type checks in the loop
+                        double *a = l_list->items->data;
+                        double *b = r_list->items->data;
+                        for (int i = 0; i < l_size; i++)
+                            result += a[i] * b[i];
+                    }
+                    else
+                    {
+                        for (int i = 0; i < l_size; i++)
+                        {
+                            Value a = list_value(l_list->items, i);
+                            Value b = list_value(r_list->items, i);
+                            result += as_number(a) * as_number(b);
+                        }
                     }
                     push_stack(vm, NEW_NUM(result));
                     break;
@@ -1364,6 +1533,12 @@ void run(vm_t *vm)
                     case OBJ_MAP:
                         push_stack(vm, NEW_NUM(map_size(AS_MAP(operand))));
                         break;
+                    case OBJ_SET:
+                        push_stack(vm, NEW_NUM(AS_SET(operand)->size));
+                        break;
+                    case OBJ_HEAP:
+                        push_stack(vm, NEW_NUM(AS_HEAP(operand)->size));
+                        break;
                     }
                 }
                 else
@@ -1385,11 +1560,56 @@ void run(vm_t *vm)
 
             break;
         }
+        case OP_CALL_BUILTIN:
+        {
+            // Bound at compile time: the arguments are on the stack, without a callee
+            index = code[pc++];
+            operand = code[pc++];
+        call_builtin:;
+            int num_args = operand;
+            int slot = vm->sp - num_args;
+
+            vm->pc = pc;
+            Value result = builtin_functions[index].func(vm, num_args, &vm->stack[slot]);
+            if (IS_OBJ(result))
+                add_obj(vm, AS_OBJ(result));
+
+            vm->sp = slot;
+            push_stack(vm, result);
+            break;
+        }
+
+        case OP_CALL_NATIVE:
+        {
+            // The callee was a built-in at compile time, so unless the global
+            // has been reassigned it is called on its arguments in place
+            uint8_t num_args = code[pc];
+            int slot = vm->sp - num_args - 1;
+            Value callee = vm->stack[slot];
+
+            if (IS_FUN(callee) && AS_FUN(callee)->is_native && !AS_FUN(callee)->is_method)
+            {
+                pc++;
+                vm->pc = pc;
+
+                // The arguments stay on the stack, so they are rooted during the call
+                Value result = AS_FUN(callee)->native(vm, num_args, &vm->stack[slot + 1]);
+                if (IS_OBJ(result))
+                    add_obj(vm, AS_OBJ(result));
+
+                vm->stack[slot] = result;
+                vm->sp = slot + 1;
+                break;
+            }
+        }
+            // fall through
         case OP_CALL_FUNCTION:
         {
 
             // Read the number of arguments from the bytecode
-            uint8_t num_args = code[pc++];
+            index = code[pc++];
+        call_function:;
+            int num_args = index;
 
             // Allocate memory for the arguments
             Value args[num_args];
@@ -1458,15 +1678,33 @@ void run(vm_t *vm)
 
             iter = vm->iters[vm->iter_sp];
 
+            // Pipelines run their stage functions as they are pulled, and
+            // generators their body
+            if (iter->type == OBJ_ITER || iter->type == OBJ_GEN)
+            {
+                vm->pc = pc;
+                if (iter->type == OBJ_ITER ? iter_pull(vm, (PiIter *)iter, &value)
+                                           : gen_resume(vm, (PiGen *)iter, &value))
+                {
+                    push_stack(vm, value);
+                    pc += 2;
+                }
+                else
+                {
+                    vm->iter_sp--;
+                    pc += address - 1;
+                }
+                break;
+            }
+
             // Check if the iterator has more elements
             if (iter_hasNext(iter))
             {
                 if (iter->type == OBJ_MAP)
                 {
                     PiMap *map = (PiMap *)iter;
-                    ht_next(&map->it);
-                    char *key = map->it.key;
-                    push_stack(vm, NEW_OBJ(add_obj(vm, new_pistring(key))));
+                    char *key = map_keyAt(map, map->current++);
+                    push_stack(vm, NEW_OBJ(add_obj(vm, new_pistring(string_copy(key)))));
                 }
                 else
                 {
@@ -1530,11 +1768,16 @@ void run(vm_t *vm)
 
         case OP_PUSH_LIST:
         {
-            int numElements = (code[pc++] << 8) | code[pc++];
-            list_t *list = list_create(sizeof(Value));
+            index = (code[pc++] << 8);
+            index |= code[pc++];
+        push_list:;
+            int numElements = index;
+            list_t *list;
 
             if (numElements == 0)
             {
+                // An empty list is numeric: it stays packed until it gets a non-number
+                list = list_create(sizeof(double));
                 Object *l_obj = add_obj(vm, new_list(list));
                 PiList *plist = (PiList *)l_obj;
                 plist->is_numeric = true;
@@ -1551,13 +1794,19 @@ void run(vm_t *vm)
             bool is_matrix = true;
             int rows = -1, cols = -1;
 
-            // First: collect all values and add to list
+            for (int i = 0; i < numElements && is_numeric; i++)
+                if (!IS_NUM(vm->stack[vm->sp + i]))
+                    is_numeric = false;
+
+            // Collect all values, as packed doubles if they are all numbers
+            list = list_create(is_numeric ? sizeof(double) : sizeof(Value));
             for (int i = 0; i < numElements; i++)
             {
                 Value v = vm->stack[vm->sp + i];
-                if (is_numeric && !IS_NUM(v))
-                    is_numeric = false;
-                list_add(list, &v);
+                if (is_numeric)
+                    list_add(list, &AS_NUM(v));
+                else
+                    list_add(list, &v);
             }
 
             if (is_numeric)
@@ -1615,8 +1864,10 @@ void run(vm_t *vm)
         {
 
             // Read the number of elements in the map
-            int numElements = code[pc++] << 8;
-            numElements |= code[pc++];
+            index = code[pc++] << 8;
+            index |= code[pc++];
+        push_map:;
+            int numElements = index;
             // create a new hashtable
             table_t *table = ht_create(sizeof(Value));
 
@@ -1647,7 +1898,9 @@ void run(vm_t *vm)
         case OP_PUSH_FUNCTION:
         {
             // Read the number of parameters
-            int numParams = code[pc++];
+            index = code[pc++];
+        push_function:;
+            int numParams = index;
 
             ObjCode *body = AS_CODE(pop_stack(vm));
             char *name = AS_CSTRING(pop_stack(vm));
@@ -1675,9 +1928,12 @@ void run(vm_t *vm)
 
         case OP_PUSH_CLOSURE:
         {
-            int numParams = code[pc++];
+            index = code[pc++];
             // Read the number of upvalues
-            int numUpvalues = code[pc++];
+            operand = code[pc++];
+        push_closure:;
+            int numParams = index;
+            int numUpvalues = operand;
 
             UpValue **upvalues = ALLOCATE(UpValue *, numUpvalues + 1);
 
@@ -1722,7 +1978,8 @@ void run(vm_t *vm)
 
         case OP_LOAD_UPVALUE:
         {
-            int index = code[pc++];
+            index = code[pc++];
+        load_upvalue:;
             UpValue *upValue = function->upvalues[index];
             if (upValue->index != -1)
                 push_stack(vm, vm->stack[upValue->index]);
@@ -1733,12 +1990,16 @@ void run(vm_t *vm)
 
         case OP_STORE_UPVALUE:
         {
-            int index = code[pc++];
+            index = code[pc++];
+        store_upvalue:;
             UpValue *upValue = function->upvalues[index];
             if (upValue->index != -1)
                 vm->stack[upValue->index] = pop_stack(vm);
             else
-                function->upvalues[index]->value = pop_stack(vm);
+            {
+                upValue->value = pop_stack(vm);
+                write_barrier_value(vm, upValue->value);
+            }
             break;
         }
 
@@ -1763,7 +2024,7 @@ void run(vm_t *vm)
                     double end_num = as_number(end);
                     Value slice = get_slice(AS_OBJ(sequence), as_number(start), as_number(end),
                                             IS_NIL(step) ? 1.0 : as_number(step));
-                    push_stack(vm, slice); // Push the slice onto the stack
+                    push_stack(vm, NEW_OBJ(add_obj(vm, AS_OBJ(slice)))); // Push the slice onto the stack
                 }
                 else
                     vm_error(vm, "Slice operand must be a list or string.");
@@ -1777,90 +2038,95 @@ void run(vm_t *vm)
             Value index = pop_stack(vm);     // Get the index from the stack
             Value container = pop_stack(vm); // Get the container from the stack
 
-            if (!IS_OBJ(container))
-                vm_error(vm, "Unsupported operand type for get item operator.\n");
+            push_stack(vm, get_item(vm, container, index));
+            break;
+        }
 
-            switch (OBJ_TYPE(container))
-            {
-            case OBJ_LIST:
-            {
-                list_t *list = as_list(container);
-                if (list->size == 0)
-                    push_stack(vm, NEW_NIL());
-                else
-                {
-                    int _index = as_number(index);
-                    Value item = *(Value *)list_getAt(list, _index);
-                    push_stack(vm, item); // Avoid unsafe memory access
-                }
-                break;
-            }
-            case OBJ_MAP:
-            {
-                table_t *table = AS_MAP(container)->table;
+        case OP_SET_ITEM:
+        {
+            Value index = pop_stack(vm);     // The index/key
+            Value container = pop_stack(vm); // The container (list/map)
+            Value value = pop_stack(vm);     // The value to set
 
-                // Value item = *(Value *)ht_get(table, as_string(index));
-                Value item = map_get(AS_MAP(container), index);
-                push_stack(vm, item); // Push NIL if key not found
-                break;
-            }
+            set_item(vm, container, index, value);
+            break;
+        }
+
+        case OP_GET_FIELD:
+        {
+            // Read the key constant and the inline cache of this site
+            index = (code[pc] << 8) | code[pc + 1];
+            operand = (code[pc + 2] << 8) | code[pc + 3];
+            pc += 4;
+        get_field:;
+            int ic = operand;
 
-            case OBJ_STRING:
+            Value key = *(Value *)list_getAt(vm->constants, index);
+            Value container = pop_stack(vm);
+
+            if (IS_MAP(container) && AS_MAP(container)->shape && ic < vm->ic_count)
             {
+                PiMap *map = AS_MAP(container);
+                InlineCache *cache = &vm->ics[ic];
 
-                char *str = as_string(container);                      // Convert Value to char*
-                int _index = get_index(as_number(index), strlen(str)); // Convert index to int
+                // Cache miss: resolve the slot once and remember it for this shape
+                if (cache->shape != map->shape)
+                {
+                    int slot = shape_slot(map->shape, AS_CSTRING(key));
+                    if (slot < 0)
+                    {
+                        push_stack(vm, NEW_NIL());
+                        break;
+                    }
+                    cache->shape = map->shape;
+                    cache->slot = slot;
+                }
 
-                // Convert the character to a string (newly allocated)
-                char *_char = malloc(2); // 1 char + null terminator
-                _char[0] = str[_index];
-                _char[1] = '\0';
-                push_stack(vm, NEW_OBJ(add_obj(vm, new_pistring(_char))));
-                free(str);
+                push_stack(vm, map->fields[cache->slot]);
                 break;
             }
 
-            default:
-                vm_error(vm, "Unsupported operand type for get item operator.\n");
-            }
+            push_stack(vm, get_item(vm, container, key));
             break;
         }
 
-        case OP_SET_ITEM:
+        case OP_SET_FIELD:
         {
-            Value index = pop_stack(vm);     // The index/key
-            Value container = pop_stack(vm); // The container (list/map)
-            Value value = pop_stack(vm);     // The value to set
-
-            if (!IS_OBJ(container))
-                vm_error(vm, "Unsupported operand type for set item operator.\n");
+            // Read the key constant and the inline cache of this site
+            index = (code[pc] << 8) | code[pc + 1];
+            operand = (code[pc + 2] << 8) | code[pc + 3];
+            pc += 4;
+        set_field:;
+            int ic = operand;
+
+            Value key = *(Value *)list_getAt(vm->constants, index);
+            Value container = pop_stack(vm);
+            Value value = pop_stack(vm);
 
-            switch (OBJ_TYPE(container))
+            if (IS_MAP(container) && AS_MAP(container)->shape && ic < vm->ic_count)
             {
-            case OBJ_LIST:
-            {
-                list_t *list = as_list(container);
-                int _index = get_index(as_number(index), list_size(list));
+                PiMap *map = AS_MAP(container);
+                InlineCache *cache = &vm->ics[ic];
 
-                list_set(list, _index, &value);
-                break;
-            }
+                write_barrier(vm, (Object *)map, value);
 
-            case OBJ_MAP:
-            {
-                table_t *table = AS_MAP(container)->table;
+                if (cache->shape == map->shape)
+                {
+                    map->fields[cache->slot] = value;
+                    break;
+                }
 
-                map_set(AS_MAP(container), index, value);
+                // Adding a new key moves the instance to another shape
+                map_put(map, AS_CSTRING(key), value);
+                if (map->shape)
+                {
+                    cache->shape = map->shape;
+                    cache->slot = shape_slot(map->shape, AS_CSTRING(key));
+                }
                 break;
             }
 
-            case OBJ_STRING:
-                vm_error(vm, "Cannot modify immutable string.\n");
-                break;
-
-            default:
-                vm_error(vm, "Unsupported operand type for set item operator.\n");
-            }
+            set_item(vm, container, key, value);
             break;
         }
 
@@ -1872,24 +2138,25 @@ void run(vm_t *vm)
             for (int i = vm->sp - 1; i >= vm->bp; i--)
                 remove_upvalue(vm, i);
 
-            Frame *frame = pop_frame(vm);
-
-            while (vm->iter_sp > frame->iters_top)
-                vm->iter_sp--;
+            leave_frame(vm);
+            push_stack(vm, retval);
 
-            if (vm->iter_sp != -1)
-                iter = vm->iters[vm->iter_sp];
+            return;
+        }
 
-            vm->pc = frame->pc;
-            vm->bp = frame->bp;
-            vm->sp = frame->sp;
-            vm->ip = frame->ip;
+        case OP_YIELD:
+        {
+            // Save the frame of the generator and hand the value to the caller
+            Value yielded = pop_stack(vm);
 
-            vm->code = frame->code;
+            Frame *frame = vm->frame_sp > 0 ? vm->frames[vm->frame_sp - 1] : NULL;
+            if (frame == NULL || frame->generator == NULL)
+                vm_error(vm, "'yield' outside of a generator.");
 
-            free_frame(frame);
+            gen_suspend(vm, (PiGen *)frame->generator, pc);
 
-            push_stack(vm, retval);
+            leave_frame(vm);
+            push_stack(vm, yielded);
 
             return;
         }
@@ -1901,6 +2168,74 @@ void run(vm_t *vm)
             return;
         }
 
+        case OP_WIDE:
+        {
+            // The next instruction has its operands twice as wide: 16-bit
+            // instead of 8-bit, 32-bit instead of 16-bit
+            op = code[pc++];
+            switch ((OpCode)op)
+            {
+            case OP_LOAD_CONST:
+                index = _read_int(code, pc);
+                pc += 4;
+                goto load_const;
+            case OP_PUSH_LIST:
+                index = _read_int(code, pc);
+                pc += 4;
+                goto push_list;
+            case OP_PUSH_MAP:
+                index = _read_int(code, pc);
+                pc += 4;
+                goto push_map;
+            case OP_GET_FIELD:
+            case OP_SET_FIELD:
+                index = _read_int(code, pc);
+                operand = _read_int(code, pc + 4);
+                pc += 8;
+                if (op == OP_GET_FIELD)
+                    goto get_field;
+                goto set_field;
+            case OP_CALL_BUILTIN:
+            case OP_PUSH_CLOSURE:
+                index = _read_short(code, pc);
+                operand = _read_short(code, pc + 2);
+                pc += 4;
+                if (op == OP_CALL_BUILTIN)
+                    goto call_builtin;
+                goto push_closure;
+            default:
+                break;
+            }
+
+            index = _read_short(code, pc);
+            pc += 2;
+            switch ((OpCode)op)
+            {
+            case OP_STORE_GLOBAL:
+                goto store_global;
+            case OP_LOAD_GLOBAL:
+                goto load_global;
+            case OP_LOAD_LOCAL:
+                goto load_local;
+            case OP_STORE_LOCAL:
+                goto store_local;
+            case OP_POP_N:
+                goto pop_n;
+            case OP_LOAD_UPVALUE:
+                goto load_upvalue;
+            case OP_STORE_UPVALUE:
+                goto store_upvalue;
+            case OP_CALL_NATIVE:
+            case OP_CALL_FUNCTION:
+                goto call_function;
+            case OP_PUSH_FUNCTION:
+                goto push_function;
+            default:
+                vm_errorf(vm, "Unknown wide opcode: [%d]", op);
+            }
+            break;
+        }
+
         case OP_NO:
             break;
 
@@ -1920,45 +2255,9 @@ void run(vm_t *vm)
             vm->pc = pc;
         }
 
-#ifdef __EMSCRIPTEN__
-// Allocation-driven threshold to avoid collecting on instruction-heavy loops.
+        // Allocation-driven threshold to avoid collecting on instruction-heavy loops.
         if (vm->counter >= vm->next_gc)
-        {
-            run_gc(vm);
-            vm->counter = 0;
-        }
-#else
-        if (vm->counter >= vm->next_gc)
-        {
-            int before = count_objs(vm);
-            run_gc(vm);
-            int after = count_objs(vm);
-            int collected = before - after;
-
-            vm->counter = 0;
-
-            // Adapt threshold to avoid over-collecting in long-running loops.
-            if (collected <= 0)
-                vm->next_gc += vm->next_gc / 2; // GC reclaimed nothing: back off.
-            else
-                vm->next_gc = after + (after / 2); // Target ~1.5x live set allocations.
-            vm->obj_count = after;
-
-            // Clamp bounds (prevent very frequent or very rare GC).
-            if (vm->next_gc < GC_MIN_THRESHOLD)
-                vm->next_gc = GC_MIN_THRESHOLD;
-            else if (vm->next_gc > GC_MAX_THRESHOLD)
-                vm->next_gc = GC_MAX_THRESHOLD;
-
-#ifdef DEBUG
-            printf("[DEBUG] SP: %d\n", vm->sp);
-            printf("[GC] Running garbage collection...\n");
-            printf("[GC] Before: %d objects in memory\n", before);
-            printf("[GC] After: %d objects in memory\n", after);
-            printf("[GC] Collected: %d, Next threshold: %d\n", collected, vm->next_gc);
-#endif
-        }
-#endif
+            collect(vm);
         vm->pc = pc;
     }
 }
@@ -1983,6 +2282,16 @@ void free_vm(vm_t *vm)
     // Free the memory allocated for the global hash table
     ht_free(vm->globals);
 
+    free(vm->ics);
+    free_shape(vm->shapes);
+
+    gc_workers_destroy(vm->gc_workers);
+    gc_stats_free(&vm->gc_stats);
+    free(vm->remembered);
+    free(vm->gc_stack.items);
+    free(vm->mark_stack.items);
+    pool_destroy(vm->pool);
+
     // Free the memory allocated for the mutex
     pthread_mutex_destroy(&vm->lock);
 
@@ -12,15 +12,42 @@
 #include "screen.h"
 #include "pi_frame.h"
 #include "cart.h"
+#include "pi_pool.h"
+#include "gc_stats.h"
 
 #define STACK_MAX 1024 // max stack size
 #define ITER_MAX 256   // max iterator stack size
 
 #define RUN_STEPS 1024 // max number of instructions to run
 
-// Initial GC threshold (number of newly allocated VM objects).
+// Nursery size: number of newly allocated VM objects that triggers a minor collection.
 #define NEXT_GC 4096
 
+// Bounds on how much the old generation may grow between full collections.
+#define GC_MIN_THRESHOLD 4096
+#define GC_MAX_THRESHOLD (1024 * 1024 * 8)
+
+// Default time budget of one incremental GC slice, in milliseconds.
+#define GC_BUDGET 0.5
+
+// Phase of the incremental full collection.
+typedef enum
+{
+    GC_IDLE,     // No full collection in progress
+    GC_MARKING,  // Tracing the heap from the gray stack
+    GC_SWEEPING, // Freeing the dead objects of the old generation
+} GCPhase;
+
+typedef struct GCWorkers GCWorkers;
+
+// Growable stack of objects waiting to be scanned by the collector.
+typedef struct
+{
+    Object **items;
+    int count;
+    int capacity;
+} MarkStack;
+
 typedef struct
 {
     int pc; // Program Counter: Points to the current instruction being executed.
@@ -41,7 +68,14 @@ typedef struct
 
     table_t *globals; // Hash table storing global variables.
 
-    Object *objects; // Linked list of dynamically allocated objects (for garbage collection).
+    Object *objects;     // Young generation: objects allocated since the last collection.
+    Object *old_objects; // Old generation: objects that survived at least one collection.
+    int old_count;       // Number of objects in the old generation.
+    int next_major;      // Old generation size that triggers the next full collection.
+
+    Object **remembered;     // Remembered set: young objects referenced from the old generation.
+    int remembered_count;    // Number of objects in the remembered set.
+    int remembered_capacity; // Allocated size of the remembered set.
 
     Object *iters[STACK_MAX]; // Iterator stack to support loops and iteration constructs.
     int iter_sp;              // Iterator Stack Pointer: Tracks the top of the iterator stack.
@@ -62,13 +96,29 @@ typedef struct
 
     int counter;
 
-    table_t *instrs; // PiList of instruction metadata
+    list_t *lines; // Line table of the global code
 
     int next_gc; // Next garbage collection threshold
-    list_t *gc_stack;
+    MarkStack gc_stack;     // Gray stack of the incremental marker
+    MarkStack mark_stack;   // Pending objects of a non-incremental mark
+    GCPhase gc_phase;       // Phase of the current full collection
+    Object *sweep_objects;  // Old objects not yet swept by the current full collection
+    Object *gc_scan;        // Large list being scanned in chunks (NULL if none)
+    int gc_scan_index;      // Next element of gc_scan to scan
+    double gc_budget;       // Time budget of one incremental slice (ms)
+    int gc_threads;         // Threads used by the collector, the VM thread included
+    GCWorkers *gc_workers;  // Helper threads (created on first use)
+    Object *dead_cells;     // Cells freed by the background sweeper, not yet back in the pool
+    GCStats gc_stats;       // Collector counters, reported by gc_stats()
 
     int obj_count;
 
+    pool_t *pool; // Size-class allocator for object headers
+
+    Shape *shapes;     // Root of the instance shape tree
+    InlineCache *ics;  // Inline caches of the constant-key field access sites
+    int ic_count;      // Number of inline caches
+
     Cart *cart; // Pointer to the loaded cartridge, if any.
 
     Uint32 frameInterval_ms; // Target frame interval for draw pacing (0 = uncapped)
@@ -3,14 +3,25 @@
 
 #include "string.h"
 
-String *new_string(char *data)
+String *new_string(const char *data)
 {
     String *result = malloc(sizeof(String));
-    result->data = strdup(data);
+    result->data = string_copy(data);
     result->length = strlen(data);
     return result;
 }
 
+/**
+ * Returns a heap copy of a C string (strdup is not part of C99).
+ */
+char *string_copy(const char *data)
+{
+    size_t size = strlen(data) + 1;
+    char *copy = malloc(size);
+    memcpy(copy, data, size);
+    return copy;
+}
+
 char *string_get(list_t *list, int index)
 {
     String *str = (String *)list_getAt(list, index);
@@ -12,7 +12,8 @@ typedef struct
 } String;
 
 
-String *new_string(char *data);
+String *new_string(const char *data);
+char *string_copy(const char *data);
 char *string_get(list_t *list, int index);
 void free_strings(list_t *list);
 void free_string(String *str);